@@ -21,6 +21,14 @@ const calculateWaterUsed = (durationSeconds: number): number => {
   return Math.round(durationSeconds * PUMP_FLOW_RATE_LPS * 100) / 100;
 };
 
+// Diferencia entre dos lecturas de un contador acumulado del ESP32. Si el
+// contador bajó (corte de luz antes de guardarlo en NVS, canal re-vinculado)
+// lo que falta ya se sumó antes: se toma como nuevo origen sin sumar nada.
+const counterDelta = (current: number, previous: unknown): number => {
+  const base = typeof previous === 'number' ? previous : 0;
+  return current >= base ? current - base : 0;
+};
+
 // Calcular offset de timezone basado en longitud (cada 15° = 1 hora)
 const getTimezoneOffsetFromLongitude = (longitude: number): number => {
   return Math.round(longitude / 15);
@@ -71,170 +79,298 @@ const shouldTriggerSchedule = (schedules: any[], config: any): { shouldTrigger:
   return { shouldTrigger: false, schedule: null };
 };
 
-// ESP32 envía datos de sensores
-router.post('/sensor-data', async (req, res) => {
-  try {
-    const { zoneId, sensors } = req.body;
+// Calidad que el ESP32 adjunta a cada lectura filtrada (sensors.quality).
+// Un campo ausente es "ok"; "invalid" llega con valor null y no se usa.
+type SensorQuality = 'ok' | 'filtered' | 'held' | 'invalid';
 
-    if (!zoneId || !sensors) {
-      return res.status(400).json({ error: 'Datos inválidos' });
-    }
+const isUsableReading = (sensors: any, field: string): boolean => {
+  const quality: SensorQuality | undefined = sensors?.quality?.[field];
+  return quality !== 'invalid' && sensors?.[field] !== null && sensors?.[field] !== undefined;
+};
 
-    const zone = await Zone.findByPk(zoneId);
-    if (!zone) {
-      return res.status(404).json({ 
-        error: 'Zona no encontrada',
-        pairingRequired: true 
-      });
-    }
+// Une los sensores compartidos del nodo con los de una zona. La calidad
+// acompaña al valor: si la zona trae su propio valor (p.ej. una hoja
+// ESP-NOW con su tanque), la calidad compartida de ese campo se descarta.
+const mergeZoneSensors = (shared: any, own: any): any => {
+  const quality: Record<string, SensorQuality> = { ...(shared.quality || {}) };
+  for (const field of Object.keys(own)) {
+    delete quality[field];
+  }
+  Object.assign(quality, own.quality || {});
+  return { ...shared, ...own, quality };
+};
 
-    const currentStatus = (zone.status as any) || {};
-    const currentSensors = (zone.sensors as any) || {};
-    const config = (zone.config as any) || {};
-    
-    const manualPumpCommand = currentStatus.manualPumpCommand;
-
-    const updatedSensors = {
-      ...currentSensors,
-      temperature: sensors.temperature ?? currentSensors.temperature,
-      soilMoisture: sensors.soilMoisture ?? currentSensors.soilMoisture,
-      waterLevel: sensors.waterLevel ?? currentSensors.waterLevel,
-      lightLevel: sensors.lightLevel ?? currentSensors.lightLevel,
-      tankLevel: sensors.waterLevel ?? currentSensors.tankLevel,
-      humidity: sensors.humidity ?? currentSensors.humidity,
+// Config que el ESP32 cambió con su API local (POST /control), quizás con
+// el servidor caído. El nodo la reenvía en cada subida hasta que la
+// respuesta la confirma, así que el backend la adopta tal cual llega.
+const applyLocalConfig = (config: any, localConfig: any): any => {
+  if (!localConfig || typeof localConfig !== 'object') {
+    return null;
+  }
+  const updated = { ...config };
+  if (typeof localConfig.autoMode === 'boolean') {
+    updated.autoMode = localConfig.autoMode;
+  }
+  if (typeof localConfig.moistureThreshold === 'number' && localConfig.moistureThreshold > 0) {
+    updated.moistureThreshold = localConfig.moistureThreshold;
+  }
+  if (typeof localConfig.wateringDuration === 'number' && localConfig.wateringDuration >= 1) {
+    updated.wateringDuration = Math.floor(localConfig.wateringDuration);
+  }
+  return updated;
+};
+
+interface SensorReadingResult {
+  status: number;
+  body: any;
+}
+
+// Procesa la lectura de una zona y calcula los comandos que debe aplicar el ESP32.
+// ruleBlocked: la regla de riego de la zona (evaluada en el ESP32) impide el auto-riego
+const processSensorReading = async (
+  zoneId: number,
+  sensors: any,
+  localConfig?: any,
+  ruleBlocked = false
+): Promise<SensorReadingResult> => {
+  const zone = await Zone.findByPk(zoneId);
+  if (!zone) {
+    return {
+      status: 404,
+      body: {
+        error: 'Zona no encontrada',
+        pairingRequired: true
+      }
     };
+  }
 
-    let pumpStatus: 'ON' | 'OFF' | 'LOCKED' = sensors.pumpStatus ? 'ON' : 'OFF';
-    const tankLevel = updatedSensors.tankLevel ?? 100;
+  const currentStatus = (zone.status as any) || {};
+  const currentSensors = (zone.sensors as any) || {};
+  const localUpdatedConfig = applyLocalConfig((zone.config as any) || {}, localConfig);
+  const config = localUpdatedConfig || (zone.config as any) || {};
+  if (localUpdatedConfig) {
+    console.log(`[LOCAL] Zona ${zoneId}: config cambiada en el ESP32`, localConfig);
+  }
+  
+  const manualPumpCommand = currentStatus.manualPumpCommand;
+
+  const updatedSensors = {
+    ...currentSensors,
+    quality: sensors.quality || {},
+    temperature: sensors.temperature ?? currentSensors.temperature,
+    soilMoisture: sensors.soilMoisture ?? currentSensors.soilMoisture,
+    waterLevel: sensors.waterLevel ?? currentSensors.waterLevel,
+    lightLevel: sensors.lightLevel ?? currentSensors.lightLevel,
+    tankLevel: sensors.waterLevel ?? currentSensors.tankLevel,
+    humidity: sensors.humidity ?? currentSensors.humidity,
+  };
+
+  let pumpStatus: 'ON' | 'OFF' | 'LOCKED' = sensors.pumpStatus ? 'ON' : 'OFF';
+  const tankLevel = updatedSensors.tankLevel ?? 100;
+
+  if (tankLevel <= 5) {
+    pumpStatus = 'LOCKED';
+  }
 
-    if (tankLevel <= 5) {
-      pumpStatus = 'LOCKED';
-    }
+  let autoWaterCommand: boolean | null = null;
+  const soilMoisture = updatedSensors.soilMoisture ?? 100;
+  const moistureThreshold = config.moistureThreshold ?? 30;
+  const schedules = config.schedules || [];
+  
+  // Sin una humedad fiable en esta lectura el backend no decide riego automático
+  const soilUsable = isUsableReading(sensors, 'soilMoisture');
 
-    let autoWaterCommand: boolean | null = null;
-    const soilMoisture = updatedSensors.soilMoisture ?? 100;
-    const moistureThreshold = config.moistureThreshold ?? 30;
-    const schedules = config.schedules || [];
+  if (pumpStatus !== 'LOCKED' && tankLevel > 5) {
     
-    if (pumpStatus !== 'LOCKED' && tankLevel > 5) {
-      
-      if (config.autoMode && soilMoisture < moistureThreshold) {
-        if (currentStatus.pump !== 'ON') {
-          console.log(`[AUTO] Riego automático: humedad ${soilMoisture}% < umbral ${moistureThreshold}%`);
-          autoWaterCommand = true;
-        }
-      } 
-      else if (config.autoMode && soilMoisture >= moistureThreshold + 5 && currentStatus.pump === 'ON' && !manualPumpCommand) {
-        console.log(`[AUTO] Riego detenido: humedad ${soilMoisture}% alcanzada`);
-        autoWaterCommand = false;
+    if (config.autoMode && soilUsable && soilMoisture < moistureThreshold) {
+      if (currentStatus.pump !== 'ON' && ruleBlocked) {
+        console.log(`[AUTO] Zona ${zoneId}: humedad ${soilMoisture}% < umbral, pero la regla de riego no lo permite`);
+      } else if (currentStatus.pump !== 'ON') {
+        console.log(`[AUTO] Riego automático: humedad ${soilMoisture}% < umbral ${moistureThreshold}%`);
+        autoWaterCommand = true;
       }
+    } 
+    else if (config.autoMode && soilUsable && soilMoisture >= moistureThreshold + 5 && currentStatus.pump === 'ON' && !manualPumpCommand) {
+      console.log(`[AUTO] Riego detenido: humedad ${soilMoisture}% alcanzada`);
+      autoWaterCommand = false;
+    }
+    
+    // Verificar horarios programados
+    const scheduleCheck = shouldTriggerSchedule(schedules, config);
+    if (scheduleCheck.shouldTrigger) {
+      const lastTrigger = currentStatus.lastScheduleTrigger ? new Date(currentStatus.lastScheduleTrigger).getTime() : 0;
+      const cooldownMs = 5 * 60 * 1000; // 5 minutos
       
-      // Verificar horarios programados
-      const scheduleCheck = shouldTriggerSchedule(schedules, config);
-      if (scheduleCheck.shouldTrigger) {
-        const lastTrigger = currentStatus.lastScheduleTrigger ? new Date(currentStatus.lastScheduleTrigger).getTime() : 0;
-        const cooldownMs = 5 * 60 * 1000; // 5 minutos
-        
-        if (currentStatus.pump !== 'ON' && (Date.now() - lastTrigger) > cooldownMs) {
-          console.log(`[SCHEDULE] Iniciando riego: ${scheduleCheck.schedule?.time}`);
-          autoWaterCommand = true;
-        }
+      if (currentStatus.pump !== 'ON' && (Date.now() - lastTrigger) > cooldownMs) {
+        console.log(`[SCHEDULE] Iniciando riego: ${scheduleCheck.schedule?.time}`);
+        autoWaterCommand = true;
       }
     }
+  }
 
-    const updatedStatus: any = {
-      ...currentStatus,
-      connection: 'ONLINE',
-      lastUpdate: new Date().toISOString(),
-      pump: pumpStatus,
-      hasSensorData: true,
-      manualPumpCommand: manualPumpCommand,
-      lastScheduleTrigger: autoWaterCommand === true ? new Date().toISOString() : currentStatus.lastScheduleTrigger,
-      totalWaterUsed: currentStatus.totalWaterUsed || 0,
-    };
-
-    const previousPumpStatus = currentStatus.pump;
-    const pumpChanged = previousPumpStatus !== pumpStatus;
-
-    if (pumpStatus === 'ON' && previousPumpStatus !== 'ON') {
-      updatedStatus.pumpStartTime = new Date().toISOString();
-    }
+  const updatedStatus: any = {
+    ...currentStatus,
+    connection: 'ONLINE',
+    lastUpdate: new Date().toISOString(),
+    pump: pumpStatus,
+    hasSensorData: true,
+    manualPumpCommand: manualPumpCommand,
+    lastScheduleTrigger: autoWaterCommand === true ? new Date().toISOString() : currentStatus.lastScheduleTrigger,
+    totalWaterUsed: currentStatus.totalWaterUsed || 0,
+  };
+
+  const previousPumpStatus = currentStatus.pump;
+  const pumpChanged = previousPumpStatus !== pumpStatus;
+
+  if (pumpStatus === 'ON' && previousPumpStatus !== 'ON') {
+    updatedStatus.pumpStartTime = new Date().toISOString();
+  }
 
-    let waterUsedThisSession = 0;
-    if (pumpStatus !== 'ON' && previousPumpStatus === 'ON' && currentStatus.pumpStartTime) {
-      const startTime = new Date(currentStatus.pumpStartTime).getTime();
-      const endTime = Date.now();
-      const durationSeconds = (endTime - startTime) / 1000;
-      waterUsedThisSession = calculateWaterUsed(durationSeconds);
-      
+  let waterUsedThisSession = 0;
+  let wateringsFinished = 0;
+  if (typeof sensors.pumpSessions === 'number') {
+    // El ESP32 mide cada riego y manda totales acumulados: se suma la
+    // diferencia con lo último recibido, aunque el riego haya empezado y
+    // terminado entre dos subidas
+    const sessions = counterDelta(sensors.pumpSessions, currentStatus.devicePumpSessions);
+    const runtimeMs = counterDelta(sensors.pumpRuntimeMs ?? 0, currentStatus.devicePumpRuntimeMs);
+    const liters = counterDelta(sensors.waterUsedLiters ?? 0, currentStatus.deviceWaterLiters);
+
+    if (sessions > 0) {
+      waterUsedThisSession = Math.round(liters * 100) / 100;
+      wateringsFinished = sessions;
       updatedStatus.totalWaterUsed = (currentStatus.totalWaterUsed || 0) + waterUsedThisSession;
       updatedStatus.lastWatered = new Date().toISOString();
-      updatedStatus.lastWateringDuration = Math.round(durationSeconds);
+      updatedStatus.lastWateringDuration = Math.round(runtimeMs / 1000);
       updatedStatus.lastWateringLiters = waterUsedThisSession;
-      updatedStatus.pumpStartTime = null;
-      
-      console.log(`[WATER] Riego: ${durationSeconds.toFixed(1)}s = ${waterUsedThisSession}L`);
+      console.log(`[WATER] ${sessions} riego(s) medido(s) por el ESP32: ${(runtimeMs / 1000).toFixed(1)}s = ${waterUsedThisSession}L`);
     }
+    updatedStatus.devicePumpSessions = sensors.pumpSessions;
+    updatedStatus.devicePumpRuntimeMs = sensors.pumpRuntimeMs ?? 0;
+    updatedStatus.deviceWaterLiters = sensors.waterUsedLiters ?? 0;
+    updatedStatus.pumpStartTime = pumpStatus === 'ON' ? updatedStatus.pumpStartTime : null;
+  } else if (pumpStatus !== 'ON' && previousPumpStatus === 'ON' && currentStatus.pumpStartTime) {
+    // Firmware sin contadores: se estima con la hora de las subidas
+    const startTime = new Date(currentStatus.pumpStartTime).getTime();
+    const endTime = Date.now();
+    const durationSeconds = (endTime - startTime) / 1000;
+    waterUsedThisSession = calculateWaterUsed(durationSeconds);
+    
+    updatedStatus.totalWaterUsed = (currentStatus.totalWaterUsed || 0) + waterUsedThisSession;
+    updatedStatus.lastWatered = new Date().toISOString();
+    updatedStatus.lastWateringDuration = Math.round(durationSeconds);
+    updatedStatus.lastWateringLiters = waterUsedThisSession;
+    updatedStatus.pumpStartTime = null;
+    wateringsFinished = 1;
+    
+    console.log(`[WATER] Riego: ${durationSeconds.toFixed(1)}s = ${waterUsedThisSession}L`);
+  }
 
-    await zone.update({
-      sensors: updatedSensors,
-      status: updatedStatus
-    });
+  await zone.update({
+    sensors: updatedSensors,
+    status: updatedStatus,
+    ...(localUpdatedConfig ? { config: localUpdatedConfig } : {})
+  });
 
-    if (pumpChanged && zone.userId) {
-      if (pumpStatus === 'ON') {
-        const eventType = config.autoMode ? 'RIEGO_AUTO_INICIO' : 'RIEGO_MANUAL';
-        await createEvent(
-          zone.userId, zone.id, eventType,
-          `Riego ${config.autoMode ? 'automático' : 'manual'} iniciado en ${zone.name}`,
-          { soilMoisture, threshold: moistureThreshold, automatic: config.autoMode }
-        );
-      } else if (pumpStatus === 'OFF' && previousPumpStatus === 'ON') {
-        await createEvent(
-          zone.userId, zone.id, config.autoMode ? 'RIEGO_AUTO_FIN' : 'RIEGO_FIN',
-          `Riego finalizado en ${zone.name}: ${waterUsedThisSession}L`,
-          { 
-            automatic: config.autoMode, 
-            durationSeconds: updatedStatus.lastWateringDuration,
-            litersUsed: waterUsedThisSession,
-            totalWaterUsed: updatedStatus.totalWaterUsed
-          }
-        );
-      } else if (pumpStatus === 'LOCKED') {
-        await createEvent(
-          zone.userId, zone.id, 'ALERTA_TANQUE',
-          `Bomba bloqueada: tanque vacío (${tankLevel}%)`,
-          { tankLevel }
-        );
-      }
+  if ((pumpChanged || wateringsFinished > 0) && zone.userId) {
+    // Va antes que el inicio: si un riego terminó y otro empezó entre dos
+    // subidas la bomba sigue en ON, pero el que terminó se registra igual
+    if (wateringsFinished > 0) {
+      await createEvent(
+        zone.userId, zone.id, config.autoMode ? 'RIEGO_AUTO_FIN' : 'RIEGO_FIN',
+        wateringsFinished > 1
+          ? `${wateringsFinished} riegos finalizados en ${zone.name}: ${waterUsedThisSession}L`
+          : `Riego finalizado en ${zone.name}: ${waterUsedThisSession}L`,
+        { 
+          automatic: config.autoMode, 
+          sessions: wateringsFinished,
+          durationSeconds: updatedStatus.lastWateringDuration,
+          litersUsed: waterUsedThisSession,
+          totalWaterUsed: updatedStatus.totalWaterUsed
+        }
+      );
     }
 
-    let finalPumpCommand: boolean | null = null;
-    
-    if (manualPumpCommand !== undefined) {
-      finalPumpCommand = manualPumpCommand;
-    } else if (autoWaterCommand !== null) {
-      finalPumpCommand = autoWaterCommand;
+    if (pumpChanged && pumpStatus === 'ON') {
+      const eventType = config.autoMode ? 'RIEGO_AUTO_INICIO' : 'RIEGO_MANUAL';
+      await createEvent(
+        zone.userId, zone.id, eventType,
+        `Riego ${config.autoMode ? 'automático' : 'manual'} iniciado en ${zone.name}`,
+        { soilMoisture, threshold: moistureThreshold, automatic: config.autoMode }
+      );
+    } else if (pumpChanged && pumpStatus === 'LOCKED') {
+      await createEvent(
+        zone.userId, zone.id, 'ALERTA_TANQUE',
+        `Bomba bloqueada: tanque vacío (${tankLevel}%)`,
+        { tankLevel }
+      );
     }
+  }
 
-    const response: any = {
-      success: true,
-      commands: {
-        pumpState: finalPumpCommand,
-        autoMode: config.autoMode || false,
-        moistureThreshold: moistureThreshold,
-        wateringDuration: config.wateringDuration || 10,
-        tankLocked: pumpStatus === 'LOCKED'
+  let finalPumpCommand: boolean | null = null;
+  
+  if (manualPumpCommand !== undefined) {
+    finalPumpCommand = manualPumpCommand;
+  } else if (autoWaterCommand !== null) {
+    finalPumpCommand = autoWaterCommand;
+  }
+
+  const response: any = {
+    success: true,
+    commands: {
+      pumpState: finalPumpCommand,
+      autoMode: config.autoMode || false,
+      moistureThreshold: moistureThreshold,
+      wateringDuration: config.wateringDuration || 10,
+      tankLocked: pumpStatus === 'LOCKED',
+      rule: config.ruleBytecode || ''
+    }
+  };
+
+  if (manualPumpCommand !== undefined) {
+    await zone.update({ 
+      status: { ...updatedStatus, manualPumpCommand: undefined } 
+    });
+  }
+
+  return { status: 200, body: response };
+};
+
+// ESP32 envía datos de sensores.
+// Formato de una zona:   { zoneId, sensors }
+// Formato multi-zona:    { sensors: {compartidos}, zones: [{ zoneId, channel, sensors, localConfig? }] }
+// La respuesta multi-zona lleva un bloque { zoneId, status, commands } por zona.
+router.post('/sensor-data', async (req, res) => {
+  try {
+    const { zoneId, sensors, zones } = req.body;
+
+    if (Array.isArray(zones)) {
+      const sharedSensors = sensors || {};
+      const results: any[] = [];
+
+      for (const entry of zones) {
+        if (!entry || !entry.zoneId) {
+          continue;
+        }
+        const zoneSensors = mergeZoneSensors(sharedSensors, entry.sensors || {});
+        try {
+          const result = await processSensorReading(entry.zoneId, zoneSensors, entry.localConfig, entry.ruleBlocked === true);
+          results.push({ zoneId: entry.zoneId, status: result.status, ...result.body });
+        } catch (error) {
+          console.error(`Error actualizando sensores de zona ${entry.zoneId}:`, error);
+          results.push({ zoneId: entry.zoneId, status: 500, error: 'Error del servidor' });
+        }
       }
-    };
 
-    if (manualPumpCommand !== undefined) {
-      await zone.update({ 
-        status: { ...updatedStatus, manualPumpCommand: undefined } 
-      });
+      return res.json({ success: true, zones: results });
     }
 
-    res.json(response);
+    if (!zoneId || !sensors) {
+      return res.status(400).json({ error: 'Datos inválidos' });
+    }
+
+    const result = await processSensorReading(zoneId, sensors);
+    res.status(result.status).json(result.body);
   } catch (error) {
     console.error('Error actualizando sensores:', error);
     res.status(500).json({ error: 'Error del servidor' });
@@ -265,6 +401,7 @@ router.get('/commands/:zoneId', async (req, res) => {
       moistureThreshold: config.moistureThreshold || 30,
       wateringDuration: config.wateringDuration || 10,
       tankLocked: isLocked,
+      rule: config.ruleBytecode || '',
       currentPumpStatus: status.pump
     };
 
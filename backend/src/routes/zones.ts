@@ -1,6 +1,7 @@
 import { Router, Request, Response } from 'express';
 import Zone from '../models/Zone';
 import Event from '../models/Event';
+import { compileRule, RuleCompileError } from '../services/ruleCompiler';
 
 const router = Router();
 
@@ -13,6 +14,24 @@ const createEvent = async (userId: number, zoneId: number, type: string, descrip
   }
 };
 
+// Compila config.rule a config.ruleBytecode (lo que recibe el ESP32).
+// Siempre desde el texto: el bytecode nunca se acepta tal como llega.
+// Devuelve el mensaje de error si la regla no compila
+const compileZoneRule = (config: any): string | null => {
+  if (!config) {
+    return null;
+  }
+  try {
+    config.ruleBytecode = compileRule(typeof config.rule === 'string' ? config.rule : '');
+    return null;
+  } catch (error) {
+    if (error instanceof RuleCompileError) {
+      return `Regla inválida: ${error.message}`;
+    }
+    throw error;
+  }
+};
+
 // Obtener una zona específica (por ID)
 router.get('/detail/:id', async (req: Request, res: Response) => {
   try {
@@ -56,6 +75,11 @@ router.post('/', async (req: Request, res: Response) => {
       hasSensorData: false,
     };
 
+    const ruleError = compileZoneRule(req.body.config);
+    if (ruleError) {
+      return res.status(400).json({ error: ruleError });
+    }
+
     const payload = {
       ...req.body,
       sensors: req.body.sensors ?? defaultSensors,
@@ -92,6 +116,11 @@ router.put('/:id', async (req: Request, res: Response) => {
     const oldConfig = zone.config as any;
     const newConfig = req.body.config;
 
+    const ruleError = compileZoneRule(newConfig);
+    if (ruleError) {
+      return res.status(400).json({ error: ruleError });
+    }
+
     await zone.update(req.body);
 
     // Registrar eventos de cambios de configuración importantes
@@ -131,6 +160,19 @@ router.put('/:id', async (req: Request, res: Response) => {
         );
       }
 
+      // Cambio de regla de riego
+      if ((oldConfig?.ruleBytecode || '') !== newConfig.ruleBytecode) {
+        await createEvent(
+          zone.userId,
+          zone.id,
+          'CONFIG_CAMBIO',
+          newConfig.ruleBytecode
+            ? `Regla de riego actualizada en ${zone.name}: ${newConfig.rule}`
+            : `Regla de riego eliminada en ${zone.name}`,
+          { rule: newConfig.rule || '' }
+        );
+      }
+
       // Cambio de modo vacaciones
       if (oldConfig?.vacationMode?.enabled !== newConfig.vacationMode?.enabled) {
         await createEvent(
@@ -0,0 +1,218 @@
+// Compilador de reglas de riego a bytecode para el ESP32
+// (formato e intérprete en esp32-idf/main/rule_vm.h).
+//
+// La regla es una expresión que decide si el modo automático puede regar:
+//   light < 70 and temperature >= 10
+//   not (humedad > 85) y luz < 80
+// Variables: soilMoisture, tankLevel, temperature, humidity, lightLevel,
+// threshold (o sus alias). Operadores: + - * < <= > >= and/or/not (y/o/no,
+// &&/||/!) y paréntesis. and/or se compilan con saltos hacia adelante
+// (cortocircuito); el nodo rechaza cualquier programa con saltos hacia atrás.
+
+export const RULE_VM_VERSION = 1;
+export const RULE_MAX_CODE = 64;
+const RULE_MAX_STACK = 8;
+
+const OP = {
+  PUSH: 0x01,
+  LOAD: 0x02,
+  ADD: 0x10,
+  SUB: 0x11,
+  MUL: 0x12,
+  LT: 0x20,
+  LE: 0x21,
+  GT: 0x22,
+  GE: 0x23,
+  NOT: 0x28,
+  JFK: 0x31,
+  JTK: 0x32,
+};
+
+// Mismo orden que rule_var_t
+const VARIABLES: Record<string, number> = {
+  soilmoisture: 0, soil: 0, suelo: 0,
+  tanklevel: 1, tank: 1, tanque: 1,
+  temperature: 2, temp: 2, temperatura: 2,
+  humidity: 3, humedad: 3,
+  lightlevel: 4, light: 4, luz: 4,
+  threshold: 5, umbral: 5,
+};
+
+const KEYWORDS: Record<string, string> = {
+  and: 'and', y: 'and', '&&': 'and',
+  or: 'or', o: 'or', '||': 'or',
+  not: 'not', no: 'not', '!': 'not',
+};
+
+const COMPARISONS: Record<string, number> = { '<': OP.LT, '<=': OP.LE, '>': OP.GT, '>=': OP.GE };
+
+export class RuleCompileError extends Error {}
+
+type Token = { kind: 'number' | 'name' | 'symbol'; text: string };
+
+const tokenize = (source: string): Token[] => {
+  const tokens: Token[] = [];
+  const pattern = /\s*(?:(\d+(?:\.\d+)?)|([A-Za-zÁÉÍÓÚáéíóúñÑ_]+)|(<=|>=|&&|\|\||[<>+\-*()!]))/y;
+  let index = 0;
+  while (index < source.length) {
+    if (/^\s*$/.test(source.slice(index))) {
+      break;
+    }
+    pattern.lastIndex = index;
+    const match = pattern.exec(source);
+    if (!match) {
+      throw new RuleCompileError(`Símbolo no reconocido en la posición ${index + 1}`);
+    }
+    if (match[1] !== undefined) {
+      tokens.push({ kind: 'number', text: match[1] });
+    } else if (match[2] !== undefined) {
+      tokens.push({ kind: 'name', text: match[2].toLowerCase() });
+    } else {
+      tokens.push({ kind: 'symbol', text: match[3] });
+    }
+    index = pattern.lastIndex;
+  }
+  return tokens;
+};
+
+class Compiler {
+  private code: number[] = [RULE_VM_VERSION];
+  private depth = 0;
+  private position = 0;
+
+  constructor(private tokens: Token[]) {}
+
+  compile(): number[] {
+    this.parseOr();
+    if (this.position < this.tokens.length) {
+      throw new RuleCompileError(`Sobra "${this.tokens[this.position].text}" al final de la regla`);
+    }
+    if (this.code.length > RULE_MAX_CODE) {
+      throw new RuleCompileError(`La regla ocupa ${this.code.length} bytes (máximo ${RULE_MAX_CODE})`);
+    }
+    return this.code;
+  }
+
+  private peek(): Token | undefined {
+    return this.tokens[this.position];
+  }
+
+  private keyword(): string | undefined {
+    const token = this.peek();
+    return token && token.kind !== 'number' && Object.prototype.hasOwnProperty.call(KEYWORDS, token.text)
+      ? KEYWORDS[token.text]
+      : undefined;
+  }
+
+  private emit(op: number, stackChange: number, ...operands: number[]) {
+    this.code.push(op, ...operands);
+    this.depth += stackChange;
+    if (this.depth > RULE_MAX_STACK) {
+      throw new RuleCompileError('Regla demasiado anidada');
+    }
+  }
+
+  // a or b  ->  a JTK fin b fin:   (con a verdadera no se evalúa b)
+  private parseShortCircuit(word: string, jump: number, operand: () => void) {
+    operand();
+    while (this.keyword() === word) {
+      this.position++;
+      this.emit(jump, -1, 0);
+      const patch = this.code.length - 1;
+      operand();
+      const offset = this.code.length - (patch + 1);
+      if (offset > 127) {
+        throw new RuleCompileError('Regla demasiado larga');
+      }
+      this.code[patch] = offset;
+    }
+  }
+
+  private parseOr() {
+    this.parseShortCircuit('or', OP.JTK, () => this.parseAnd());
+  }
+
+  private parseAnd() {
+    this.parseShortCircuit('and', OP.JFK, () => this.parseNot());
+  }
+
+  private parseNot() {
+    if (this.keyword() === 'not') {
+      this.position++;
+      this.parseNot();
+      this.emit(OP.NOT, 0);
+      return;
+    }
+    this.parseComparison();
+  }
+
+  private parseComparison() {
+    this.parseSum();
+    const token = this.peek();
+    if (token && token.kind === 'symbol' && COMPARISONS[token.text] !== undefined) {
+      this.position++;
+      this.parseSum();
+      this.emit(COMPARISONS[token.text], -1);
+    }
+  }
+
+  private parseSum() {
+    this.parseProduct();
+    let token = this.peek();
+    while (token && token.kind === 'symbol' && (token.text === '+' || token.text === '-')) {
+      this.position++;
+      this.parseProduct();
+      this.emit(token.text === '+' ? OP.ADD : OP.SUB, -1);
+      token = this.peek();
+    }
+  }
+
+  private parseProduct() {
+    this.parseAtom();
+    while (this.peek()?.text === '*') {
+      this.position++;
+      this.parseAtom();
+      this.emit(OP.MUL, -1);
+    }
+  }
+
+  private parseAtom() {
+    const token = this.peek();
+    if (!token) {
+      throw new RuleCompileError('La regla termina antes de tiempo');
+    }
+    this.position++;
+    if (token.kind === 'number' || (token.text === '-' && this.peek()?.kind === 'number')) {
+      const text = token.kind === 'number' ? token.text : `-${this.tokens[this.position++].text}`;
+      const tenths = Math.round(parseFloat(text) * 10);
+      if (tenths < -32768 || tenths > 32767) {
+        throw new RuleCompileError(`Número fuera de rango: ${text}`);
+      }
+      this.emit(OP.PUSH, 1, tenths & 0xff, (tenths >> 8) & 0xff);
+      return;
+    }
+    if (token.kind === 'name' && Object.prototype.hasOwnProperty.call(VARIABLES, token.text)) {
+      this.emit(OP.LOAD, 1, VARIABLES[token.text]);
+      return;
+    }
+    if (token.text === '(') {
+      this.parseOr();
+      if (this.peek()?.text !== ')') {
+        throw new RuleCompileError('Falta ")"');
+      }
+      this.position++;
+      return;
+    }
+    throw new RuleCompileError(`No se esperaba "${token.text}"`);
+  }
+}
+
+// Devuelve el bytecode en hex ('' = sin regla). Lanza RuleCompileError
+export const compileRule = (source: string): string => {
+  const tokens = tokenize(source || '');
+  if (tokens.length === 0) {
+    return '';
+  }
+  const code = new Compiler(tokens).compile();
+  return code.map((byte) => (byte < 16 ? '0' : '') + byte.toString(16)).join('');
+};
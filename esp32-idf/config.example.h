@@ -24,6 +24,18 @@
 #define TANK_HEIGHT_CM 17.0f                    // Altura total del tanque en cm
 #define SENSOR_TO_BOTTOM_DISTANCE_CM 17.0f      // Distancia del sensor al fondo
 
+// Opcional: tanques de sección no uniforme. Pares { distancia sensor-agua en cm, % }
+// con distancia ascendente; se interpola por tramos. Si se omite, el tanque
+// se considera cilíndrico (recta entre lleno y vacío).
+/*
+#define TANK_LEVEL_CURVE { \
+    {  0.0f, 100.0f }, \
+    {  6.0f,  70.0f }, \
+    { 12.0f,  30.0f }, \
+    { 17.0f,   0.0f }, \
+}
+*/
+
 // ==================== CALIBRACIÓN SENSOR DE HUMEDAD ====================
 // Para calibrar:
 // 1. Colocar sensor al aire (seco) -> anotar valor ADC
@@ -40,4 +52,105 @@
 #define LDR_DARK_ADC 3500.0f                    // Valor ADC en oscuridad
 #define LDR_BRIGHT_ADC 500.0f                   // Valor ADC con luz directa
 
+// Estas calibraciones se compilan en el firmware. Para recalibrar un sensor
+// en campo sin recompilar: POST http://<ip-esp32>/calibrate
+// { "sensor": "soil0", "rawA": 3200, "valueA": 0, "rawB": 700, "valueB": 100 }
+// (se guarda en NVS; { "sensor": "soil0", "reset": true } vuelve a estos valores)
+// con "Authorization: Bearer <token de /pair>". Los puntos deben caer en
+// 0-4095 y dentro del rango del sensor.
+
+// ==================== FILTRADO DE SENSORES ====================
+// Cada lectura pasa por un filtro Hampel (descarta picos), un límite de
+// cambio por muestra y una EWMA, y lleva una calidad (ok / filtered / held /
+// invalid) que usan el modo automático y el backend. Una lectura fallida
+// (timeout del ultrasonido, DHT11 sin respuesta) repite el último valor
+// hasta N fallos seguidos y luego queda inválida. Valores por defecto:
+// (ventana, k, desvío mínimo, alpha EWMA, cambio máx. por muestra, fallos tolerados)
+// #define SOIL_FILTER (5, 3.0f, 1.0f, 0.5f, 15.0f, 3)
+// #define LIGHT_FILTER (3, 3.0f, 2.0f, 0.6f, 0.0f, 3)
+// #define TANK_FILTER (5, 3.0f, 1.0f, 0.4f, 10.0f, 3)
+// #define TEMPERATURE_FILTER (5, 3.0f, 0.5f, 0.5f, 3.0f, 6)
+// #define HUMIDITY_FILTER (5, 3.0f, 2.0f, 0.5f, 10.0f, 6)
+
+// ==================== CONSUMO DE AGUA ====================
+// El nodo mide el tiempo de cada riego y lo convierte en litros con el
+// caudal de la bomba. Los totales viajan en cada subida y se ven en /info.
+// #define PUMP_FLOW_LPH 120.0f
+
+// ==================== CONTROL RÁPIDO ====================
+// Mientras una bomba riega, el suelo de ese canal y el tanque se leen a
+// esta frecuencia (1-4 Hz) para cortar el riego sin esperar al ciclo de 5 s.
+// #define FAST_CONTROL_HZ 4
+
+// ==================== SUBIDA AL SERVIDOR ====================
+// El POST avanza de a pasos sin frenar las lecturas: cada paso espera la red
+// como mucho UPLOAD_IO_TIMEOUT_MS. Si una fase (conexión DNS+TCP+TLS, envío,
+// respuesta) o la subida entera pasa su plazo, se aborta y la lectura
+// siguiente sale en una subida nueva. Estadísticas en /info ("upload").
+// #define UPLOAD_CONNECT_TIMEOUT_MS 6000
+// #define UPLOAD_SEND_TIMEOUT_MS 2000
+// #define UPLOAD_RECEIVE_TIMEOUT_MS 6000
+// #define UPLOAD_BUDGET_MS 10000
+// #define UPLOAD_IO_TIMEOUT_MS 250
+
+// ==================== API LOCAL ====================
+// GET/POST /control manejan bomba y config de cada zona desde la misma red
+// WiFi, aunque el servidor no responda. Piden "Authorization: Bearer
+// <token>"; sin LOCAL_API_TOKEN el nodo genera uno al azar, lo guarda en
+// NVS y lo entrega a la app en la respuesta de /pair.
+// #define LOCAL_API_TOKEN "un-token-largo-y-secreto"
+
+// ==================== ZONAS (MULTI-CANAL) ====================
+// Un mismo ESP32 puede controlar varias zonas (máximo 8). Cada canal tiene
+// su propio sensor de humedad de suelo (canal ADC1) y su propio relé; el
+// tanque, el DHT11 y el LDR son compartidos. Desde la app se vincula cada
+// canal a una zona con POST /pair { "zoneId": N, "channel": C }.
+// Formato: { canal ADC1 del sensor de suelo, GPIO del relé }
+// Canales ADC1 disponibles: CH0 (GPIO36), CH3 (GPIO39), CH4 (GPIO32),
+// CH5 (GPIO33), CH6 (GPIO34). CH7 (GPIO35) está reservado para el LDR.
+// Si se omite, se usa un único canal: { ADC_CHANNEL_6, GPIO_NUM_25 }.
+#define ZONE_CHANNEL_MAP { \
+    { ADC_CHANNEL_6, GPIO_NUM_25 }, \
+}
+/* Ejemplo con 4 zonas:
+#define ZONE_CHANNEL_MAP { \
+    { ADC_CHANNEL_6, GPIO_NUM_25 }, \
+    { ADC_CHANNEL_0, GPIO_NUM_26 }, \
+    { ADC_CHANNEL_3, GPIO_NUM_27 }, \
+    { ADC_CHANNEL_4, GPIO_NUM_14 }, \
+}
+*/
+
+// ==================== MODO MEMORIA ESTÁTICA ====================
+// 1 = cJSON usa una arena fija que se reinicia cada ciclo, la tarea de
+// sensores se crea con memoria estática y el cliente HTTPS se reutiliza
+// entre envíos. Pensado para uptime de semanas sin fragmentar el heap.
+// El reporte de heap por subsistema se imprime al arrancar y cada 5 min.
+#define AGROMIND_STATIC_MEMORY 0
+// #define JSON_ARENA_SIZE (12 * 1024)
+
+// ==================== GATEWAY ESP-NOW ====================
+// NODE_ROLE_STANDALONE: cada nodo sube a la nube por su cuenta (por defecto).
+// NODE_ROLE_GATEWAY: además recibe por ESP-NOW las lecturas de las hojas
+//   cercanas, las sube en su mismo POST y les reenvía sus "commands".
+// NODE_ROLE_LEAF: no abre sesión TLS; manda sus lecturas al gateway.
+// Gateway y hojas deben estar en la misma red WiFi (mismo canal). Las
+// zonas de una hoja se vinculan igual que siempre, con POST /pair.
+// #define AGROMIND_NODE_ROLE NODE_ROLE_GATEWAY
+// #define GATEWAY_UPLOAD_ZONES 24
+// Una hoja acepta comandos solo de su gateway: el primero que le responde,
+// y otro solo tras 20 s sin noticias de él. Con la MAC fija nunca cambia
+// (ver la MAC STA del gateway en su log de arranque).
+// #define ESPNOW_GATEWAY_MAC { 0x24, 0x6F, 0x28, 0x00, 0x00, 0x01 }
+// Gateway con AGROMIND_STATIC_MEMORY 1: el POST y la respuesta de las hojas
+// también van a la arena; subir JSON_ARENA_SIZE ~1.5 KB por zona de hoja.
+
+// ==================== ACTUALIZACIÓN OTA ====================
+// Manifiesto JSON con la última versión publicada y parches delta desde
+// versiones anteriores (generados con host/tools/delta_tool). Sin esta
+// definición el nodo no busca actualizaciones.
+// #define OTA_MANIFEST_URL "https://tu-servidor.com/firmware/manifest.json"
+// #define OTA_CHECK_INTERVAL_S (6 * 3600)
+// #define OTA_VERIFY_TIMEOUT_S 300
+
 #endif // CONFIG_H
@@ -0,0 +1,289 @@
+/*
+ * AgroMind host tools - Cliente HTTP/1.1 mínimo (ver http_client.h)
+ */
+
+#include "http_client.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+const char *http_result_name(http_result_t result) {
+    switch (result) {
+        case HTTP_RESULT_OK: return "ok";
+        case HTTP_RESULT_CONNECT_FAILED: return "connect";
+        case HTTP_RESULT_SEND_FAILED: return "send";
+        case HTTP_RESULT_TIMEOUT: return "timeout";
+        case HTTP_RESULT_BAD_RESPONSE: return "bad_response";
+        case HTTP_RESULT_CLOSED: return "closed";
+    }
+    return "?";
+}
+
+int64_t host_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+http_connection_t::http_connection_t(const std::string &host, uint16_t port, int timeout_ms, bool keep_alive)
+    : host_(host), port_(port), timeout_ms_(timeout_ms), keep_alive_(keep_alive) {
+}
+
+http_connection_t::~http_connection_t() {
+    close();
+}
+
+void http_connection_t::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    buffer_.clear();
+}
+
+http_result_t http_connection_t::ensure_connected() {
+    if (fd_ >= 0) {
+        return HTTP_RESULT_OK;
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", port_);
+    if (getaddrinfo(host_.c_str(), port_str, &hints, &res) != 0 || res == NULL) {
+        return HTTP_RESULT_CONNECT_FAILED;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return HTTP_RESULT_CONNECT_FAILED;
+    }
+
+    // connect() no bloqueante para poder aplicar el timeout
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return HTTP_RESULT_CONNECT_FAILED;
+    }
+    if (rc != 0) {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        rc = poll(&pfd, 1, timeout_ms_);
+        if (rc <= 0) {
+            ::close(fd);
+            return rc == 0 ? HTTP_RESULT_TIMEOUT : HTTP_RESULT_CONNECT_FAILED;
+        }
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+        if (so_error != 0) {
+            ::close(fd);
+            return HTTP_RESULT_CONNECT_FAILED;
+        }
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fd_ = fd;
+    buffer_.clear();
+    return HTTP_RESULT_OK;
+}
+
+http_result_t http_connection_t::send_all(const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (size_t)n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = { fd_, POLLOUT, 0 };
+            int rc = poll(&pfd, 1, timeout_ms_);
+            if (rc == 0) {
+                return HTTP_RESULT_TIMEOUT;
+            }
+            if (rc > 0) {
+                continue;
+            }
+        }
+        return HTTP_RESULT_SEND_FAILED;
+    }
+    return HTTP_RESULT_OK;
+}
+
+http_result_t http_connection_t::fill_buffer() {
+    struct pollfd pfd = { fd_, POLLIN, 0 };
+    int rc = poll(&pfd, 1, timeout_ms_);
+    if (rc == 0) {
+        return HTTP_RESULT_TIMEOUT;
+    }
+    if (rc < 0) {
+        return HTTP_RESULT_BAD_RESPONSE;
+    }
+    char chunk[4096];
+    ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n == 0) {
+        return HTTP_RESULT_CLOSED;
+    }
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTP_RESULT_TIMEOUT : HTTP_RESULT_CLOSED;
+    }
+    buffer_.append(chunk, (size_t)n);
+    return HTTP_RESULT_OK;
+}
+
+http_result_t http_connection_t::read_response(http_response_t *response, bool *server_closes) {
+    size_t header_end;
+    while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+        http_result_t r = fill_buffer();
+        if (r != HTTP_RESULT_OK) {
+            return r;
+        }
+    }
+
+    std::string headers = buffer_.substr(0, header_end);
+    buffer_.erase(0, header_end + 4);
+
+    // Línea de estado: HTTP/1.1 200 OK
+    if (headers.compare(0, 5, "HTTP/") != 0) {
+        return HTTP_RESULT_BAD_RESPONSE;
+    }
+    size_t sp = headers.find(' ');
+    if (sp == std::string::npos) {
+        return HTTP_RESULT_BAD_RESPONSE;
+    }
+    response->status = atoi(headers.c_str() + sp + 1);
+
+    long content_length = -1;
+    bool chunked = false;
+    *server_closes = false;
+    size_t line_start = headers.find("\r\n");
+    while (line_start != std::string::npos) {
+        line_start += 2;
+        size_t line_end = headers.find("\r\n", line_start);
+        std::string line = headers.substr(line_start, line_end == std::string::npos
+                                                          ? std::string::npos : line_end - line_start);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string key = line.substr(0, colon);
+            const char *value = line.c_str() + colon + 1;
+            while (*value == ' ') {
+                value++;
+            }
+            if (strcasecmp(key.c_str(), "Content-Length") == 0) {
+                content_length = atol(value);
+            } else if (strcasecmp(key.c_str(), "Transfer-Encoding") == 0 && strcasestr(value, "chunked")) {
+                chunked = true;
+            } else if (strcasecmp(key.c_str(), "Connection") == 0 && strcasestr(value, "close")) {
+                *server_closes = true;
+            }
+        }
+        line_start = line_end;
+    }
+
+    response->body.clear();
+    if (chunked) {
+        while (true) {
+            size_t line_end;
+            while ((line_end = buffer_.find("\r\n")) == std::string::npos) {
+                http_result_t r = fill_buffer();
+                if (r != HTTP_RESULT_OK) {
+                    return r;
+                }
+            }
+            long chunk_size = strtol(buffer_.c_str(), NULL, 16);
+            buffer_.erase(0, line_end + 2);
+            while ((long)buffer_.size() < chunk_size + 2) {
+                http_result_t r = fill_buffer();
+                if (r != HTTP_RESULT_OK) {
+                    return r;
+                }
+            }
+            response->body.append(buffer_, 0, (size_t)chunk_size);
+            buffer_.erase(0, (size_t)chunk_size + 2);
+            if (chunk_size == 0) {
+                break;
+            }
+        }
+    } else if (content_length >= 0) {
+        while ((long)buffer_.size() < content_length) {
+            http_result_t r = fill_buffer();
+            if (r != HTTP_RESULT_OK) {
+                return r;
+            }
+        }
+        response->body = buffer_.substr(0, (size_t)content_length);
+        buffer_.erase(0, (size_t)content_length);
+    } else {
+        // Sin longitud: el cuerpo termina cuando el servidor cierra
+        while (fill_buffer() == HTTP_RESULT_OK) {
+        }
+        response->body.swap(buffer_);
+        buffer_.clear();
+        *server_closes = true;
+    }
+    return HTTP_RESULT_OK;
+}
+
+http_result_t http_connection_t::request(const char *method, const std::string &path,
+                                         const std::string &body, http_response_t *response) {
+    // Un reintento si una conexión keep-alive reutilizada resultó estar cerrada
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = fd_ >= 0;
+        http_result_t r = ensure_connected();
+        if (r != HTTP_RESULT_OK) {
+            return r;
+        }
+
+        std::string req;
+        req.reserve(256 + body.size());
+        req += method;
+        req += ' ';
+        req += path;
+        req += " HTTP/1.1\r\nHost: ";
+        req += host_;
+        req += keep_alive_ ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n";
+        if (!body.empty()) {
+            req += "Content-Type: application/json\r\nContent-Length: ";
+            req += std::to_string(body.size());
+            req += "\r\n";
+        }
+        req += "\r\n";
+        req += body;
+
+        r = send_all(req);
+        bool server_closes = false;
+        if (r == HTTP_RESULT_OK) {
+            r = read_response(response, &server_closes);
+        }
+        if (r != HTTP_RESULT_OK) {
+            close();
+            if (reused && (r == HTTP_RESULT_CLOSED || r == HTTP_RESULT_SEND_FAILED)) {
+                continue;
+            }
+            return r;
+        }
+        if (!keep_alive_ || server_closes) {
+            close();
+        }
+        return HTTP_RESULT_OK;
+    }
+    return HTTP_RESULT_CLOSED;
+}
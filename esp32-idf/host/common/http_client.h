@@ -0,0 +1,62 @@
+/*
+ * AgroMind host tools - Cliente HTTP/1.1 mínimo sobre sockets POSIX
+ *
+ * Pensado para generadores de carga: sin dependencias externas, con
+ * timeouts por operación y reutilización opcional de la conexión
+ * (keep-alive). Solo HTTP plano (servidor local del ESP32 o backend local).
+ */
+
+#ifndef AGROMIND_HOST_HTTP_CLIENT_H
+#define AGROMIND_HOST_HTTP_CLIENT_H
+
+#include <stdint.h>
+#include <string>
+
+enum http_result_t {
+    HTTP_RESULT_OK = 0,
+    HTTP_RESULT_CONNECT_FAILED,
+    HTTP_RESULT_SEND_FAILED,
+    HTTP_RESULT_TIMEOUT,
+    HTTP_RESULT_BAD_RESPONSE,
+    HTTP_RESULT_CLOSED,
+};
+
+const char *http_result_name(http_result_t result);
+
+struct http_response_t {
+    int status = 0;
+    std::string body;
+};
+
+class http_connection_t {
+public:
+    http_connection_t(const std::string &host, uint16_t port, int timeout_ms, bool keep_alive);
+    ~http_connection_t();
+
+    http_connection_t(const http_connection_t &) = delete;
+    http_connection_t &operator=(const http_connection_t &) = delete;
+
+    // body vacío = sin cuerpo. Reconecta automáticamente si hace falta.
+    http_result_t request(const char *method, const std::string &path,
+                          const std::string &body, http_response_t *response);
+
+    void close();
+
+private:
+    http_result_t ensure_connected();
+    http_result_t send_all(const std::string &data);
+    http_result_t read_response(http_response_t *response, bool *server_closes);
+    http_result_t fill_buffer();
+
+    std::string host_;
+    uint16_t port_;
+    int timeout_ms_;
+    bool keep_alive_;
+    int fd_ = -1;
+    std::string buffer_;
+};
+
+// Tiempo monotónico en microsegundos
+int64_t host_time_us();
+
+#endif // AGROMIND_HOST_HTTP_CLIENT_H
@@ -0,0 +1,79 @@
+/*
+ * AgroMind host tools - Registro de latencias (ver latency_stats.h)
+ */
+
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <math.h>
+
+void latency_stats_t::merge(const latency_stats_t &other) {
+    samples_us_.insert(samples_us_.end(), other.samples_us_.begin(), other.samples_us_.end());
+    for (const auto &entry : other.errors_) {
+        errors_[entry.first] += entry.second;
+    }
+    sorted_ = false;
+}
+
+uint64_t latency_stats_t::error_count() const {
+    uint64_t total = 0;
+    for (const auto &entry : errors_) {
+        total += entry.second;
+    }
+    return total;
+}
+
+int64_t latency_stats_t::percentile_us(double p) {
+    if (samples_us_.empty()) {
+        return 0;
+    }
+    if (!sorted_) {
+        std::sort(samples_us_.begin(), samples_us_.end());
+        sorted_ = true;
+    }
+    // Método "nearest rank"
+    size_t rank = (size_t)ceil(p / 100.0 * (double)samples_us_.size());
+    if (rank == 0) {
+        rank = 1;
+    }
+    return samples_us_[std::min(rank, samples_us_.size()) - 1];
+}
+
+int64_t latency_stats_t::max_us() {
+    return percentile_us(100.0);
+}
+
+double latency_stats_t::mean_us() const {
+    if (samples_us_.empty()) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int64_t sample : samples_us_) {
+        sum += (double)sample;
+    }
+    return sum / (double)samples_us_.size();
+}
+
+void latency_stats_t::print_header(FILE *out) {
+    fprintf(out, "%-14s %9s %8s %7s %9s %9s %9s %9s %9s\n",
+            "endpoint", "ok", "errores", "err%", "p50 ms", "p90 ms", "p99 ms", "max ms", "req/s");
+}
+
+void latency_stats_t::print_row(FILE *out, const char *name, double elapsed_s) {
+    uint64_t ok = count();
+    uint64_t errors = error_count();
+    uint64_t total = ok + errors;
+    fprintf(out, "%-14s %9llu %8llu %6.2f%% %9.2f %9.2f %9.2f %9.2f %9.1f\n",
+            name,
+            (unsigned long long)ok,
+            (unsigned long long)errors,
+            total > 0 ? 100.0 * (double)errors / (double)total : 0.0,
+            percentile_us(50) / 1000.0,
+            percentile_us(90) / 1000.0,
+            percentile_us(99) / 1000.0,
+            max_us() / 1000.0,
+            elapsed_s > 0 ? (double)total / elapsed_s : 0.0);
+    for (const auto &entry : errors_) {
+        fprintf(out, "%-14s   %s: %llu\n", "", entry.first.c_str(), (unsigned long long)entry.second);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * AgroMind host tools - Registro de latencias y percentiles
+ *
+ * Cada hilo de carga llena su propio registro (sin locks) y al final se
+ * combinan con merge() para calcular percentiles exactos.
+ */
+
+#ifndef AGROMIND_HOST_LATENCY_STATS_H
+#define AGROMIND_HOST_LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class latency_stats_t {
+public:
+    void add(int64_t latency_us) { samples_us_.push_back(latency_us); }
+    void add_error(const std::string &kind) { errors_[kind]++; }
+
+    void merge(const latency_stats_t &other);
+
+    uint64_t count() const { return samples_us_.size(); }
+    uint64_t error_count() const;
+    const std::map<std::string, uint64_t> &errors() const { return errors_; }
+
+    // p en [0, 100]; ordena las muestras la primera vez que se consulta
+    int64_t percentile_us(double p);
+    int64_t max_us();
+    double mean_us() const;
+
+    // Una línea: nombre, n, errores, p50/p90/p99/max en ms, tasa
+    void print_row(FILE *out, const char *name, double elapsed_s);
+    static void print_header(FILE *out);
+
+private:
+    std::vector<int64_t> samples_us_;
+    std::map<std::string, uint64_t> errors_;
+    bool sorted_ = false;
+};
+
+#endif // AGROMIND_HOST_LATENCY_STATS_H
@@ -0,0 +1,36 @@
+/*
+ * AgroMind host tools - SHA-256 (FIPS 180-4)
+ *
+ * Mismo hash que usa el firmware con mbedtls para verificar imágenes OTA.
+ */
+
+#ifndef AGROMIND_HOST_SHA256_H
+#define AGROMIND_HOST_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define SHA256_DIGEST_SIZE 32
+
+class sha256_t {
+public:
+    sha256_t() { reset(); }
+
+    void reset();
+    void update(const uint8_t *data, size_t len);
+    void finish(uint8_t digest[SHA256_DIGEST_SIZE]);
+
+    static void hash(const uint8_t *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+    static std::string to_hex(const uint8_t digest[SHA256_DIGEST_SIZE]);
+
+private:
+    void transform(const uint8_t block[64]);
+
+    uint32_t state_[8];
+    uint64_t total_len_;
+    uint8_t buffer_[64];
+    size_t buffer_len_;
+};
+
+#endif // AGROMIND_HOST_SHA256_H
@@ -0,0 +1,32 @@
+/*
+ * AgroMind host shim - esp_err.h (los códigos que usan los módulos portables)
+ */
+
+#ifndef HOST_SHIM_ESP_ERR_H
+#define HOST_SHIM_ESP_ERR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_HANDLE 0x1107
+#define ESP_ERR_NVS_READ_ONLY 0x1108
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+
+const char *esp_err_to_name(esp_err_t code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_ERR_H
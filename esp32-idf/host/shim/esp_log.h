@@ -0,0 +1,48 @@
+/*
+ * AgroMind host shim - esp_log.h
+ *
+ * Mismas macros que ESP-IDF; el nivel global se ajusta con
+ * esp_log_level_set("*", nivel). Por defecto solo errores, para que miles
+ * de nodos simulados no inunden la consola.
+ */
+
+#ifndef HOST_SHIM_ESP_LOG_H
+#define HOST_SHIM_ESP_LOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_LOG_NONE = 0,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+esp_log_level_t host_log_level(void);
+// Sin verificación de formato: el firmware usa %ld para int32_t (Xtensa)
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+
+#define HOST_LOG_AT(level, tag, format, ...) do {                  \
+        if (host_log_level() >= (level)) {                         \
+            host_log_write(level, tag, format, ##__VA_ARGS__);     \
+        }                                                          \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG_AT(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG_AT(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG_AT(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG_AT(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG_AT(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_LOG_H
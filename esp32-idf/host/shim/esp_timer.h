@@ -0,0 +1,14 @@
+/*
+ * AgroMind host shim - esp_timer.h (solo el reloj)
+ */
+
+#ifndef HOST_SHIM_ESP_TIMER_H
+#define HOST_SHIM_ESP_TIMER_H
+
+#include "host_clock.h"
+
+static inline int64_t esp_timer_get_time(void) {
+    return host_clock_now_us();
+}
+
+#endif // HOST_SHIM_ESP_TIMER_H
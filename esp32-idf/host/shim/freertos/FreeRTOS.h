@@ -0,0 +1,28 @@
+/*
+ * AgroMind host shim - freertos/FreeRTOS.h
+ *
+ * TickType_t de 32 bits y la misma frecuencia que el firmware, para que el
+ * desborde de ticks (cada 49.7 días) llegue igual que en el dispositivo.
+ */
+
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+#include <stdint.h>
+
+#ifndef configTICK_RATE_HZ
+#define configTICK_RATE_HZ 1000     // CONFIG_FREERTOS_HZ de sdkconfig.defaults
+#endif
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * (uint64_t)configTICK_RATE_HZ) / (uint64_t)1000U))
+
+#endif // HOST_SHIM_FREERTOS_H
@@ -0,0 +1,22 @@
+/*
+ * AgroMind host shim - freertos/task.h (ticks y retardos)
+ */
+
+#ifndef HOST_SHIM_FREERTOS_TASK_H
+#define HOST_SHIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TickType_t xTaskGetTickCount(void);
+// Con reloj virtual avanza el reloj; con el real duerme el hilo
+void vTaskDelay(TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_FREERTOS_TASK_H
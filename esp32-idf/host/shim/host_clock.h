@@ -0,0 +1,30 @@
+/*
+ * AgroMind host shim - Reloj del host
+ *
+ * Por defecto sigue el reloj monotónico real. En modo virtual el tiempo solo
+ * avanza con host_clock_advance_us(), así un arnés puede comprimir días de
+ * operación en segundos. Los ticks de FreeRTOS y esp_timer_get_time() salen
+ * de aquí.
+ */
+
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t host_clock_now_us(void);
+
+// start_us permite arrancar cerca del desborde de TickType_t
+void host_clock_use_virtual(int64_t start_us);
+void host_clock_advance_us(int64_t delta_us);
+int host_clock_is_virtual(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_CLOCK_H
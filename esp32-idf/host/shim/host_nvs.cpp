@@ -0,0 +1,226 @@
+/*
+ * AgroMind host shim - NVS en memoria (ver nvs.h y host_nvs.h)
+ */
+
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "host_nvs.h"
+#include "nvs.h"
+
+#define NVS_KEY_NAME_MAX_SIZE 16    // 15 caracteres + '\0', como en ESP-IDF
+
+struct nvs_item_t {
+    std::vector<uint8_t> data;
+    bool is_blob;
+};
+
+struct key_stats_t {
+    uint64_t writes = 0;
+    uint64_t entries = 0;
+};
+
+struct open_handle_t {
+    std::string name_space;
+    bool writable;
+};
+
+static std::mutex nvs_mutex;
+static std::map<std::string, nvs_item_t> items;            // "namespace/clave"
+static std::map<std::string, key_stats_t> key_stats;
+static std::map<nvs_handle_t, open_handle_t> handles;
+static nvs_handle_t next_handle = 1;
+static host_nvs_stats_t stats;
+
+static uint64_t entries_for(const nvs_item_t &item) {
+    if (!item.is_blob) {
+        return 1;
+    }
+    return 2 + (item.data.size() + 31) / 32;
+}
+
+static esp_err_t resolve(nvs_handle_t handle, const char *key, bool write, std::string *full_key) {
+    auto it = handles.find(handle);
+    if (it == handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (key == NULL || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (write && !it->second.writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    *full_key = it->second.name_space + "/" + key;
+    return ESP_OK;
+}
+
+static esp_err_t set_item(nvs_handle_t handle, const char *key, const void *value, size_t length, bool is_blob) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    std::string full_key;
+    esp_err_t err = resolve(handle, key, true, &full_key);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    nvs_item_t item;
+    item.data.assign((const uint8_t *)value, (const uint8_t *)value + length);
+    item.is_blob = is_blob;
+    auto existing = items.find(full_key);
+    if (existing != items.end() && existing->second.is_blob == is_blob && existing->second.data == item.data) {
+        stats.unchanged++;
+        return ESP_OK;
+    }
+
+    uint64_t entries = entries_for(item);
+    stats.writes++;
+    stats.entries += entries;
+    key_stats[full_key].writes++;
+    key_stats[full_key].entries += entries;
+    items[full_key] = item;
+    return ESP_OK;
+}
+
+static esp_err_t get_item(nvs_handle_t handle, const char *key, bool is_blob, const nvs_item_t **out) {
+    std::string full_key;
+    esp_err_t err = resolve(handle, key, false, &full_key);
+    if (err != ESP_OK) {
+        return err;
+    }
+    auto it = items.find(full_key);
+    if (it == items.end() || it->second.is_blob != is_blob) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out = &it->second;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    if (name == NULL || strlen(name) >= NVS_KEY_NAME_MAX_SIZE || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_handle_t handle = next_handle++;
+    handles[handle] = open_handle_t{ name, open_mode == NVS_READWRITE };
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    if (handles.find(handle) == handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    stats.commits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    std::string full_key;
+    esp_err_t err = resolve(handle, key, true, &full_key);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Borrar solo marca las entradas en el bitmap de su página
+    if (items.erase(full_key) == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    stats.erases++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value) {
+    return set_item(handle, key, &value, sizeof(value), false);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    const nvs_item_t *item = NULL;
+    esp_err_t err = get_item(handle, key, false, &item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (item->data.size() != sizeof(*out_value)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memcpy(out_value, item->data.data(), sizeof(*out_value));
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return set_item(handle, key, value, length, true);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    const nvs_item_t *item = NULL;
+    esp_err_t err = get_item(handle, key, true, &item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (out_value == NULL) {
+        *length = item->data.size();
+        return ESP_OK;
+    }
+    if (*length < item->data.size()) {
+        *length = item->data.size();
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, item->data.data(), item->data.size());
+    *length = item->data.size();
+    return ESP_OK;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// ==================== CONTADORES ====================
+
+void host_nvs_reset(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    items.clear();
+    key_stats.clear();
+    handles.clear();
+    memset(&stats, 0, sizeof(stats));
+}
+
+host_nvs_stats_t host_nvs_get_stats(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return stats;
+}
+
+void host_nvs_for_each_key(void (*fn)(void *ctx, const char *key, uint64_t writes, uint64_t entries), void *ctx) {
+    std::map<std::string, key_stats_t> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(nvs_mutex);
+        snapshot = key_stats;
+    }
+    for (const auto &entry : snapshot) {
+        fn(ctx, entry.first.c_str(), entry.second.writes, entry.second.entries);
+    }
+}
+
+double host_nvs_page_erase_cycles(uint32_t pages) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return pages == 0 ? 0.0 : (double)stats.entries / ((double)HOST_NVS_PAGE_ENTRIES * pages);
+}
@@ -0,0 +1,44 @@
+/*
+ * AgroMind host shim - Contadores del NVS simulado
+ *
+ * Modelo de escritura de NVS de ESP-IDF: páginas de 4 KB con 126 entradas
+ * de 32 bytes. Un entero ocupa una entrada; un blob, una de índice, una de
+ * cabecera del bloque de datos y ceil(bytes / 32) de datos. Un set con el
+ * mismo valor que ya está guardado no escribe nada (NVS lo compara antes).
+ * Cada página se borra una vez por cada 126 entradas escritas en ella, y
+ * las escrituras rotan por todas las páginas de la partición.
+ */
+
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_NVS_PAGE_ENTRIES 126
+
+typedef struct {
+    uint64_t writes;            // set_* que cambiaron el valor
+    uint64_t unchanged;         // set_* con el mismo valor (sin escritura)
+    uint64_t entries;           // entradas de 32 bytes escritas
+    uint64_t erases;            // claves borradas
+    uint64_t commits;
+} host_nvs_stats_t;
+
+// Vacía el almacenamiento y los contadores
+void host_nvs_reset(void);
+host_nvs_stats_t host_nvs_get_stats(void);
+// Escrituras por clave ("namespace/clave"), en orden alfabético
+void host_nvs_for_each_key(void (*fn)(void *ctx, const char *key, uint64_t writes, uint64_t entries), void *ctx);
+
+// Borrados de página estimados para una partición de `pages` páginas
+double host_nvs_page_erase_cycles(uint32_t pages);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_NVS_H
@@ -0,0 +1,75 @@
+/*
+ * AgroMind host shim - Implementación de reloj, ticks y log
+ */
+
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_clock.h"
+
+static std::atomic<bool> virtual_clock(false);
+static std::atomic<int64_t> virtual_now_us(0);
+static std::atomic<int> log_level(ESP_LOG_ERROR);
+
+static int64_t real_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t host_clock_now_us(void) {
+    return virtual_clock.load(std::memory_order_relaxed) ? virtual_now_us.load(std::memory_order_relaxed)
+                                                         : real_now_us();
+}
+
+void host_clock_use_virtual(int64_t start_us) {
+    virtual_now_us.store(start_us);
+    virtual_clock.store(true);
+}
+
+void host_clock_advance_us(int64_t delta_us) {
+    virtual_now_us.fetch_add(delta_us, std::memory_order_relaxed);
+}
+
+int host_clock_is_virtual(void) {
+    return virtual_clock.load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    // Truncado a 32 bits: desborda igual que en el ESP32
+    return (TickType_t)(uint64_t)(host_clock_now_us() / (1000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    int64_t delta_us = (int64_t)ticks * (1000000 / configTICK_RATE_HZ);
+    if (host_clock_is_virtual()) {
+        host_clock_advance_us(delta_us);
+        return;
+    }
+    struct timespec ts = { (time_t)(delta_us / 1000000), (long)(delta_us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;  // un único nivel global en el host
+    log_level.store(level);
+}
+
+esp_log_level_t host_log_level(void) {
+    return (esp_log_level_t)log_level.load(std::memory_order_relaxed);
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char LETTERS[] = "NEWIDV";
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%lld) %s: %s\n", LETTERS[level], (long long)(host_clock_now_us() / 1000), tag, line);
+}
@@ -0,0 +1,551 @@
+/*
+ * AgroMind host tools - Parches delta AGD1 para OTA
+ *
+ * Subcomandos:
+ *   diff  <origen.bin> <destino.bin> <parche.agd>
+ *         Genera el parche: índice hash de bloques de la imagen origen y
+ *         búsqueda voraz de la coincidencia más larga en cada posición del
+ *         destino (COPY si supera --min-match bytes, INSERT si no).
+ *   apply <origen.bin> <parche.agd> <salida.bin> [--chunk 1460]
+ *         [--interrupt-every 0]
+ *         Aplica el parche con el mismo main/delta_patch.cpp del firmware,
+ *         en trozos del tamaño de un segmento TCP y sectores de 4 KB. Con
+ *         --interrupt-every N simula un corte cada N bytes descargados: se
+ *         descarta lo no confirmado y se reanuda desde el último checkpoint
+ *         (estado del aplicador + offset del parche), igual que en el nodo.
+ *   manifest --version 1.2.0 --image app.bin --url https://.../app.bin
+ *         [--patch 1.1.0=parche.agd=https://.../1.1.0-1.2.0.agd ...]
+ *         Imprime el manifiesto JSON que lee main/ota_update.cpp.
+ *   selftest [--size 307200]
+ *         Ida y vuelta diff/apply sobre imágenes sintéticas (idéntica, cambio
+ *         en el medio, bloque insertado...) con trozos de 1 byte a más de un
+ *         sector y cortes de red.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cJSON.h"
+#include "delta_patch.h"
+#include "sha256.h"
+
+#define SECTOR_SIZE 4096
+#define DEFAULT_MIN_MATCH 32
+#define HASH_WINDOW 16
+#define HASH_BUCKET_BITS 20
+#define MAX_CHAIN_PROBES 32
+
+typedef std::vector<uint8_t> bytes_t;
+
+static bool read_file(const char *path, bytes_t *out) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return false;
+    }
+    out->clear();
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        out->insert(out->end(), buffer, buffer + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const char *path, const bytes_t &data) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+        fprintf(stderr, "No se pudo escribir %s\n", path);
+        if (f != NULL) {
+            fclose(f);
+        }
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+static void put_u32(bytes_t *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out->push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+// ==================== DIFF ====================
+
+static inline uint32_t window_hash(const uint8_t *p) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < HASH_WINDOW; ++i) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h >> (32 - HASH_BUCKET_BITS);
+}
+
+struct diff_stats_t {
+    size_t copies = 0;
+    size_t inserts = 0;
+    size_t copied_bytes = 0;
+    size_t inserted_bytes = 0;
+};
+
+static void emit_insert(bytes_t *patch, const bytes_t &target, size_t start, size_t end, diff_stats_t *stats) {
+    if (end <= start) {
+        return;
+    }
+    patch->push_back(DELTA_OP_INSERT);
+    put_u32(patch, (uint32_t)(end - start));
+    patch->insert(patch->end(), target.begin() + start, target.begin() + end);
+    stats->inserts++;
+    stats->inserted_bytes += end - start;
+}
+
+static void emit_copy(bytes_t *patch, size_t offset, size_t length, diff_stats_t *stats) {
+    patch->push_back(DELTA_OP_COPY);
+    put_u32(patch, (uint32_t)offset);
+    put_u32(patch, (uint32_t)length);
+    stats->copies++;
+    stats->copied_bytes += length;
+}
+
+static bytes_t make_patch(const bytes_t &source, const bytes_t &target, size_t min_match, diff_stats_t *stats) {
+    // Cadenas hash: head[bucket] -> última posición, prev[pos] -> anterior
+    std::vector<int32_t> head((size_t)1 << HASH_BUCKET_BITS, -1);
+    std::vector<int32_t> prev(source.size(), -1);
+    for (size_t pos = 0; pos + HASH_WINDOW <= source.size(); ++pos) {
+        uint32_t bucket = window_hash(&source[pos]);
+        prev[pos] = head[bucket];
+        head[bucket] = (int32_t)pos;
+    }
+
+    delta_header_t header = {};
+    header.source_size = (uint32_t)source.size();
+    header.target_size = (uint32_t)target.size();
+    sha256_t::hash(source.data(), source.size(), header.source_sha256);
+    sha256_t::hash(target.data(), target.size(), header.target_sha256);
+
+    bytes_t patch(DELTA_HEADER_SIZE);
+    delta_header_encode(&header, patch.data());
+
+    size_t literal_start = 0;
+    size_t pos = 0;
+    size_t next_expected = SIZE_MAX;  // offset origen que continúa la última copia
+    while (pos + HASH_WINDOW <= target.size()) {
+        size_t best_len = 0;
+        size_t best_offset = 0;
+
+        // Firmware recompilado: lo más probable es que siga donde quedó la copia anterior
+        if (next_expected < source.size()) {
+            size_t len = 0;
+            while (pos + len < target.size() && next_expected + len < source.size() &&
+                   source[next_expected + len] == target[pos + len]) {
+                ++len;
+            }
+            best_len = len;
+            best_offset = next_expected;
+        }
+
+        int probes = 0;
+        for (int32_t cand = head[window_hash(&target[pos])]; cand >= 0 && probes < MAX_CHAIN_PROBES;
+             cand = prev[cand], ++probes) {
+            size_t len = 0;
+            while (pos + len < target.size() && cand + len < source.size() &&
+                   source[cand + len] == target[pos + len]) {
+                ++len;
+            }
+            if (len > best_len) {
+                best_len = len;
+                best_offset = (size_t)cand;
+            }
+        }
+
+        if (best_len >= min_match) {
+            // Extender hacia atrás sobre los literales pendientes
+            while (pos > literal_start && best_offset > 0 && source[best_offset - 1] == target[pos - 1]) {
+                --pos;
+                --best_offset;
+                ++best_len;
+            }
+            emit_insert(&patch, target, literal_start, pos, stats);
+            emit_copy(&patch, best_offset, best_len, stats);
+            pos += best_len;
+            literal_start = pos;
+            next_expected = best_offset + best_len;
+        } else {
+            ++pos;
+            if (next_expected != SIZE_MAX) {
+                ++next_expected;  // mismo desplazamiento tras un byte cambiado
+            }
+        }
+    }
+    emit_insert(&patch, target, literal_start, target.size(), stats);
+    return patch;
+}
+
+static int cmd_diff(int argc, char **argv) {
+    size_t min_match = DEFAULT_MIN_MATCH;
+    std::vector<const char *> paths;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--min-match") == 0 && i + 1 < argc) {
+            min_match = (size_t)atoi(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 3 || min_match < HASH_WINDOW) {
+        fprintf(stderr, "Uso: delta_tool diff <origen.bin> <destino.bin> <parche.agd> [--min-match %d]\n",
+                DEFAULT_MIN_MATCH);
+        return 2;
+    }
+
+    bytes_t source, target;
+    if (!read_file(paths[0], &source) || !read_file(paths[1], &target)) {
+        return 1;
+    }
+    diff_stats_t stats;
+    bytes_t patch = make_patch(source, target, min_match, &stats);
+    if (!write_file(paths[2], patch)) {
+        return 1;
+    }
+    printf("origen  %zu bytes\n", source.size());
+    printf("destino %zu bytes\n", target.size());
+    printf("parche  %zu bytes (%.1f%% del destino)\n", patch.size(),
+           target.empty() ? 0.0 : 100.0 * patch.size() / target.size());
+    printf("  COPY   %6zu ops, %zu bytes\n", stats.copies, stats.copied_bytes);
+    printf("  INSERT %6zu ops, %zu bytes\n", stats.inserts, stats.inserted_bytes);
+    return 0;
+}
+
+// ==================== APPLY ====================
+
+static int read_source(void *ctx, uint32_t offset, uint8_t *buffer, size_t len) {
+    const bytes_t *source = (const bytes_t *)ctx;
+    if ((size_t)offset + len > source->size()) {
+        return -1;
+    }
+    memcpy(buffer, source->data() + offset, len);
+    return 0;
+}
+
+// Lo que el nodo guarda en NVS en cada límite de sector
+struct apply_checkpoint_t {
+    delta_state_t state;
+    size_t image_written;
+};
+
+// Aplica el parche como el nodo: trozos de "chunk" bytes, sectores de 4 KB y,
+// con interrupt_every > 0, un corte cada tantos bytes descargados que retoma
+// desde el último checkpoint. Devuelve false (con el motivo en stderr) si el
+// parche es inválido o la imagen resultante no coincide con su SHA-256.
+static bool apply_patch(const bytes_t &source, const bytes_t &patch, size_t chunk, size_t interrupt_every,
+                        bytes_t *image, int *interruptions) {
+    uint8_t sector[SECTOR_SIZE];
+    size_t sector_fill = 0;
+    apply_checkpoint_t checkpoint = {};
+    delta_state_init(&checkpoint.state);
+    delta_state_t state = checkpoint.state;
+
+    image->clear();
+    *interruptions = 0;
+    size_t downloaded_since_cut = 0;
+    bool source_checked = false;
+    delta_result_t result = DELTA_OK;
+
+    while (result == DELTA_OK) {
+        // Con el parche ya descargado (o un checkpoint que lo consumió entero)
+        // solo queda la salida pendiente de un COPY final: length = 0
+        size_t offset = state.patch_consumed;
+        size_t remaining = offset < patch.size() ? patch.size() - offset : 0;
+        size_t length = remaining < chunk ? remaining : chunk;
+
+        if (interrupt_every > 0 && downloaded_since_cut + length > interrupt_every) {
+            // Corte de red: se pierde lo no confirmado y se retoma con Range
+            state = checkpoint.state;
+            image->resize(checkpoint.image_written);
+            sector_fill = 0;
+            downloaded_since_cut = 0;
+            (*interruptions)++;
+            continue;
+        }
+        downloaded_since_cut += length;
+
+        const uint8_t *input = patch.data() + (patch.size() - remaining);
+        while (result == DELTA_OK) {
+            size_t consumed = 0;
+            size_t produced = 0;
+            result = delta_apply_step(&state, input, length, &consumed,
+                                      sector + sector_fill, SECTOR_SIZE - sector_fill, &produced,
+                                      read_source, (void *)&source);
+            if (result != DELTA_OK && result != DELTA_DONE) {
+                fprintf(stderr, "Parche inválido en %u: %s\n", state.patch_consumed, delta_result_name(result));
+                return false;
+            }
+            if (!source_checked && state.phase != DELTA_PHASE_HEADER) {
+                uint8_t digest[SHA256_DIGEST_SIZE];
+                sha256_t::hash(source.data(), source.size(), digest);
+                if (state.header.source_size != source.size() ||
+                    memcmp(digest, state.header.source_sha256, SHA256_DIGEST_SIZE) != 0) {
+                    fprintf(stderr, "El parche no corresponde a la imagen origen\n");
+                    return false;
+                }
+                source_checked = true;
+            }
+            sector_fill += produced;
+            input += consumed;
+            length -= consumed;
+            if (sector_fill == SECTOR_SIZE || result == DELTA_DONE) {
+                image->insert(image->end(), sector, sector + sector_fill);
+                sector_fill = 0;
+                checkpoint.state = state;
+                checkpoint.image_written = image->size();
+            }
+            if (consumed == 0 && produced == 0) {
+                break;  // pide más parche
+            }
+        }
+        if (result == DELTA_OK && state.patch_consumed >= patch.size()) {
+            fprintf(stderr, "Parche truncado en %u bytes\n", state.patch_consumed);
+            return false;
+        }
+    }
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t::hash(image->data(), image->size(), digest);
+    if (image->size() != state.header.target_size ||
+        memcmp(digest, state.header.target_sha256, SHA256_DIGEST_SIZE) != 0) {
+        fprintf(stderr, "❌ SHA-256 de la imagen resultante no coincide\n");
+        return false;
+    }
+    return true;
+}
+
+static bool valid_interrupt(size_t chunk, size_t interrupt_every) {
+    // Entre dos cortes tiene que completarse al menos un sector
+    return interrupt_every == 0 || interrupt_every >= 2 * SECTOR_SIZE + chunk + DELTA_HEADER_SIZE;
+}
+
+static int cmd_apply(int argc, char **argv) {
+    size_t chunk = 1460;
+    size_t interrupt_every = 0;
+    std::vector<const char *> paths;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interrupt-every") == 0 && i + 1 < argc) {
+            interrupt_every = (size_t)atoi(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 3 || chunk == 0 || !valid_interrupt(chunk, interrupt_every)) {
+        fprintf(stderr, "Uso: delta_tool apply <origen.bin> <parche.agd> <salida.bin> "
+                        "[--chunk 1460] [--interrupt-every 0 | >= 2*4096+chunk+76]\n");
+        return 2;
+    }
+
+    bytes_t source, patch;
+    if (!read_file(paths[0], &source) || !read_file(paths[1], &patch)) {
+        return 1;
+    }
+
+    bytes_t image;
+    int interruptions = 0;
+    if (!apply_patch(source, patch, chunk, interrupt_every, &image, &interruptions)) {
+        return 1;
+    }
+    if (!write_file(paths[2], image)) {
+        return 1;
+    }
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t::hash(image.data(), image.size(), digest);
+    printf("✅ %zu bytes, sha256 %s", image.size(), sha256_t::to_hex(digest).c_str());
+    if (interrupt_every > 0) {
+        printf(", %d reanudaciones", interruptions);
+    }
+    printf("\n");
+    return 0;
+}
+
+// ==================== SELFTEST ====================
+// Ida y vuelta diff -> apply sobre imágenes sintéticas, con varios tamaños de
+// trozo y cortes. Cubre los parches que terminan en COPY (imagen idéntica,
+// cambio en el medio): la salida del último COPY sale después del último
+// byte del parche.
+
+struct selftest_case_t {
+    const char *name;
+    bytes_t source;
+    bytes_t target;
+};
+
+static bytes_t pseudo_image(size_t size, uint32_t seed) {
+    // Bloques repetidos con variaciones, como el código de un binario
+    bytes_t out(size);
+    uint32_t x = seed;
+    for (size_t i = 0; i < size; ++i) {
+        x = x * 1103515245u + 12345u;
+        out[i] = (uint8_t)((i % 97 < 60) ? (i * 31 + seed) : (x >> 16));
+    }
+    return out;
+}
+
+static int cmd_selftest(int argc, char **argv) {
+    size_t image_size = 300 * 1024;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--size") == 0) {
+            image_size = (size_t)atoi(argv[i + 1]);
+        }
+    }
+    if (image_size < 4 * SECTOR_SIZE) {
+        fprintf(stderr, "Uso: delta_tool selftest [--size 307200 (>= 16384)]\n");
+        return 2;
+    }
+
+    const bytes_t base = pseudo_image(image_size, 7);
+    std::vector<selftest_case_t> cases;
+    cases.push_back({ "idéntica", base, base });
+
+    bytes_t middle = base;
+    for (size_t i = 0; i < 4; ++i) {
+        middle[image_size / 2 + i] ^= 0x5A;
+    }
+    cases.push_back({ "4 bytes en el medio", base, middle });
+
+    bytes_t tail = base;
+    tail[image_size - 1] ^= 0xFF;
+    cases.push_back({ "último byte", base, tail });
+
+    bytes_t grown = base;
+    bytes_t extra = pseudo_image(5000, 99);
+    grown.insert(grown.begin() + image_size / 3, extra.begin(), extra.end());
+    cases.push_back({ "bloque insertado", base, grown });
+
+    bytes_t shrunk(base.begin(), base.end() - 3 * SECTOR_SIZE - 17);
+    cases.push_back({ "imagen más corta", base, shrunk });
+
+    cases.push_back({ "sin relación", base, pseudo_image(image_size, 1234) });
+
+    const size_t chunks[] = { 1, 1460, SECTOR_SIZE + 77 };
+    int failures = 0;
+    for (const selftest_case_t &test : cases) {
+        diff_stats_t stats;
+        bytes_t patch = make_patch(test.source, test.target, DEFAULT_MIN_MATCH, &stats);
+        for (size_t chunk : chunks) {
+            size_t interrupts[] = { 0, 2 * SECTOR_SIZE + chunk + DELTA_HEADER_SIZE };
+            for (size_t interrupt_every : interrupts) {
+                if (chunk == 1 && interrupt_every > 0 && test.target.size() > 64 * 1024) {
+                    continue;  // un byte por paso y cortes: demasiado lento sin aportar
+                }
+                bytes_t image;
+                int interruptions = 0;
+                bool ok = apply_patch(test.source, patch, chunk, interrupt_every, &image, &interruptions) &&
+                          image == test.target;
+                if (!ok) {
+                    failures++;
+                    printf("❌ %-20s chunk %5zu cortes %6zu\n", test.name, chunk, interrupt_every);
+                }
+            }
+        }
+        printf("   %-20s parche %7zu bytes (%zu COPY, %zu INSERT)\n", test.name, patch.size(),
+               stats.copies, stats.inserts);
+    }
+
+    printf("%s\n", failures == 0 ? "✅ OK" : "❌ FALLÓ");
+    return failures == 0 ? 0 : 1;
+}
+
+// ==================== MANIFEST ====================
+
+static int cmd_manifest(int argc, char **argv) {
+    const char *version = NULL;
+    const char *image_path = NULL;
+    const char *url = NULL;
+    std::vector<std::string> patches;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--version") == 0) {
+            version = argv[i + 1];
+        } else if (strcmp(argv[i], "--image") == 0) {
+            image_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--url") == 0) {
+            url = argv[i + 1];
+        } else if (strcmp(argv[i], "--patch") == 0) {
+            patches.push_back(argv[i + 1]);
+        } else {
+            version = NULL;
+            break;
+        }
+    }
+    if (version == NULL || image_path == NULL || url == NULL || argc % 2 != 0) {
+        fprintf(stderr, "Uso: delta_tool manifest --version V --image app.bin --url URL "
+                        "[--patch VERSION_ORIGEN=parche.agd=URL ...]\n");
+        return 2;
+    }
+
+    bytes_t image;
+    if (!read_file(image_path, &image)) {
+        return 1;
+    }
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t::hash(image.data(), image.size(), digest);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "version", version);
+    cJSON_AddStringToObject(root, "url", url);
+    cJSON_AddNumberToObject(root, "size", (double)image.size());
+    cJSON_AddStringToObject(root, "sha256", sha256_t::to_hex(digest).c_str());
+    cJSON *list = cJSON_AddArrayToObject(root, "patches");
+
+    for (const std::string &spec : patches) {
+        size_t first = spec.find('=');
+        size_t second = first == std::string::npos ? std::string::npos : spec.find('=', first + 1);
+        if (second == std::string::npos) {
+            fprintf(stderr, "--patch espera VERSION_ORIGEN=archivo=URL: %s\n", spec.c_str());
+            cJSON_Delete(root);
+            return 2;
+        }
+        std::string path = spec.substr(first + 1, second - first - 1);
+        bytes_t patch;
+        delta_header_t header;
+        if (!read_file(path.c_str(), &patch)) {
+            cJSON_Delete(root);
+            return 1;
+        }
+        if (patch.size() < DELTA_HEADER_SIZE || !delta_header_decode(patch.data(), &header) ||
+            memcmp(header.target_sha256, digest, SHA256_DIGEST_SIZE) != 0) {
+            fprintf(stderr, "%s no es un parche hacia %s\n", path.c_str(), image_path);
+            cJSON_Delete(root);
+            return 1;
+        }
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "fromVersion", spec.substr(0, first).c_str());
+        cJSON_AddStringToObject(entry, "url", spec.substr(second + 1).c_str());
+        cJSON_AddNumberToObject(entry, "size", (double)patch.size());
+        cJSON_AddItemToArray(list, entry);
+    }
+
+    char *text = cJSON_Print(root);
+    printf("%s\n", text);
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "diff") == 0) {
+        return cmd_diff(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "apply") == 0) {
+        return cmd_apply(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "manifest") == 0) {
+        return cmd_manifest(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "selftest") == 0) {
+        return cmd_selftest(argc - 2, argv + 2);
+    }
+    fprintf(stderr, "Uso: %s diff|apply|manifest|selftest ...\n", argc > 0 ? argv[0] : "delta_tool");
+    return 2;
+}
@@ -0,0 +1,692 @@
+/*
+ * AgroMind host tools - Simulador de flota contra el backend
+ *
+ * Cada nodo virtual ejecuta el mismo código que el firmware para armar el
+ * POST multiplexado (upload_build_payload) y aplicar la respuesta
+ * (upload_handle_response + zone_control): modo automático, comandos
+ * manuales, tankLocked y liberación de canales con 404.
+ *
+ * La física es simple pero realista: el suelo se seca según la temperatura
+ * (ciclo diario comprimido), sube mientras la bomba riega, el tanque baja
+ * con las bombas encendidas y "alguien" lo rellena al vaciarse.
+ *
+ * Métricas:
+ *   - throughput y latencia p50/p90/p99 de /api/iot/sensor-data
+ *   - RTT de comando: desde POST /api/zones/:id/pump hasta que el nodo
+ *     virtual cambia el relé al recibir pumpState en una respuesta
+ *   - re-emparejamientos tras 404 y retraso del planificador (si el
+ *     generador no da abasto, el retraso crece y los resultados no valen)
+ *
+ * Uso:
+ *   fleet_sim [--host 127.0.0.1] [--port 5000] [--nodes 1000]
+ *             [--zones-per-node 2] [--interval 5] [--duration 120]
+ *             [--threads 16] [--zone-base 1 | --provision --user-id 1]
+ *             [--auto-ratio 0.5] [--commands-per-min 30]
+ *             [--delete-per-min 0] [--repair-delay 10] [--day-seconds 600]
+ *             [--log-level error|warn|info]
+ *
+ * Sin --provision los nodos usan los IDs zone-base..zone-base+N-1, que deben
+ * existir (si no, todo acaba en 404 y re-emparejamiento). Con --provision se
+ * crean zonas nuevas vía POST /api/zones; --delete-per-min borra zonas al
+ * azar para ejercitar el camino 404 -> liberar canal -> emparejar de nuevo.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <mutex>
+#include <queue>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "http_client.h"
+#include "latency_stats.h"
+#include "upload_protocol.h"
+#include "zone_control.h"
+
+#define SENSOR_DATA_PATH "/api/iot/sensor-data"
+#define COMMAND_TIMEOUT_US (120LL * 1000000)
+#define PROGRESS_INTERVAL_US (10LL * 1000000)
+
+struct sim_options_t {
+    std::string host = "127.0.0.1";
+    uint16_t port = 5000;
+    int nodes = 1000;
+    int zones_per_node = 2;
+    double interval_s = 5.0;
+    int duration_s = 120;
+    int threads = 16;
+    long zone_base = 1;
+    bool provision = false;
+    long user_id = 1;
+    double auto_ratio = 0.5;
+    double commands_per_min = 30.0;
+    double delete_per_min = 0.0;
+    double repair_delay_s = 10.0;
+    double day_seconds = 600.0;
+    int timeout_ms = 10000;
+    esp_log_level_t log_level = ESP_LOG_ERROR;
+};
+
+struct worker_stats_t {
+    latency_stats_t upload;
+    latency_stats_t provision;
+    latency_stats_t command_rtt;
+    latency_stats_t schedule_lag;
+    uint64_t zone_readings = 0;
+    uint64_t pump_switches = 0;
+    uint64_t released = 0;
+    uint64_t repaired = 0;
+    uint64_t bad_json = 0;
+};
+
+// Vista de una zona compartida con el hilo de comandos (solo atómicos)
+struct zone_mirror_t {
+    std::atomic<int32_t> zone_id{0};
+    std::atomic<bool> pump_on{false};
+    std::atomic<bool> auto_mode{false};
+    std::atomic<int64_t> command_issued_us{0};   // 0 = sin comando pendiente
+    std::atomic<bool> command_target{false};
+};
+
+struct virtual_zone_t {
+    double moisture;
+    double dry_rate;        // %/s a 25 °C
+    double gain_rate;       // %/s con la bomba encendida
+    int64_t released_at_us;
+    int32_t previous_zone_id;
+    bool auto_mode;         // configuración inicial al aprovisionar
+};
+
+struct virtual_node_t {
+    int index;
+    node_state_t state;
+    virtual_zone_t zones[MAX_ZONE_CHANNELS];
+    zone_mirror_t mirror[MAX_ZONE_CHANNELS];
+    double tank;
+    int64_t last_step_us;
+    int64_t next_upload_us;
+    uint32_t rng;
+    worker_stats_t *stats;  // del hilo dueño; los hooks corren en ese hilo
+};
+
+static const sim_options_t *g_opts = NULL;
+static int64_t g_start_us = 0;
+static std::atomic<uint64_t> g_uploads_done(0);
+
+// ==================== UTILIDADES ====================
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static double random_unit(uint32_t *state) {
+    return (double)(next_random(state) >> 8) / (double)(1U << 24);
+}
+
+static double random_range(uint32_t *state, double lo, double hi) {
+    return lo + (hi - lo) * random_unit(state);
+}
+
+static double clamp(double value, double lo, double hi) {
+    return value < lo ? lo : (value > hi ? hi : value);
+}
+
+static bool parse_log_level(const char *text, esp_log_level_t *level) {
+    static const struct { const char *name; esp_log_level_t level; } LEVELS[] = {
+        { "none", ESP_LOG_NONE }, { "error", ESP_LOG_ERROR }, { "warn", ESP_LOG_WARN },
+        { "info", ESP_LOG_INFO }, { "debug", ESP_LOG_DEBUG },
+    };
+    for (const auto &entry : LEVELS) {
+        if (strcmp(text, entry.name) == 0) {
+            *level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Uso: %s [--host 127.0.0.1] [--port 5000] [--nodes 1000] [--zones-per-node 2]\n"
+            "          [--interval 5] [--duration 120] [--threads 16]\n"
+            "          [--zone-base 1 | --provision --user-id 1] [--auto-ratio 0.5]\n"
+            "          [--commands-per-min 30] [--delete-per-min 0] [--repair-delay 10]\n"
+            "          [--day-seconds 600] [--timeout-ms 10000] [--log-level error]\n",
+            argv0);
+}
+
+static bool parse_args(int argc, char **argv, sim_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--provision") == 0) {
+            opts->provision = true;
+            continue;
+        }
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--host") == 0) {
+            opts->host = value;
+        } else if (strcmp(arg, "--port") == 0) {
+            opts->port = (uint16_t)atoi(value);
+        } else if (strcmp(arg, "--nodes") == 0) {
+            opts->nodes = atoi(value);
+        } else if (strcmp(arg, "--zones-per-node") == 0) {
+            opts->zones_per_node = atoi(value);
+        } else if (strcmp(arg, "--interval") == 0) {
+            opts->interval_s = atof(value);
+        } else if (strcmp(arg, "--duration") == 0) {
+            opts->duration_s = atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            opts->threads = atoi(value);
+        } else if (strcmp(arg, "--zone-base") == 0) {
+            opts->zone_base = atol(value);
+        } else if (strcmp(arg, "--user-id") == 0) {
+            opts->user_id = atol(value);
+        } else if (strcmp(arg, "--auto-ratio") == 0) {
+            opts->auto_ratio = atof(value);
+        } else if (strcmp(arg, "--commands-per-min") == 0) {
+            opts->commands_per_min = atof(value);
+        } else if (strcmp(arg, "--delete-per-min") == 0) {
+            opts->delete_per_min = atof(value);
+        } else if (strcmp(arg, "--repair-delay") == 0) {
+            opts->repair_delay_s = atof(value);
+        } else if (strcmp(arg, "--day-seconds") == 0) {
+            opts->day_seconds = atof(value);
+        } else if (strcmp(arg, "--timeout-ms") == 0) {
+            opts->timeout_ms = atoi(value);
+        } else if (strcmp(arg, "--log-level") == 0) {
+            if (!parse_log_level(value, &opts->log_level)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    if (opts->delete_per_min > 0 && !opts->provision) {
+        fprintf(stderr, "--delete-per-min requiere --provision (borra zonas del backend)\n");
+        return false;
+    }
+    return opts->nodes > 0 && opts->threads > 0 && opts->duration_s > 0 && opts->interval_s > 0 &&
+           opts->zones_per_node >= 1 && opts->zones_per_node <= MAX_ZONE_CHANNELS;
+}
+
+// ==================== HOOKS DEL NODO VIRTUAL ====================
+
+static void sim_set_relay(void *ctx, int channel, bool on) {
+    virtual_node_t *vnode = (virtual_node_t *)ctx;
+    zone_mirror_t *mirror = &vnode->mirror[channel];
+    mirror->pump_on.store(on);
+    vnode->stats->pump_switches++;
+
+    int64_t issued = mirror->command_issued_us.load();
+    if (issued != 0 && mirror->command_target.load() == on &&
+        mirror->command_issued_us.compare_exchange_strong(issued, 0)) {
+        vnode->stats->command_rtt.add(esp_timer_get_time() - issued);
+    }
+}
+
+static void sim_zone_released(void *ctx, int channel) {
+    virtual_node_t *vnode = (virtual_node_t *)ctx;
+    vnode->zones[channel].released_at_us = esp_timer_get_time();
+    vnode->mirror[channel].zone_id.store(0);
+    vnode->mirror[channel].command_issued_us.store(0);
+    vnode->stats->released++;
+}
+
+// ==================== APROVISIONAMIENTO ====================
+
+// Lo que haría la app: crear la zona en el backend y emparejarla al canal
+static int32_t provision_zone(http_connection_t *conn, const virtual_node_t *vnode, int channel,
+                              bool auto_mode, worker_stats_t *stats) {
+    char body[256];
+    snprintf(body, sizeof(body),
+             "{\"userId\":%ld,\"name\":\"sim-%d-%d\",\"type\":\"Outdoor\","
+             "\"config\":{\"autoMode\":%s,\"moistureThreshold\":30,\"wateringDuration\":10}}",
+             g_opts->user_id, vnode->index, channel, auto_mode ? "true" : "false");
+
+    http_response_t response;
+    int64_t start = esp_timer_get_time();
+    http_result_t r = conn->request("POST", "/api/zones", body, &response);
+    if (r != HTTP_RESULT_OK) {
+        stats->provision.add_error(http_result_name(r));
+        return 0;
+    }
+    if (response.status != 201 && response.status != 200) {
+        stats->provision.add_error("http " + std::to_string(response.status));
+        return 0;
+    }
+    stats->provision.add(esp_timer_get_time() - start);
+
+    cJSON *root = cJSON_Parse(response.body.c_str());
+    cJSON *id = root ? cJSON_GetObjectItem(root, "id") : NULL;
+    int32_t zone_id = (id && cJSON_IsNumber(id)) ? (int32_t)cJSON_GetNumberValue(id) : 0;
+    cJSON_Delete(root);
+    return zone_id;
+}
+
+static void bind_zone(virtual_node_t *vnode, int channel, int32_t zone_id) {
+    vnode->state.zones[channel].zone_id = zone_id;
+    vnode->zones[channel].released_at_us = 0;
+    vnode->zones[channel].previous_zone_id = zone_id;
+    vnode->mirror[channel].zone_id.store(zone_id);
+    node_state_touch(&vnode->state);
+}
+
+static void init_virtual_node(virtual_node_t *vnode, int index, worker_stats_t *stats) {
+    vnode->index = index;
+    vnode->stats = stats;
+    vnode->rng = 0x9E3779B9u ^ (uint32_t)((index + 1) * 2654435761u);
+
+    node_hooks_t hooks = {};
+    hooks.set_relay = sim_set_relay;
+    hooks.zone_released = sim_zone_released;
+    hooks.ctx = vnode;
+    node_state_init(&vnode->state, g_opts->zones_per_node, &hooks);
+
+    vnode->tank = random_range(&vnode->rng, 40.0, 100.0);
+    for (int ch = 0; ch < g_opts->zones_per_node; ++ch) {
+        virtual_zone_t *zone = &vnode->zones[ch];
+        zone->moisture = random_range(&vnode->rng, 25.0, 60.0);
+        zone->dry_rate = random_range(&vnode->rng, 0.005, 0.03);
+        zone->gain_rate = random_range(&vnode->rng, 0.5, 1.5);
+        zone->released_at_us = 0;
+        zone->previous_zone_id = 0;
+        zone->auto_mode = random_unit(&vnode->rng) < g_opts->auto_ratio;
+    }
+}
+
+// ==================== FÍSICA ====================
+
+static void step_physics(virtual_node_t *vnode, int64_t now_us) {
+    double dt = (double)(now_us - vnode->last_step_us) / 1e6;
+    vnode->last_step_us = now_us;
+    if (dt <= 0) {
+        return;
+    }
+
+    // Día comprimido: temperatura 12..34 °C, luz 0..100 %
+    double day_phase = fmod((double)(now_us - g_start_us) / 1e6 / g_opts->day_seconds + vnode->index * 0.013, 1.0);
+    double sun = sin(2.0 * M_PI * day_phase);
+    node_state_t *state = &vnode->state;
+    state->temperature_c = (float)(23.0 + 11.0 * sun + random_range(&vnode->rng, -0.3, 0.3));
+    state->ambient_humidity = (float)clamp(60.0 - 25.0 * sun + random_range(&vnode->rng, -1.0, 1.0), 10.0, 100.0);
+    state->light_level = (float)clamp(100.0 * sun + random_range(&vnode->rng, -2.0, 2.0), 0.0, 100.0);
+
+    int pumps_on = 0;
+    double heat = clamp(state->temperature_c / 25.0, 0.3, 2.0);
+    for (int ch = 0; ch < state->channel_count; ++ch) {
+        virtual_zone_t *zone = &vnode->zones[ch];
+        zone->moisture -= zone->dry_rate * heat * dt;
+        if (state->zones[ch].pump_state && vnode->tank > 0.0) {
+            zone->moisture += zone->gain_rate * dt;
+            pumps_on++;
+        }
+        zone->moisture = clamp(zone->moisture, 2.0, 95.0);
+        state->zones[ch].last_soil_moisture =
+            (float)clamp(zone->moisture + random_range(&vnode->rng, -0.8, 0.8), 0.0, 100.0);
+    }
+
+    vnode->tank = clamp(vnode->tank - pumps_on * 0.15 * dt, 0.0, 100.0);
+    if (vnode->tank < 3.0 && random_unit(&vnode->rng) < 0.02 * dt) {
+        vnode->tank = 100.0;  // rellenado manual
+    }
+    state->tank_level = (float)vnode->tank;
+}
+
+// ==================== CICLO DE UN NODO ====================
+
+static void repair_released_zones(http_connection_t *conn, virtual_node_t *vnode, int64_t now_us) {
+    for (int ch = 0; ch < vnode->state.channel_count; ++ch) {
+        virtual_zone_t *zone = &vnode->zones[ch];
+        if (vnode->state.zones[ch].zone_id > 0 || zone->released_at_us == 0 ||
+            now_us - zone->released_at_us < (int64_t)(g_opts->repair_delay_s * 1e6)) {
+            continue;
+        }
+        int32_t zone_id = g_opts->provision ? provision_zone(conn, vnode, ch, zone->auto_mode, vnode->stats)
+                                            : zone->previous_zone_id;
+        if (zone_id > 0) {
+            bind_zone(vnode, ch, zone_id);
+            vnode->stats->repaired++;
+        } else {
+            zone->released_at_us = now_us;  // reintentar más tarde
+        }
+    }
+}
+
+// Lo mismo que send_sensor_data() + http_event_handler() en el firmware
+static void run_node_cycle(http_connection_t *conn, virtual_node_t *vnode) {
+    int64_t now_us = esp_timer_get_time();
+    repair_released_zones(conn, vnode, now_us);
+    step_physics(vnode, now_us);
+
+    node_state_t *state = &vnode->state;
+    int configured = node_configured_zone_count(state);
+    if (configured == 0) {
+        return;
+    }
+    zone_apply_auto_mode_all(state);
+
+    cJSON *root = upload_build_payload(state);
+    char *payload = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (payload == NULL) {
+        return;
+    }
+
+    http_response_t response;
+    int64_t start = esp_timer_get_time();
+    http_result_t r = conn->request("POST", SENSOR_DATA_PATH, payload, &response);
+    int64_t elapsed = esp_timer_get_time() - start;
+    cJSON_free(payload);
+
+    worker_stats_t *stats = vnode->stats;
+    if (r != HTTP_RESULT_OK) {
+        stats->upload.add_error(http_result_name(r));
+        return;
+    }
+    if (response.status < 200 || response.status >= 300) {
+        stats->upload.add_error("http " + std::to_string(response.status));
+        return;
+    }
+    stats->upload.add(elapsed);
+    stats->zone_readings += (uint64_t)configured;
+    g_uploads_done.fetch_add(1, std::memory_order_relaxed);
+
+    if (!upload_handle_response(state, response.body.c_str(), response.body.size())) {
+        stats->bad_json++;
+    }
+    for (int ch = 0; ch < state->channel_count; ++ch) {
+        vnode->mirror[ch].auto_mode.store(state->zones[ch].auto_mode_enabled);
+    }
+}
+
+struct schedule_entry_t {
+    int64_t due_us;
+    virtual_node_t *vnode;
+    bool operator>(const schedule_entry_t &other) const { return due_us > other.due_us; }
+};
+
+static void run_worker(std::vector<virtual_node_t *> nodes, int64_t deadline_us, worker_stats_t *stats) {
+    http_connection_t conn(g_opts->host, g_opts->port, g_opts->timeout_ms, true);
+    int64_t interval_us = (int64_t)(g_opts->interval_s * 1e6);
+
+    std::priority_queue<schedule_entry_t, std::vector<schedule_entry_t>, std::greater<schedule_entry_t>> schedule;
+    int64_t now_us = esp_timer_get_time();
+    for (virtual_node_t *vnode : nodes) {
+        vnode->last_step_us = now_us;
+        // Arranques repartidos en el primer intervalo, como una flota real
+        vnode->next_upload_us = now_us + (int64_t)(random_unit(&vnode->rng) * (double)interval_us);
+        schedule.push({ vnode->next_upload_us, vnode });
+    }
+
+    while (!schedule.empty()) {
+        schedule_entry_t entry = schedule.top();
+        if (entry.due_us >= deadline_us) {
+            break;
+        }
+        schedule.pop();
+
+        now_us = esp_timer_get_time();
+        if (entry.due_us > now_us) {
+            std::this_thread::sleep_for(std::chrono::microseconds(entry.due_us - now_us));
+        }
+        stats->schedule_lag.add(now_us > entry.due_us ? now_us - entry.due_us : 0);
+
+        run_node_cycle(&conn, entry.vnode);
+        entry.vnode->next_upload_us = entry.due_us + interval_us;
+        schedule.push({ entry.vnode->next_upload_us, entry.vnode });
+    }
+}
+
+// ==================== COMANDOS DESDE LA "APP" ====================
+
+struct commander_stats_t {
+    latency_stats_t command_post;
+    latency_stats_t delete_post;
+    uint64_t commands_lost = 0;
+};
+
+static zone_mirror_t *pick_zone(std::vector<virtual_node_t> &fleet, uint32_t *rng, bool manual_only) {
+    for (int attempt = 0; attempt < 32; ++attempt) {
+        virtual_node_t &vnode = fleet[next_random(rng) % fleet.size()];
+        zone_mirror_t *mirror = &vnode.mirror[next_random(rng) % (uint32_t)g_opts->zones_per_node];
+        if (mirror->zone_id.load() <= 0 || mirror->command_issued_us.load() != 0) {
+            continue;
+        }
+        // En zonas automáticas el backend también enciende la bomba: el RTT no sería medible
+        if (manual_only && mirror->auto_mode.load()) {
+            continue;
+        }
+        return mirror;
+    }
+    return NULL;
+}
+
+static void expire_lost_commands(std::vector<virtual_node_t> &fleet, commander_stats_t *stats) {
+    int64_t now_us = esp_timer_get_time();
+    for (virtual_node_t &vnode : fleet) {
+        for (int ch = 0; ch < g_opts->zones_per_node; ++ch) {
+            int64_t issued = vnode.mirror[ch].command_issued_us.load();
+            if (issued != 0 && now_us - issued > COMMAND_TIMEOUT_US &&
+                vnode.mirror[ch].command_issued_us.compare_exchange_strong(issued, 0)) {
+                stats->commands_lost++;
+            }
+        }
+    }
+}
+
+static void run_commander(std::vector<virtual_node_t> &fleet, int64_t deadline_us,
+                          std::atomic<bool> *stop, commander_stats_t *stats) {
+    http_connection_t conn(g_opts->host, g_opts->port, g_opts->timeout_ms, true);
+    uint32_t rng = 0xC0FFEEu;
+    double events_per_min = g_opts->commands_per_min + g_opts->delete_per_min;
+    if (events_per_min <= 0) {
+        return;
+    }
+    int64_t mean_gap_us = (int64_t)(60e6 / events_per_min);
+    int64_t next_expire_us = esp_timer_get_time() + 1000000;
+
+    while (!stop->load() && esp_timer_get_time() < deadline_us) {
+        // Llegadas de Poisson
+        int64_t gap_us = (int64_t)(-log(1.0 - random_unit(&rng) * 0.999999) * (double)mean_gap_us);
+        std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+        if (esp_timer_get_time() > next_expire_us) {
+            expire_lost_commands(fleet, stats);
+            next_expire_us = esp_timer_get_time() + 1000000;
+        }
+
+        bool do_delete = random_unit(&rng) * events_per_min < g_opts->delete_per_min;
+        zone_mirror_t *mirror = pick_zone(fleet, &rng, !do_delete);
+        if (mirror == NULL) {
+            continue;
+        }
+        int32_t zone_id = mirror->zone_id.load();
+        char path[64];
+        http_response_t response;
+        http_result_t r;
+        int64_t start = esp_timer_get_time();
+
+        if (do_delete) {
+            snprintf(path, sizeof(path), "/api/zones/%ld", (long)zone_id);
+            r = conn.request("DELETE", path, "", &response);
+            latency_stats_t &s = stats->delete_post;
+            if (r != HTTP_RESULT_OK) {
+                s.add_error(http_result_name(r));
+            } else if (response.status >= 300) {
+                s.add_error("http " + std::to_string(response.status));
+            } else {
+                s.add(esp_timer_get_time() - start);
+            }
+            continue;
+        }
+
+        bool target = !mirror->pump_on.load();
+        mirror->command_target.store(target);
+        mirror->command_issued_us.store(start);
+        snprintf(path, sizeof(path), "/api/zones/%ld/pump", (long)zone_id);
+        r = conn.request("POST", path, target ? "{\"action\":\"ON\"}" : "{\"action\":\"OFF\"}", &response);
+        latency_stats_t &s = stats->command_post;
+        if (r != HTTP_RESULT_OK || response.status >= 300) {
+            // Rechazado (p. ej. tanque bajo): no hay nada que medir
+            mirror->command_issued_us.store(0);
+            s.add_error(r != HTTP_RESULT_OK ? http_result_name(r) : "http " + std::to_string(response.status));
+        } else {
+            s.add(esp_timer_get_time() - start);
+        }
+    }
+}
+
+// ==================== MAIN ====================
+
+static void print_progress(int64_t deadline_us, std::atomic<bool> *stop) {
+    uint64_t last_done = 0;
+    int64_t last_us = esp_timer_get_time();
+    while (!stop->load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - last_us < PROGRESS_INTERVAL_US) {
+            continue;
+        }
+        uint64_t done = g_uploads_done.load();
+        printf("  t=%5.0fs  %7.1f subidas/s  (restan %.0fs)\n",
+               (double)(now_us - g_start_us) / 1e6,
+               (double)(done - last_done) / ((double)(now_us - last_us) / 1e6),
+               deadline_us > now_us ? (double)(deadline_us - now_us) / 1e6 : 0.0);
+        fflush(stdout);
+        last_done = done;
+        last_us = now_us;
+    }
+}
+
+int main(int argc, char **argv) {
+    static sim_options_t opts;
+    if (!parse_args(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    g_opts = &opts;
+    esp_log_level_set("*", opts.log_level);
+
+    int threads = opts.threads > opts.nodes ? opts.nodes : opts.threads;
+    std::vector<worker_stats_t> stats(threads);
+    std::vector<virtual_node_t> fleet(opts.nodes);
+    for (int i = 0; i < opts.nodes; ++i) {
+        init_virtual_node(&fleet[i], i, &stats[i % threads]);
+    }
+
+    printf("🌱 Flota: %d nodos x %d zonas contra http://%s:%u%s, cada %.1fs durante %ds (%d hilos)\n",
+           opts.nodes, opts.zones_per_node, opts.host.c_str(), opts.port, SENSOR_DATA_PATH,
+           opts.interval_s, opts.duration_s, threads);
+
+    // Emparejamiento inicial (en paralelo cuando hay que crear zonas)
+    {
+        std::vector<std::thread> provisioners;
+        for (int t = 0; t < threads; ++t) {
+            provisioners.emplace_back([&, t]() {
+                http_connection_t conn(opts.host, opts.port, opts.timeout_ms, true);
+                for (int i = t; i < opts.nodes; i += threads) {
+                    virtual_node_t *vnode = &fleet[i];
+                    for (int ch = 0; ch < opts.zones_per_node; ++ch) {
+                        int32_t zone_id = opts.provision
+                            ? provision_zone(&conn, vnode, ch, vnode->zones[ch].auto_mode, &stats[t])
+                            : (int32_t)(opts.zone_base + (long)i * opts.zones_per_node + ch);
+                        if (zone_id > 0) {
+                            bind_zone(vnode, ch, zone_id);
+                        }
+                    }
+                }
+            });
+        }
+        for (auto &thread : provisioners) {
+            thread.join();
+        }
+        if (opts.provision) {
+            latency_stats_t provision;
+            for (auto &s : stats) {
+                provision.merge(s.provision);
+            }
+            printf("📦 Zonas creadas: %llu (errores %llu)\n",
+                   (unsigned long long)provision.count(), (unsigned long long)provision.error_count());
+        }
+    }
+
+    g_start_us = esp_timer_get_time();
+    int64_t deadline_us = g_start_us + (int64_t)opts.duration_s * 1000000;
+    std::atomic<bool> stop(false);
+
+    std::vector<std::vector<virtual_node_t *>> assignment(threads);
+    for (int i = 0; i < opts.nodes; ++i) {
+        assignment[i % threads].push_back(&fleet[i]);
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(run_worker, assignment[t], deadline_us, &stats[t]);
+    }
+    commander_stats_t commander;
+    std::thread commander_thread(run_commander, std::ref(fleet), deadline_us, &stop, &commander);
+    std::thread progress_thread(print_progress, deadline_us, &stop);
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    stop.store(true);
+    commander_thread.join();
+    progress_thread.join();
+    double elapsed_s = (double)(esp_timer_get_time() - g_start_us) / 1e6;
+
+    worker_stats_t total;
+    for (auto &s : stats) {
+        total.upload.merge(s.upload);
+        total.command_rtt.merge(s.command_rtt);
+        total.schedule_lag.merge(s.schedule_lag);
+        total.provision.merge(s.provision);
+        total.zone_readings += s.zone_readings;
+        total.pump_switches += s.pump_switches;
+        total.released += s.released;
+        total.repaired += s.repaired;
+        total.bad_json += s.bad_json;
+    }
+    expire_lost_commands(fleet, &commander);
+
+    printf("\n");
+    latency_stats_t::print_header(stdout);
+    total.upload.print_row(stdout, "sensor-data", elapsed_s);
+    commander.command_post.print_row(stdout, "zones/:id/pump", elapsed_s);
+    if (opts.delete_per_min > 0) {
+        commander.delete_post.print_row(stdout, "DELETE zones", elapsed_s);
+    }
+    if (opts.provision) {
+        total.provision.print_row(stdout, "POST zones", elapsed_s);
+    }
+
+    printf("\nThroughput: %.1f subidas/s, %.1f lecturas de zona/s\n",
+           (double)total.upload.count() / elapsed_s, (double)total.zone_readings / elapsed_s);
+    printf("RTT de comando (app -> relé): n=%llu p50 %.2fs p90 %.2fs p99 %.2fs max %.2fs | perdidos %llu\n",
+           (unsigned long long)total.command_rtt.count(),
+           total.command_rtt.percentile_us(50) / 1e6, total.command_rtt.percentile_us(90) / 1e6,
+           total.command_rtt.percentile_us(99) / 1e6, total.command_rtt.max_us() / 1e6,
+           (unsigned long long)commander.commands_lost);
+    printf("Bomba: %llu cambios de relé | 404: %llu canales liberados, %llu re-emparejados | JSON inválido: %llu\n",
+           (unsigned long long)total.pump_switches, (unsigned long long)total.released,
+           (unsigned long long)total.repaired, (unsigned long long)total.bad_json);
+    printf("Retraso del planificador: p99 %.1f ms, max %.1f ms%s\n",
+           total.schedule_lag.percentile_us(99) / 1000.0, total.schedule_lag.max_us() / 1000.0,
+           total.schedule_lag.percentile_us(99) > (int64_t)(opts.interval_s * 1e6 / 10)
+               ? "  ⚠️ el generador no da abasto: subir --threads" : "");
+
+    return total.upload.count() > 0 ? 0 : 1;
+}
@@ -0,0 +1,779 @@
+/*
+ * AgroMind host tools - Simulación de gateway ESP-NOW con hojas
+ *
+ * Ejecuta main/espnow_link (tramas, agregación, reparto y reintentos),
+ * main/upload_protocol y main/zone_control de un gateway y N hojas sobre
+ * una radio simulada con pérdida y latencia, con reloj virtual: una hora de
+ * operación corre en segundos y el resultado es reproducible (--seed).
+ *
+ * La "nube" es un backend en proceso con las reglas de /api/iot/sensor-data
+ * que importan aquí: un bloque { zoneId, status, commands } por zona, el
+ * pumpState manual se entrega una sola vez y las zonas borradas dan 404.
+ *
+ * Verifica:
+ *   - cada zona de hoja llega a la nube en cada ciclo (hueco máximo)
+ *   - cada comando manual termina aplicado en la hoja dueña, aunque se
+ *     pierdan tramas (latencia p50/p99 y comandos perdidos)
+ *   - un 404 libera el canal en la hoja correcta
+ *   - con --gateway-outage las hojas vuelven a encontrar al gateway
+ *   - una hoja con el gateway vivo descarta las COMMANDS de otra MAC
+ *     (--rogue-per-min: "bomba encendida" en todas las zonas de una hoja)
+ * Sale con código 1 si hay comandos perdidos, zonas sin reportar, 404 sin
+ * propagar o una trama ajena aceptada.
+ *
+ * Uso:
+ *   gateway_sim [--leaves 10] [--zones-per-leaf 2] [--gateway-zones 1]
+ *               [--interval 5] [--duration 3600] [--loss 0.1]
+ *               [--latency-ms 3] [--cloud-latency-ms 300]
+ *               [--commands-per-min 6] [--delete-per-min 0]
+ *               [--upload-zones 24] [--auto-ratio 0.3]
+ *               [--gateway-outage-at 0 --gateway-outage-s 60]
+ *               [--rogue-per-min 2] [--seed 1] [--log-level error]
+ */
+
+#include <map>
+#include <queue>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cJSON.h"
+#include "esp_log.h"
+#include "espnow_link.h"
+#include "host_clock.h"
+#include "latency_stats.h"
+#include "upload_protocol.h"
+#include "zone_control.h"
+
+#define GATEWAY_INDEX 0
+static const uint8_t ROGUE_MAC[LINK_MAC_LEN] = { 0x02, 0xba, 0xd0, 0x00, 0x00, 0x01 };
+#define SIM_START_US 1000000LL
+
+struct sim_options_t {
+    int leaves = 10;
+    int zones_per_leaf = 2;
+    int gateway_zones = 1;
+    double interval_s = 5.0;
+    int duration_s = 3600;
+    double loss = 0.1;
+    double latency_ms = 3.0;
+    double cloud_latency_ms = 300.0;
+    double commands_per_min = 6.0;
+    double delete_per_min = 0.0;
+    int upload_zones = 24;
+    double auto_ratio = 0.3;
+    double outage_at_s = 0.0;
+    double outage_s = 60.0;
+    double rogue_per_min = 2.0;
+    uint32_t seed = 1;
+    esp_log_level_t log_level = ESP_LOG_ERROR;
+};
+
+enum event_type_t {
+    EVENT_LEAF_SAMPLE,
+    EVENT_GATEWAY_UPLOAD,
+    EVENT_CLOUD_RESPONSE,
+    EVENT_RADIO_DELIVER,
+    EVENT_CLOUD_COMMAND,
+    EVENT_CLOUD_DELETE,
+    EVENT_ROGUE_COMMANDS,
+};
+
+struct event_t {
+    int64_t at_us;
+    uint64_t order;             // desempate estable
+    event_type_t type;
+    int node;                   // destino (hoja o gateway)
+    int from;
+    std::string payload;        // trama o respuesta HTTP
+
+    bool operator<(const event_t &other) const {
+        return at_us != other.at_us ? at_us > other.at_us : order > other.order;
+    }
+};
+
+struct sim_node_t {
+    int index;
+    uint8_t mac[LINK_MAC_LEN];
+    node_state_t node;
+    link_leaf_t leaf;
+    uint32_t rng;
+    int32_t channel_zone[MAX_ZONE_CHANNELS];    // zona asignada al arrancar
+    float moisture[MAX_ZONE_CHANNELS];
+};
+
+// Estado de una zona en la nube simulada
+struct cloud_zone_t {
+    int owner;
+    int channel;
+    bool exists = true;
+    bool auto_mode = false;
+    float threshold = 30.0f;
+    uint32_t duration = 10;
+    int manual = -1;            // -1 = sin comando; 0/1 = pumpState pendiente
+    bool reported_pump = false;
+    int64_t last_report_us = 0;
+    int64_t max_gap_us = 0;
+    uint64_t reports = 0;
+    int64_t deleted_at_us = 0;
+    bool released = false;
+};
+
+struct pending_command_t {
+    int32_t zone_id;
+    bool state;
+    int64_t issued_us;
+};
+
+struct sim_stats_t {
+    uint64_t uploads = 0;
+    uint64_t uploaded_zones = 0;
+    uint64_t payload_bytes = 0;
+    uint64_t frames_sent = 0;
+    uint64_t frames_lost = 0;
+    uint64_t reading_frames = 0;
+    uint64_t reading_bytes = 0;
+    uint64_t commands_issued = 0;
+    uint64_t commands_superseded = 0;
+    uint64_t commands_cancelled = 0;
+    uint64_t deletes = 0;
+    uint64_t fallback_cycles = 0;       // ciclos de hoja sin gateway
+    uint64_t rogue_frames = 0;
+    uint64_t rogue_accepted = 0;        // aplicadas o que cambiaron el gateway
+    latency_stats_t command_latency;
+    latency_stats_t release_latency;
+};
+
+struct simulation_t {
+    sim_options_t opts;
+    std::vector<sim_node_t> nodes;
+    link_gateway_t gateway;
+    std::map<int32_t, cloud_zone_t> cloud;
+    std::vector<pending_command_t> pending;
+    std::priority_queue<event_t> events;
+    uint64_t event_order = 0;
+    uint32_t rng = 1;
+    sim_stats_t stats;
+};
+
+static simulation_t *g_sim = NULL;
+
+// ==================== UTILIDADES ====================
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static double random_unit(uint32_t *state) {
+    return (double)(next_random(state) >> 8) / (double)(1U << 24);
+}
+
+static double random_range(uint32_t *state, double lo, double hi) {
+    return lo + (hi - lo) * random_unit(state);
+}
+
+static int64_t seconds_to_us(double seconds) {
+    return (int64_t)(seconds * 1000000.0);
+}
+
+static void schedule(simulation_t *sim, int64_t at_us, event_type_t type, int node,
+                     int from = -1, const std::string &payload = std::string()) {
+    event_t event;
+    event.at_us = at_us;
+    event.order = sim->event_order++;
+    event.type = type;
+    event.node = node;
+    event.from = from;
+    event.payload = payload;
+    sim->events.push(event);
+}
+
+static bool gateway_down(const simulation_t *sim, int64_t now_us) {
+    if (sim->opts.outage_at_s <= 0.0) {
+        return false;
+    }
+    int64_t start = SIM_START_US + seconds_to_us(sim->opts.outage_at_s);
+    return now_us >= start && now_us < start + seconds_to_us(sim->opts.outage_s);
+}
+
+static bool parse_log_level(const char *text, esp_log_level_t *level) {
+    static const struct { const char *name; esp_log_level_t level; } LEVELS[] = {
+        { "none", ESP_LOG_NONE }, { "error", ESP_LOG_ERROR }, { "warn", ESP_LOG_WARN },
+        { "info", ESP_LOG_INFO }, { "debug", ESP_LOG_DEBUG },
+    };
+    for (const auto &entry : LEVELS) {
+        if (strcmp(text, entry.name) == 0) {
+            *level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Uso: %s [--leaves 10] [--zones-per-leaf 2] [--gateway-zones 1]\n"
+            "          [--interval 5] [--duration 3600] [--loss 0.1] [--latency-ms 3]\n"
+            "          [--cloud-latency-ms 300] [--commands-per-min 6] [--delete-per-min 0]\n"
+            "          [--upload-zones 24] [--auto-ratio 0.3]\n"
+            "          [--gateway-outage-at 0 --gateway-outage-s 60] [--rogue-per-min 2]\n"
+            "          [--seed 1] [--log-level error]\n",
+            argv0);
+}
+
+static bool parse_args(int argc, char **argv, sim_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--leaves") == 0) {
+            opts->leaves = atoi(value);
+        } else if (strcmp(arg, "--zones-per-leaf") == 0) {
+            opts->zones_per_leaf = atoi(value);
+        } else if (strcmp(arg, "--gateway-zones") == 0) {
+            opts->gateway_zones = atoi(value);
+        } else if (strcmp(arg, "--interval") == 0) {
+            opts->interval_s = atof(value);
+        } else if (strcmp(arg, "--duration") == 0) {
+            opts->duration_s = atoi(value);
+        } else if (strcmp(arg, "--loss") == 0) {
+            opts->loss = atof(value);
+        } else if (strcmp(arg, "--latency-ms") == 0) {
+            opts->latency_ms = atof(value);
+        } else if (strcmp(arg, "--cloud-latency-ms") == 0) {
+            opts->cloud_latency_ms = atof(value);
+        } else if (strcmp(arg, "--commands-per-min") == 0) {
+            opts->commands_per_min = atof(value);
+        } else if (strcmp(arg, "--delete-per-min") == 0) {
+            opts->delete_per_min = atof(value);
+        } else if (strcmp(arg, "--upload-zones") == 0) {
+            opts->upload_zones = atoi(value);
+        } else if (strcmp(arg, "--auto-ratio") == 0) {
+            opts->auto_ratio = atof(value);
+        } else if (strcmp(arg, "--gateway-outage-at") == 0) {
+            opts->outage_at_s = atof(value);
+        } else if (strcmp(arg, "--gateway-outage-s") == 0) {
+            opts->outage_s = atof(value);
+        } else if (strcmp(arg, "--rogue-per-min") == 0) {
+            opts->rogue_per_min = atof(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            opts->seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--log-level") == 0) {
+            if (!parse_log_level(value, &opts->log_level)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return opts->leaves >= 1 && opts->leaves <= LINK_MAX_LEAVES &&
+           opts->zones_per_leaf >= 1 && opts->zones_per_leaf <= MAX_ZONE_CHANNELS &&
+           opts->gateway_zones >= 0 && opts->gateway_zones <= MAX_ZONE_CHANNELS &&
+           opts->upload_zones >= MAX_ZONE_CHANNELS && opts->duration_s > 0 && opts->interval_s > 0 &&
+           opts->loss >= 0.0 && opts->loss < 1.0 && opts->seed != 0;
+}
+
+// ==================== RADIO SIMULADA ====================
+
+static int find_node_by_mac(const simulation_t *sim, const uint8_t mac[LINK_MAC_LEN]) {
+    for (const sim_node_t &node : sim->nodes) {
+        if (memcmp(node.mac, mac, LINK_MAC_LEN) == 0) {
+            return node.index;
+        }
+    }
+    return -1;
+}
+
+static void radio_transmit(simulation_t *sim, int from, int to, const uint8_t *data, size_t length) {
+    sim->stats.frames_sent++;
+    if (random_unit(&sim->rng) < sim->opts.loss) {
+        sim->stats.frames_lost++;
+        return;
+    }
+    double latency_ms = sim->opts.latency_ms * random_range(&sim->rng, 0.5, 1.5);
+    schedule(sim, host_clock_now_us() + seconds_to_us(latency_ms / 1000.0), EVENT_RADIO_DELIVER, to, from,
+             std::string((const char *)data, length));
+}
+
+static int sim_radio_send(void *ctx, const uint8_t mac[LINK_MAC_LEN], const uint8_t *data, size_t length) {
+    simulation_t *sim = g_sim;
+    const sim_node_t *sender = (const sim_node_t *)ctx;
+    if (sender->index == GATEWAY_INDEX && gateway_down(sim, host_clock_now_us())) {
+        return 0;   // la trama "sale" pero el gateway está apagado
+    }
+    if (link_frame_type(data, length) == LINK_FRAME_READING) {
+        sim->stats.reading_frames++;
+        sim->stats.reading_bytes += length;
+    }
+    if (memcmp(mac, LINK_BROADCAST_MAC, LINK_MAC_LEN) == 0) {
+        for (const sim_node_t &node : sim->nodes) {
+            if (node.index != sender->index) {
+                radio_transmit(sim, sender->index, node.index, data, length);
+            }
+        }
+        return 0;
+    }
+    int destination = find_node_by_mac(sim, mac);
+    if (destination < 0) {
+        return -1;
+    }
+    radio_transmit(sim, sender->index, destination, data, length);
+    return 0;
+}
+
+// ==================== HOOKS DE LOS NODOS ====================
+
+static void sim_zone_released(void *ctx, int channel) {
+    simulation_t *sim = g_sim;
+    const sim_node_t *node = (const sim_node_t *)ctx;
+    auto it = sim->cloud.find(node->channel_zone[channel]);
+    if (it == sim->cloud.end() || it->second.released) {
+        return;
+    }
+    it->second.released = true;
+    if (!it->second.exists) {
+        sim->stats.release_latency.add(host_clock_now_us() - it->second.deleted_at_us);
+    } else {
+        sim->stats.release_latency.add_error("zona existente");
+    }
+}
+
+// ==================== NUBE SIMULADA ====================
+
+static std::string cloud_process_upload(simulation_t *sim, const char *body) {
+    int64_t now = host_clock_now_us();
+    cJSON *request = cJSON_Parse(body);
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+    cJSON *results = cJSON_AddArrayToObject(response, "zones");
+
+    const cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, cJSON_GetObjectItem(request, "zones")) {
+        int32_t zone_id = (int32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "zoneId"));
+        cJSON *result = cJSON_CreateObject();
+        cJSON_AddNumberToObject(result, "zoneId", zone_id);
+        cJSON_AddItemToArray(results, result);
+
+        auto it = sim->cloud.find(zone_id);
+        if (it == sim->cloud.end() || !it->second.exists) {
+            cJSON_AddNumberToObject(result, "status", 404);
+            cJSON_AddStringToObject(result, "error", "Zona no encontrada");
+            continue;
+        }
+        cloud_zone_t *zone = &it->second;
+        if (zone->last_report_us > 0 && now - zone->last_report_us > zone->max_gap_us) {
+            zone->max_gap_us = now - zone->last_report_us;
+        }
+        zone->last_report_us = now;
+        zone->reports++;
+        cJSON *sensors = cJSON_GetObjectItem(entry, "sensors");
+        zone->reported_pump = cJSON_IsTrue(cJSON_GetObjectItem(sensors, "pumpStatus"));
+
+        cJSON_AddNumberToObject(result, "status", 200);
+        cJSON_AddBoolToObject(result, "success", true);
+        cJSON *commands = cJSON_AddObjectToObject(result, "commands");
+        if (zone->manual >= 0) {
+            cJSON_AddBoolToObject(commands, "pumpState", zone->manual == 1);
+            zone->manual = -1;      // el backend lo entrega una sola vez
+        } else {
+            cJSON_AddNullToObject(commands, "pumpState");
+        }
+        cJSON_AddBoolToObject(commands, "autoMode", zone->auto_mode);
+        cJSON_AddNumberToObject(commands, "moistureThreshold", zone->threshold);
+        cJSON_AddNumberToObject(commands, "wateringDuration", zone->duration);
+        cJSON_AddBoolToObject(commands, "tankLocked", false);
+    }
+
+    char *text = cJSON_PrintUnformatted(response);
+    std::string out = text != NULL ? text : "";
+    cJSON_free(text);
+    cJSON_Delete(response);
+    cJSON_Delete(request);
+    return out;
+}
+
+static void cloud_issue_command(simulation_t *sim) {
+    std::vector<int32_t> candidates;
+    for (const auto &entry : sim->cloud) {
+        if (entry.second.exists && !entry.second.auto_mode && entry.second.reports > 0) {
+            candidates.push_back(entry.first);
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    int32_t zone_id = candidates[next_random(&sim->rng) % candidates.size()];
+    cloud_zone_t *zone = &sim->cloud[zone_id];
+    bool state = !zone->reported_pump;
+    zone->manual = state ? 1 : 0;
+
+    for (auto it = sim->pending.begin(); it != sim->pending.end(); ++it) {
+        if (it->zone_id == zone_id) {
+            sim->pending.erase(it);
+            sim->stats.commands_superseded++;
+            break;
+        }
+    }
+    sim->pending.push_back({ zone_id, state, host_clock_now_us() });
+    sim->stats.commands_issued++;
+}
+
+static void cloud_delete_zone(simulation_t *sim) {
+    std::vector<int32_t> candidates;
+    for (const auto &entry : sim->cloud) {
+        if (entry.second.exists) {
+            candidates.push_back(entry.first);
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    int32_t zone_id = candidates[next_random(&sim->rng) % candidates.size()];
+    cloud_zone_t *zone = &sim->cloud[zone_id];
+    zone->exists = false;
+    zone->deleted_at_us = host_clock_now_us();
+    sim->stats.deletes++;
+}
+
+// Comandos ya visibles en el relé de su zona
+static void check_pending_commands(simulation_t *sim) {
+    int64_t now = host_clock_now_us();
+    for (size_t i = 0; i < sim->pending.size();) {
+        const pending_command_t &command = sim->pending[i];
+        const cloud_zone_t &zone = sim->cloud[command.zone_id];
+        if (!zone.exists) {
+            sim->stats.commands_cancelled++;
+            sim->pending.erase(sim->pending.begin() + (long)i);
+            continue;
+        }
+        const zone_state_t *state = &sim->nodes[zone.owner].node.zones[zone.channel];
+        if (state->zone_id == command.zone_id && state->pump_state == command.state) {
+            sim->stats.command_latency.add(now - command.issued_us);
+            sim->pending.erase(sim->pending.begin() + (long)i);
+            continue;
+        }
+        ++i;
+    }
+}
+
+// ==================== CICLOS DE LOS NODOS ====================
+
+static void sample_node(sim_node_t *node) {
+    node->node.temperature_c = (float)random_range(&node->rng, 18.0, 32.0);
+    node->node.ambient_humidity = (float)random_range(&node->rng, 30.0, 80.0);
+    node->node.tank_level = (float)random_range(&node->rng, 60.0, 90.0);
+    node->node.light_level = (float)random_range(&node->rng, 0.0, 100.0);
+    for (int ch = 0; ch < node->node.channel_count; ++ch) {
+        zone_state_t *zone = &node->node.zones[ch];
+        node->moisture[ch] += zone->pump_state ? 3.0f : -(float)random_range(&node->rng, 0.0, 0.6);
+        node->moisture[ch] = node->moisture[ch] < 5.0f ? 5.0f : (node->moisture[ch] > 90.0f ? 90.0f : node->moisture[ch]);
+        zone->last_soil_moisture = node->moisture[ch];
+    }
+    zone_apply_auto_mode_all(&node->node);
+}
+
+// Un vecino con otra MAC manda "bomba encendida" a todas las zonas de una
+// hoja que tiene el gateway vivo: no debe aplicarse ni quedarse con la hoja
+static void rogue_send_commands(simulation_t *sim) {
+    int target = 1 + (int)(next_random(&sim->rng) % (uint32_t)sim->opts.leaves);
+    sim_node_t *node = &sim->nodes[target];
+    if (!link_leaf_gateway_alive(&node->leaf)) {
+        return;
+    }
+    link_commands_t commands = {};
+    commands.seq = (uint16_t)next_random(&sim->rng);
+    for (int ch = 0; ch < node->node.channel_count; ++ch) {
+        if (node->node.zones[ch].zone_id > 0) {
+            link_zone_command_t *command = &commands.zones[commands.zone_count++];
+            command->zone_id = node->node.zones[ch].zone_id;
+            command->status = 200;
+            command->flags = LINK_CMD_HAS_PUMP | LINK_CMD_PUMP_ON;
+        }
+    }
+    uint8_t frame[LINK_MAX_FRAME];
+    size_t length = link_encode_commands(&commands, frame, sizeof(frame));
+    uint32_t applied = node->leaf.commands_applied;
+    link_leaf_handle_frame(&node->leaf, ROGUE_MAC, frame, length);
+    sim->stats.rogue_frames++;
+    if (node->leaf.commands_applied != applied ||
+        memcmp(node->leaf.gateway_mac, sim->nodes[GATEWAY_INDEX].mac, LINK_MAC_LEN) != 0) {
+        sim->stats.rogue_accepted++;
+    }
+}
+
+static void handle_leaf_sample(simulation_t *sim, sim_node_t *node) {
+    sample_node(node);
+    if (!link_leaf_gateway_alive(&node->leaf)) {
+        sim->stats.fallback_cycles++;
+    }
+    link_leaf_send_reading(&node->leaf);
+}
+
+static void handle_gateway_upload(simulation_t *sim) {
+    if (gateway_down(sim, host_clock_now_us())) {
+        return;
+    }
+    sim_node_t *gateway_node = &sim->nodes[GATEWAY_INDEX];
+    sample_node(gateway_node);
+    if (node_configured_zone_count(&gateway_node->node) + link_gateway_zone_count(&sim->gateway) == 0) {
+        return;
+    }
+
+    cJSON *root = upload_build_payload(&gateway_node->node);
+    int leaf_zones = link_gateway_add_zones(&sim->gateway, root, sim->opts.upload_zones);
+    char *payload = cJSON_PrintUnformatted(root);
+    sim->stats.uploads++;
+    sim->stats.uploaded_zones += (uint64_t)(node_configured_zone_count(&gateway_node->node) + leaf_zones);
+    sim->stats.payload_bytes += strlen(payload);
+
+    std::string response = cloud_process_upload(sim, payload);
+    cJSON_free(payload);
+    cJSON_Delete(root);
+    schedule(sim, host_clock_now_us() + seconds_to_us(sim->opts.cloud_latency_ms / 1000.0),
+             EVENT_CLOUD_RESPONSE, GATEWAY_INDEX, -1, response);
+}
+
+static void handle_cloud_response(simulation_t *sim, const std::string &body) {
+    cJSON *response = cJSON_Parse(body.c_str());
+    if (response == NULL) {
+        return;
+    }
+    upload_apply_response(&sim->nodes[GATEWAY_INDEX].node, response);
+    link_gateway_route_response(&sim->gateway, response);
+    cJSON_Delete(response);
+}
+
+static void handle_radio_delivery(simulation_t *sim, const event_t &event) {
+    const sim_node_t *sender = &sim->nodes[event.from];
+    const uint8_t *data = (const uint8_t *)event.payload.data();
+    size_t length = event.payload.size();
+    if (event.node == GATEWAY_INDEX) {
+        if (!gateway_down(sim, event.at_us)) {
+            link_gateway_handle_frame(&sim->gateway, sender->mac, data, length);
+        }
+    } else {
+        link_leaf_handle_frame(&sim->nodes[event.node].leaf, sender->mac, data, length);
+    }
+}
+
+// ==================== ARMADO ====================
+
+static void build_simulation(simulation_t *sim) {
+    const sim_options_t &opts = sim->opts;
+    sim->rng = opts.seed;
+    int32_t next_zone_id = 1;
+
+    sim->nodes.resize((size_t)opts.leaves + 1);
+    for (int i = 0; i <= opts.leaves; ++i) {
+        sim_node_t *node = &sim->nodes[i];
+        node->index = i;
+        uint8_t mac[LINK_MAC_LEN] = { 0x24, 0x6f, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i };
+        memcpy(node->mac, mac, LINK_MAC_LEN);
+        node->rng = opts.seed * 2654435761u + (uint32_t)i * 40503u + 1u;
+
+        int channels = i == GATEWAY_INDEX ? opts.gateway_zones : opts.zones_per_leaf;
+        node_hooks_t hooks = {};
+        hooks.zone_released = sim_zone_released;
+        hooks.ctx = node;
+        node_state_init(&node->node, channels > 0 ? channels : 1, &hooks);
+
+        for (int ch = 0; ch < channels; ++ch) {
+            int32_t zone_id = next_zone_id++;
+            node->node.zones[ch].zone_id = zone_id;
+            node->channel_zone[ch] = zone_id;
+            node->moisture[ch] = (float)random_range(&node->rng, 30.0, 60.0);
+
+            cloud_zone_t zone;
+            zone.owner = i;
+            zone.channel = ch;
+            zone.auto_mode = random_unit(&sim->rng) < opts.auto_ratio;
+            zone.threshold = (float)(int)random_range(&sim->rng, 25.0, 40.0);
+            zone.duration = (uint32_t)random_range(&sim->rng, 5.0, 30.0);
+            sim->cloud[zone_id] = zone;
+        }
+
+        link_radio_t radio = {};
+        radio.send = sim_radio_send;
+        radio.ctx = node;
+        if (i == GATEWAY_INDEX) {
+            link_gateway_init(&sim->gateway, &radio);
+            schedule(sim, SIM_START_US + seconds_to_us(opts.interval_s), EVENT_GATEWAY_UPLOAD, i);
+        } else {
+            link_leaf_init(&node->leaf, &node->node, &radio);
+            schedule(sim, SIM_START_US + seconds_to_us(random_range(&sim->rng, 0.0, opts.interval_s)),
+                     EVENT_LEAF_SAMPLE, i);
+        }
+    }
+
+    if (opts.commands_per_min > 0) {
+        schedule(sim, SIM_START_US + seconds_to_us(60.0 / opts.commands_per_min), EVENT_CLOUD_COMMAND, -1);
+    }
+    if (opts.delete_per_min > 0) {
+        schedule(sim, SIM_START_US + seconds_to_us(60.0 / opts.delete_per_min), EVENT_CLOUD_DELETE, -1);
+    }
+    if (opts.rogue_per_min > 0) {
+        schedule(sim, SIM_START_US + seconds_to_us(60.0 / opts.rogue_per_min), EVENT_ROGUE_COMMANDS, -1);
+    }
+}
+
+static void run_simulation(simulation_t *sim) {
+    const sim_options_t &opts = sim->opts;
+    int64_t end_us = SIM_START_US + seconds_to_us(opts.duration_s);
+    int64_t interval_us = seconds_to_us(opts.interval_s);
+
+    while (!sim->events.empty() && sim->events.top().at_us <= end_us) {
+        event_t event = sim->events.top();
+        sim->events.pop();
+        host_clock_advance_us(event.at_us - host_clock_now_us());
+
+        switch (event.type) {
+            case EVENT_LEAF_SAMPLE:
+                handle_leaf_sample(sim, &sim->nodes[event.node]);
+                schedule(sim, event.at_us + interval_us, EVENT_LEAF_SAMPLE, event.node);
+                break;
+            case EVENT_GATEWAY_UPLOAD:
+                handle_gateway_upload(sim);
+                schedule(sim, event.at_us + interval_us, EVENT_GATEWAY_UPLOAD, GATEWAY_INDEX);
+                break;
+            case EVENT_CLOUD_RESPONSE:
+                handle_cloud_response(sim, event.payload);
+                break;
+            case EVENT_RADIO_DELIVER:
+                handle_radio_delivery(sim, event);
+                break;
+            case EVENT_CLOUD_COMMAND:
+                cloud_issue_command(sim);
+                schedule(sim, event.at_us + seconds_to_us(60.0 / opts.commands_per_min *
+                                                          random_range(&sim->rng, 0.5, 1.5)),
+                         EVENT_CLOUD_COMMAND, -1);
+                break;
+            case EVENT_CLOUD_DELETE:
+                cloud_delete_zone(sim);
+                schedule(sim, event.at_us + seconds_to_us(60.0 / opts.delete_per_min *
+                                                          random_range(&sim->rng, 0.5, 1.5)),
+                         EVENT_CLOUD_DELETE, -1);
+                break;
+            case EVENT_ROGUE_COMMANDS:
+                rogue_send_commands(sim);
+                schedule(sim, event.at_us + seconds_to_us(60.0 / opts.rogue_per_min *
+                                                          random_range(&sim->rng, 0.5, 1.5)),
+                         EVENT_ROGUE_COMMANDS, -1);
+                break;
+        }
+        check_pending_commands(sim);
+    }
+    host_clock_advance_us(end_us - host_clock_now_us());
+}
+
+// ==================== REPORTE ====================
+
+static int print_report(simulation_t *sim) {
+    const sim_options_t &opts = sim->opts;
+    sim_stats_t &stats = sim->stats;
+    int64_t now = host_clock_now_us();
+    // Margen para lo que quedó en vuelo al terminar
+    int64_t grace_us = seconds_to_us(opts.interval_s * 4) + (opts.outage_at_s > 0 ? seconds_to_us(opts.outage_s) : 0);
+
+    int leaf_zones = opts.leaves * opts.zones_per_leaf;
+    printf("\n=== gateway_sim: %d hojas x %d zonas + %d zonas propias, %ds virtuales ===\n",
+           opts.leaves, opts.zones_per_leaf, opts.gateway_zones, opts.duration_s);
+
+    printf("\nSubidas a la nube (una sesión TLS en lugar de %d)\n", opts.leaves + 1);
+    printf("  POST                 %llu (%.1f zonas y %.0f bytes de media)\n",
+           (unsigned long long)stats.uploads,
+           stats.uploads ? (double)stats.uploaded_zones / (double)stats.uploads : 0.0,
+           stats.uploads ? (double)stats.payload_bytes / (double)stats.uploads : 0.0);
+    printf("  tramas READING       %llu (%.0f bytes de media)\n",
+           (unsigned long long)stats.reading_frames,
+           stats.reading_frames ? (double)stats.reading_bytes / (double)stats.reading_frames : 0.0);
+
+    // Frescura: hueco máximo entre reportes de cada zona viva
+    int never_reported = 0;
+    std::vector<int64_t> gaps;
+    for (const auto &entry : sim->cloud) {
+        const cloud_zone_t &zone = entry.second;
+        if (!zone.exists) {
+            continue;
+        }
+        if (zone.reports == 0) {
+            never_reported++;
+        } else {
+            gaps.push_back(zone.max_gap_us > now - zone.last_report_us ? zone.max_gap_us : now - zone.last_report_us);
+        }
+    }
+    latency_stats_t gap_stats;
+    for (int64_t gap : gaps) {
+        gap_stats.add(gap);
+    }
+    printf("  hueco máx. por zona  p50 %.1f s, máx %.1f s (intervalo %.1f s), sin reportar %d\n",
+           gap_stats.percentile_us(50) / 1e6, gap_stats.max_us() / 1e6, opts.interval_s, never_reported);
+
+    printf("\nRadio (pérdida %.0f %%)\n", opts.loss * 100.0);
+    printf("  tramas               %llu enviadas, %llu perdidas\n",
+           (unsigned long long)stats.frames_sent, (unsigned long long)stats.frames_lost);
+    printf("  COMMANDS             %u enviadas, %u retransmisiones\n",
+           sim->gateway.commands_sent, sim->gateway.retransmissions);
+    uint32_t duplicates = 0;
+    for (const sim_node_t &node : sim->nodes) {
+        duplicates += node.leaf.duplicates;
+    }
+    printf("  duplicados en hojas  %u, rechazadas en gateway %u\n", duplicates, sim->gateway.rejected_frames);
+    printf("  ciclos de hoja sin gateway  %llu\n", (unsigned long long)stats.fallback_cycles);
+    printf("  COMMANDS ajenas      %llu enviadas, %llu aceptadas\n",
+           (unsigned long long)stats.rogue_frames, (unsigned long long)stats.rogue_accepted);
+
+    int lost = 0;
+    for (const pending_command_t &command : sim->pending) {
+        if (now - command.issued_us > grace_us) {
+            lost++;
+        }
+    }
+    printf("\nComandos manuales: %llu emitidos, %llu reemplazados, %llu cancelados (zona borrada), %d perdidos\n",
+           (unsigned long long)stats.commands_issued, (unsigned long long)stats.commands_superseded,
+           (unsigned long long)stats.commands_cancelled, lost);
+    latency_stats_t::print_header(stdout);
+    stats.command_latency.print_row(stdout, "comando", opts.duration_s);
+
+    int unreleased = 0;
+    for (const auto &entry : sim->cloud) {
+        const cloud_zone_t &zone = entry.second;
+        if (!zone.exists && !zone.released && now - zone.deleted_at_us > grace_us) {
+            unreleased++;
+        }
+    }
+    if (stats.deletes > 0) {
+        printf("\nZonas borradas: %llu, canal liberado en la hoja: %llu, sin liberar: %d\n",
+               (unsigned long long)stats.deletes, (unsigned long long)stats.release_latency.count(), unreleased);
+        latency_stats_t::print_header(stdout);
+        stats.release_latency.print_row(stdout, "404->libre", opts.duration_s);
+    }
+
+    bool failed = lost > 0 || unreleased > 0 || stats.release_latency.error_count() > 0 || stats.rogue_accepted > 0 ||
+                  (leaf_zones + opts.gateway_zones <= opts.upload_zones && never_reported > 0);
+    printf("\n%s\n", failed ? "❌ FALLO" : "✅ OK");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    static simulation_t sim;
+    if (!parse_args(argc, argv, &sim.opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    g_sim = &sim;
+    esp_log_level_set("*", sim.opts.log_level);
+    host_clock_use_virtual(SIM_START_US);
+
+    build_simulation(&sim);
+    run_simulation(&sim);
+    return print_report(&sim);
+}
@@ -0,0 +1,223 @@
+/*
+ * AgroMind host tools - Generador de carga para el servidor local del ESP32
+ *
+ * Simula varias instancias de la app consultando /info mientras otras
+ * emparejan / desemparejan, y reporta latencias p50/p90/p99 y tasa de
+ * errores por endpoint. Un 503 en /pair o /unpair significa que la cola
+ * de workers asíncronos del firmware estaba llena.
+ *
+ * Uso:
+ *   local_httpd_load --host 192.168.1.50 [--port 80] [--threads 8]
+ *                    [--duration 30] [--mix 90:5:5] [--zone-id 1]
+ *                    [--channel 0] [--keep-alive] [--timeout-ms 5000]
+ *
+ * ⚠️ /pair y /unpair modifican el NVS del dispositivo: usar un nodo de banco.
+ * Se desempareja solo el canal indicado para no perder las demás zonas.
+ */
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_client.h"
+#include "latency_stats.h"
+
+enum endpoint_t {
+    ENDPOINT_INFO = 0,
+    ENDPOINT_PAIR,
+    ENDPOINT_UNPAIR,
+    ENDPOINT_COUNT
+};
+
+static const char *const ENDPOINT_NAMES[ENDPOINT_COUNT] = { "GET /info", "POST /pair", "POST /unpair" };
+
+struct load_options_t {
+    std::string host = "192.168.4.1";
+    uint16_t port = 80;
+    int threads = 8;
+    int duration_s = 30;
+    int mix[ENDPOINT_COUNT] = { 90, 5, 5 };
+    long zone_id = 1;
+    int channel = 0;
+    bool keep_alive = false;
+    int timeout_ms = 5000;
+};
+
+struct worker_result_t {
+    latency_stats_t stats[ENDPOINT_COUNT];
+    uint64_t busy_503 = 0;
+};
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Uso: %s --host IP [--port 80] [--threads 8] [--duration 30]\n"
+            "          [--mix info:pair:unpair] [--zone-id N] [--channel N]\n"
+            "          [--keep-alive] [--timeout-ms 5000]\n",
+            argv0);
+}
+
+static bool parse_mix(const char *text, int mix[ENDPOINT_COUNT]) {
+    int a, b, c;
+    if (sscanf(text, "%d:%d:%d", &a, &b, &c) != 3 || a < 0 || b < 0 || c < 0 || a + b + c == 0) {
+        return false;
+    }
+    mix[ENDPOINT_INFO] = a;
+    mix[ENDPOINT_PAIR] = b;
+    mix[ENDPOINT_UNPAIR] = c;
+    return true;
+}
+
+static bool parse_args(int argc, char **argv, load_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--keep-alive") == 0) {
+            opts->keep_alive = true;
+            continue;
+        }
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--host") == 0) {
+            opts->host = value;
+        } else if (strcmp(arg, "--port") == 0) {
+            opts->port = (uint16_t)atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            opts->threads = atoi(value);
+        } else if (strcmp(arg, "--duration") == 0) {
+            opts->duration_s = atoi(value);
+        } else if (strcmp(arg, "--mix") == 0) {
+            if (!parse_mix(value, opts->mix)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--zone-id") == 0) {
+            opts->zone_id = atol(value);
+        } else if (strcmp(arg, "--channel") == 0) {
+            opts->channel = atoi(value);
+        } else if (strcmp(arg, "--timeout-ms") == 0) {
+            opts->timeout_ms = atoi(value);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return opts->threads > 0 && opts->duration_s > 0 && opts->timeout_ms > 0;
+}
+
+// xorshift32: barato y suficiente para repartir la mezcla de endpoints
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static endpoint_t pick_endpoint(const load_options_t &opts, uint32_t *rng) {
+    int total = opts.mix[0] + opts.mix[1] + opts.mix[2];
+    int roll = (int)(next_random(rng) % (uint32_t)total);
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (roll < opts.mix[e]) {
+            return (endpoint_t)e;
+        }
+        roll -= opts.mix[e];
+    }
+    return ENDPOINT_INFO;
+}
+
+static void run_worker(const load_options_t &opts, int index, int64_t deadline_us,
+                       std::atomic<bool> *stop, worker_result_t *result) {
+    http_connection_t conn(opts.host, opts.port, opts.timeout_ms, opts.keep_alive);
+    uint32_t rng = 0x9E3779B9u ^ (uint32_t)(index * 2654435761u);
+
+    char pair_body[64];
+    char unpair_body[32];
+    snprintf(pair_body, sizeof(pair_body), "{\"zoneId\":%ld,\"channel\":%d}", opts.zone_id, opts.channel);
+    snprintf(unpair_body, sizeof(unpair_body), "{\"channel\":%d}", opts.channel);
+
+    while (!stop->load(std::memory_order_relaxed) && host_time_us() < deadline_us) {
+        endpoint_t endpoint = pick_endpoint(opts, &rng);
+        http_response_t response;
+        int64_t start = host_time_us();
+        http_result_t r;
+        switch (endpoint) {
+            case ENDPOINT_PAIR:
+                r = conn.request("POST", "/pair", pair_body, &response);
+                break;
+            case ENDPOINT_UNPAIR:
+                r = conn.request("POST", "/unpair", unpair_body, &response);
+                break;
+            default:
+                r = conn.request("GET", "/info", "", &response);
+                break;
+        }
+        int64_t elapsed = host_time_us() - start;
+
+        latency_stats_t &stats = result->stats[endpoint];
+        if (r != HTTP_RESULT_OK) {
+            stats.add_error(http_result_name(r));
+        } else if (response.status == 503) {
+            stats.add_error("503 ocupado");
+            result->busy_503++;
+        } else if (response.status < 200 || response.status >= 300) {
+            stats.add_error("http " + std::to_string(response.status));
+        } else {
+            stats.add(elapsed);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    load_options_t opts;
+    if (!parse_args(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    printf("🔨 Carga contra http://%s:%u  hilos=%d  duración=%ds  mezcla=%d:%d:%d  keep-alive=%s\n",
+           opts.host.c_str(), opts.port, opts.threads, opts.duration_s,
+           opts.mix[0], opts.mix[1], opts.mix[2], opts.keep_alive ? "sí" : "no");
+
+    std::vector<worker_result_t> results(opts.threads);
+    std::vector<std::thread> workers;
+    std::atomic<bool> stop(false);
+    int64_t start_us = host_time_us();
+    int64_t deadline_us = start_us + (int64_t)opts.duration_s * 1000000;
+
+    for (int i = 0; i < opts.threads; ++i) {
+        workers.emplace_back(run_worker, std::cref(opts), i, deadline_us, &stop, &results[i]);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    double elapsed_s = (double)(host_time_us() - start_us) / 1e6;
+
+    latency_stats_t totals[ENDPOINT_COUNT];
+    uint64_t busy_503 = 0;
+    for (const auto &result : results) {
+        for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+            totals[e].merge(result.stats[e]);
+        }
+        busy_503 += result.busy_503;
+    }
+
+    printf("\n");
+    latency_stats_t::print_header(stdout);
+    latency_stats_t all;
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        totals[e].print_row(stdout, ENDPOINT_NAMES[e], elapsed_s);
+        all.merge(totals[e]);
+    }
+    all.print_row(stdout, "total", elapsed_s);
+
+    if (busy_503 > 0) {
+        printf("\n⚠️  %llu respuestas 503: cola asíncrona llena (ASYNC_QUEUE_LENGTH)\n",
+               (unsigned long long)busy_503);
+    }
+    return all.count() > 0 ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+/*
+ * AgroMind host tools - Reglas de riego: benchmark del intérprete y prueba
+ * del verificador (main/rule_vm.h)
+ *
+ * Uso: rule_bench [--iterations 5000000] [--fuzz 200000] [--seed 1] [--hex 01...]
+ *
+ *   - Casos fijos: programas que no terminan (saltos hacia atrás), saltos a
+ *     mitad de instrucción, pilas vacías, llenas o distintas entre caminos,
+ *     código inalcanzable. Cada uno debe rechazarse con su motivo.
+ *   - Fuzz: expresiones aleatorias compiladas como lo hace ruleCompiler.ts
+ *     (todas deben verificarse) y versiones con bytes mutados. Cada programa
+ *     aceptado corre también en un intérprete de referencia con todas las
+ *     comprobaciones (pila, límites, pasos <= bytes); cualquier desborde,
+ *     bucle o resultado distinto de rule_eval() es un fallo del verificador.
+ *   - Benchmark: ns por evaluación de las reglas de ejemplo (hex generado por
+ *     el backend) y del peor caso, un programa de RULE_MAX_CODE bytes que
+ *     ejecuta todas sus instrucciones. Con --hex se agrega uno propio.
+ *
+ * Sale con código 1 si algún caso o programa del fuzz falla.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "rule_vm.h"
+
+#define INPUT_SETS 1024
+
+struct bench_options_t {
+    long iterations = 5000000;
+    long fuzz = 200000;
+    uint32_t seed = 1;
+    const char *hex = NULL;
+};
+
+typedef std::vector<uint8_t> bytes_t;
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static uint32_t random_below(uint32_t *state, uint32_t n) {
+    return next_random(state) % n;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr, "Uso: %s [--iterations 5000000] [--fuzz 200000] [--seed 1] [--hex 01...]\n", argv0);
+}
+
+static bool parse_args(int argc, char **argv, bench_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--iterations") == 0) {
+            opts->iterations = atol(value);
+        } else if (strcmp(arg, "--fuzz") == 0) {
+            opts->fuzz = atol(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            opts->seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--hex") == 0) {
+            opts->hex = value;
+        } else {
+            return false;
+        }
+    }
+    return opts->iterations > 0 && opts->fuzz >= 0 && opts->seed != 0;
+}
+
+// ==================== INTÉRPRETE DE REFERENCIA ====================
+// Lento y desconfiado: comprueba todo lo que rule_eval() da por hecho
+
+static int operand_bytes(uint8_t op) {
+    switch (op) {
+        case RULE_OP_PUSH: return 2;
+        case RULE_OP_LOAD: case RULE_OP_JMP: case RULE_OP_JFK: case RULE_OP_JTK: return 1;
+        default: return 0;
+    }
+}
+
+static bool reference_eval(const bytes_t &code, const rule_inputs_t *inputs, rule_result_t *result,
+                           size_t *steps, std::string *error) {
+    float stack[RULE_MAX_STACK];
+    int sp = 0;
+    size_t pc = 1;
+    *steps = 0;
+    while (pc < code.size()) {
+        if (++*steps > code.size()) {
+            *error = "no termina";
+            return false;
+        }
+        uint8_t op = code[pc];
+        size_t next = pc + 1 + (size_t)operand_bytes(op);
+        if (next > code.size()) {
+            *error = "lee fuera del programa";
+            return false;
+        }
+        int pops = 0;
+        int pushes = 0;
+        switch (op) {
+            case RULE_OP_PUSH: pushes = 1; break;
+            case RULE_OP_LOAD:
+                if (code[pc + 1] >= RULE_VAR_COUNT) {
+                    *error = "variable fuera de rango";
+                    return false;
+                }
+                pushes = 1;
+                break;
+            case RULE_OP_ADD: case RULE_OP_SUB: case RULE_OP_MUL:
+            case RULE_OP_LT: case RULE_OP_LE: case RULE_OP_GT: case RULE_OP_GE:
+            case RULE_OP_AND: case RULE_OP_OR:
+                pops = 2;
+                pushes = 1;
+                break;
+            case RULE_OP_NOT: pops = 1; pushes = 1; break;
+            case RULE_OP_JMP: break;
+            case RULE_OP_JFK: case RULE_OP_JTK: pops = 1; break;
+            default:
+                *error = "opcode desconocido";
+                return false;
+        }
+        if (sp < pops) {
+            *error = "pila vacía";
+            return false;
+        }
+        if (sp - pops + pushes > RULE_MAX_STACK) {
+            *error = "pila desbordada";
+            return false;
+        }
+
+        float a = sp >= 2 ? stack[sp - 2] : 0.0f;
+        float b = sp >= 1 ? stack[sp - 1] : 0.0f;
+        size_t target = next;
+        switch (op) {
+            case RULE_OP_PUSH:
+                stack[sp++] = (float)(int16_t)(code[pc + 1] | (code[pc + 2] << 8)) / 10.0f;
+                break;
+            case RULE_OP_LOAD:
+                if ((inputs->valid & (1U << code[pc + 1])) == 0) {
+                    *result = RULE_NO_DATA;
+                    return true;
+                }
+                stack[sp++] = inputs->values[code[pc + 1]];
+                break;
+            case RULE_OP_ADD: stack[sp - 2] = a + b; sp--; break;
+            case RULE_OP_SUB: stack[sp - 2] = a - b; sp--; break;
+            case RULE_OP_MUL: stack[sp - 2] = a * b; sp--; break;
+            case RULE_OP_LT: stack[sp - 2] = a < b; sp--; break;
+            case RULE_OP_LE: stack[sp - 2] = a <= b; sp--; break;
+            case RULE_OP_GT: stack[sp - 2] = a > b; sp--; break;
+            case RULE_OP_GE: stack[sp - 2] = a >= b; sp--; break;
+            case RULE_OP_AND: stack[sp - 2] = a != 0.0f && b != 0.0f; sp--; break;
+            case RULE_OP_OR: stack[sp - 2] = a != 0.0f || b != 0.0f; sp--; break;
+            case RULE_OP_NOT: stack[sp - 1] = b == 0.0f; break;
+            case RULE_OP_JMP:
+            case RULE_OP_JFK:
+            case RULE_OP_JTK: {
+                int64_t jump = (int64_t)next + (int8_t)code[pc + 1];
+                bool taken = op == RULE_OP_JMP || ((b != 0.0f) == (op == RULE_OP_JTK));
+                if (taken) {
+                    if (jump < 1 || jump > (int64_t)code.size()) {
+                        *error = "salto fuera del programa";
+                        return false;
+                    }
+                    target = (size_t)jump;
+                } else {
+                    sp--;
+                }
+                break;
+            }
+        }
+        pc = target;
+    }
+    if (sp != 1) {
+        *error = "no termina con un valor";
+        return false;
+    }
+    *result = stack[0] != 0.0f ? RULE_ALLOW : RULE_BLOCK;
+    return true;
+}
+
+// ==================== GENERADOR ====================
+// Emite el mismo bytecode que ruleCompiler.ts para una expresión aleatoria
+
+struct emitter_t {
+    bytes_t code;
+    int depth = 0;
+    int max_depth = 0;
+};
+
+static void emit(emitter_t *e, uint8_t op, int stack_change) {
+    e->code.push_back(op);
+    e->depth += stack_change;
+    e->max_depth = e->depth > e->max_depth ? e->depth : e->max_depth;
+}
+
+static void emit_push(emitter_t *e, int16_t tenths) {
+    emit(e, RULE_OP_PUSH, 1);
+    e->code.push_back((uint8_t)(tenths & 0xff));
+    e->code.push_back((uint8_t)((tenths >> 8) & 0xff));
+}
+
+static void emit_load(emitter_t *e, uint8_t var) {
+    emit(e, RULE_OP_LOAD, 1);
+    e->code.push_back(var);
+}
+
+static void gen_expr(uint32_t *rng, emitter_t *e, int budget) {
+    uint32_t kind = budget <= 0 ? random_below(rng, 2) : random_below(rng, 7);
+    switch (kind) {
+        case 0:
+            emit_push(e, (int16_t)((int)random_below(rng, 2001) - 1000));
+            break;
+        case 1:
+            emit_load(e, (uint8_t)random_below(rng, RULE_VAR_COUNT));
+            break;
+        case 2:
+            gen_expr(rng, e, budget - 1);
+            gen_expr(rng, e, budget - 1);
+            emit(e, (uint8_t)(RULE_OP_LT + random_below(rng, 4)), -1);
+            break;
+        case 3:
+            gen_expr(rng, e, budget - 1);
+            gen_expr(rng, e, budget - 1);
+            emit(e, (uint8_t)(RULE_OP_ADD + random_below(rng, 3)), -1);
+            break;
+        case 4:
+            gen_expr(rng, e, budget - 1);
+            emit(e, RULE_OP_NOT, 0);
+            break;
+        default: {
+            // and/or con cortocircuito: a JFK|JTK fin b fin:
+            gen_expr(rng, e, budget - 1);
+            emit(e, random_below(rng, 2) ? RULE_OP_JFK : RULE_OP_JTK, -1);
+            e->code.push_back(0);
+            size_t patch = e->code.size() - 1;
+            gen_expr(rng, e, budget - 1);
+            e->code[patch] = (uint8_t)(e->code.size() - (patch + 1));
+            break;
+        }
+    }
+}
+
+static bool generate_program(uint32_t *rng, bytes_t *out) {
+    emitter_t e;
+    e.code.push_back(RULE_VM_VERSION);
+    gen_expr(rng, &e, 1 + (int)random_below(rng, 5));
+    if (e.code.size() > RULE_MAX_CODE || e.max_depth > RULE_MAX_STACK) {
+        return false;
+    }
+    *out = e.code;
+    return true;
+}
+
+static void mutate(uint32_t *rng, bytes_t *code) {
+    int changes = 1 + (int)random_below(rng, 3);
+    for (int i = 0; i < changes; ++i) {
+        size_t at = random_below(rng, (uint32_t)code->size());
+        switch (random_below(rng, 5)) {
+            case 0:
+                (*code)[at] = (uint8_t)next_random(rng);
+                break;
+            case 1:
+                // Salto hacia atrás: un bucle si el verificador lo dejara pasar
+                (*code)[at] = RULE_OP_JMP + (uint8_t)random_below(rng, 3);
+                if (at + 1 < code->size()) {
+                    (*code)[at + 1] = (uint8_t)(int8_t)-(1 + (int)random_below(rng, 16));
+                }
+                break;
+            case 2:
+                code->resize(1 + random_below(rng, (uint32_t)code->size()));
+                break;
+            case 3:
+                code->insert(code->begin() + (long)at, (uint8_t)(RULE_OP_ADD + random_below(rng, 0x30)));
+                break;
+            default:
+                code->erase(code->begin() + (long)at);
+                if (code->empty()) {
+                    code->push_back(RULE_VM_VERSION);
+                }
+                break;
+        }
+    }
+}
+
+static void random_inputs(uint32_t *rng, rule_inputs_t *inputs) {
+    for (int v = 0; v < RULE_VAR_COUNT; ++v) {
+        inputs->values[v] = (float)((int)random_below(rng, 1201) - 100) / 10.0f;
+    }
+    // De vez en cuando un sensor sin lectura fiable
+    inputs->valid = (1U << RULE_VAR_COUNT) - 1;
+    if (random_below(rng, 8) == 0) {
+        inputs->valid &= ~(1U << random_below(rng, RULE_VAR_COUNT));
+    }
+}
+
+// ==================== CASOS FIJOS ====================
+
+struct fixed_case_t {
+    const char *name;
+    bytes_t code;
+    rule_verify_t expected;
+};
+
+static std::vector<fixed_case_t> fixed_cases(void) {
+    const uint8_t V = RULE_VM_VERSION;
+    std::vector<fixed_case_t> cases = {
+        { "bucle JMP -2", { V, RULE_OP_PUSH, 10, 0, RULE_OP_JMP, 0xFE }, RULE_VERIFY_BACKWARD_JUMP },
+        { "bucle JTK al inicio", { V, RULE_OP_PUSH, 10, 0, RULE_OP_JTK, 0xFA }, RULE_VERIFY_BACKWARD_JUMP },
+        { "salto a un operando", { V, RULE_OP_JMP, 1, RULE_OP_PUSH, 10, 0 }, RULE_VERIFY_BAD_JUMP },
+        { "salto tras el final", { V, RULE_OP_PUSH, 10, 0, RULE_OP_JFK, 9 }, RULE_VERIFY_BAD_JUMP },
+        { "pila vacía", { V, RULE_OP_PUSH, 10, 0, RULE_OP_ADD }, RULE_VERIFY_STACK_UNDERFLOW },
+        { "pila distinta", { V, RULE_OP_PUSH, 1, 0, RULE_OP_JFK, 6, RULE_OP_PUSH, 1, 0, RULE_OP_PUSH, 1, 0 },
+          RULE_VERIFY_STACK_MISMATCH },
+        { "inalcanzable", { V, RULE_OP_PUSH, 1, 0, RULE_OP_JMP, 3, RULE_OP_PUSH, 1, 0 }, RULE_VERIFY_UNREACHABLE },
+        { "variable 9", { V, RULE_OP_LOAD, 9 }, RULE_VERIFY_BAD_VARIABLE },
+        { "opcode 0xFF", { V, 0xFF }, RULE_VERIFY_BAD_OPCODE },
+        { "PUSH sin operando", { V, RULE_OP_PUSH, 1 }, RULE_VERIFY_TRUNCATED },
+        { "versión 2", { 2, RULE_OP_PUSH, 1, 0 }, RULE_VERIFY_BAD_VERSION },
+        { "sin instrucciones", { V }, RULE_VERIFY_BAD_RESULT },
+        { "dos resultados", { V, RULE_OP_PUSH, 1, 0, RULE_OP_PUSH, 1, 0 }, RULE_VERIFY_BAD_RESULT },
+        { "vacío", {}, RULE_VERIFY_EMPTY },
+    };
+
+    fixed_case_t overflow = { "9 valores en la pila", { V }, RULE_VERIFY_STACK_OVERFLOW };
+    for (int i = 0; i < RULE_MAX_STACK + 1; ++i) {
+        overflow.code.insert(overflow.code.end(), { RULE_OP_LOAD, 0 });
+    }
+    cases.push_back(overflow);
+
+    fixed_case_t too_long = { "65 bytes", { V }, RULE_VERIFY_TOO_LONG };
+    too_long.code.insert(too_long.code.end(), { RULE_OP_PUSH, 1, 0 });
+    while (too_long.code.size() < RULE_MAX_CODE + 1) {
+        too_long.code.push_back(RULE_OP_NOT);
+    }
+    cases.push_back(too_long);
+    return cases;
+}
+
+// ==================== BENCHMARK ====================
+
+struct bench_program_t {
+    std::string name;
+    bytes_t code;
+};
+
+static bytes_t from_hex(const char *hex) {
+    uint8_t code[RULE_MAX_CODE];
+    size_t length = 0;
+    if (!rule_hex_decode(hex, code, &length)) {
+        return bytes_t();
+    }
+    return bytes_t(code, code + length);
+}
+
+// soil < 90 and soil < 91 and ... : con humedad baja ejecuta todo el programa
+static bytes_t worst_case_program(void) {
+    emitter_t e;
+    e.code.push_back(RULE_VM_VERSION);
+    for (int i = 0;; ++i) {
+        size_t needed = (i == 0 ? 6 : 8);
+        if (e.code.size() + needed > RULE_MAX_CODE) {
+            break;
+        }
+        size_t patch = 0;
+        if (i > 0) {
+            emit(&e, RULE_OP_JFK, -1);
+            e.code.push_back(0);
+            patch = e.code.size() - 1;
+        }
+        emit_load(&e, RULE_VAR_SOIL);
+        emit_push(&e, (int16_t)(900 + i));
+        emit(&e, RULE_OP_LT, -1);
+        if (i > 0) {
+            e.code[patch] = (uint8_t)(e.code.size() - (patch + 1));
+        }
+    }
+    return e.code;
+}
+
+static size_t count_instructions(const bytes_t &code) {
+    size_t count = 0;
+    for (size_t pc = 1; pc < code.size(); pc += 1 + (size_t)operand_bytes(code[pc])) {
+        count++;
+    }
+    return count;
+}
+
+static double bench_program(const rule_program_t *program, const rule_inputs_t *inputs, long iterations,
+                            long *allowed) {
+    volatile long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        sink = sink + (rule_eval(program, &inputs[i & (INPUT_SETS - 1)]) == RULE_ALLOW);
+    }
+    auto end = std::chrono::steady_clock::now();
+    *allowed = sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+}
+
+int main(int argc, char **argv) {
+    bench_options_t opts;
+    if (!parse_args(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    uint32_t rng = opts.seed;
+    bool failed = false;
+
+    printf("Casos fijos\n");
+    for (const fixed_case_t &c : fixed_cases()) {
+        rule_verify_t result = rule_verify(c.code.data(), c.code.size());
+        bool ok = result == c.expected;
+        failed = failed || !ok;
+        printf("  %s %-22s %s\n", ok ? "✅" : "❌", c.name, rule_verify_name(result));
+    }
+
+    // Fuzz: generados (deben pasar) y mutados (lo que pase debe ser seguro)
+    long generated = 0, generated_rejected = 0, mutated = 0, accepted = 0, unsafe = 0, mismatched = 0;
+    long verdicts[RULE_VERIFY_BAD_RESULT + 1] = {};
+    size_t max_steps = 0;
+    for (long i = 0; i < opts.fuzz; ++i) {
+        bytes_t code;
+        if (!generate_program(&rng, &code)) {
+            continue;
+        }
+        generated++;
+        if (rule_verify(code.data(), code.size()) != RULE_VERIFY_OK) {
+            generated_rejected++;
+            continue;
+        }
+        mutate(&rng, &code);
+        mutated++;
+        rule_verify_t verdict = rule_verify(code.data(), code.size());
+        verdicts[verdict]++;
+        if (verdict != RULE_VERIFY_OK) {
+            continue;
+        }
+        accepted++;
+
+        rule_program_t program = {};
+        rule_program_load(&program, code.data(), code.size());
+        for (int trial = 0; trial < 4; ++trial) {
+            rule_inputs_t inputs;
+            random_inputs(&rng, &inputs);
+            rule_result_t expected;
+            size_t steps = 0;
+            std::string error;
+            if (!reference_eval(code, &inputs, &expected, &steps, &error)) {
+                if (unsafe++ < 5) {
+                    fprintf(stderr, "❌ Programa aceptado pero inseguro (%s), %zu bytes\n", error.c_str(), code.size());
+                }
+                break;
+            }
+            max_steps = steps > max_steps ? steps : max_steps;
+            if (rule_eval(&program, &inputs) != expected) {
+                mismatched++;
+                break;
+            }
+        }
+    }
+    failed = failed || generated_rejected > 0 || unsafe > 0 || mismatched > 0;
+    printf("\nFuzz (semilla %u)\n", (unsigned)opts.seed);
+    printf("  generados            %ld, rechazados %ld (deben ser 0)\n", generated, generated_rejected);
+    printf("  mutados              %ld, aceptados %ld, inseguros %ld, resultado distinto %ld\n", mutated, accepted,
+           unsafe, mismatched);
+    printf("  pasos máx.           %zu (límite %d bytes)\n", max_steps, RULE_MAX_CODE);
+    for (int v = RULE_VERIFY_EMPTY; v <= RULE_VERIFY_BAD_RESULT; ++v) {
+        if (verdicts[v] > 0) {
+            printf("    %-26s %ld\n", rule_verify_name((rule_verify_t)v), verdicts[v]);
+        }
+    }
+
+    // Reglas de ejemplo tal como las compila backend/src/services/ruleCompiler.ts
+    std::vector<bench_program_t> programs = {
+        { "light < 70 and temperature >= 10", from_hex("01020401bc02203106020201640023") },
+        { "not (humedad > 85) y luz < 80", from_hex("01020301520322283106020401200320") },
+        { "soil < threshold - 5 or tank > 50", from_hex("010200020501320011203206020101f40122") },
+        { "peor caso", worst_case_program() },
+    };
+    if (opts.hex != NULL) {
+        programs.push_back({ std::string("--hex ") + opts.hex, from_hex(opts.hex) });
+    }
+
+    static rule_inputs_t inputs[INPUT_SETS];
+    for (int i = 0; i < INPUT_SETS; ++i) {
+        random_inputs(&rng, &inputs[i]);
+        inputs[i].valid = (1U << RULE_VAR_COUNT) - 1;
+    }
+
+    printf("\nBenchmark (%ld evaluaciones por regla)\n", opts.iterations);
+    printf("  %-36s %6s %6s %10s %10s\n", "regla", "bytes", "instr", "ns/eval", "permite");
+    for (const bench_program_t &p : programs) {
+        rule_program_t program = {};
+        rule_verify_t result = rule_program_load(&program, p.code.data(), p.code.size());
+        if (result != RULE_VERIFY_OK) {
+            printf("  %-36s rechazada: %s\n", p.name.c_str(), rule_verify_name(result));
+            failed = true;
+            continue;
+        }
+        long allowed = 0;
+        double ns = bench_program(&program, inputs, opts.iterations, &allowed);
+        printf("  %-36s %6zu %6zu %10.1f %9.1f%%\n", p.name.c_str(), p.code.size(), count_instructions(p.code), ns,
+               100.0 * (double)allowed / (double)opts.iterations);
+    }
+
+    printf("\n%s\n", failed ? "❌ FALLO" : "✅ OK");
+    return failed ? 1 : 0;
+}
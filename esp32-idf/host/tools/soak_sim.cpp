@@ -0,0 +1,1105 @@
+/*
+ * AgroMind host tools - Prueba de resistencia (soak) con reloj virtual
+ *
+ * Corre 90 días de operación de un nodo en pocos minutos: los filtros de
+ * sensores (main/sensor_filter.h), el control de zonas y el modelo del suelo
+ * (main/zone_control, main/soil_model), el protocolo de subida
+ * (main/upload_protocol) y la persistencia por canal (main/node_storage)
+ * sobre un suelo, un tanque y un clima simulados. Los errores que solo
+ * aparecen tras semanas encendido salen aquí:
+ *
+ *   - ticks: cada arranque queda a --boot-before-wrap-h horas del desborde
+ *     de TickType_t (49.7 días a 1000 Hz) y se verifica que ningún riego
+ *     automático termine antes o después de su plazo. Además se prueba un
+ *     riego que cruza el desborde en cada segundo de su duración.
+ *   - heap: cJSON del ciclo de envío reserva en un heap first-fit simulado;
+ *     pico por ciclo, mínimo libre histórico, bloque libre mayor y bloques
+ *     que siguen vivos al cerrar el ciclo (fugas).
+ *   - NVS: escrituras, entradas de 32 bytes y borrados de página estimados
+ *     (host/shim/host_nvs.h), con cortes de luz y reinicios por OTA.
+ *   - agua: litros reales contra los del nodo y los que suma el backend con
+ *     las reglas de /api/iot/sensor-data (diferencia de contadores).
+ *   - control rápido: mientras una bomba riega, el suelo y el tanque se leen
+ *     a --fast-hz como control_task (0 = solo cada ciclo); se mide cuánto
+ *     sigue la bomba después de que el suelo real pasó el objetivo y cuánta
+ *     agua se saca con el tanque bajo MIN_TANK_PERCENTAGE.
+ *   - API local: la app cambia umbral y duración con POST /control (también
+ *     durante caídas del servidor) y la nube adopta el localConfig; tras
+ *     cada subida confirmada la config del nodo y la de la nube coinciden.
+ *
+ * Sale con código 1 si algún riego no respeta su plazo, hay fugas o reservas
+ * fallidas, el backend se desvía más de un 1 %, la NVS no llega a 10 años,
+ * la config del nodo y la de la nube quedan distintas o el modelo del suelo
+ * aprende una ganancia a más de un 15 % de la real o un secado a más de un
+ * 30 % (o 0.1 %/h).
+ *
+ * Uso:
+ *   soak_sim [--days 90] [--zones 4] [--interval 5] [--boot-before-wrap-h 12]
+ *            [--power-loss-per-week 0.5] [--ota-per-month 1] [--upload-fail 0.02]
+ *            [--commands-per-day 4] [--local-changes-per-day 2] [--outages-per-week 1]
+ *            [--fast-hz 4] [--heap-kb 64] [--nvs-pages 4] [--seed 1] [--log-level error]
+ */
+
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cJSON.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_clock.h"
+#include "host_nvs.h"
+#include "node_storage.h"
+#include "sensor_filter.h"
+#include "upload_protocol.h"
+#include "zone_control.h"
+
+#define SIM_START_US 1000000LL
+#define TICK_WRAP_US ((int64_t)(1ULL << 32) * (1000000 / configTICK_RATE_HZ))
+#define US_PER_HOUR 3600000000LL
+#define US_PER_DAY (24 * US_PER_HOUR)
+
+#define HEAP_ALIGN 8
+#define HEAP_BLOCK_OVERHEAD 8           // cabecera por bloque, como multi_heap
+#define TANK_CAPACITY_L 200.0
+#define FLASH_ERASE_CYCLES 100000.0
+#define MIN_NVS_LIFETIME_YEARS 10.0
+#define MAX_WATER_ERROR 0.01
+#define MAX_SOIL_GAIN_ERROR 0.15       // fracción de la ganancia real
+#define MAX_SOIL_DRY_ERROR 0.30        // fracción del secado real...
+#define MAX_SOIL_DRY_ERROR_ABS 0.10    // ...o %/h, lo que sea mayor
+#define PUMP_STEP_US 250000             // paso del entorno con una bomba encendida
+
+// Mismos valores por defecto que main.cpp
+#define SOIL_FILTER (5, 3.0f, 1.0f, 0.5f, 15.0f, 3)
+#define LIGHT_FILTER (3, 3.0f, 2.0f, 0.6f, 0.0f, 3)
+#define TANK_FILTER (5, 3.0f, 1.0f, 0.4f, 10.0f, 3)
+#define TEMPERATURE_FILTER (5, 3.0f, 0.5f, 0.5f, 3.0f, 6)
+#define HUMIDITY_FILTER (5, 3.0f, 2.0f, 0.5f, 10.0f, 6)
+
+struct soak_options_t {
+    int days = 90;
+    int zones = 4;
+    double interval_s = 5.0;
+    double boot_before_wrap_h = 12.0;   // 0 = cada arranque desde tick 0
+    double power_loss_per_week = 0.5;
+    double ota_per_month = 1.0;
+    double upload_fail = 0.02;
+    double commands_per_day = 4.0;      // por zona manual
+    double local_changes_per_day = 2.0; // POST /control con config, por nodo
+    double outages_per_week = 1.0;      // servidor caído de 10 min a 3 h
+    int fast_hz = 4;                    // FAST_CONTROL_HZ; 0 = sin control rápido
+    int heap_kb = 64;
+    uint32_t nvs_pages = 4;             // partición nvs de 0x4000
+    uint32_t seed = 1;
+    esp_log_level_t log_level = ESP_LOG_ERROR;
+};
+
+// ==================== HEAP SIMULADO ====================
+
+// First-fit con unión de bloques libres vecinos. Solo lo usa cJSON mientras
+// corre código del nodo; la nube simulada usa malloc.
+struct sim_heap_t {
+    std::vector<uint8_t> memory;
+    std::map<uint32_t, uint32_t> free_blocks;               // offset -> tamaño
+    std::unordered_map<uint32_t, uint32_t> used_blocks;
+    size_t used = 0;
+    size_t min_free = 0;
+    size_t cycle_peak = 0;
+    size_t cycle_peak_blocks = 0;
+    size_t peak = 0;
+    size_t peak_blocks = 0;
+    size_t min_largest_free = 0;
+    uint64_t allocations = 0;
+    uint64_t failures = 0;
+    uint64_t leaked_cycles = 0;
+    bool device = false;                // reservas del nodo o de la nube
+};
+
+static sim_heap_t g_heap;
+
+static void heap_init(sim_heap_t *heap, size_t bytes) {
+    heap->memory.assign(bytes, 0);
+    heap->free_blocks.clear();
+    heap->free_blocks[0] = (uint32_t)bytes;
+    heap->min_free = bytes;
+    heap->min_largest_free = bytes;
+}
+
+static size_t heap_largest_free(const sim_heap_t *heap) {
+    size_t largest = 0;
+    for (const auto &block : heap->free_blocks) {
+        largest = block.second > largest ? block.second : largest;
+    }
+    return largest;
+}
+
+static void *sim_malloc(size_t size) {
+    sim_heap_t *heap = &g_heap;
+    if (!heap->device) {
+        return malloc(size);
+    }
+    uint32_t need = (uint32_t)(((size + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1)) + HEAP_BLOCK_OVERHEAD);
+    for (auto it = heap->free_blocks.begin(); it != heap->free_blocks.end(); ++it) {
+        if (it->second < need) {
+            continue;
+        }
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - need;
+        heap->free_blocks.erase(it);
+        if (remaining >= HEAP_BLOCK_OVERHEAD + HEAP_ALIGN) {
+            heap->free_blocks[offset + need] = remaining;
+        } else {
+            need += remaining;
+        }
+        heap->used_blocks[offset] = need;
+        heap->used += need;
+        heap->allocations++;
+        if (heap->used > heap->cycle_peak) {
+            heap->cycle_peak = heap->used;
+            heap->cycle_peak_blocks = heap->used_blocks.size();
+        }
+        size_t free_now = heap->memory.size() - heap->used;
+        heap->min_free = free_now < heap->min_free ? free_now : heap->min_free;
+        return heap->memory.data() + offset + HEAP_BLOCK_OVERHEAD;
+    }
+    // Sin bloque: en el ESP32 sería NULL; aquí se registra y se sigue
+    heap->failures++;
+    return malloc(size);
+}
+
+static void sim_free(void *ptr) {
+    sim_heap_t *heap = &g_heap;
+    uint8_t *p = (uint8_t *)ptr;
+    if (p == NULL) {
+        return;
+    }
+    if (p < heap->memory.data() || p >= heap->memory.data() + heap->memory.size()) {
+        free(ptr);
+        return;
+    }
+    uint32_t offset = (uint32_t)(p - heap->memory.data() - HEAP_BLOCK_OVERHEAD);
+    auto used = heap->used_blocks.find(offset);
+    if (used == heap->used_blocks.end()) {
+        fprintf(stderr, "❌ free() de un bloque no reservado (offset %u)\n", offset);
+        abort();
+    }
+    uint32_t size = used->second;
+    heap->used_blocks.erase(used);
+    heap->used -= size;
+
+    auto next = heap->free_blocks.lower_bound(offset);
+    if (next != heap->free_blocks.end() && offset + size == next->first) {
+        size += next->second;
+        next = heap->free_blocks.erase(next);
+    }
+    if (next != heap->free_blocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    heap->free_blocks[offset] = size;
+}
+
+// ==================== ESTADO DE LA SIMULACIÓN ====================
+
+struct soil_sim_t {
+    double moisture;
+    double infiltrating = 0.0;          // agua aplicada que aún no llega al sensor
+    double gain_per_s;
+    double dry_per_hour;
+};
+
+// Riego en curso visto desde el relé
+struct pump_session_t {
+    bool on = false;
+    bool automatic = false;
+    bool overrun_reported = false;
+    int64_t start_us = 0;
+    uint32_t planned_s = 0;
+    int64_t target_reached_us = 0;      // el suelo real llegó a umbral + histéresis
+};
+
+// Zona en la nube: configuración y contabilidad como backend/src/routes/iot.ts
+struct cloud_zone_t {
+    bool auto_mode = true;
+    float threshold = 35.0f;
+    uint32_t duration = 45;
+    int manual = -1;                    // -1 = sin comando; 0/1 = pumpState pendiente
+    int64_t next_command_us = 0;
+    bool has_baseline = false;
+    double device_sessions = 0;
+    double device_runtime_ms = 0;
+    double device_liters = 0;
+    double liters = 0;
+    uint64_t sessions = 0;
+};
+
+struct soak_stats_t {
+    uint64_t cycles = 0;
+    uint64_t uploads = 0;
+    uint64_t failed_uploads = 0;
+    uint64_t payload_bytes = 0;
+    size_t max_payload = 0;
+    uint64_t boots = 0;
+    uint64_t power_losses = 0;
+    uint64_t ota_reboots = 0;
+    uint64_t tick_wraps = 0;
+    int64_t max_uptime_us = 0;
+    uint64_t auto_sessions = 0;
+    uint64_t cut_short = 0;
+    uint64_t overrun = 0;
+    uint64_t truth_sessions = 0;
+    int64_t truth_runtime_us = 0;
+    uint64_t sessions_lost = 0;         // riegos que el nodo olvidó por cortes
+    uint64_t fast_samples = 0;
+    uint64_t overshoot_sessions = 0;
+    int64_t overshoot_total_us = 0;
+    int64_t overshoot_max_us = 0;
+    double liters_below_min = 0.0;
+    uint64_t outages = 0;
+    uint64_t local_changes = 0;
+    uint64_t local_config_uploads = 0;  // zonas que viajaron con localConfig
+    uint64_t config_checks = 0;
+    uint64_t config_mismatches = 0;
+    int wrap_probes = 0;
+    int wrap_failures = 0;
+};
+
+struct soak_t {
+    soak_options_t opts;
+    uint32_t rng = 1;
+    int64_t sim_us = 0;                 // tiempo total simulado
+    int64_t boot_us = 0;                // sim_us del último arranque
+    TickType_t last_tick = 0;
+
+    node_state_t node;
+    sensor_filter_t soil_filters[MAX_ZONE_CHANNELS];
+    sensor_filter_t tank_filter;
+    sensor_filter_t light_filter;
+    sensor_filter_t temperature_filter;
+    sensor_filter_t humidity_filter;
+
+    soil_sim_t soil[MAX_ZONE_CHANNELS];
+    pump_session_t sessions[MAX_ZONE_CHANNELS];
+    double tank_liters = TANK_CAPACITY_L;
+    int64_t refill_at_us = 0;
+    int64_t rain_until_us = 0;
+    int64_t outage_until_us = 0;
+    bool ota_pending = false;
+
+    cloud_zone_t cloud[MAX_ZONE_CHANNELS];
+    soak_stats_t stats;
+};
+
+// ==================== UTILIDADES ====================
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static double random_unit(uint32_t *state) {
+    return (double)(next_random(state) >> 8) / (double)(1U << 24);
+}
+
+static double random_range(uint32_t *state, double lo, double hi) {
+    return lo + (hi - lo) * random_unit(state);
+}
+
+static double random_gaussian(uint32_t *state, double sigma) {
+    double u1 = random_unit(state) + 1e-9;
+    double u2 = random_unit(state);
+    return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// Probabilidad de que un evento de `per_period` veces por `period_us` caiga en dt
+static bool random_event(uint32_t *state, double per_period, int64_t period_us, int64_t dt_us) {
+    return per_period > 0 && random_unit(state) < per_period * (double)dt_us / (double)period_us;
+}
+
+static int64_t seconds_to_us(double seconds) {
+    return (int64_t)(seconds * 1000000.0);
+}
+
+static bool parse_log_level(const char *text, esp_log_level_t *level) {
+    static const struct { const char *name; esp_log_level_t level; } LEVELS[] = {
+        { "none", ESP_LOG_NONE }, { "error", ESP_LOG_ERROR }, { "warn", ESP_LOG_WARN },
+        { "info", ESP_LOG_INFO }, { "debug", ESP_LOG_DEBUG },
+    };
+    for (const auto &entry : LEVELS) {
+        if (strcmp(text, entry.name) == 0) {
+            *level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Uso: %s [--days 90] [--zones 4] [--interval 5] [--boot-before-wrap-h 12]\n"
+            "          [--power-loss-per-week 0.5] [--ota-per-month 1] [--upload-fail 0.02]\n"
+            "          [--commands-per-day 4] [--local-changes-per-day 2] [--outages-per-week 1]\n"
+            "          [--fast-hz 4] [--heap-kb 64] [--nvs-pages 4] [--seed 1] [--log-level error]\n",
+            argv0);
+}
+
+static bool parse_args(int argc, char **argv, soak_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--days") == 0) {
+            opts->days = atoi(value);
+        } else if (strcmp(arg, "--zones") == 0) {
+            opts->zones = atoi(value);
+        } else if (strcmp(arg, "--interval") == 0) {
+            opts->interval_s = atof(value);
+        } else if (strcmp(arg, "--boot-before-wrap-h") == 0) {
+            opts->boot_before_wrap_h = atof(value);
+        } else if (strcmp(arg, "--power-loss-per-week") == 0) {
+            opts->power_loss_per_week = atof(value);
+        } else if (strcmp(arg, "--ota-per-month") == 0) {
+            opts->ota_per_month = atof(value);
+        } else if (strcmp(arg, "--upload-fail") == 0) {
+            opts->upload_fail = atof(value);
+        } else if (strcmp(arg, "--commands-per-day") == 0) {
+            opts->commands_per_day = atof(value);
+        } else if (strcmp(arg, "--local-changes-per-day") == 0) {
+            opts->local_changes_per_day = atof(value);
+        } else if (strcmp(arg, "--outages-per-week") == 0) {
+            opts->outages_per_week = atof(value);
+        } else if (strcmp(arg, "--fast-hz") == 0) {
+            opts->fast_hz = atoi(value);
+        } else if (strcmp(arg, "--heap-kb") == 0) {
+            opts->heap_kb = atoi(value);
+        } else if (strcmp(arg, "--nvs-pages") == 0) {
+            opts->nvs_pages = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            opts->seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--log-level") == 0) {
+            if (!parse_log_level(value, &opts->log_level)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return opts->days > 0 && opts->zones >= 1 && opts->zones <= MAX_ZONE_CHANNELS &&
+           opts->interval_s > 0 && opts->boot_before_wrap_h >= 0 && opts->heap_kb > 0 &&
+           opts->nvs_pages >= 2 && opts->upload_fail >= 0.0 && opts->upload_fail < 1.0 && opts->seed != 0 &&
+           opts->fast_hz >= 0 && opts->fast_hz <= 4;
+}
+
+// ==================== HOOKS DEL NODO ====================
+
+static void soak_set_relay(void *ctx, int channel, bool on) {
+    soak_t *soak = (soak_t *)ctx;
+    pump_session_t *session = &soak->sessions[channel];
+    const zone_state_t *zone = &soak->node.zones[channel];
+    if (on && !session->on) {
+        session->on = true;
+        session->automatic = zone->auto_watering_active;
+        session->overrun_reported = false;
+        session->start_us = soak->sim_us;
+        session->planned_s = zone->planned_duration_s;
+        session->target_reached_us = 0;
+        soak->stats.auto_sessions += session->automatic ? 1 : 0;
+        return;
+    }
+    if (on || !session->on) {
+        return;
+    }
+
+    int64_t elapsed_us = soak->sim_us - session->start_us;
+    session->on = false;
+    soak->stats.truth_sessions++;
+    soak->stats.truth_runtime_us += elapsed_us;
+    if (!session->automatic) {
+        return;
+    }
+    if (session->target_reached_us > 0) {
+        int64_t overshoot_us = soak->sim_us - session->target_reached_us;
+        soak->stats.overshoot_sessions++;
+        soak->stats.overshoot_total_us += overshoot_us;
+        soak->stats.overshoot_max_us = overshoot_us > soak->stats.overshoot_max_us ? overshoot_us
+                                                                                    : soak->stats.overshoot_max_us;
+    }
+    // Un riego automático solo termina antes de plazo si llegó a la humedad
+    // objetivo o se quedó sin tanque
+    bool recovered = zone->last_soil_moisture >= zone->moisture_threshold + MOISTURE_HYSTERESIS;
+    bool tank_low = soak->node.tank_level <= MIN_TANK_PERCENTAGE;
+    if (!recovered && !tank_low &&
+        elapsed_us + seconds_to_us(soak->opts.interval_s) < (int64_t)session->planned_s * 1000000) {
+        soak->stats.cut_short++;
+        ESP_LOGE("SOAK", "Riego cortado [canal %d]: %.1f s de %u s (tick %lu)", channel,
+                 elapsed_us / 1e6, (unsigned)session->planned_s, (unsigned long)xTaskGetTickCount());
+    }
+}
+
+static void soak_soil_model_updated(void *ctx, int channel) {
+    soak_t *soak = (soak_t *)ctx;
+    node_storage_save_soil_model(&soak->node, channel);
+}
+
+// ==================== ARRANQUE ====================
+
+static int64_t boot_clock_us(const soak_options_t &opts) {
+    if (opts.boot_before_wrap_h <= 0) {
+        return SIM_START_US;
+    }
+    int64_t before_us = (int64_t)(opts.boot_before_wrap_h * (double)US_PER_HOUR);
+    return before_us < TICK_WRAP_US ? TICK_WRAP_US - before_us : SIM_START_US;
+}
+
+static void init_filters(soak_t *soak) {
+    for (int ch = 0; ch < MAX_ZONE_CHANNELS; ++ch) {
+        soak->soil_filters[ch].init(make_sensor_filter_config SOIL_FILTER);
+    }
+    soak->tank_filter.init(make_sensor_filter_config TANK_FILTER);
+    soak->light_filter.init(make_sensor_filter_config LIGHT_FILTER);
+    soak->temperature_filter.init(make_sensor_filter_config TEMPERATURE_FILTER);
+    soak->humidity_filter.init(make_sensor_filter_config HUMIDITY_FILTER);
+}
+
+// Lo que hace app_main(): estado limpio, relés apagados y lo guardado en NVS
+static void boot_node(soak_t *soak) {
+    if (soak->stats.boots > 0) {
+        int64_t uptime = soak->sim_us - soak->boot_us;
+        soak->stats.max_uptime_us = uptime > soak->stats.max_uptime_us ? uptime : soak->stats.max_uptime_us;
+    }
+    soak->stats.boots++;
+    soak->boot_us = soak->sim_us;
+    host_clock_use_virtual(boot_clock_us(soak->opts));
+    soak->last_tick = xTaskGetTickCount();
+
+    node_hooks_t hooks = {};
+    hooks.set_relay = soak_set_relay;
+    hooks.soil_model_updated = soak_soil_model_updated;
+    hooks.ctx = soak;
+    node_state_init(&soak->node, soak->opts.zones, &hooks);
+    init_filters(soak);
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        soak->node.zones[ch].zone_id = ch + 1;
+        soak->sessions[ch] = pump_session_t();
+    }
+
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        for (int ch = 0; ch < soak->opts.zones; ++ch) {
+            node_storage_load_channel(nvs, &soak->node, ch);
+        }
+        nvs_close(nvs);
+    }
+}
+
+// Corte de luz: las bombas paran y el nodo pierde lo que no llegó a NVS
+static void power_loss(soak_t *soak) {
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        pump_session_t *session = &soak->sessions[ch];
+        if (session->on) {
+            soak->stats.truth_sessions++;
+            soak->stats.truth_runtime_us += soak->sim_us - session->start_us;
+        }
+    }
+    uint64_t before = 0;
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        before += soak->node.zones[ch].meter.sessions;
+    }
+    soak->stats.power_losses++;
+    boot_node(soak);
+    uint64_t after = 0;
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        after += soak->node.zones[ch].meter.sessions;
+    }
+    soak->stats.sessions_lost += before - after;
+}
+
+// ==================== ENTORNO ====================
+
+static void step_environment(soak_t *soak, double dt_s) {
+    const soak_options_t &opts = soak->opts;
+    double hour = fmod((double)soak->sim_us / (double)US_PER_HOUR, 24.0);
+    double temperature = 22.0 + 7.0 * sin(2.0 * M_PI * (hour - 9.0) / 24.0);
+
+    if (soak->sim_us >= soak->rain_until_us &&
+        random_event(&soak->rng, 1.0, 5 * US_PER_DAY, seconds_to_us(dt_s))) {
+        soak->rain_until_us = soak->sim_us + (int64_t)(random_range(&soak->rng, 0.5, 3.0) * (double)US_PER_HOUR);
+    }
+    bool raining = soak->sim_us < soak->rain_until_us;
+
+    double flow_lps = soak->node.pump_flow_lph / 3600.0;
+    for (int ch = 0; ch < opts.zones; ++ch) {
+        soil_sim_t *soil = &soak->soil[ch];
+        bool pumping = soak->sessions[ch].on && soak->tank_liters > 0.0;
+        if (pumping) {
+            soil->infiltrating += soil->gain_per_s * dt_s;
+            if (soak->tank_liters / TANK_CAPACITY_L * 100.0 <= MIN_TANK_PERCENTAGE) {
+                soak->stats.liters_below_min += flow_lps * dt_s;
+            }
+            soak->tank_liters -= flow_lps * dt_s;
+        }
+        // El agua llega al sensor en ~1 min
+        double arrived = soil->infiltrating * (1.0 - exp(-dt_s / 60.0));
+        soil->infiltrating -= arrived;
+        soil->moisture += arrived;
+        soil->moisture -= soil->dry_per_hour * (1.0 + 0.03 * (temperature - 22.0)) * dt_s / 3600.0;
+        if (raining) {
+            soil->moisture += 8.0 * dt_s / 3600.0;
+        }
+        soil->moisture = soil->moisture < 3.0 ? 3.0 : (soil->moisture > 95.0 ? 95.0 : soil->moisture);
+
+        pump_session_t *session = &soak->sessions[ch];
+        const zone_state_t *zone = &soak->node.zones[ch];
+        if (session->on && session->automatic && session->target_reached_us == 0 &&
+            soil->moisture >= zone->moisture_threshold + MOISTURE_HYSTERESIS) {
+            session->target_reached_us = soak->sim_us;
+        }
+    }
+
+    // Alguien rellena el tanque unas horas después de que se vacía
+    if (soak->tank_liters < 0.0) {
+        soak->tank_liters = 0.0;
+    }
+    if (soak->refill_at_us == 0 && soak->tank_liters < TANK_CAPACITY_L * 0.1) {
+        soak->refill_at_us = soak->sim_us + 6 * US_PER_HOUR;
+    }
+    if (soak->refill_at_us != 0 && soak->sim_us >= soak->refill_at_us) {
+        soak->tank_liters = TANK_CAPACITY_L;
+        soak->refill_at_us = 0;
+    }
+}
+
+static void sample_tank(soak_t *soak) {
+    double tank = soak->tank_liters / TANK_CAPACITY_L * 100.0;
+    if (random_unit(&soak->rng) < 0.01) {
+        soak->node.tank_quality = soak->tank_filter.miss();         // eco perdido
+    } else {
+        soak->node.tank_quality = soak->tank_filter.update((float)(tank + random_gaussian(&soak->rng, 0.5)));
+    }
+    soak->node.tank_level = soak->tank_filter.value();
+}
+
+static void sample_soil(soak_t *soak, int channel) {
+    uint32_t *rng = &soak->rng;
+    sensor_filter_t *filter = &soak->soil_filters[channel];
+    sensor_quality_t quality;
+    double chance = random_unit(rng);
+    if (chance < 0.002) {
+        quality = filter->miss();
+    } else {
+        double reading = soak->soil[channel].moisture + random_gaussian(rng, 0.6);
+        if (chance < 0.005) {
+            reading += random_unit(rng) < 0.5 ? -40.0 : 40.0;   // pico del ADC
+        }
+        quality = filter->update((float)reading);
+    }
+    zone_observe_moisture(&soak->node, channel, filter->value(), quality);
+}
+
+// Lo que hace sample_sensors(): lecturas con ruido, picos y fallos
+static void sample_sensors(soak_t *soak) {
+    node_state_t *node = &soak->node;
+    uint32_t *rng = &soak->rng;
+    double hour = fmod((double)soak->sim_us / (double)US_PER_HOUR, 24.0);
+    double temperature = 22.0 + 7.0 * sin(2.0 * M_PI * (hour - 9.0) / 24.0);
+    double daylight = sin(M_PI * (hour - 6.0) / 12.0);
+
+    if (random_unit(rng) < 0.01) {
+        node->temperature_quality = soak->temperature_filter.miss();
+        node->humidity_quality = soak->humidity_filter.miss();
+    } else {
+        node->temperature_quality = soak->temperature_filter.update((float)(temperature + random_gaussian(rng, 0.3)));
+        node->humidity_quality = soak->humidity_filter.update((float)(80.0 - 1.5 * temperature + random_gaussian(rng, 1.0)));
+    }
+    node->temperature_c = soak->temperature_filter.value();
+    node->ambient_humidity = soak->humidity_filter.value();
+
+    sample_tank(soak);
+
+    node->light_quality = soak->light_filter.update((float)(daylight > 0 ? daylight * 100.0 : 0.0));
+    node->light_level = soak->light_filter.value();
+
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        sample_soil(soak, ch);
+    }
+    zone_apply_auto_mode_all(node);
+}
+
+// Lo que hace fast_control_step(): tanque y suelo de los canales que riegan
+static void fast_control_step(soak_t *soak) {
+    soak->stats.fast_samples++;
+    sample_tank(soak);
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        if (soak->node.zones[ch].pump_state) {
+            sample_soil(soak, ch);
+            zone_fast_control(&soak->node, ch);
+        }
+    }
+}
+
+// ==================== NUBE SIMULADA ====================
+
+// Diferencia de un contador acumulado, igual que counterDelta() del backend
+static double counter_delta(double current, double previous, bool has_baseline) {
+    double base = has_baseline ? previous : 0.0;
+    return current >= base ? current - base : 0.0;
+}
+
+static void cloud_schedule_commands(soak_t *soak) {
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        cloud_zone_t *zone = &soak->cloud[ch];
+        if (zone->auto_mode || soak->opts.commands_per_day <= 0 || soak->sim_us < zone->next_command_us) {
+            continue;
+        }
+        // Encender y, unos minutos después, apagar
+        bool turn_on = !soak->sessions[ch].on;
+        zone->manual = turn_on ? 1 : 0;
+        double wait_s = turn_on ? random_range(&soak->rng, 30.0, 120.0)
+                                : random_range(&soak->rng, 0.5, 1.5) * 86400.0 / soak->opts.commands_per_day;
+        zone->next_command_us = soak->sim_us + seconds_to_us(wait_s);
+    }
+}
+
+static std::string cloud_process_upload(soak_t *soak, const char *body) {
+    cJSON *request = cJSON_Parse(body);
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+    cJSON *results = cJSON_AddArrayToObject(response, "zones");
+
+    const cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, cJSON_GetObjectItem(request, "zones")) {
+        int32_t zone_id = (int32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "zoneId"));
+        cJSON *result = cJSON_CreateObject();
+        cJSON_AddNumberToObject(result, "zoneId", zone_id);
+        cJSON_AddItemToArray(results, result);
+        if (zone_id < 1 || zone_id > soak->opts.zones) {
+            cJSON_AddNumberToObject(result, "status", 404);
+            continue;
+        }
+        cloud_zone_t *zone = &soak->cloud[zone_id - 1];
+
+        // Config cambiada con la API local: la nube la adopta
+        const cJSON *local_config = cJSON_GetObjectItem(entry, "localConfig");
+        if (cJSON_IsObject(local_config)) {
+            soak->stats.local_config_uploads++;
+            zone->auto_mode = cJSON_IsTrue(cJSON_GetObjectItem(local_config, "autoMode"));
+            zone->threshold = (float)cJSON_GetNumberValue(cJSON_GetObjectItem(local_config, "moistureThreshold"));
+            zone->duration = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(local_config, "wateringDuration"));
+        }
+
+        const cJSON *sensors = cJSON_GetObjectItem(entry, "sensors");
+        const cJSON *sessions = cJSON_GetObjectItem(sensors, "pumpSessions");
+        if (cJSON_IsNumber(sessions)) {
+            double device_sessions = cJSON_GetNumberValue(sessions);
+            double device_runtime = cJSON_GetNumberValue(cJSON_GetObjectItem(sensors, "pumpRuntimeMs"));
+            double device_liters = cJSON_GetNumberValue(cJSON_GetObjectItem(sensors, "waterUsedLiters"));
+            if (counter_delta(device_sessions, zone->device_sessions, zone->has_baseline) > 0) {
+                zone->sessions += (uint64_t)counter_delta(device_sessions, zone->device_sessions, zone->has_baseline);
+                zone->liters += counter_delta(device_liters, zone->device_liters, zone->has_baseline);
+            }
+            zone->has_baseline = true;
+            zone->device_sessions = device_sessions;
+            zone->device_runtime_ms = device_runtime;
+            zone->device_liters = device_liters;
+        }
+
+        cJSON_AddNumberToObject(result, "status", 200);
+        cJSON_AddBoolToObject(result, "success", true);
+        cJSON *commands = cJSON_AddObjectToObject(result, "commands");
+        if (zone->manual >= 0) {
+            cJSON_AddBoolToObject(commands, "pumpState", zone->manual == 1);
+            zone->manual = -1;      // el backend lo entrega una sola vez
+        } else {
+            cJSON_AddNullToObject(commands, "pumpState");
+        }
+        cJSON_AddBoolToObject(commands, "autoMode", zone->auto_mode);
+        cJSON_AddNumberToObject(commands, "moistureThreshold", zone->threshold);
+        cJSON_AddNumberToObject(commands, "wateringDuration", zone->duration);
+        cJSON_AddBoolToObject(commands, "tankLocked", false);
+    }
+
+    char *text = cJSON_PrintUnformatted(response);
+    std::string out = text != NULL ? text : "";
+    cJSON_free(text);
+    cJSON_Delete(response);
+    cJSON_Delete(request);
+    return out;
+}
+
+// ==================== CICLO ====================
+
+// Lo que hace send_sensor_data() en modo heap (AGROMIND_STATIC_MEMORY 0)
+static void upload_cycle(soak_t *soak) {
+    g_heap.device = true;
+    g_heap.cycle_peak = g_heap.used;
+    g_heap.cycle_peak_blocks = g_heap.used_blocks.size();
+    cJSON *root = upload_build_payload(&soak->node);
+    char *payload = cJSON_PrintUnformatted(root);
+    size_t largest = heap_largest_free(&g_heap);
+    g_heap.min_largest_free = largest < g_heap.min_largest_free ? largest : g_heap.min_largest_free;
+    g_heap.device = false;
+
+    bool failed = random_unit(&soak->rng) < soak->opts.upload_fail || soak->sim_us < soak->outage_until_us;
+    std::string response;
+    if (payload != NULL) {
+        size_t length = strlen(payload);
+        soak->stats.uploads++;
+        soak->stats.payload_bytes += length;
+        soak->stats.max_payload = length > soak->stats.max_payload ? length : soak->stats.max_payload;
+        if (!failed) {
+            response = cloud_process_upload(soak, payload);
+        }
+    }
+    soak->stats.failed_uploads += failed ? 1 : 0;
+
+    g_heap.device = true;
+    if (!response.empty()) {
+        upload_handle_response(&soak->node, response.c_str(), response.size());
+        // Lo confirmado por la nube debe ser la config que usa el nodo
+        for (int ch = 0; ch < soak->opts.zones; ++ch) {
+            const zone_state_t *zone = &soak->node.zones[ch];
+            const cloud_zone_t *cloud = &soak->cloud[ch];
+            soak->stats.config_checks++;
+            if (zone->config_pending || zone->auto_mode_enabled != cloud->auto_mode ||
+                zone->moisture_threshold != cloud->threshold || zone->watering_duration != cloud->duration) {
+                soak->stats.config_mismatches++;
+                ESP_LOGE("SOAK", "Config distinta [canal %d]: nodo %.0f%%/%us%s, nube %.0f%%/%us", ch,
+                         zone->moisture_threshold, (unsigned)zone->watering_duration,
+                         zone->config_pending ? " (pendiente)" : "", cloud->threshold, (unsigned)cloud->duration);
+            }
+        }
+    }
+    cJSON_Delete(root);
+    cJSON_free(payload);
+    g_heap.device = false;
+
+    if (g_heap.cycle_peak > g_heap.peak) {
+        g_heap.peak = g_heap.cycle_peak;
+        g_heap.peak_blocks = g_heap.cycle_peak_blocks;
+    }
+    if (!g_heap.used_blocks.empty()) {
+        g_heap.leaked_cycles++;
+    }
+}
+
+// POST /control de la app: umbral y duración de una zona. No cambia
+// autoMode para que cada zona siga siendo automática o manual.
+static void local_config_change(soak_t *soak) {
+    int channel = (int)(next_random(&soak->rng) % (uint32_t)soak->opts.zones);
+    cJSON *commands = cJSON_CreateObject();
+    cJSON_AddNumberToObject(commands, "moistureThreshold", (int)random_range(&soak->rng, 28.0, 42.0));
+    cJSON_AddNumberToObject(commands, "wateringDuration", (int)random_range(&soak->rng, 15.0, 60.0));
+    zone_apply_local_commands(&soak->node, channel, commands);
+    cJSON_Delete(commands);
+    soak->stats.local_changes++;
+}
+
+static void check_sessions(soak_t *soak) {
+    for (int ch = 0; ch < soak->opts.zones; ++ch) {
+        pump_session_t *session = &soak->sessions[ch];
+        if (!session->on || !session->automatic || session->overrun_reported) {
+            continue;
+        }
+        int64_t limit_us = (int64_t)session->planned_s * 1000000 + seconds_to_us(2 * soak->opts.interval_s);
+        if (soak->sim_us - session->start_us > limit_us) {
+            session->overrun_reported = true;
+            soak->stats.overrun++;
+            ESP_LOGE("SOAK", "Riego excedido [canal %d]: plazo %u s (tick %lu)", ch,
+                     (unsigned)session->planned_s, (unsigned long)xTaskGetTickCount());
+        }
+    }
+}
+
+// Hasta el próximo ciclo de sensor_task. Con una bomba encendida el entorno
+// avanza en pasos de PUMP_STEP_US (para medir cuándo el suelo llega al
+// objetivo) y control_task muestrea a fast_hz.
+static void advance_to_next_cycle(soak_t *soak, int64_t interval_us) {
+    int64_t cycle_end_us = soak->sim_us + interval_us;
+    int64_t fast_period_us = soak->opts.fast_hz > 0 ? 1000000 / soak->opts.fast_hz : 0;
+    int64_t next_fast_us = soak->sim_us + fast_period_us;
+    while (soak->sim_us < cycle_end_us) {
+        int64_t step_us = cycle_end_us - soak->sim_us;
+        bool pumping = node_any_pump_on(&soak->node);
+        if (pumping && step_us > PUMP_STEP_US) {
+            step_us = PUMP_STEP_US;
+        }
+        soak->sim_us += step_us;
+        vTaskDelay(pdMS_TO_TICKS((uint32_t)(step_us / 1000)));
+        step_environment(soak, (double)step_us / 1e6);
+        if (pumping && fast_period_us > 0 && soak->sim_us >= next_fast_us) {
+            fast_control_step(soak);
+            next_fast_us += fast_period_us;
+        }
+    }
+}
+
+static void run_soak(soak_t *soak) {
+    const soak_options_t &opts = soak->opts;
+    int64_t interval_us = seconds_to_us(opts.interval_s);
+    int64_t end_us = (int64_t)opts.days * US_PER_DAY;
+
+    heap_init(&g_heap, (size_t)opts.heap_kb * 1024);
+    host_nvs_reset();
+    soak->rng = opts.seed;
+    for (int ch = 0; ch < opts.zones; ++ch) {
+        soak->soil[ch].moisture = random_range(&soak->rng, 35.0, 55.0);
+        soak->soil[ch].gain_per_s = random_range(&soak->rng, 0.15, 0.5);
+        soak->soil[ch].dry_per_hour = random_range(&soak->rng, 0.3, 0.9);
+        // Una de cada cuatro zonas se riega a mano desde la app
+        soak->cloud[ch].auto_mode = ch % 4 != 3;
+        soak->cloud[ch].threshold = (float)(int)random_range(&soak->rng, 30.0, 40.0);
+        soak->cloud[ch].duration = (uint32_t)random_range(&soak->rng, 20.0, 60.0);
+        soak->cloud[ch].next_command_us = seconds_to_us(random_range(&soak->rng, 600.0, 7200.0));
+    }
+    boot_node(soak);
+
+    while (soak->sim_us < end_us) {
+        // Lo que duerme sensor_task entre ciclos
+        advance_to_next_cycle(soak, interval_us);
+
+        TickType_t tick = xTaskGetTickCount();
+        soak->stats.tick_wraps += tick < soak->last_tick ? 1 : 0;
+        soak->last_tick = tick;
+
+        if (random_event(&soak->rng, opts.power_loss_per_week, 7 * US_PER_DAY, interval_us)) {
+            power_loss(soak);
+        }
+        if (random_event(&soak->rng, opts.ota_per_month, 30 * US_PER_DAY, interval_us)) {
+            soak->ota_pending = true;
+        }
+
+        if (soak->sim_us >= soak->outage_until_us &&
+            random_event(&soak->rng, opts.outages_per_week, 7 * US_PER_DAY, interval_us)) {
+            soak->outage_until_us = soak->sim_us + seconds_to_us(random_range(&soak->rng, 600.0, 3 * 3600.0));
+            soak->stats.outages++;
+        }
+
+        cloud_schedule_commands(soak);
+        g_heap.device = true;
+        sample_sensors(soak);
+        if (random_event(&soak->rng, opts.local_changes_per_day, US_PER_DAY, interval_us)) {
+            local_config_change(soak);
+        }
+        g_heap.device = false;
+        upload_cycle(soak);
+        node_storage_flush_pump_meters(&soak->node, false);
+        check_sessions(soak);
+        soak->stats.cycles++;
+
+        // Como can_reboot_for_update(): espera a que no haya riegos
+        if (soak->ota_pending) {
+            bool pumping = false;
+            for (int ch = 0; ch < opts.zones; ++ch) {
+                pumping = pumping || soak->node.zones[ch].pump_state;
+            }
+            if (!pumping) {
+                node_storage_flush_pump_meters(&soak->node, true);
+                soak->ota_pending = false;
+                soak->stats.ota_reboots++;
+                boot_node(soak);
+            }
+        }
+    }
+    int64_t uptime = soak->sim_us - soak->boot_us;
+    soak->stats.max_uptime_us = uptime > soak->stats.max_uptime_us ? uptime : soak->stats.max_uptime_us;
+}
+
+// ==================== DESBORDE DE TICKS ====================
+
+// Un riego automático de duration_s que empieza en cada segundo alrededor
+// del desborde de TickType_t: el relé debe quedar encendido su plazo exacto
+static void run_wrap_probe(soak_t *soak, uint32_t duration_s) {
+    for (int offset_s = -(int)duration_s - 5; offset_s <= 5; ++offset_s) {
+        host_clock_use_virtual(TICK_WRAP_US + (int64_t)offset_s * 1000000);
+        node_state_t node;
+        node_state_init(&node, 1, NULL);
+        zone_state_t *zone = &node.zones[0];
+        zone->zone_id = 1;
+        zone->auto_mode_enabled = true;
+        zone->moisture_threshold = 35.0f;
+        zone->watering_duration = duration_s;
+        zone->last_soil_moisture = 20.0f;       // no se recupera: solo el plazo lo apaga
+        node.tank_level = 80.0f;
+
+        int on_s = -1;
+        for (uint32_t t = 0; t <= duration_s * 3; ++t) {
+            zone_apply_auto_mode(&node, 0);
+            if (zone->pump_state && on_s < 0) {
+                on_s = (int)t;
+            } else if (!zone->pump_state && on_s >= 0) {
+                if ((int)(t - on_s) != (int)duration_s) {
+                    soak->stats.wrap_failures++;
+                    ESP_LOGE("SOAK", "Riego a %d s del desborde: %d s en lugar de %u s", offset_s,
+                             (int)(t - on_s), (unsigned)duration_s);
+                }
+                break;
+            }
+            host_clock_advance_us(1000000);
+            if (t == duration_s * 3 && zone->pump_state) {
+                soak->stats.wrap_failures++;
+                ESP_LOGE("SOAK", "Riego a %d s del desborde: no se apagó", offset_s);
+            }
+        }
+        soak->stats.wrap_probes++;
+    }
+}
+
+// ==================== REPORTE ====================
+
+static void print_key(void *ctx, const char *key, uint64_t writes, uint64_t entries) {
+    double days = *(const double *)ctx;
+    printf("    %-20s %8llu escrituras (%.1f/día), %llu entradas\n", key, (unsigned long long)writes,
+           (double)writes / days, (unsigned long long)entries);
+}
+
+static int print_report(soak_t *soak, double wall_s) {
+    const soak_options_t &opts = soak->opts;
+    soak_stats_t &stats = soak->stats;
+    double days = (double)soak->sim_us / (double)US_PER_DAY;
+
+    printf("\n=== soak_sim: %.0f días virtuales, %d zonas, ciclo %.0f s ===\n", days, opts.zones, opts.interval_s);
+    printf("  tiempo real %.1f s (%.0fx)\n", wall_s, wall_s > 0 ? (double)soak->sim_us / 1e6 / wall_s : 0.0);
+    printf("  ciclos %llu | subidas %llu (%llu fallidas, %.0f bytes de media, máx %zu)\n",
+           (unsigned long long)stats.cycles, (unsigned long long)stats.uploads,
+           (unsigned long long)stats.failed_uploads,
+           stats.uploads ? (double)stats.payload_bytes / (double)stats.uploads : 0.0, stats.max_payload);
+    printf("  arranques %llu (%llu cortes de luz, %llu OTA), uptime máx %.1f días\n",
+           (unsigned long long)stats.boots, (unsigned long long)stats.power_losses,
+           (unsigned long long)stats.ota_reboots, (double)stats.max_uptime_us / (double)US_PER_DAY);
+
+    printf("\nTicks (%d Hz: TickType_t desborda cada %.1f días de uptime)\n", configTICK_RATE_HZ,
+           (double)TICK_WRAP_US / (double)US_PER_DAY);
+    if (opts.boot_before_wrap_h > 0) {
+        printf("  cada arranque a %.1f h del desborde\n", opts.boot_before_wrap_h);
+    }
+    printf("  desbordes vistos     %llu\n", (unsigned long long)stats.tick_wraps);
+    printf("  riegos automáticos   %llu, cortados antes de plazo %llu, excedidos %llu\n",
+           (unsigned long long)stats.auto_sessions, (unsigned long long)stats.cut_short,
+           (unsigned long long)stats.overrun);
+    printf("  riego que cruza el desborde: %d inicios probados, %d con duración incorrecta\n",
+           stats.wrap_probes, stats.wrap_failures);
+
+    printf("\nHeap (first-fit simulado de %d KB para cJSON del nodo)\n", opts.heap_kb);
+    printf("  pico por ciclo       %zu bytes en %zu bloques\n", g_heap.peak, g_heap.peak_blocks);
+    printf("  mínimo libre         %zu bytes | bloque libre mayor en el pico: mín %zu bytes\n",
+           g_heap.min_free, g_heap.min_largest_free);
+    printf("  reservas             %llu (%.0f por ciclo), fallidas %llu, ciclos con bloques vivos %llu\n",
+           (unsigned long long)g_heap.allocations,
+           stats.cycles ? (double)g_heap.allocations / (double)stats.cycles : 0.0,
+           (unsigned long long)g_heap.failures, (unsigned long long)g_heap.leaked_cycles);
+
+    host_nvs_stats_t nvs = host_nvs_get_stats();
+    double erase_cycles = host_nvs_page_erase_cycles(opts.nvs_pages);
+    double years = erase_cycles > 0 ? FLASH_ERASE_CYCLES / (erase_cycles / days) / 365.0 : INFINITY;
+    printf("\nNVS (partición de %u páginas)\n", opts.nvs_pages);
+    printf("  escrituras           %llu (%.1f/día), %llu omitidas por valor igual, %llu commits\n",
+           (unsigned long long)nvs.writes, (double)nvs.writes / days, (unsigned long long)nvs.unchanged,
+           (unsigned long long)nvs.commits);
+    host_nvs_for_each_key(print_key, &days);
+    printf("  borrados por página  %.1f en %.0f días -> %.0f años hasta %.0f ciclos\n",
+           erase_cycles, days, years, FLASH_ERASE_CYCLES);
+
+    double flow_lps = DEFAULT_PUMP_FLOW_LPH / 3600.0;
+    double truth_liters = (double)stats.truth_runtime_us / 1e6 * flow_lps;
+    double node_liters = 0.0;
+    double cloud_liters = 0.0;
+    uint64_t node_sessions = 0;
+    uint64_t cloud_sessions = 0;
+    for (int ch = 0; ch < opts.zones; ++ch) {
+        node_liters += zone_pump_liters(&soak->node, ch);
+        node_sessions += soak->node.zones[ch].meter.sessions;
+        cloud_liters += soak->cloud[ch].liters;
+        cloud_sessions += soak->cloud[ch].sessions;
+    }
+    double cloud_error = truth_liters > 0 ? fabs(cloud_liters - truth_liters) / truth_liters : 0.0;
+    printf("\nAgua\n");
+    printf("  real                 %llu riegos, %.1f L\n", (unsigned long long)stats.truth_sessions, truth_liters);
+    printf("  nodo                 %llu riegos, %.1f L (%llu riegos olvidados por cortes de luz)\n",
+           (unsigned long long)node_sessions, node_liters, (unsigned long long)stats.sessions_lost);
+    printf("  backend              %llu riegos, %.1f L (%.2f %% de diferencia)\n",
+           (unsigned long long)cloud_sessions, cloud_liters, cloud_error * 100.0);
+
+    printf("\nControl rápido (%s)\n", opts.fast_hz > 0 ? "activo" : "desactivado");
+    if (opts.fast_hz > 0) {
+        printf("  muestreo             %d Hz con bomba encendida, %llu muestras\n", opts.fast_hz,
+               (unsigned long long)stats.fast_samples);
+    }
+    printf("  bomba tras objetivo  media %.2f s, máx %.2f s en %llu auto-riegos (%.2f L de más)\n",
+           stats.overshoot_sessions ? (double)stats.overshoot_total_us / 1e6 / (double)stats.overshoot_sessions : 0.0,
+           (double)stats.overshoot_max_us / 1e6, (unsigned long long)stats.overshoot_sessions,
+           (double)stats.overshoot_total_us / 1e6 * flow_lps);
+    printf("  tanque bajo el %.0f %%  %.2f L bombeados\n", MIN_TANK_PERCENTAGE, stats.liters_below_min);
+
+    printf("\nAPI local\n");
+    printf("  cambios de config    %llu (%llu caídas del servidor), %llu zonas subidas con localConfig\n",
+           (unsigned long long)stats.local_changes, (unsigned long long)stats.outages,
+           (unsigned long long)stats.local_config_uploads);
+    printf("  nodo vs. nube        %llu comprobaciones, %llu distintas\n",
+           (unsigned long long)stats.config_checks, (unsigned long long)stats.config_mismatches);
+
+    // Solo se juzga lo que el modelo ya dio por aprendido
+    printf("\nModelo del suelo (aprendido / real)\n");
+    uint32_t soil_off = 0;
+    for (int ch = 0; ch < opts.zones; ++ch) {
+        const soil_model_params_t *params = &soak->node.zones[ch].soil.params;
+        const soil_sim_t *truth = &soak->soil[ch];
+        bool gain_off = params->gain_samples >= SOIL_MODEL_MIN_SAMPLES &&
+                        fabs(params->gain_per_s - truth->gain_per_s) > truth->gain_per_s * MAX_SOIL_GAIN_ERROR;
+        double dry_tolerance = fmax(truth->dry_per_hour * MAX_SOIL_DRY_ERROR, MAX_SOIL_DRY_ERROR_ABS);
+        bool dry_off = params->dry_samples > 0 && fabs(params->dry_per_hour - truth->dry_per_hour) > dry_tolerance;
+        soil_off += (gain_off || dry_off) ? 1 : 0;
+        printf("  canal %d  %s  ganancia %.3f / %.3f %%/s  secado %.2f / %.2f %%/h  (%u riegos)%s\n", ch,
+               soak->cloud[ch].auto_mode ? "auto  " : "manual", params->gain_per_s, truth->gain_per_s,
+               params->dry_per_hour, truth->dry_per_hour, (unsigned)params->gain_samples,
+               (gain_off || dry_off) ? "  ❌" : "");
+    }
+    printf("  tolerancia           ganancia ±%.0f %%, secado ±%.0f %% o ±%.2f %%/h\n", MAX_SOIL_GAIN_ERROR * 100.0,
+           MAX_SOIL_DRY_ERROR * 100.0, MAX_SOIL_DRY_ERROR_ABS);
+
+    // Con control rápido la bomba no debe seguir un ciclo entero de
+    // sensor_task después de llegar al objetivo
+    bool slow_stop = opts.fast_hz > 0 && stats.overshoot_max_us >= seconds_to_us(opts.interval_s);
+    bool failed = stats.wrap_failures > 0 || stats.cut_short > 0 || stats.overrun > 0 ||
+                  g_heap.failures > 0 || g_heap.leaked_cycles > 0 || cloud_error > MAX_WATER_ERROR ||
+                  years < MIN_NVS_LIFETIME_YEARS || stats.config_mismatches > 0 || slow_stop ||
+                  soil_off > 0;
+    printf("\n%s\n", failed ? "❌ FALLO" : "✅ OK");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    static soak_t soak;
+    if (!parse_args(argc, argv, &soak.opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", soak.opts.log_level);
+
+    cJSON_Hooks hooks = {};
+    hooks.malloc_fn = sim_malloc;
+    hooks.free_fn = sim_free;
+    cJSON_InitHooks(&hooks);
+
+    auto started = std::chrono::steady_clock::now();
+    run_wrap_probe(&soak, 30);
+    run_soak(&soak);
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return print_report(&soak, wall_s);
+}
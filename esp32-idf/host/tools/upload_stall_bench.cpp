@@ -0,0 +1,490 @@
+/*
+ * AgroMind host tools - Subida bloqueante vs. no bloqueante contra un
+ * servidor lento
+ *
+ * Levanta en 127.0.0.1 un servidor que hace de backend lento: responde
+ * tras --response-delay-ms y cada --hang-every peticiones se cuelga (lee la
+ * petición y nunca contesta). Contra él corre dos veces el ciclo de
+ * sensor_task, a --cycle-ms en vez de 5 s:
+ *
+ *   - bloqueante: como antes, un POST que espera respuesta o timeout
+ *     (--blocking-timeout-ms, 5000 = el de esp_http_client por defecto)
+ *     antes de volver al ciclo.
+ *   - asíncrono: la misma máquina de estados del firmware
+ *     (main/upload_session.h) sobre un socket no bloqueante; cada paso
+ *     espera como mucho --io-ms y entre pasos el ciclo sigue a su ritmo.
+ *
+ * Reporta para cada modo cuánto bloqueó un paso la tarea, cuánto se
+ * atrasaron los ciclos de lectura y qué pasó con las subidas. Sale con
+ * código 1 si en modo asíncrono un ciclo se atrasa más de 2 * --io-ms + 50 ms
+ * o si ninguna subida termina bien.
+ *
+ * Uso:
+ *   upload_stall_bench [--cycles 20] [--cycle-ms 500] [--response-delay-ms 150]
+ *                      [--hang-every 5] [--blocking-timeout-ms 5000]
+ *                      [--connect-ms 1000] [--send-ms 500] [--receive-ms 1500]
+ *                      [--budget-ms 2000] [--io-ms 20] [--payload-bytes 2048]
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "http_client.h"
+#include "upload_session.h"
+
+#define UPLOAD_PATH "/api/iot/sensor-data"
+#define POLL_MS 5                   // entre pasos, como UPLOAD_POLL_MS
+#define SERVER_RESPONSE "{\"success\":true,\"zones\":[]}"
+
+struct bench_options_t {
+    int cycles = 20;
+    int cycle_ms = 500;
+    int response_delay_ms = 150;
+    int hang_every = 5;
+    int blocking_timeout_ms = 5000;
+    upload_limits_t limits = { 1000, 500, 1500, 2000 };
+    int io_ms = 20;
+    int payload_bytes = 2048;
+};
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Uso: %s [--cycles 20] [--cycle-ms 500] [--response-delay-ms 150]\n"
+            "          [--hang-every 5] [--blocking-timeout-ms 5000]\n"
+            "          [--connect-ms 1000] [--send-ms 500] [--receive-ms 1500]\n"
+            "          [--budget-ms 2000] [--io-ms 20] [--payload-bytes 2048]\n",
+            argv0);
+}
+
+static bool parse_args(int argc, char **argv, bench_options_t *opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        if (strcmp(arg, "--cycles") == 0) {
+            opts->cycles = atoi(value);
+        } else if (strcmp(arg, "--cycle-ms") == 0) {
+            opts->cycle_ms = atoi(value);
+        } else if (strcmp(arg, "--response-delay-ms") == 0) {
+            opts->response_delay_ms = atoi(value);
+        } else if (strcmp(arg, "--hang-every") == 0) {
+            opts->hang_every = atoi(value);
+        } else if (strcmp(arg, "--blocking-timeout-ms") == 0) {
+            opts->blocking_timeout_ms = atoi(value);
+        } else if (strcmp(arg, "--connect-ms") == 0) {
+            opts->limits.connect_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--send-ms") == 0) {
+            opts->limits.send_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--receive-ms") == 0) {
+            opts->limits.receive_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--budget-ms") == 0) {
+            opts->limits.budget_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--io-ms") == 0) {
+            opts->io_ms = atoi(value);
+        } else if (strcmp(arg, "--payload-bytes") == 0) {
+            opts->payload_bytes = atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return opts->cycles > 0 && opts->cycle_ms > 0 && opts->response_delay_ms >= 0 && opts->hang_every >= 0 &&
+           opts->blocking_timeout_ms > 0 && opts->io_ms > 0 && opts->io_ms < opts->cycle_ms &&
+           opts->payload_bytes > 0;
+}
+
+static void sleep_ms(int64_t ms) {
+    if (ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+// ==================== SERVIDOR LENTO ====================
+
+struct slow_server_t {
+    int listen_fd = -1;
+    uint16_t port = 0;
+    int response_delay_ms = 0;
+    int hang_every = 0;
+    std::atomic<bool> stop{ false };
+    std::atomic<uint32_t> requests{ 0 };
+    std::thread acceptor;
+    std::vector<std::thread> handlers;
+};
+
+// Lee cabeceras y cuerpo (Content-Length). false si el cliente cerró antes
+static bool read_request(slow_server_t *server, int fd) {
+    std::string data;
+    size_t body_start = std::string::npos;
+    size_t content_length = 0;
+    char buffer[2048];
+    while (!server->stop) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return false;
+        }
+        data.append(buffer, (size_t)n);
+        if (body_start == std::string::npos) {
+            size_t end = data.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                continue;
+            }
+            body_start = end + 4;
+            const char *length = strcasestr(data.c_str(), "Content-Length:");
+            content_length = length != NULL ? strtoul(length + 15, NULL, 10) : 0;
+        }
+        if (data.size() >= body_start + content_length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void handle_connection(slow_server_t *server, int fd) {
+    if (read_request(server, fd)) {
+        uint32_t index = ++server->requests;
+        if (server->hang_every > 0 && index % (uint32_t)server->hang_every == 0) {
+            // Colgado: no contesta hasta que el cliente se rinda
+            char discard[256];
+            while (!server->stop) {
+                struct pollfd pfd = { fd, POLLIN, 0 };
+                if (poll(&pfd, 1, 50) > 0 && recv(fd, discard, sizeof(discard), 0) <= 0) {
+                    break;
+                }
+            }
+        } else {
+            sleep_ms(server->response_delay_ms);
+            char response[256];
+            int length = snprintf(response, sizeof(response),
+                                  "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                                  strlen(SERVER_RESPONSE), SERVER_RESPONSE);
+            send(fd, response, (size_t)length, MSG_NOSIGNAL);
+        }
+    }
+    close(fd);
+}
+
+static bool server_start(slow_server_t *server) {
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd < 0) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 16) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(server->listen_fd);
+        return false;
+    }
+    server->port = ntohs(addr.sin_port);
+    server->acceptor = std::thread([server]() {
+        while (!server->stop) {
+            struct pollfd pfd = { server->listen_fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 50) <= 0) {
+                continue;
+            }
+            int fd = accept(server->listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                server->handlers.emplace_back(handle_connection, server, fd);
+            }
+        }
+    });
+    return true;
+}
+
+static void server_stop(slow_server_t *server) {
+    server->stop = true;
+    server->acceptor.join();
+    for (std::thread &handler : server->handlers) {
+        handler.join();
+    }
+    close(server->listen_fd);
+}
+
+// ==================== TRANSPORTE NO BLOQUEANTE ====================
+// Hace lo que esp_http_client_perform() en modo is_async: avanza lo que
+// pueda sin pasar de io_ms y avisa a la sesión cada fase alcanzada
+
+enum step_result_t { STEP_PENDING, STEP_DONE, STEP_ERROR };
+
+struct async_request_t {
+    int fd = -1;
+    std::string out;
+    size_t sent = 0;
+    std::string in;
+};
+
+static std::string build_request(const std::string &body) {
+    char head[256];
+    snprintf(head, sizeof(head),
+             "POST " UPLOAD_PATH " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\n"
+             "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+             body.size());
+    return std::string(head) + body;
+}
+
+static bool response_complete(const std::string &in) {
+    size_t end = in.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return false;
+    }
+    const char *length = strcasestr(in.c_str(), "Content-Length:");
+    size_t content_length = length != NULL ? strtoul(length + 15, NULL, 10) : 0;
+    return in.size() >= end + 4 + content_length;
+}
+
+static void async_close(async_request_t *request) {
+    if (request->fd >= 0) {
+        close(request->fd);
+        request->fd = -1;
+    }
+}
+
+static step_result_t async_step(async_request_t *request, upload_session_t *session, uint16_t port, int io_ms) {
+    int64_t deadline_us = host_time_us() + (int64_t)io_ms * 1000;
+    while (true) {
+        int remaining_ms = (int)((deadline_us - host_time_us()) / 1000);
+        remaining_ms = remaining_ms > 0 ? remaining_ms : 0;
+
+        if (session->phase == UPLOAD_PHASE_CONNECT) {
+            if (request->fd < 0) {
+                request->fd = socket(AF_INET, SOCK_STREAM, 0);
+                fcntl(request->fd, F_SETFL, fcntl(request->fd, F_GETFL, 0) | O_NONBLOCK);
+                struct sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                addr.sin_port = htons(port);
+                if (connect(request->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+                    return STEP_ERROR;
+                }
+            }
+            struct pollfd pfd = { request->fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, remaining_ms) <= 0) {
+                return STEP_PENDING;
+            }
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(request->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                return STEP_ERROR;
+            }
+            upload_session_advance(session, UPLOAD_PHASE_SEND, host_time_us());
+        } else if (session->phase == UPLOAD_PHASE_SEND) {
+            struct pollfd pfd = { request->fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, remaining_ms) <= 0) {
+                return STEP_PENDING;
+            }
+            ssize_t n = send(request->fd, request->out.data() + request->sent, request->out.size() - request->sent,
+                             MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN) {
+                return STEP_ERROR;
+            }
+            request->sent += n > 0 ? (size_t)n : 0;
+            if (request->sent == request->out.size()) {
+                upload_session_advance(session, UPLOAD_PHASE_RECEIVE, host_time_us());
+            }
+        } else {
+            struct pollfd pfd = { request->fd, POLLIN, 0 };
+            if (poll(&pfd, 1, remaining_ms) <= 0) {
+                return STEP_PENDING;
+            }
+            char buffer[1024];
+            ssize_t n = recv(request->fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EAGAIN) {
+                continue;
+            }
+            if (n <= 0) {
+                return response_complete(request->in) ? STEP_DONE : STEP_ERROR;
+            }
+            request->in.append(buffer, (size_t)n);
+            if (response_complete(request->in)) {
+                return STEP_DONE;
+            }
+        }
+    }
+}
+
+// ==================== CICLOS ====================
+
+static std::string sample_payload(int cycle, int bytes) {
+    char head[64];
+    snprintf(head, sizeof(head), "{\"cycle\":%d,\"pad\":\"", cycle);
+    std::string payload(head);
+    payload.append((size_t)(bytes > (int)payload.size() + 2 ? bytes - (int)payload.size() - 2 : 0), 'x');
+    payload += "\"}";
+    return payload;
+}
+
+// Como antes: un POST que bloquea el ciclo hasta la respuesta o el timeout
+static void run_blocking(const bench_options_t &opts, uint16_t port, upload_session_t *session) {
+    http_connection_t connection("127.0.0.1", port, opts.blocking_timeout_ms, false);
+    int64_t next_cycle_us = host_time_us();
+    for (int cycle = 0; cycle < opts.cycles; ++cycle) {
+        sleep_ms((next_cycle_us - host_time_us()) / 1000);
+        int64_t now_us = host_time_us();
+        upload_session_cycle(session, now_us - next_cycle_us);
+        next_cycle_us += (int64_t)opts.cycle_ms * 1000;
+        if (next_cycle_us < now_us) {
+            next_cycle_us = now_us + (int64_t)opts.cycle_ms * 1000;
+        }
+
+        upload_session_start(session, now_us);
+        http_response_t response;
+        http_result_t result = connection.request("POST", UPLOAD_PATH, sample_payload(cycle, opts.payload_bytes),
+                                                  &response);
+        int64_t end_us = host_time_us();
+        upload_session_note_call(session, end_us - now_us);
+        upload_session_finish(session,
+                              result == HTTP_RESULT_OK ? UPLOAD_END_OK
+                              : result == HTTP_RESULT_TIMEOUT ? UPLOAD_END_TIMEOUT : UPLOAD_END_ERROR,
+                              end_us);
+        connection.close();
+    }
+}
+
+// Como sensor_task ahora: el ciclo sigue y la subida avanza de a pasos
+static void run_async(const bench_options_t &opts, uint16_t port, upload_session_t *session) {
+    async_request_t request;
+    int cycle = 0;
+    int64_t next_cycle_us = host_time_us();
+    int64_t end_us = next_cycle_us + (int64_t)opts.cycles * opts.cycle_ms * 1000;
+
+    auto start_upload = [&](int64_t now_us) {
+        async_close(&request);
+        request = async_request_t();
+        request.out = build_request(sample_payload(cycle, opts.payload_bytes));
+        upload_session_start(session, now_us);
+    };
+
+    while (cycle < opts.cycles || (upload_session_active(session) && host_time_us() < end_us + 10000000)) {
+        int64_t now_us = host_time_us();
+        if (cycle < opts.cycles && now_us >= next_cycle_us) {
+            upload_cycle_t action = upload_session_cycle(session, now_us - next_cycle_us);
+            next_cycle_us += (int64_t)opts.cycle_ms * 1000;
+            if (next_cycle_us < now_us) {
+                next_cycle_us = now_us + (int64_t)opts.cycle_ms * 1000;
+            }
+            cycle++;
+            if (action == UPLOAD_CYCLE_START) {
+                start_upload(now_us);
+            } else if (action == UPLOAD_CYCLE_REPLACE) {
+                request.out = build_request(sample_payload(cycle, opts.payload_bytes));
+            }
+        }
+
+        if (upload_session_active(session)) {
+            int64_t step_us = host_time_us();
+            step_result_t result = async_step(&request, session, port, opts.io_ms);
+            int64_t done_us = host_time_us();
+            upload_session_note_call(session, done_us - step_us);
+
+            upload_end_t end = UPLOAD_END_OK;
+            bool finished = result != STEP_PENDING || upload_session_expired(session, done_us, &end);
+            if (result == STEP_ERROR) {
+                end = UPLOAD_END_ERROR;
+            }
+            if (finished) {
+                async_close(&request);
+                if (upload_session_finish(session, end, done_us)) {
+                    start_upload(done_us);
+                }
+            }
+        }
+
+        int64_t wait_ms = (next_cycle_us - host_time_us()) / 1000;
+        sleep_ms(upload_session_active(session) && wait_ms > POLL_MS ? POLL_MS : wait_ms);
+    }
+    async_close(&request);
+}
+
+// ==================== REPORTE ====================
+
+static double ms(int64_t us) {
+    return (double)us / 1000.0;
+}
+
+// El modo bloqueante no ve las fases: solo el timeout total
+static void print_mode(const char *name, const upload_session_t *session, bool phases) {
+    const upload_stats_t *stats = &session->stats;
+    printf("%s\n", name);
+    printf("  subidas        %u iniciadas, %u ok, %u error, %u plazo vencido, %u sin presupuesto\n",
+           stats->started, stats->ended[UPLOAD_END_OK], stats->ended[UPLOAD_END_ERROR],
+           stats->ended[UPLOAD_END_TIMEOUT], stats->ended[UPLOAD_END_BUDGET]);
+    if (phases) {
+        printf("  plazos         conexión %u, envío %u, recepción %u\n", stats->timeouts[UPLOAD_PHASE_CONNECT],
+               stats->timeouts[UPLOAD_PHASE_SEND], stats->timeouts[UPLOAD_PHASE_RECEIVE]);
+    }
+    printf("  lecturas       %u reemplazadas, %u ciclos en espera\n", stats->superseded, stats->deferred);
+    printf("  bloqueo        máx. %.1f ms, medio %.2f ms por paso (%u pasos)\n", ms(stats->call_max_us),
+           stats->calls > 0 ? ms(stats->call_total_us) / stats->calls : 0.0, stats->calls);
+    printf("  atraso ciclo   máx. %.1f ms, medio %.1f ms (%u ciclos)\n", ms(stats->late_max_us),
+           stats->cycles > 0 ? ms(stats->late_total_us) / stats->cycles : 0.0, stats->cycles);
+    printf("  subida         máx. %.1f ms\n\n", ms(stats->upload_max_us));
+}
+
+int main(int argc, char **argv) {
+    bench_options_t opts;
+    if (!parse_args(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    slow_server_t server;
+    server.response_delay_ms = opts.response_delay_ms;
+    server.hang_every = opts.hang_every;
+    if (!server_start(&server)) {
+        fprintf(stderr, "No se pudo abrir el servidor local\n");
+        return 2;
+    }
+    printf("Servidor lento en 127.0.0.1:%u: responde en %d ms, se cuelga 1 de cada %d\n\n", server.port,
+           opts.response_delay_ms, opts.hang_every);
+
+    upload_session_t blocking;
+    upload_session_init(&blocking, &opts.limits);
+    run_blocking(opts, server.port, &blocking);
+    print_mode("Bloqueante (un POST por ciclo, timeout único)", &blocking, false);
+
+    upload_session_t async;
+    upload_session_init(&async, &opts.limits);
+    run_async(opts, server.port, &async);
+    print_mode("Asíncrono (upload_session, pasos de --io-ms)", &async, true);
+
+    server_stop(&server);
+
+    int64_t allowed_late_us = (int64_t)(2 * opts.io_ms + 50) * 1000;
+    bool late_ok = async.stats.late_max_us <= allowed_late_us;
+    bool uploads_ok = async.stats.ended[UPLOAD_END_OK] > 0;
+    printf("Atraso máx. de un ciclo: %.1f ms -> %.1f ms (límite %.0f ms)\n", ms(blocking.stats.late_max_us),
+           ms(async.stats.late_max_us), ms(allowed_late_us));
+    printf("Bloqueo máx. de un paso: %.1f ms -> %.1f ms\n", ms(blocking.stats.call_max_us),
+           ms(async.stats.call_max_us));
+    if (!uploads_ok) {
+        printf("❌ Ninguna subida asíncrona terminó bien\n");
+    }
+    printf("\n%s\n", late_ok && uploads_ok ? "✅ OK" : "❌ FALLO");
+    return late_ok && uploads_ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/*
+ * AgroMind - Perfil de arranque (ver boot_profile.h)
+ */
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "boot_profile.h"
+
+static const char *TAG = "ARRANQUE";
+
+static const char *const PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "nvs",
+    "config",
+    "reles",
+    "wifi_init",
+    "wifi_ip",
+    "perifericos",
+    "tareas",
+    "primera_lectura",
+    "primera_subida",
+};
+
+// 0 = todavía no pasó. Cada fase la escribe una sola tarea, una vez.
+static int64_t phase_start_us[BOOT_PHASE_COUNT];
+static int64_t phase_end_us[BOOT_PHASE_COUNT];
+
+void boot_profile_begin(boot_phase_t phase) {
+    if (phase_start_us[phase] == 0) {
+        phase_start_us[phase] = esp_timer_get_time();
+    }
+}
+
+void boot_profile_end(boot_phase_t phase) {
+    if (phase_start_us[phase] != 0 && phase_end_us[phase] == 0) {
+        phase_end_us[phase] = esp_timer_get_time();
+    }
+}
+
+bool boot_profile_done(boot_phase_t phase) {
+    return phase_end_us[phase] != 0;
+}
+
+static double to_ms(int64_t us) {
+    return (double)(us / 100) / 10.0;
+}
+
+void boot_profile_report(void) {
+    ESP_LOGI(TAG, "⏱️ Arranque (ms desde el inicio de la app):");
+    for (int i = 0; i < BOOT_PHASE_COUNT; ++i) {
+        if (phase_start_us[i] == 0) {
+            continue;
+        }
+        if (phase_end_us[i] == 0) {
+            ESP_LOGI(TAG, "   %-16s inicio %8.1f  (en curso)", PHASE_NAMES[i], to_ms(phase_start_us[i]));
+        } else {
+            ESP_LOGI(TAG, "   %-16s inicio %8.1f  duración %8.1f", PHASE_NAMES[i], to_ms(phase_start_us[i]),
+                     to_ms(phase_end_us[i] - phase_start_us[i]));
+        }
+    }
+    if (phase_end_us[BOOT_PHASE_FIRST_UPLOAD] != 0) {
+        ESP_LOGI(TAG, "   hasta la primera subida: %.1f ms", to_ms(phase_end_us[BOOT_PHASE_FIRST_UPLOAD]));
+    }
+}
+
+void boot_profile_add_json(cJSON *parent) {
+    cJSON *boot = cJSON_AddObjectToObject(parent, "boot");
+    int64_t first_upload_us = phase_end_us[BOOT_PHASE_FIRST_UPLOAD];
+    cJSON_AddNumberToObject(boot, "firstUploadMs", first_upload_us != 0 ? to_ms(first_upload_us) : -1.0);
+    cJSON *phases = cJSON_AddArrayToObject(boot, "phases");
+    for (int i = 0; i < BOOT_PHASE_COUNT; ++i) {
+        int64_t start_us = phase_start_us[i];
+        int64_t end_us = phase_end_us[i];
+        if (start_us == 0) {
+            continue;
+        }
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "name", PHASE_NAMES[i]);
+        cJSON_AddNumberToObject(entry, "startMs", to_ms(start_us));
+        cJSON_AddNumberToObject(entry, "ms", end_us != 0 ? to_ms(end_us - start_us) : -1.0);
+        cJSON_AddItemToArray(phases, entry);
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * AgroMind - Perfil de arranque
+ *
+ * Marca el inicio y el fin de cada fase del arranque con esp_timer (µs
+ * desde que arrancó la app, sin contar el bootloader). Las fases de
+ * app_main van en serie; la asociación WiFi, la primera lectura y la
+ * primera subida corren en paralelo en otras tareas. Cuando termina la
+ * primera subida se imprime la tabla en el log; /info la expone en "boot".
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cJSON.h"
+
+typedef enum {
+    BOOT_PHASE_NVS = 0,         // nvs_flash_init (y borrado si hace falta)
+    BOOT_PHASE_CONFIG,          // estado del nodo, config y calibración desde NVS
+    BOOT_PHASE_RELAYS,          // relés en HIGH antes que nada
+    BOOT_PHASE_WIFI_INIT,       // netif, driver WiFi y esp_wifi_start()
+    BOOT_PHASE_WIFI_CONNECT,    // de esp_wifi_start() a la primera IP
+    BOOT_PHASE_PERIPHERALS,     // ultrasonido, DHT, ADC y su calibración
+    BOOT_PHASE_TASKS,           // ESP-NOW, OTA y tareas
+    BOOT_PHASE_FIRST_SAMPLE,    // primera lectura de todos los sensores
+    BOOT_PHASE_FIRST_UPLOAD,    // primer envío confirmado (POST 2xx o ESP-NOW)
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+// Solo cuenta la primera vez de cada fase; las siguientes se ignoran
+void boot_profile_begin(boot_phase_t phase);
+void boot_profile_end(boot_phase_t phase);
+bool boot_profile_done(boot_phase_t phase);
+
+// Imprime la tabla de fases en el log
+void boot_profile_report(void);
+
+// "boot": {"firstUploadMs", "phases": [{"name", "startMs", "ms"}]}
+void boot_profile_add_json(cJSON *parent);
+
+#endif // BOOT_PROFILE_H
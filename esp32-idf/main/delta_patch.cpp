@@ -0,0 +1,162 @@
+/*
+ * AgroMind - Aplicador de parches delta AGD1 (ver delta_patch.h)
+ */
+
+#include <string.h>
+
+#include "delta_patch.h"
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+void delta_header_encode(const delta_header_t *header, uint8_t out[DELTA_HEADER_SIZE]) {
+    memcpy(out, DELTA_MAGIC, 4);
+    write_u32(out + 4, header->source_size);
+    write_u32(out + 8, header->target_size);
+    memcpy(out + 12, header->source_sha256, DELTA_HASH_SIZE);
+    memcpy(out + 12 + DELTA_HASH_SIZE, header->target_sha256, DELTA_HASH_SIZE);
+}
+
+bool delta_header_decode(const uint8_t in[DELTA_HEADER_SIZE], delta_header_t *header) {
+    if (memcmp(in, DELTA_MAGIC, 4) != 0) {
+        return false;
+    }
+    header->source_size = read_u32(in + 4);
+    header->target_size = read_u32(in + 8);
+    memcpy(header->source_sha256, in + 12, DELTA_HASH_SIZE);
+    memcpy(header->target_sha256, in + 12 + DELTA_HASH_SIZE, DELTA_HASH_SIZE);
+    return true;
+}
+
+void delta_state_init(delta_state_t *state) {
+    memset(state, 0, sizeof(*state));
+    state->phase = DELTA_PHASE_HEADER;
+}
+
+// Acumula hasta "needed" bytes en state->pending; true cuando está completo
+static bool accumulate(delta_state_t *state, size_t needed,
+                       const uint8_t *input, size_t input_len, size_t *in_pos) {
+    size_t take = needed - state->pending_len;
+    if (take > input_len - *in_pos) {
+        take = input_len - *in_pos;
+    }
+    memcpy(state->pending + state->pending_len, input + *in_pos, take);
+    state->pending_len += (uint32_t)take;
+    *in_pos += take;
+    return state->pending_len == needed;
+}
+
+static delta_result_t start_op(delta_state_t *state) {
+    uint8_t opcode = state->pending[0];
+    uint32_t length;
+    if (opcode == DELTA_OP_COPY) {
+        state->copy_offset = read_u32(state->pending + 1);
+        length = read_u32(state->pending + 5);
+        if (state->copy_offset > state->header.source_size ||
+            length > state->header.source_size - state->copy_offset) {
+            return DELTA_ERR_RANGE;
+        }
+        state->phase = DELTA_PHASE_COPY;
+    } else {
+        length = read_u32(state->pending + 1);
+        state->phase = DELTA_PHASE_INSERT;
+    }
+    if (length == 0 || length > state->header.target_size - state->target_written) {
+        return DELTA_ERR_RANGE;
+    }
+    state->op_remaining = length;
+    state->pending_len = 0;
+    return DELTA_OK;
+}
+
+delta_result_t delta_apply_step(delta_state_t *state,
+                                const uint8_t *input, size_t input_len, size_t *consumed,
+                                uint8_t *output, size_t output_cap, size_t *produced,
+                                delta_read_source_fn read_source, void *ctx) {
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+    delta_result_t result = DELTA_OK;
+
+    while (result == DELTA_OK) {
+        if (state->phase == DELTA_PHASE_HEADER) {
+            if (!accumulate(state, DELTA_HEADER_SIZE, input, input_len, &in_pos)) {
+                break;  // falta entrada
+            }
+            if (!delta_header_decode(state->pending, &state->header)) {
+                result = DELTA_ERR_MAGIC;
+                break;
+            }
+            state->pending_len = 0;
+            state->phase = state->header.target_size > 0 ? DELTA_PHASE_OP : DELTA_PHASE_DONE;
+        } else if (state->phase == DELTA_PHASE_OP) {
+            if (state->pending_len == 0 && in_pos == input_len) {
+                break;
+            }
+            uint8_t opcode = state->pending_len > 0 ? state->pending[0] : input[in_pos];
+            if (opcode != DELTA_OP_COPY && opcode != DELTA_OP_INSERT) {
+                result = DELTA_ERR_OPCODE;
+                break;
+            }
+            size_t needed = opcode == DELTA_OP_COPY ? 9 : 5;
+            if (!accumulate(state, needed, input, input_len, &in_pos)) {
+                break;
+            }
+            result = start_op(state);
+        } else if (state->phase == DELTA_PHASE_COPY || state->phase == DELTA_PHASE_INSERT) {
+            size_t chunk = state->op_remaining;
+            if (chunk > output_cap - out_pos) {
+                chunk = output_cap - out_pos;
+            }
+            if (state->phase == DELTA_PHASE_INSERT && chunk > input_len - in_pos) {
+                chunk = input_len - in_pos;
+            }
+            if (chunk == 0) {
+                break;  // salida llena o falta entrada
+            }
+            if (state->phase == DELTA_PHASE_COPY) {
+                if (read_source(ctx, state->copy_offset, output + out_pos, chunk) != 0) {
+                    result = DELTA_ERR_SOURCE;
+                    break;
+                }
+                state->copy_offset += (uint32_t)chunk;
+            } else {
+                memcpy(output + out_pos, input + in_pos, chunk);
+                in_pos += chunk;
+            }
+            out_pos += chunk;
+            state->op_remaining -= (uint32_t)chunk;
+            state->target_written += (uint32_t)chunk;
+            if (state->op_remaining == 0) {
+                state->phase = state->target_written == state->header.target_size
+                                   ? DELTA_PHASE_DONE : DELTA_PHASE_OP;
+            }
+        } else {
+            result = DELTA_DONE;
+        }
+    }
+
+    state->patch_consumed += (uint32_t)in_pos;
+    *consumed = in_pos;
+    *produced = out_pos;
+    return result;
+}
+
+const char *delta_result_name(delta_result_t result) {
+    switch (result) {
+        case DELTA_OK: return "ok";
+        case DELTA_DONE: return "completo";
+        case DELTA_ERR_MAGIC: return "cabecera inválida";
+        case DELTA_ERR_OPCODE: return "operación desconocida";
+        case DELTA_ERR_RANGE: return "rango fuera de la imagen";
+        case DELTA_ERR_SOURCE: return "error leyendo la imagen origen";
+    }
+    return "?";
+}
@@ -0,0 +1,89 @@
+/*
+ * AgroMind - Parches binarios delta (formato AGD1)
+ *
+ * Un parche describe la imagen nueva como una secuencia de operaciones
+ * sobre la imagen que ya corre en el dispositivo:
+ *
+ *   cabecera (76 bytes, little-endian)
+ *     "AGD1" | tamaño origen u32 | tamaño destino u32
+ *     | SHA-256 origen [32] | SHA-256 destino [32]
+ *   operaciones hasta completar el tamaño destino
+ *     0x01 COPY   offset u32, longitud u32   -> bytes de la imagen origen
+ *     0x02 INSERT longitud u32, datos[...]    -> bytes literales del parche
+ *
+ * El aplicador funciona por pasos, estilo zlib: consume lo que haya llegado
+ * del parche y produce como mucho output_cap bytes. Todo su estado vive en
+ * delta_state_t (POD), así una descarga interrumpida se retoma guardándolo
+ * en NVS junto con el offset del parche. No calcula hashes: el llamador
+ * verifica origen y destino (mbedtls en el ESP32, host/common en el PC).
+ *
+ * Generador y aplicador de referencia: esp32-idf/host/tools/delta_tool.cpp
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_MAGIC "AGD1"
+#define DELTA_HEADER_SIZE 76
+#define DELTA_HASH_SIZE 32
+
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_INSERT 0x02
+#define DELTA_OP_MAX_HEADER 9
+
+typedef enum {
+    DELTA_OK = 0,           // progreso; pedir más entrada o más espacio de salida
+    DELTA_DONE,             // imagen destino completa
+    DELTA_ERR_MAGIC,
+    DELTA_ERR_OPCODE,
+    DELTA_ERR_RANGE,        // COPY fuera de la imagen origen o destino desbordado
+    DELTA_ERR_SOURCE,       // falló la lectura de la imagen origen
+} delta_result_t;
+
+typedef struct {
+    uint32_t source_size;
+    uint32_t target_size;
+    uint8_t source_sha256[DELTA_HASH_SIZE];
+    uint8_t target_sha256[DELTA_HASH_SIZE];
+} delta_header_t;
+
+typedef enum {
+    DELTA_PHASE_HEADER = 0,
+    DELTA_PHASE_OP,
+    DELTA_PHASE_COPY,
+    DELTA_PHASE_INSERT,
+    DELTA_PHASE_DONE,
+} delta_phase_t;
+
+typedef struct {
+    uint32_t phase;                 // delta_phase_t
+    uint32_t pending_len;           // bytes acumulados de una cabecera partida
+    uint8_t pending[DELTA_HEADER_SIZE];
+    uint32_t op_remaining;
+    uint32_t copy_offset;
+    uint32_t patch_consumed;        // offset del parche ya procesado (para Range)
+    uint32_t target_written;
+    delta_header_t header;          // válido desde que phase > HEADER
+} delta_state_t;
+
+// Lee len bytes de la imagen origen; devuelve 0 si todo fue bien
+typedef int (*delta_read_source_fn)(void *ctx, uint32_t offset, uint8_t *buffer, size_t len);
+
+void delta_state_init(delta_state_t *state);
+
+delta_result_t delta_apply_step(delta_state_t *state,
+                                const uint8_t *input, size_t input_len, size_t *consumed,
+                                uint8_t *output, size_t output_cap, size_t *produced,
+                                delta_read_source_fn read_source, void *ctx);
+
+// Serialización de la cabecera (usada por el generador del host)
+void delta_header_encode(const delta_header_t *header, uint8_t out[DELTA_HEADER_SIZE]);
+bool delta_header_decode(const uint8_t in[DELTA_HEADER_SIZE], delta_header_t *header);
+
+const char *delta_result_name(delta_result_t result);
+
+#endif // DELTA_PATCH_H
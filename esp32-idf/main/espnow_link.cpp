@@ -0,0 +1,584 @@
+/*
+ * AgroMind - Enlace ESP-NOW hoja/gateway (ver espnow_link.h)
+ */
+
+#include <math.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "espnow_link.h"
+#include "upload_protocol.h"
+
+static const char *TAG = "ESPNOW";
+
+const uint8_t LINK_BROADCAST_MAC[LINK_MAC_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+#define LINK_HEADER_SIZE 5
+#define LINK_READING_FIXED_SIZE (LINK_HEADER_SIZE + 9)
+#define LINK_READING_ZONE_SIZE 20
+#define LINK_COMMANDS_FIXED_SIZE (LINK_HEADER_SIZE + 1)
+#define LINK_COMMANDS_ZONE_SIZE 11
+
+// ==================== CODIFICACIÓN ====================
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    put_u16(p, (uint16_t)value);
+    put_u16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static long clamp_round(float value, long min, long max) {
+    long rounded = lroundf(value);
+    return rounded < min ? min : (rounded > max ? max : rounded);
+}
+
+static void put_header(uint8_t *out, uint8_t type, uint16_t seq) {
+    out[0] = LINK_MAGIC;
+    out[1] = LINK_VERSION;
+    out[2] = type;
+    put_u16(out + 3, seq);
+}
+
+int link_frame_type(const uint8_t *data, size_t length) {
+    if (length < LINK_HEADER_SIZE || data[0] != LINK_MAGIC || data[1] != LINK_VERSION) {
+        return 0;
+    }
+    return data[2] == LINK_FRAME_READING || data[2] == LINK_FRAME_COMMANDS ? data[2] : 0;
+}
+
+size_t link_encode_reading(const link_reading_t *reading, uint8_t *out, size_t capacity) {
+    size_t length = LINK_READING_FIXED_SIZE + (size_t)reading->zone_count * LINK_READING_ZONE_SIZE;
+    if (reading->zone_count > MAX_ZONE_CHANNELS || length > capacity) {
+        return 0;
+    }
+    put_header(out, LINK_FRAME_READING, reading->seq);
+    uint8_t *p = out + LINK_HEADER_SIZE;
+    put_u16(p, reading->ack_seq);
+    put_u16(p + 2, (uint16_t)(int16_t)clamp_round(reading->temperature_c * 10.0f, -32768, 32767));
+    p[4] = (uint8_t)clamp_round(reading->ambient_humidity, 0, 100);
+    p[5] = (uint8_t)clamp_round(reading->tank_level, 0, 100);
+    p[6] = (uint8_t)clamp_round(reading->light_level, 0, 100);
+    p[7] = (uint8_t)((reading->temperature_quality & 3) | ((reading->humidity_quality & 3) << 2) |
+                     ((reading->tank_quality & 3) << 4) | ((reading->light_quality & 3) << 6));
+    p[8] = reading->zone_count;
+    p += 9;
+    for (int i = 0; i < reading->zone_count; ++i) {
+        const link_zone_reading_t *zone = &reading->zones[i];
+        put_u32(p, (uint32_t)zone->zone_id);
+        p[4] = zone->channel;
+        put_u16(p + 5, (uint16_t)clamp_round(zone->soil_moisture * 10.0f, 0, 1000));
+        p[7] = (uint8_t)((zone->pump_on ? LINK_ZONE_PUMP_ON : 0) |
+                         ((zone->soil_quality & 3) << LINK_ZONE_QUALITY_SHIFT));
+        put_u32(p + 8, zone->pump_runtime_ms);
+        put_u32(p + 12, zone->pump_sessions);
+        put_u32(p + 16, (uint32_t)llroundf(zone->water_liters * 100.0f));
+        p += LINK_READING_ZONE_SIZE;
+    }
+    return length;
+}
+
+bool link_decode_reading(const uint8_t *data, size_t length, link_reading_t *reading) {
+    if (link_frame_type(data, length) != LINK_FRAME_READING || length < LINK_READING_FIXED_SIZE) {
+        return false;
+    }
+    const uint8_t *p = data + LINK_HEADER_SIZE;
+    uint8_t zone_count = p[8];
+    if (zone_count > MAX_ZONE_CHANNELS ||
+        length != LINK_READING_FIXED_SIZE + (size_t)zone_count * LINK_READING_ZONE_SIZE) {
+        return false;
+    }
+    memset(reading, 0, sizeof(*reading));
+    reading->seq = get_u16(data + 3);
+    reading->ack_seq = get_u16(p);
+    reading->temperature_c = (int16_t)get_u16(p + 2) / 10.0f;
+    reading->ambient_humidity = p[4];
+    reading->tank_level = p[5];
+    reading->light_level = p[6];
+    reading->temperature_quality = (sensor_quality_t)(p[7] & 3);
+    reading->humidity_quality = (sensor_quality_t)((p[7] >> 2) & 3);
+    reading->tank_quality = (sensor_quality_t)((p[7] >> 4) & 3);
+    reading->light_quality = (sensor_quality_t)((p[7] >> 6) & 3);
+    reading->zone_count = zone_count;
+    p += 9;
+    for (int i = 0; i < zone_count; ++i) {
+        link_zone_reading_t *zone = &reading->zones[i];
+        zone->zone_id = (int32_t)get_u32(p);
+        zone->channel = p[4];
+        zone->soil_moisture = get_u16(p + 5) / 10.0f;
+        zone->pump_on = (p[7] & LINK_ZONE_PUMP_ON) != 0;
+        zone->soil_quality = (sensor_quality_t)((p[7] >> LINK_ZONE_QUALITY_SHIFT) & 3);
+        zone->pump_runtime_ms = get_u32(p + 8);
+        zone->pump_sessions = get_u32(p + 12);
+        zone->water_liters = get_u32(p + 16) / 100.0f;
+        p += LINK_READING_ZONE_SIZE;
+    }
+    return true;
+}
+
+size_t link_encode_commands(const link_commands_t *commands, uint8_t *out, size_t capacity) {
+    size_t length = LINK_COMMANDS_FIXED_SIZE + (size_t)commands->zone_count * LINK_COMMANDS_ZONE_SIZE;
+    if (commands->zone_count > MAX_ZONE_CHANNELS || length > capacity) {
+        return 0;
+    }
+    put_header(out, LINK_FRAME_COMMANDS, commands->seq);
+    uint8_t *p = out + LINK_HEADER_SIZE;
+    *p++ = commands->zone_count;
+    for (int i = 0; i < commands->zone_count; ++i) {
+        const link_zone_command_t *zone = &commands->zones[i];
+        put_u32(p, (uint32_t)zone->zone_id);
+        put_u16(p + 4, zone->status);
+        p[6] = zone->flags;
+        put_u16(p + 7, (uint16_t)clamp_round(zone->moisture_threshold * 10.0f, 0, 1000));
+        put_u16(p + 9, (uint16_t)(zone->watering_duration > 0xffff ? 0xffff : zone->watering_duration));
+        p += LINK_COMMANDS_ZONE_SIZE;
+    }
+    return length;
+}
+
+bool link_decode_commands(const uint8_t *data, size_t length, link_commands_t *commands) {
+    if (link_frame_type(data, length) != LINK_FRAME_COMMANDS || length < LINK_COMMANDS_FIXED_SIZE) {
+        return false;
+    }
+    uint8_t zone_count = data[LINK_HEADER_SIZE];
+    if (zone_count > MAX_ZONE_CHANNELS ||
+        length != LINK_COMMANDS_FIXED_SIZE + (size_t)zone_count * LINK_COMMANDS_ZONE_SIZE) {
+        return false;
+    }
+    memset(commands, 0, sizeof(*commands));
+    commands->seq = get_u16(data + 3);
+    commands->zone_count = zone_count;
+    const uint8_t *p = data + LINK_COMMANDS_FIXED_SIZE;
+    for (int i = 0; i < zone_count; ++i) {
+        link_zone_command_t *zone = &commands->zones[i];
+        zone->zone_id = (int32_t)get_u32(p);
+        zone->status = get_u16(p + 4);
+        zone->flags = p[6];
+        zone->moisture_threshold = get_u16(p + 7) / 10.0f;
+        zone->watering_duration = get_u16(p + 9);
+        p += LINK_COMMANDS_ZONE_SIZE;
+    }
+    return true;
+}
+
+static bool ticks_within(TickType_t since, uint32_t ms) {
+    return (TickType_t)(xTaskGetTickCount() - since) <= pdMS_TO_TICKS(ms);
+}
+
+// ==================== HOJA ====================
+
+void link_leaf_init(link_leaf_t *leaf, node_state_t *node, const link_radio_t *radio) {
+    memset(leaf, 0, sizeof(*leaf));
+    leaf->node = node;
+    if (radio != NULL) {
+        leaf->radio = *radio;
+    }
+}
+
+void link_leaf_pin_gateway(link_leaf_t *leaf, const uint8_t mac[LINK_MAC_LEN]) {
+    memcpy(leaf->gateway_mac, mac, LINK_MAC_LEN);
+    leaf->gateway_pinned = true;
+}
+
+bool link_leaf_gateway_alive(const link_leaf_t *leaf) {
+    return leaf->gateway_known && ticks_within(leaf->last_gateway_tick, LINK_GATEWAY_TIMEOUT_MS);
+}
+
+bool link_leaf_send_reading(link_leaf_t *leaf) {
+    const node_state_t *node = leaf->node;
+    link_reading_t reading = {};
+    reading.seq = leaf->next_seq++;
+    reading.ack_seq = leaf->has_command_seq ? leaf->last_command_seq : 0;
+    reading.temperature_c = node->temperature_c;
+    reading.ambient_humidity = node->ambient_humidity;
+    reading.tank_level = node->tank_level;
+    reading.light_level = node->light_level;
+    reading.temperature_quality = node->temperature_quality;
+    reading.humidity_quality = node->humidity_quality;
+    reading.tank_quality = node->tank_quality;
+    reading.light_quality = node->light_quality;
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        const zone_state_t *zone = &node->zones[ch];
+        if (zone->zone_id <= 0) {
+            continue;
+        }
+        link_zone_reading_t *entry = &reading.zones[reading.zone_count++];
+        entry->zone_id = zone->zone_id;
+        entry->channel = (uint8_t)ch;
+        entry->soil_moisture = zone->last_soil_moisture;
+        entry->soil_quality = zone->soil_quality;
+        entry->pump_runtime_ms = (uint32_t)(zone->meter.total_runtime_us / 1000U);
+        entry->pump_sessions = zone->meter.sessions;
+        entry->water_liters = (float)zone_pump_liters(node, ch);
+        entry->pump_on = zone->pump_state;
+    }
+
+    // Gateway caído o reemplazado: volver a buscarlo por broadcast (uno
+    // fijo se sigue llamando directo)
+    if (leaf->gateway_known && !link_leaf_gateway_alive(leaf)) {
+        ESP_LOGW(TAG, "Sin respuesta del gateway, buscando por %s",
+                 leaf->gateway_pinned ? "su MAC fija" : "broadcast");
+        leaf->gateway_known = false;
+    }
+
+    uint8_t frame[LINK_MAX_FRAME];
+    size_t length = link_encode_reading(&reading, frame, sizeof(frame));
+    if (length == 0 || leaf->radio.send == NULL) {
+        return false;
+    }
+    const uint8_t *destination = leaf->gateway_known || leaf->gateway_pinned ? leaf->gateway_mac
+                                                                              : LINK_BROADCAST_MAC;
+    if (leaf->radio.send(leaf->radio.ctx, destination, frame, length) != 0) {
+        return false;
+    }
+    leaf->readings_sent++;
+    return true;
+}
+
+// Traduce la trama al mismo objeto "commands" del servidor para que la hoja
+// aplique exactamente las reglas de zone_apply_commands
+static void apply_zone_command(node_state_t *node, int channel, const link_zone_command_t *command) {
+    cJSON *commands = cJSON_CreateObject();
+    if (commands == NULL) {
+        return;
+    }
+    if (command->flags & LINK_CMD_HAS_CONFIG) {
+        cJSON_AddBoolToObject(commands, "autoMode", (command->flags & LINK_CMD_AUTO_MODE) != 0);
+        if (command->moisture_threshold > 0.0f) {
+            cJSON_AddNumberToObject(commands, "moistureThreshold", command->moisture_threshold);
+        }
+        if (command->watering_duration > 0) {
+            cJSON_AddNumberToObject(commands, "wateringDuration", command->watering_duration);
+        }
+    }
+    cJSON_AddBoolToObject(commands, "tankLocked", (command->flags & LINK_CMD_TANK_LOCKED) != 0);
+    if (command->flags & LINK_CMD_HAS_PUMP) {
+        cJSON_AddBoolToObject(commands, "pumpState", (command->flags & LINK_CMD_PUMP_ON) != 0);
+    } else {
+        cJSON_AddNullToObject(commands, "pumpState");
+    }
+    zone_apply_commands(node, channel, commands);
+    cJSON_Delete(commands);
+}
+
+void link_leaf_handle_frame(link_leaf_t *leaf, const uint8_t mac[LINK_MAC_LEN],
+                            const uint8_t *data, size_t length) {
+    link_commands_t commands;
+    if (!link_decode_commands(data, length, &commands)) {
+        return;
+    }
+
+    // Con el gateway vivo (o fijo) cualquier otro emisor se descarta: si no,
+    // un vecino podría encender bombas y quedarse con la hoja
+    bool same_gateway = memcmp(leaf->gateway_mac, mac, LINK_MAC_LEN) == 0;
+    if (!same_gateway && (leaf->gateway_pinned || link_leaf_gateway_alive(leaf))) {
+        leaf->rejected_frames++;
+        ESP_LOGW(TAG, "Comandos de %02x:%02x:%02x:%02x:%02x:%02x descartados: no es el gateway",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        return;
+    }
+    if (!same_gateway) {
+        // Gateway nuevo: su seq no tiene relación con la del anterior
+        memcpy(leaf->gateway_mac, mac, LINK_MAC_LEN);
+        leaf->has_command_seq = false;
+    }
+    if (!leaf->gateway_known || !same_gateway) {
+        leaf->gateway_known = true;
+        ESP_LOGI(TAG, "📡 Gateway %02x:%02x:%02x:%02x:%02x:%02x",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+    leaf->last_gateway_tick = xTaskGetTickCount();
+
+    if (leaf->has_command_seq && commands.seq == leaf->last_command_seq) {
+        leaf->duplicates++;     // retransmisión: el ack se perdió
+        return;
+    }
+
+    node_state_t *node = leaf->node;
+    for (int i = 0; i < commands.zone_count; ++i) {
+        const link_zone_command_t *command = &commands.zones[i];
+        int channel = node_find_channel(node, command->zone_id);
+        if (channel < 0) {
+            continue;
+        }
+        if (command->status == 404) {
+            ESP_LOGW(TAG, "⚠️ Zona %ld no existe en el servidor, liberando canal %d",
+                     (long)command->zone_id, channel);
+            zone_release(node, channel);
+        } else {
+            apply_zone_command(node, channel, command);
+        }
+    }
+    zone_apply_auto_mode_all(node);
+
+    leaf->last_command_seq = commands.seq;
+    leaf->has_command_seq = true;
+    leaf->commands_applied++;
+}
+
+// ==================== GATEWAY ====================
+
+void link_gateway_init(link_gateway_t *gateway, const link_radio_t *radio) {
+    memset(gateway, 0, sizeof(*gateway));
+    if (radio != NULL) {
+        gateway->radio = *radio;
+    }
+}
+
+static bool send_commands(link_gateway_t *gateway, const link_peer_t *peer) {
+    uint8_t frame[LINK_MAX_FRAME];
+    size_t length = link_encode_commands(&peer->pending, frame, sizeof(frame));
+    if (length == 0 || gateway->radio.send == NULL) {
+        return false;
+    }
+    return gateway->radio.send(gateway->radio.ctx, peer->mac, frame, length) == 0;
+}
+
+static link_peer_t *find_or_add_peer(link_gateway_t *gateway, const uint8_t mac[LINK_MAC_LEN]) {
+    link_peer_t *free_slot = NULL;
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        link_peer_t *peer = &gateway->peers[i];
+        if (peer->in_use && memcmp(peer->mac, mac, LINK_MAC_LEN) == 0) {
+            return peer;
+        }
+        bool expired = peer->in_use && !ticks_within(peer->last_seen_tick, LINK_LEAF_EXPIRE_MS);
+        if (free_slot == NULL && (!peer->in_use || expired)) {
+            free_slot = peer;
+        }
+    }
+    if (free_slot != NULL) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->in_use = true;
+        free_slot->next_seq = 1;    // ack_seq 0 = "nada aplicado todavía"
+        memcpy(free_slot->mac, mac, LINK_MAC_LEN);
+        ESP_LOGI(TAG, "➕ Hoja %02x:%02x:%02x:%02x:%02x:%02x",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+    return free_slot;
+}
+
+void link_gateway_handle_frame(link_gateway_t *gateway, const uint8_t mac[LINK_MAC_LEN],
+                               const uint8_t *data, size_t length) {
+    link_reading_t reading;
+    if (!link_decode_reading(data, length, &reading)) {
+        gateway->rejected_frames++;
+        return;
+    }
+    link_peer_t *peer = find_or_add_peer(gateway, mac);
+    if (peer == NULL) {
+        gateway->rejected_frames++;
+        ESP_LOGW(TAG, "Tabla de hojas llena (%d)", LINK_MAX_LEAVES);
+        return;
+    }
+    peer->reading = reading;
+    peer->last_seen_tick = xTaskGetTickCount();
+    gateway->readings_received++;
+
+    // La hoja está despierta: momento de reintentar lo que no confirmó
+    if (peer->has_pending) {
+        if (reading.ack_seq == peer->pending.seq) {
+            peer->has_pending = false;
+        } else if (send_commands(gateway, peer)) {
+            gateway->retransmissions++;
+        }
+    }
+}
+
+static bool peer_is_fresh(const link_peer_t *peer) {
+    return peer->in_use && ticks_within(peer->last_seen_tick, LINK_LEAF_STALE_MS);
+}
+
+int link_gateway_active_leaves(link_gateway_t *gateway) {
+    int count = 0;
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        if (peer_is_fresh(&gateway->peers[i]) && gateway->peers[i].reading.zone_count > 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int link_gateway_zone_count(link_gateway_t *gateway) {
+    int count = 0;
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        if (peer_is_fresh(&gateway->peers[i])) {
+            count += gateway->peers[i].reading.zone_count;
+        }
+    }
+    return count;
+}
+
+int link_gateway_add_zones(link_gateway_t *gateway, cJSON *payload, int max_zones) {
+    cJSON *zone_array = cJSON_GetObjectItem(payload, "zones");
+    if (zone_array == NULL) {
+        zone_array = cJSON_AddArrayToObject(payload, "zones");
+    }
+
+    // Si no entran todas, se empieza cada ciclo por una hoja distinta
+    int added = 0;
+    int start = gateway->upload_cursor;
+    for (int n = 0; n < LINK_MAX_LEAVES; ++n) {
+        int index = (start + n) % LINK_MAX_LEAVES;
+        const link_peer_t *peer = &gateway->peers[index];
+        if (!peer_is_fresh(peer) || peer->reading.zone_count == 0) {
+            continue;
+        }
+        const link_reading_t *reading = &peer->reading;
+        if (added + reading->zone_count > max_zones) {
+            gateway->upload_cursor = index;
+            break;
+        }
+        for (int z = 0; z < reading->zone_count; ++z) {
+            const link_zone_reading_t *zone = &reading->zones[z];
+            cJSON *entry = cJSON_CreateObject();
+            cJSON_AddNumberToObject(entry, "zoneId", zone->zone_id);
+            cJSON_AddNumberToObject(entry, "channel", zone->channel);
+            // Los sensores compartidos de la hoja pisan los del gateway en el backend
+            cJSON *sensors = cJSON_CreateObject();
+            upload_add_reading(sensors, "soilMoisture", zone->soil_moisture, zone->soil_quality);
+            cJSON_AddBoolToObject(sensors, "pumpStatus", zone->pump_on);
+            upload_add_reading(sensors, "temperature", reading->temperature_c, reading->temperature_quality);
+            upload_add_reading(sensors, "ambientHumidity", reading->ambient_humidity, reading->humidity_quality);
+            upload_add_reading(sensors, "waterLevel", reading->tank_level, reading->tank_quality);
+            upload_add_reading(sensors, "lightLevel", reading->light_level, reading->light_quality);
+            upload_add_pump_meter(sensors, zone->pump_sessions, zone->pump_runtime_ms, zone->water_liters);
+            cJSON_AddItemToObject(entry, "sensors", sensors);
+            cJSON_AddItemToArray(zone_array, entry);
+        }
+        added += reading->zone_count;
+    }
+    return added;
+}
+
+// Hoja que reportó la zona más recientemente (una zona puede cambiar de hoja)
+static link_peer_t *find_zone_owner(link_gateway_t *gateway, int32_t zone_id) {
+    link_peer_t *owner = NULL;
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        link_peer_t *peer = &gateway->peers[i];
+        if (!peer->in_use) {
+            continue;
+        }
+        for (int z = 0; z < peer->reading.zone_count; ++z) {
+            if (peer->reading.zones[z].zone_id == zone_id &&
+                (owner == NULL ||
+                 (int32_t)(peer->last_seen_tick - owner->last_seen_tick) > 0)) {
+                owner = peer;
+            }
+        }
+    }
+    return owner;
+}
+
+static void parse_zone_command(const cJSON *result, link_zone_command_t *command) {
+    memset(command, 0, sizeof(*command));
+    command->zone_id = (int32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "zoneId"));
+    cJSON *status = cJSON_GetObjectItem(result, "status");
+    command->status = cJSON_IsNumber(status) ? (uint16_t)cJSON_GetNumberValue(status) : 200;
+
+    cJSON *commands = cJSON_GetObjectItem(result, "commands");
+    if (!cJSON_IsObject(commands)) {
+        return;
+    }
+    cJSON *pump_state = cJSON_GetObjectItem(commands, "pumpState");
+    if (cJSON_IsBool(pump_state)) {
+        command->flags |= LINK_CMD_HAS_PUMP | (cJSON_IsTrue(pump_state) ? LINK_CMD_PUMP_ON : 0);
+    }
+    cJSON *auto_mode = cJSON_GetObjectItem(commands, "autoMode");
+    if (cJSON_IsBool(auto_mode)) {
+        command->flags |= LINK_CMD_HAS_CONFIG | (cJSON_IsTrue(auto_mode) ? LINK_CMD_AUTO_MODE : 0);
+    }
+    cJSON *threshold = cJSON_GetObjectItem(commands, "moistureThreshold");
+    if (cJSON_IsNumber(threshold)) {
+        command->moisture_threshold = (float)cJSON_GetNumberValue(threshold);
+    }
+    cJSON *duration = cJSON_GetObjectItem(commands, "wateringDuration");
+    if (cJSON_IsNumber(duration) && cJSON_GetNumberValue(duration) >= 1.0) {
+        command->watering_duration = (uint32_t)cJSON_GetNumberValue(duration);
+    }
+    if (cJSON_IsTrue(cJSON_GetObjectItem(commands, "tankLocked"))) {
+        command->flags |= LINK_CMD_TANK_LOCKED;
+    }
+}
+
+// Un comando nuevo reemplaza al pendiente, pero sin perder un pumpState o un 404
+static void carry_over_pending(const link_commands_t *pending, link_commands_t *next) {
+    for (int i = 0; i < pending->zone_count; ++i) {
+        const link_zone_command_t *old = &pending->zones[i];
+        if (!(old->flags & LINK_CMD_HAS_PUMP) && old->status != 404) {
+            continue;
+        }
+        link_zone_command_t *match = NULL;
+        for (int j = 0; j < next->zone_count; ++j) {
+            if (next->zones[j].zone_id == old->zone_id) {
+                match = &next->zones[j];
+            }
+        }
+        if (match == NULL && next->zone_count < MAX_ZONE_CHANNELS) {
+            next->zones[next->zone_count++] = *old;
+        } else if (match != NULL && old->status == 404) {
+            match->status = 404;
+        } else if (match != NULL && !(match->flags & LINK_CMD_HAS_PUMP)) {
+            match->flags |= old->flags & (LINK_CMD_HAS_PUMP | LINK_CMD_PUMP_ON);
+        }
+    }
+}
+
+void link_gateway_route_response(link_gateway_t *gateway, const cJSON *response) {
+    static link_commands_t outgoing[LINK_MAX_LEAVES];
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        outgoing[i].zone_count = 0;
+    }
+
+    const cJSON *result = NULL;
+    cJSON_ArrayForEach(result, cJSON_GetObjectItem(response, "zones")) {
+        cJSON *zone_id = cJSON_GetObjectItem(result, "zoneId");
+        if (!cJSON_IsNumber(zone_id)) {
+            continue;
+        }
+        link_peer_t *owner = find_zone_owner(gateway, (int32_t)cJSON_GetNumberValue(zone_id));
+        if (owner == NULL) {
+            continue;   // zona propia del gateway
+        }
+        link_commands_t *commands = &outgoing[owner - gateway->peers];
+        if (commands->zone_count < MAX_ZONE_CHANNELS) {
+            parse_zone_command(result, &commands->zones[commands->zone_count]);
+            if (commands->zones[commands->zone_count].status == 200 ||
+                commands->zones[commands->zone_count].status == 404) {
+                commands->zone_count++;
+            }
+        }
+    }
+
+    for (int i = 0; i < LINK_MAX_LEAVES; ++i) {
+        link_peer_t *peer = &gateway->peers[i];
+        link_commands_t *commands = &outgoing[i];
+        if (commands->zone_count == 0) {
+            continue;
+        }
+        if (peer->has_pending) {
+            carry_over_pending(&peer->pending, commands);
+        }
+        commands->seq = peer->next_seq++;
+        if (peer->next_seq == 0) {
+            peer->next_seq = 1;
+        }
+        peer->pending = *commands;
+        peer->has_pending = true;
+        if (send_commands(gateway, peer)) {
+            gateway->commands_sent++;
+        }
+    }
+}
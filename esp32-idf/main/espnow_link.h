@@ -0,0 +1,200 @@
+/*
+ * AgroMind - Enlace ESP-NOW entre nodos hoja y un gateway
+ *
+ * Las hojas no abren sesión TLS con la nube: cada ciclo envían por ESP-NOW
+ * una trama compacta con sus lecturas. El gateway guarda la última lectura
+ * de cada hoja, las suma a su propio POST multiplexado (las zonas de una
+ * hoja llevan sus sensores compartidos dentro de "sensors") y reparte los
+ * "commands" de cada zona a la hoja que la reportó.
+ *
+ * Tramas (little-endian, <= LINK_MAX_FRAME bytes):
+ *   cabecera: magic 0xA6 | versión | tipo | seq u16
+ *   READING : ack_seq u16 | temp i16 (0.1 °C) | humedad u8 | tanque u8 | luz u8
+ *             | calidades u8 (2 bits c/u: temp, humedad, tanque, luz)
+ *             | n u8 | n x { zoneId i32, canal u8, suelo u16 (0.1 %), flags u8,
+ *                            bomba ms u32, riegos u32, litros u32 (0.01 L) }
+ *   COMMANDS: n u8 | n x { zoneId i32, status u16, flags u8,
+ *                          umbral u16 (0.1 %), duración u16 (s) }
+ *
+ * Gateway de la hoja: el primero que le manda una COMMANDS válida, y otro
+ * solo después de LINK_GATEWAY_TIMEOUT_MS sin noticias del actual (o
+ * nunca, si se fijó con link_leaf_pin_gateway). Las tramas de cualquier
+ * otro emisor se descartan: no cambian el gateway ni aplican comandos.
+ *
+ * Entrega de comandos: la hoja devuelve en ack_seq la última trama COMMANDS
+ * aplicada. Mientras no llegue ese ack el gateway la retransmite con cada
+ * lectura de la hoja, y si entretanto llegan comandos nuevos conserva los
+ * pumpState y 404 pendientes (el backend entrega cada comando manual una
+ * sola vez). La hoja descarta duplicados por seq.
+ *
+ * Solo depende de zone_control, upload_protocol, cJSON y los ticks de
+ * FreeRTOS: la radio es un hook, así host/tools/gateway_sim lo ejecuta
+ * sobre un enlace simulado con pérdidas.
+ */
+
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "zone_control.h"
+
+// Rol del firmware (AGROMIND_NODE_ROLE en config.h)
+#define NODE_ROLE_STANDALONE 0      // sube directo a la nube (comportamiento original)
+#define NODE_ROLE_GATEWAY 1         // sube lo propio y lo de las hojas
+#define NODE_ROLE_LEAF 2            // solo ESP-NOW hacia el gateway
+
+#define LINK_MAGIC 0xA6
+#define LINK_VERSION 3
+#define LINK_MAX_FRAME 250          // ESP_NOW_MAX_DATA_LEN
+#define LINK_MAC_LEN 6
+
+#define LINK_FRAME_READING 1
+#define LINK_FRAME_COMMANDS 2
+
+#ifndef LINK_MAX_LEAVES
+#define LINK_MAX_LEAVES 16
+#endif
+#define LINK_LEAF_STALE_MS 15000    // lecturas más viejas no se suben
+#define LINK_LEAF_EXPIRE_MS 600000  // hoja silenciosa: se libera su entrada
+#define LINK_GATEWAY_TIMEOUT_MS 20000
+
+// flags de zona en READING
+#define LINK_ZONE_PUMP_ON 0x01
+#define LINK_ZONE_QUALITY_SHIFT 1   // bits 1-2: sensor_quality_t del suelo
+
+// flags de zona en COMMANDS
+#define LINK_CMD_HAS_PUMP 0x01      // pumpState no es null
+#define LINK_CMD_PUMP_ON 0x02
+#define LINK_CMD_AUTO_MODE 0x04
+#define LINK_CMD_TANK_LOCKED 0x08
+#define LINK_CMD_HAS_CONFIG 0x10    // autoMode/umbral/duración válidos
+
+typedef struct {
+    int32_t zone_id;
+    uint8_t channel;
+    float soil_moisture;
+    sensor_quality_t soil_quality;
+    bool pump_on;
+    // Contadores de riego de la hoja (ver pump_meter_t)
+    uint32_t pump_runtime_ms;
+    uint32_t pump_sessions;
+    float water_liters;
+} link_zone_reading_t;
+
+typedef struct {
+    uint16_t seq;
+    uint16_t ack_seq;
+    float temperature_c;
+    float ambient_humidity;
+    float tank_level;
+    float light_level;
+    sensor_quality_t temperature_quality;
+    sensor_quality_t humidity_quality;
+    sensor_quality_t tank_quality;
+    sensor_quality_t light_quality;
+    uint8_t zone_count;
+    link_zone_reading_t zones[MAX_ZONE_CHANNELS];
+} link_reading_t;
+
+typedef struct {
+    int32_t zone_id;
+    uint16_t status;                // 200 o 404
+    uint8_t flags;
+    float moisture_threshold;
+    uint32_t watering_duration;
+} link_zone_command_t;
+
+typedef struct {
+    uint16_t seq;
+    uint8_t zone_count;
+    link_zone_command_t zones[MAX_ZONE_CHANNELS];
+} link_commands_t;
+
+// Devuelve 0 si la trama salió (en el ESP32, esp_now_send)
+typedef struct {
+    int (*send)(void *ctx, const uint8_t mac[LINK_MAC_LEN], const uint8_t *data, size_t length);
+    void *ctx;
+} link_radio_t;
+
+extern const uint8_t LINK_BROADCAST_MAC[LINK_MAC_LEN];
+
+// ==================== TRAMAS ====================
+
+// Devuelven el tamaño escrito, o 0 si no entra en capacity
+size_t link_encode_reading(const link_reading_t *reading, uint8_t *out, size_t capacity);
+size_t link_encode_commands(const link_commands_t *commands, uint8_t *out, size_t capacity);
+bool link_decode_reading(const uint8_t *data, size_t length, link_reading_t *reading);
+bool link_decode_commands(const uint8_t *data, size_t length, link_commands_t *commands);
+
+// LINK_FRAME_* o 0 si no es una trama AgroMind válida
+int link_frame_type(const uint8_t *data, size_t length);
+
+// ==================== HOJA ====================
+
+typedef struct {
+    node_state_t *node;
+    link_radio_t radio;
+    uint8_t gateway_mac[LINK_MAC_LEN];
+    bool gateway_known;             // hasta entonces las lecturas van por broadcast
+    bool gateway_pinned;            // gateway_mac fijo (config.h): nunca se cambia
+    TickType_t last_gateway_tick;
+    uint16_t next_seq;
+    uint16_t last_command_seq;
+    bool has_command_seq;
+
+    uint32_t readings_sent;
+    uint32_t commands_applied;
+    uint32_t duplicates;
+    uint32_t rejected_frames;       // COMMANDS de un emisor que no es el gateway
+} link_leaf_t;
+
+void link_leaf_init(link_leaf_t *leaf, node_state_t *node, const link_radio_t *radio);
+// Solo se aceptan comandos de mac y las lecturas van siempre a ella
+void link_leaf_pin_gateway(link_leaf_t *leaf, const uint8_t mac[LINK_MAC_LEN]);
+// Envía las últimas lecturas del nodo (llamar después de muestrear)
+bool link_leaf_send_reading(link_leaf_t *leaf);
+void link_leaf_handle_frame(link_leaf_t *leaf, const uint8_t mac[LINK_MAC_LEN],
+                            const uint8_t *data, size_t length);
+// false = sin noticias del gateway: la hoja corre el modo automático sola
+bool link_leaf_gateway_alive(const link_leaf_t *leaf);
+
+// ==================== GATEWAY ====================
+
+typedef struct {
+    bool in_use;
+    uint8_t mac[LINK_MAC_LEN];
+    link_reading_t reading;
+    TickType_t last_seen_tick;
+    uint16_t next_seq;
+    bool has_pending;               // COMMANDS enviada y sin ack
+    link_commands_t pending;
+} link_peer_t;
+
+typedef struct {
+    link_peer_t peers[LINK_MAX_LEAVES];
+    link_radio_t radio;
+    int upload_cursor;              // reparto cuando no entran todas las zonas
+
+    uint32_t readings_received;
+    uint32_t commands_sent;
+    uint32_t retransmissions;
+    uint32_t rejected_frames;       // inválidas o tabla de hojas llena
+} link_gateway_t;
+
+void link_gateway_init(link_gateway_t *gateway, const link_radio_t *radio);
+void link_gateway_handle_frame(link_gateway_t *gateway, const uint8_t mac[LINK_MAC_LEN],
+                               const uint8_t *data, size_t length);
+// Hojas con lecturas recientes (y zonas vinculadas)
+int link_gateway_active_leaves(link_gateway_t *gateway);
+int link_gateway_zone_count(link_gateway_t *gateway);
+// Agrega al array "zones" del payload las zonas de las hojas recientes, como
+// mucho max_zones (por turnos entre hojas). Devuelve cuántas agregó.
+int link_gateway_add_zones(link_gateway_t *gateway, cJSON *payload, int max_zones);
+// Reparte los resultados por zona de la respuesta a las hojas dueñas
+void link_gateway_route_response(link_gateway_t *gateway, const cJSON *response);
+
+#endif // ESPNOW_LINK_H
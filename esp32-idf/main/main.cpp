@@ -7,15 +7,22 @@
  * - Sensor de Humedad de Suelo -> GPIO34 (ADC1_CH6)
  * - LDR (Sensor de Luz) -> GPIO35 (ADC1_CH7)
  * - Sensor Ultrasónico HC-SR04 -> GPIO18 (TRIG), GPIO19 (ECHO)
- * - Relé (Control de Bomba) -> GPIO5
+ * - Relé (Control de Bomba) -> GPIO25
+ *
+ * Multi-zona: un mismo nodo puede controlar hasta MAX_ZONE_CHANNELS zonas.
+ * Cada canal tiene su propio sensor de suelo y relé (ver ZONE_CHANNEL_MAP
+ * en config.h); el tanque, el DHT11 y el LDR son compartidos.
  */
 
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
@@ -26,18 +33,33 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_random.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_netif.h"
 #include "esp_http_client.h"
 #include "esp_http_server.h"
 #include "esp_crt_bundle.h"
+#include "esp_now.h"
+#include "mdns.h"
 #include "cJSON.h"
 
+#include "sensor_channel.h"
+#include "sensor_filter.h"
+#include "zone_control.h"
+#include "upload_protocol.h"
+#include "ota_update.h"
+#include "espnow_link.h"
+#include "node_storage.h"
+
 // ==================== CONFIGURACIÓN ====================
 // Importar configuración desde config.h (WiFi, calibraciones, etc.)
 #include "config.h"
 
+#include "memory_budget.h"
+#include "boot_profile.h"
+#include "upload_session.h"
+
 static const char *TAG = "AGROMIND";
 
 // ==================== CONFIGURACIÓN WIFI ====================
@@ -46,69 +68,320 @@ static const char *TAG = "AGROMIND";
 // Puerto del servidor local para configuración desde la app
 #define LOCAL_SERVER_PORT 80
 
+// Ajustes del servidor local. CONFIG_LWIP_MAX_SOCKETS (sdkconfig.defaults)
+// debe ser >= LOCAL_SERVER_MAX_SOCKETS + 3 (sockets internos de httpd) + 1
+// (cliente HTTPS de subida).
+#define LOCAL_SERVER_MAX_SOCKETS 10
+#define LOCAL_SERVER_MAX_HANDLERS 16
+#define LOCAL_SERVER_TIMEOUT_S 3            // recv/send por socket
+
+// /info se sirve desde un buffer y solo se regenera si cambió el estado
+// del nodo o pasó el TTL (evita construir JSON en cada polling de la app)
+#define INFO_CACHE_TTL_MS 1000
+#define INFO_CACHE_SIZE (1472 + 416 * MAX_ZONE_CHANNELS)  // incluye "boot" y "upload"
+
+// API local de control (/control): token de la app. Si config.h no define
+// LOCAL_API_TOKEN se genera uno (16 bytes al azar en hex) y queda en NVS.
+#define LOCAL_API_TOKEN_MAX 64
+
+// Lectura cruda máxima del ADC (ADC_BITWIDTH_12): límite de los puntos de /calibrate
+#define ADC_RAW_MAX 4095
+
+// Handlers lentos (escriben NVS) se atienden fuera de la tarea de httpd
+// para que no bloqueen /info de otras instancias de la app. Un solo worker
+// serializa las escrituras a NVS y a la tabla de zonas.
+#define ASYNC_WORKER_COUNT 1
+#define ASYNC_QUEUE_LENGTH 4
+#define ASYNC_WORKER_STACK_SIZE 4096
+
+// Servicio DNS-SD anunciado por mDNS: la app lo encuentra con una sola
+// consulta multicast (_agromind._tcp.local) en lugar de escanear la subred
+#define MDNS_SERVICE_TYPE "_agromind"
+#define MDNS_SERVICE_PROTO "_tcp"
+#define MDNS_INSTANCE_NAME "AgroMind ESP32"
+
+// Rol del nodo: autónomo (sube a la nube), gateway ESP-NOW o hoja
+#ifndef AGROMIND_NODE_ROLE
+#define AGROMIND_NODE_ROLE NODE_ROLE_STANDALONE
+#endif
+
+// Zonas de hojas que el gateway agrega a cada POST (por turnos si hay más)
+#ifndef GATEWAY_UPLOAD_ZONES
+#define GATEWAY_UPLOAD_ZONES 24
+#endif
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+#define UPLOAD_LEAF_ZONES GATEWAY_UPLOAD_ZONES
+#else
+#define UPLOAD_LEAF_ZONES 0
+#endif
+
+#define ESPNOW_QUEUE_LENGTH 8
+#define ESPNOW_TASK_STACK_SIZE 4096
+
+// Tamaño máximo del payload serializado en modo memoria estática (las
+// zonas de hojas llevan también sus sensores compartidos y todas los
+// contadores de riego; las propias, su localConfig pendiente)
+#define UPLOAD_PAYLOAD_SIZE (256 + 320 * MAX_ZONE_CHANNELS + 304 * UPLOAD_LEAF_ZONES)
+
+#define SENSOR_TASK_STACK_SIZE 4096
+#define SENSOR_CYCLE_MS 5000                // entre envíos de sensor_task
+
+// Subida no bloqueante (upload_session.h): sensor_task avanza el POST de a
+// un paso de esp_http_client (modo is_async) que bloquea como mucho
+// UPLOAD_IO_TIMEOUT_MS, con plazo por fase y un presupuesto por subida
+#ifndef UPLOAD_CONNECT_TIMEOUT_MS
+#define UPLOAD_CONNECT_TIMEOUT_MS 6000      // DNS + TCP + TLS
+#endif
+#ifndef UPLOAD_SEND_TIMEOUT_MS
+#define UPLOAD_SEND_TIMEOUT_MS 2000
+#endif
+#ifndef UPLOAD_RECEIVE_TIMEOUT_MS
+#define UPLOAD_RECEIVE_TIMEOUT_MS 6000
+#endif
+#ifndef UPLOAD_BUDGET_MS
+#define UPLOAD_BUDGET_MS 10000
+#endif
+#ifndef UPLOAD_IO_TIMEOUT_MS
+#define UPLOAD_IO_TIMEOUT_MS 250
+#endif
+static_assert(UPLOAD_IO_TIMEOUT_MS < SENSOR_CYCLE_MS, "UPLOAD_IO_TIMEOUT_MS debe ser menor que el ciclo");
+#define UPLOAD_POLL_MS 20                   // entre pasos de una subida en curso
+
+// Control rápido: con una bomba encendida control_task lee suelo y tanque
+// a FAST_CONTROL_HZ (1-4) para apagarla en cuanto se llega al objetivo.
+// Las subidas siguen cada 5 s.
+#ifndef FAST_CONTROL_HZ
+#define FAST_CONTROL_HZ 4
+#endif
+static_assert(FAST_CONTROL_HZ >= 1 && FAST_CONTROL_HZ <= 4, "FAST_CONTROL_HZ debe estar entre 1 y 4");
+#define CONTROL_TASK_STACK_SIZE 3072
+
+// Caudal de las bombas para convertir tiempo de riego en litros
+#ifndef PUMP_FLOW_LPH
+#define PUMP_FLOW_LPH DEFAULT_PUMP_FLOW_LPH
+#endif
+
+// Cada cuántos ciclos de envío se imprime el reporte de heap (60 x 5 s = 5 min)
+#define HEAP_REPORT_INTERVAL_CYCLES 60
+
 // ==================== PINES ====================
-#define RELAY_PIN GPIO_NUM_25
 #define DHT_PIN GPIO_NUM_4
 #define TRIG_PIN GPIO_NUM_18
 #define ECHO_PIN GPIO_NUM_19
-#define SOIL_MOISTURE_ADC_CHANNEL ADC_CHANNEL_6  // GPIO34
 #define LDR_ADC_CHANNEL ADC_CHANNEL_7            // GPIO35
 
+// ==================== CANALES DE ZONA ====================
+// Cada canal = { canal ADC1 del sensor de suelo, GPIO del relé }.
+// Si config.h no define ZONE_CHANNEL_MAP se usa el cableado original
+// de una sola zona: suelo en GPIO34 (ADC1_CH6) y relé en GPIO25.
+#ifndef ZONE_CHANNEL_MAP
+#define ZONE_CHANNEL_MAP { { ADC_CHANNEL_6, GPIO_NUM_25 } }
+#endif
+
+typedef struct {
+    adc_channel_t soil_channel;
+    gpio_num_t relay_pin;
+} zone_channel_pins_t;
+
+static constexpr zone_channel_pins_t ZONE_CHANNEL_PINS[] = ZONE_CHANNEL_MAP;
+#define ZONE_CHANNEL_COUNT ((int)(sizeof(ZONE_CHANNEL_PINS) / sizeof(ZONE_CHANNEL_PINS[0])))
+static_assert(sizeof(ZONE_CHANNEL_PINS) / sizeof(ZONE_CHANNEL_PINS[0]) <= MAX_ZONE_CHANNELS,
+              "ZONE_CHANNEL_MAP admite como máximo MAX_ZONE_CHANNELS canales");
+
 #define DHT_LEVEL_TIMEOUT_US 2000
 
+// ==================== CALIBRACIÓN DE SENSORES ====================
+// Las constantes de config.h se convierten en compilación a coeficientes
+// Q16.16 (ver sensor_channel.h). POST /calibrate o una entrada "cal_<canal>"
+// en NVS reemplazan la calibración de un canal en tiempo de ejecución.
+
+static constexpr linear_curve_t SOIL_MOISTURE_CURVE =
+    linear_curve_t::from_points(SOIL_MOISTURE_DRY_ADC, 0.0f, SOIL_MOISTURE_WET_ADC, 100.0f);
+static constexpr linear_curve_t LIGHT_LEVEL_CURVE =
+    linear_curve_t::from_points(LDR_DARK_ADC, 0.0f, LDR_BRIGHT_ADC, 100.0f);
+
+// Canales ADC: uno de suelo por zona (índice = canal de zona) y luego el LDR
+enum {
+    ADC_SENSOR_LIGHT = ZONE_CHANNEL_COUNT,
+    ADC_SENSOR_COUNT
+};
+
+static constexpr const char *SOIL_SENSOR_NAMES[MAX_ZONE_CHANNELS] = {
+    "soil0", "soil1", "soil2", "soil3", "soil4", "soil5", "soil6", "soil7"
+};
+
+static constexpr sensor_bank_t<linear_curve_t, ADC_SENSOR_COUNT> build_adc_sensor_bank(void) {
+    sensor_bank_t<linear_curve_t, ADC_SENSOR_COUNT> bank{};
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        bank.channel[ch] = make_sensor_channel(SOIL_SENSOR_NAMES[ch], ZONE_CHANNEL_PINS[ch].soil_channel,
+                                               SOIL_MOISTURE_CURVE, 0.0f, 100.0f);
+    }
+    bank.channel[ADC_SENSOR_LIGHT] = make_sensor_channel("light", LDR_ADC_CHANNEL,
+                                                         LIGHT_LEVEL_CURVE, 0.0f, 100.0f);
+    return bank;
+}
+
+static constexpr sensor_bank_t<linear_curve_t, ADC_SENSOR_COUNT> ADC_SENSOR_FACTORY = build_adc_sensor_bank();
+
+// Tanque: la curva convierte el tiempo de eco (µs) en % de llenado.
+// config.h puede definir TANK_LEVEL_CURVE como pares { distancia_cm, % }
+// con distancia ascendente para tanques de sección no uniforme; por
+// defecto es la recta de un tanque cilíndrico.
+#define ECHO_US_PER_CM (2.0f / 0.0343f)  // ida y vuelta a la velocidad del sonido
+
+#ifndef TANK_LEVEL_CURVE
+#define TANK_LEVEL_CURVE { \
+    { 0.0f, SENSOR_TO_BOTTOM_DISTANCE_CM / TANK_HEIGHT_CM * 100.0f }, \
+    { SENSOR_TO_BOTTOM_DISTANCE_CM, 0.0f }, \
+}
+#endif
+
+static constexpr float TANK_LEVEL_POINTS_CM[][2] = TANK_LEVEL_CURVE;
+#define TANK_CURVE_POINTS (sizeof(TANK_LEVEL_POINTS_CM) / sizeof(TANK_LEVEL_POINTS_CM[0]))
+typedef table_curve_t<TANK_CURVE_POINTS> tank_curve_t;
+
+static constexpr tank_curve_t build_tank_curve(void) {
+    float points_us[TANK_CURVE_POINTS][2] = {};
+    for (size_t i = 0; i < TANK_CURVE_POINTS; ++i) {
+        points_us[i][0] = TANK_LEVEL_POINTS_CM[i][0] * ECHO_US_PER_CM;
+        points_us[i][1] = TANK_LEVEL_POINTS_CM[i][1];
+    }
+    return make_table_curve(points_us);
+}
+
+static constexpr sensor_channel_t<tank_curve_t> TANK_SENSOR_FACTORY =
+    make_sensor_channel("tank", ECHO_PIN, build_tank_curve(), 0.0f, 100.0f);
+
+// ==================== FILTRADO DE SENSORES ====================
+// Cada canal pasa por Hampel + límite de cambio + EWMA (sensor_filter.h).
+// config.h puede redefinir cualquiera con la misma tupla:
+// (ventana, k, desvío mínimo, alpha EWMA, cambio máx. por muestra, fallos tolerados)
+#ifndef SOIL_FILTER
+#define SOIL_FILTER (5, 3.0f, 1.0f, 0.5f, 15.0f, 3)
+#endif
+#ifndef LIGHT_FILTER
+#define LIGHT_FILTER (3, 3.0f, 2.0f, 0.6f, 0.0f, 3)      // la luz cambia de golpe: sin límite
+#endif
+#ifndef TANK_FILTER
+#define TANK_FILTER (5, 3.0f, 1.0f, 0.4f, 10.0f, 3)      // ecos espurios del ultrasonido
+#endif
+#ifndef TEMPERATURE_FILTER
+#define TEMPERATURE_FILTER (5, 3.0f, 0.5f, 0.5f, 3.0f, 6)
+#endif
+#ifndef HUMIDITY_FILTER
+#define HUMIDITY_FILTER (5, 3.0f, 2.0f, 0.5f, 10.0f, 6)
+#endif
+
+static constexpr sensor_filter_config_t SOIL_FILTER_CONFIG = make_sensor_filter_config SOIL_FILTER;
+static constexpr sensor_filter_config_t LIGHT_FILTER_CONFIG = make_sensor_filter_config LIGHT_FILTER;
+static constexpr sensor_filter_config_t TANK_FILTER_CONFIG = make_sensor_filter_config TANK_FILTER;
+static constexpr sensor_filter_config_t TEMPERATURE_FILTER_CONFIG = make_sensor_filter_config TEMPERATURE_FILTER;
+static constexpr sensor_filter_config_t HUMIDITY_FILTER_CONFIG = make_sensor_filter_config HUMIDITY_FILTER;
+
 // Nota: Las siguientes constantes ahora vienen de config.h:
 // - WIFI_SSID, WIFI_PASS
 // - SERVER_URL
 // - TANK_HEIGHT_CM, SENSOR_TO_BOTTOM_DISTANCE_CM
 // - SOIL_MOISTURE_DRY_ADC, SOIL_MOISTURE_WET_ADC
 // - LDR_DARK_ADC, LDR_BRIGHT_ADC
+// - ZONE_CHANNEL_MAP, TANK_LEVEL_CURVE (opcionales)
 
 // ==================== NVS KEYS ====================
-#define NVS_NAMESPACE "agromind"
-#define NVS_KEY_ZONE_ID "zone_id"
+// NVS_NAMESPACE y las claves de lo acumulado por canal (modelo del suelo,
+// contadores de riego) están en node_storage.h
+#define NVS_KEY_ZONE_ID "zone_id"          // canal 0 (compatible con firmware de una zona)
+#define NVS_KEY_ZONE_ID_FMT "zone_id_%d"    // canales 1..N
+#define NVS_KEY_CALIBRATION_FMT "cal_%s"    // blob con la curva de un canal de sensor
 #define NVS_KEY_WIFI_SSID "wifi_ssid"
 #define NVS_KEY_WIFI_PASS "wifi_pass"
+#define NVS_KEY_API_TOKEN "api_token"
 
 // ==================== VARIABLES GLOBALES ====================
 static adc_oneshot_unit_handle_t adc1_handle;
 static adc_cali_handle_t adc1_cali_handle = NULL;
 static bool wifi_connected = false;
-static bool pump_state = false;
 static int retry_num = 0;
-static float last_temperature_c = 0.0f;
-static float last_ambient_humidity = 0.0f;
-static bool auto_mode_enabled = false;
-static float configured_moisture_threshold = 30.0f;
-static uint32_t configured_watering_duration = 10;
-static bool auto_watering_active = false;
-static TickType_t auto_watering_deadline = 0;
-static float last_soil_moisture = 0.0f;
-static float last_tank_level = 0.0f;
-
-// Configuración guardada en NVS
-static int32_t current_zone_id = 0;  // 0 = no configurado
+
+// Calibración activa de cada canal (fábrica + overrides de NVS)
+static sensor_bank_t<linear_curve_t, ADC_SENSOR_COUNT> adc_sensors = ADC_SENSOR_FACTORY;
+static sensor_channel_t<tank_curve_t> tank_sensor = TANK_SENSOR_FACTORY;
+
+// Filtros por canal (mismo índice que adc_sensors). Solo los toca la tarea
+// de sensores; /calibrate pide el reinicio de un canal con el flag.
+static sensor_filter_t adc_filters[ADC_SENSOR_COUNT];
+static volatile bool adc_filter_reset[ADC_SENSOR_COUNT];
+static sensor_filter_t tank_filter;
+static sensor_filter_t temperature_filter;
+static sensor_filter_t humidity_filter;
+
+// Zonas, sensores compartidos y versión del estado (ver zone_control.h)
+static node_state_t node;
+
+// Protege node (zonas, bombas, sensores compartidos), las calibraciones y
+// los filtros entre sensor_task, control_task, httpd, los workers async y
+// espnow_task. Las medidas de hardware se toman antes, sin él. Es recursivo porque los hooks de zone_control
+// (zone_released_hook, relay_hook) corren con el lock tomado y vuelven a
+// tomarlo. Con link_mutex el orden es siempre link_mutex -> node_mutex.
+// fast_sampling calla el log por muestra.
+static SemaphoreHandle_t node_mutex = NULL;
+static TaskHandle_t control_task_handle = NULL;
+static bool fast_sampling = false;
+
+// Una lectura más nueva que un ciclo se reutiliza en vez de repetirla: la
+// del arranque, tomada mientras WiFi se asocia, sale en la primera subida.
+// GOT_IP despierta a sensor_task para no esperar al resto del ciclo.
+static TaskHandle_t sensor_task_handle = NULL;
+static int64_t last_sample_us = 0;
+
+// Subida en curso (ver upload_session.h). Solo la escribe sensor_task, con
+// node_mutex tomado: /info copia las estadísticas (int64, se cortarían a
+// medias) bajo el mismo lock. upload_payload es el texto al que apunta el post
+// field del cliente hasta que la subida termina.
+static upload_session_t upload;
+static esp_http_client_handle_t upload_client = NULL;
+static char *upload_payload = NULL;
+static heap_probe_t upload_heap_probe;
+
+// Enlace ESP-NOW (ver espnow_link.h). link_mutex protege la tabla de hojas
+// del gateway / el estado de la hoja frente a espnow_task.
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+static link_gateway_t gateway;
+#elif AGROMIND_NODE_ROLE == NODE_ROLE_LEAF
+static link_leaf_t leaf;
+#endif
+#if AGROMIND_NODE_ROLE != NODE_ROLE_STANDALONE
+static SemaphoreHandle_t link_mutex = NULL;
+static QueueHandle_t espnow_queue = NULL;
+#endif
 
 // Servidor HTTP local para configuración desde la app
 static httpd_handle_t local_server = NULL;
+static char local_api_token[LOCAL_API_TOKEN_MAX + 1];
+static bool mdns_started = false;
 
-static const float MOISTURE_HYSTERESIS = 5.0f;
-static const float MIN_TANK_PERCENTAGE = 5.0f;
+typedef struct {
+    char body[INFO_CACHE_SIZE];
+    size_t length;
+    uint32_t state_version;
+    int64_t built_at_us;
+} info_cache_t;
 
+static info_cache_t info_cache = {};
 
-// ==================== UTILIDADES ====================
+// Petición diferida a un worker (httpd_req_async_handler_begin)
+typedef struct {
+    httpd_req_t *req;
+    esp_err_t (*handler)(httpd_req_t *req);
+} async_request_t;
 
-static float map_value(float x, float in_min, float in_max, float out_min, float out_max) {
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-}
+static QueueHandle_t async_request_queue = NULL;
 
-static float constrain_value(float x, float min_val, float max_val) {
-    if (x < min_val) {
-        return min_val;
-    }
-    if (x > max_val) {
-        return max_val;
-    }
-    return x;
+
+// ==================== UTILIDADES ====================
+
+// Cualquier cambio del estado visible en /info invalida la caché
+static void invalidate_info_cache(void) {
+    node_state_touch(&node);
 }
 
 static bool wait_for_level(gpio_num_t pin, int level, uint32_t timeout_us) {
@@ -189,255 +462,236 @@ static bool read_dht11(float *temperature, float *humidity) {
     return true;
 }
 
-static void refresh_dht_measurement(void) {
-    float temperature = 0.0f;
-    float humidity = 0.0f;
-    bool success = false;
-
-    for (int attempt = 0; attempt < 3 && !success; ++attempt) {
-        if (read_dht11(&temperature, &humidity)) {
-            success = true;
+// Las lecturas de hardware van en dos pasos: la medida cruda (DHT11 con
+// reintentos, eco del ultrasonido, ADC) sin lock, y la conversión y los
+// filtros con node_lock(). Así control_task, /control e /info no esperan
+// los hasta ~400 ms de un DHT11 que no responde.
+struct dht_sample_t {
+    bool ok;
+    float temperature;
+    float humidity;
+};
+
+struct echo_sample_t {
+    int64_t duration_us;
+    const char *timeout;     // NULL si hubo eco; si no, en qué fase expiró
+};
+
+struct adc_sample_t {
+    esp_err_t err;
+    int raw;
+    int voltage_mv;
+};
+
+static dht_sample_t measure_dht(void) {
+    dht_sample_t sample = {};
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        if (read_dht11(&sample.temperature, &sample.humidity)) {
+            sample.ok = true;
             break;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
     }
+    return sample;
+}
 
-    if (success) {
-        last_temperature_c = temperature;
-        last_ambient_humidity = humidity;
+static void apply_dht_measurement(const dht_sample_t *sample) {
+    if (sample->ok) {
+        node.temperature_quality = temperature_filter.update(sample->temperature);
+        node.humidity_quality = humidity_filter.update(sample->humidity);
     } else {
-        ESP_LOGW(TAG, "DHT11 sin lectura válida tras reintentos, usando último valor");
+        node.temperature_quality = temperature_filter.miss();
+        node.humidity_quality = humidity_filter.miss();
+        ESP_LOGW(TAG, "DHT11 sin lectura válida tras reintentos (%s)",
+                 sensor_quality_name(node.temperature_quality));
     }
+    node.temperature_c = temperature_filter.value();
+    node.ambient_humidity = humidity_filter.value();
 }
 
 // ==================== FUNCIONES DE SENSORES ====================
 
-static float read_soil_moisture(void) {
-    int adc_raw = 0;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, SOIL_MOISTURE_ADC_CHANNEL, &adc_raw));
-
-    int voltage_mv = 0;
-    if (adc1_cali_handle != NULL) {
-        adc_cali_raw_to_voltage(adc1_cali_handle, adc_raw, &voltage_mv);
+static adc_sample_t measure_adc(int index) {
+    adc_sample_t sample = {};
+    sample.err = adc_oneshot_read(adc1_handle, (adc_channel_t)adc_sensors.channel[index].source, &sample.raw);
+    if (sample.err == ESP_OK && adc1_cali_handle != NULL) {
+        adc_cali_raw_to_voltage(adc1_cali_handle, sample.raw, &sample.voltage_mv);
     }
-
-    float percentage = map_value((float)adc_raw,
-                                 SOIL_MOISTURE_WET_ADC,
-                                 SOIL_MOISTURE_DRY_ADC,
-                                 100.0f,
-                                 0.0f);
-    percentage = constrain_value(percentage, 0.0f, 100.0f);
-
-    ESP_LOGI(TAG, "Humedad Suelo - Raw: %d | Voltaje: %d mV | %.1f%%",
-             adc_raw, voltage_mv, percentage);
-
-    return percentage;
+    return sample;
 }
 
-static float read_light_level(void) {
-    int adc_raw = 0;
-    ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, LDR_ADC_CHANNEL, &adc_raw));
+// Canal ADC con su calibración activa, ya filtrado. Con node_lock() tomado
+static float apply_adc_sample(int index, const adc_sample_t *sample, sensor_quality_t *quality) {
+    const sensor_channel_t<linear_curve_t> *sensor = &adc_sensors.channel[index];
+    sensor_filter_t *filter = &adc_filters[index];
+    if (adc_filter_reset[index]) {
+        filter->init(filter->config);   // calibración nueva: la historia ya no compara
+        adc_filter_reset[index] = false;
+    }
 
-    int voltage_mv = 0;
-    if (adc1_cali_handle != NULL) {
-        adc_cali_raw_to_voltage(adc1_cali_handle, adc_raw, &voltage_mv);
+    if (sample->err != ESP_OK) {
+        *quality = filter->miss();
+        ESP_LOGW(TAG, "Sensor %s - error ADC: %s (%s)", sensor->name, esp_err_to_name(sample->err),
+                 sensor_quality_name(*quality));
+        return filter->value();
     }
 
-    // Mapeo usando valores calibrados para respuesta más gradual
-    // LDR_DARK_ADC (oscuro) -> 0%
-    // LDR_BRIGHT_ADC (brillante) -> 100%
-    float percentage = map_value((float)adc_raw, LDR_DARK_ADC, LDR_BRIGHT_ADC, 0.0f, 100.0f);
-    percentage = constrain_value(percentage, 0.0f, 100.0f);
+    int32_t value_q16 = sensor->convert_q16(sample->raw);
+    *quality = filter->update_q16(value_q16);
+    if (fast_sampling) {
+        return filter->value();
+    }
 
-    ESP_LOGI(TAG, "🔆 LDR - Raw: %d | Voltaje: %d mV | %.1f%%",
-             adc_raw, voltage_mv, percentage);
+    ESP_LOGI(TAG, "Sensor %s - Raw: %d | Voltaje: %d mV | %.1f%% -> %.1f%% (%s)",
+             sensor->name, sample->raw, sample->voltage_mv, sensor_from_q16(value_q16), filter->value(),
+             sensor_quality_name(*quality));
 
-    return percentage;
+    return filter->value();
 }
 
-static float read_water_level(void) {
+// sensor_task y control_task disparan el mismo HC-SR04: un pulso a la vez
+static SemaphoreHandle_t echo_mutex = NULL;
+
+static echo_sample_t measure_echo(void) {
+    echo_sample_t sample = {};
+    const int64_t timeout_us = 30000;
+    xSemaphoreTake(echo_mutex, portMAX_DELAY);
     gpio_set_level(TRIG_PIN, 0);
     ets_delay_us(2);
     gpio_set_level(TRIG_PIN, 1);
     ets_delay_us(10);
     gpio_set_level(TRIG_PIN, 0);
 
-    const int64_t timeout_us = 30000;
     int64_t start_wait = esp_timer_get_time();
-    while (gpio_get_level(ECHO_PIN) == 0) {
+    while (sample.timeout == NULL && gpio_get_level(ECHO_PIN) == 0) {
         if (esp_timer_get_time() - start_wait > timeout_us) {
-            ESP_LOGW(TAG, "Timeout esperando echo HIGH");
-            return 0.0f;
+            sample.timeout = "esperando echo HIGH";
         }
     }
 
     int64_t start_time = esp_timer_get_time();
-    while (gpio_get_level(ECHO_PIN) == 1) {
+    while (sample.timeout == NULL && gpio_get_level(ECHO_PIN) == 1) {
         if (esp_timer_get_time() - start_time > timeout_us) {
-            ESP_LOGW(TAG, "Timeout midiendo eco");
-            break;
+            // Sin eco de vuelta: fuera de rango, no un tanque vacío
+            sample.timeout = "midiendo eco";
         }
     }
+    sample.duration_us = esp_timer_get_time() - start_time;
+    xSemaphoreGive(echo_mutex);
+    return sample;
+}
+
+// Un timeout no es "tanque vacío": se reporta como lectura fallida
+static float apply_water_level(const echo_sample_t *sample, sensor_quality_t *quality) {
+    if (sample->timeout != NULL) {
+        *quality = tank_filter.miss();
+        ESP_LOGW(TAG, "Timeout %s (%s)", sample->timeout, sensor_quality_name(*quality));
+        return tank_filter.value();
+    }
 
-    int64_t duration = esp_timer_get_time() - start_time;
-    float distance_cm = (duration * 0.0343f) / 2.0f;  // velocidad sonido
-    distance_cm = constrain_value(distance_cm, 0.0f, SENSOR_TO_BOTTOM_DISTANCE_CM);
-    float water_height = SENSOR_TO_BOTTOM_DISTANCE_CM - distance_cm;
-    float percentage = (water_height / TANK_HEIGHT_CM) * 100.0f;
-    percentage = constrain_value(percentage, 0.0f, 100.0f);
+    int32_t value_q16 = tank_sensor.convert_q16((int32_t)sample->duration_us);
+    *quality = tank_filter.update_q16(value_q16);
+    if (fast_sampling) {
+        return tank_filter.value();
+    }
 
-    ESP_LOGI(TAG, "Nivel Agua - Distancia: %.1f cm | Altura: %.1f cm | %.1f%%",
-             distance_cm, water_height, percentage);
+    ESP_LOGI(TAG, "Nivel Agua - Eco: %lld us | Distancia: %.1f cm | %.1f%% -> %.1f%% (%s)",
+             sample->duration_us, sample->duration_us * (1.0f / ECHO_US_PER_CM), sensor_from_q16(value_q16),
+             tank_filter.value(), sensor_quality_name(*quality));
 
-    return percentage;
+    return tank_filter.value();
+}
+
+static void init_sensor_filters(void) {
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        adc_filters[ch].init(SOIL_FILTER_CONFIG);
+    }
+    adc_filters[ADC_SENSOR_LIGHT].init(LIGHT_FILTER_CONFIG);
+    tank_filter.init(TANK_FILTER_CONFIG);
+    temperature_filter.init(TEMPERATURE_FILTER_CONFIG);
+    humidity_filter.init(HUMIDITY_FILTER_CONFIG);
+    // Sin primera lectura todo es INVALID: el modo automático espera
+    node.temperature_quality = SENSOR_QUALITY_INVALID;
+    node.humidity_quality = SENSOR_QUALITY_INVALID;
+    node.tank_quality = SENSOR_QUALITY_INVALID;
+    node.light_quality = SENSOR_QUALITY_INVALID;
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        node.zones[ch].soil_quality = SENSOR_QUALITY_INVALID;
+    }
 }
 
 // ==================== CONTROL DE BOMBA ====================
 // NOTA: Muchos módulos de relé son "active-low" (se activan con 0)
 // Si tu relé se enciende cuando debería estar apagado, cambia la lógica aquí
 
-static void set_pump_state(bool state) {
-    pump_state = state;
+static void relay_hook(void *ctx, int channel, bool state) {
+    (void)ctx;
+    gpio_num_t relay_pin = ZONE_CHANNEL_PINS[channel].relay_pin;
     // Relé active-low: 0 = encendido, 1 = apagado
     int gpio_level = state ? 0 : 1;
-    gpio_set_level(RELAY_PIN, gpio_level);
-    ESP_LOGI(TAG, "🔧 BOMBA %s -> GPIO%d = %d", 
+    gpio_set_level(relay_pin, gpio_level);
+    ESP_LOGI(TAG, "🔧 BOMBA [canal %d] %s -> GPIO%d = %d",
+             channel,
              state ? "ENCENDIDA" : "APAGADA", 
-             RELAY_PIN, 
+             relay_pin, 
              gpio_level);
-}
-
-static void update_configuration_from_commands(cJSON *commands) {
-    if (commands == NULL) {
-        return;
-    }
-
-    bool previous_auto_mode = auto_mode_enabled;
-    bool config_changed = false;
-
-    cJSON *auto_mode_item = cJSON_GetObjectItem(commands, "autoMode");
-    if (auto_mode_item && cJSON_IsBool(auto_mode_item)) {
-        bool new_auto_mode = cJSON_IsTrue(auto_mode_item);
-        if (new_auto_mode != auto_mode_enabled) {
-            auto_mode_enabled = new_auto_mode;
-            config_changed = true;
-        }
-    }
-
-    if (previous_auto_mode && !auto_mode_enabled && auto_watering_active) {
-        auto_watering_active = false;
-        if (pump_state) {
-            set_pump_state(false);
-            ESP_LOGI(TAG, "Modo auto desactivado, bomba apagada");
-        }
-    }
-
-    cJSON *threshold_item = cJSON_GetObjectItem(commands, "moistureThreshold");
-    if (threshold_item && cJSON_IsNumber(threshold_item)) {
-        float new_threshold = (float)cJSON_GetNumberValue(threshold_item);
-        if (new_threshold > 0.0f && new_threshold != configured_moisture_threshold) {
-            configured_moisture_threshold = new_threshold;
-            config_changed = true;
-        }
-    }
-
-    cJSON *duration_item = cJSON_GetObjectItem(commands, "wateringDuration");
-    if (duration_item && cJSON_IsNumber(duration_item)) {
-        double raw_duration = cJSON_GetNumberValue(duration_item);
-        uint32_t new_duration = raw_duration < 1.0 ? 1U : (uint32_t)raw_duration;
-        if (new_duration != configured_watering_duration) {
-            configured_watering_duration = new_duration;
-            config_changed = true;
-        }
-    }
-
-    if (config_changed) {
-        ESP_LOGI(TAG, "Config zona -> auto:%s umbral:%.1f%% dur:%us",
-                 auto_mode_enabled ? "ON" : "OFF",
-                 configured_moisture_threshold,
-                 configured_watering_duration);
+    // Bomba encendida: control_task pasa a muestreo rápido
+    if (state && control_task_handle != NULL) {
+        xTaskNotifyGive(control_task_handle);
     }
 }
 
-static void apply_auto_mode_logic(void) {
-    // Si el modo automático está desactivado, asegurarse de que la bomba esté apagada
-    // (a menos que haya un comando manual activo)
-    if (!auto_mode_enabled) {
-        if (auto_watering_active) {
-            auto_watering_active = false;
-            if (pump_state) {
-                set_pump_state(false);
-                ESP_LOGI(TAG, "Modo auto desactivado - bomba apagada");
-            }
-        }
-        return;
-    }
-
-    ESP_LOGI(TAG, "🌱 Auto-mode check: moisture=%.1f%% threshold=%.1f%% tank=%.1f%% pump=%s",
-             last_soil_moisture, configured_moisture_threshold, last_tank_level,
-             pump_state ? "ON" : "OFF");
-
-    if (last_tank_level <= 0.0f && last_soil_moisture <= 0.0f) {
-        ESP_LOGW(TAG, "⚠️ Sin lecturas de sensores todavía");
-        return;  // aún no hay lecturas recientes
-    }
+static void node_lock(void) {
+    xSemaphoreTakeRecursive(node_mutex, portMAX_DELAY);
+}
 
-    // Si el tanque está muy bajo, apagar la bomba
-    if (last_tank_level <= MIN_TANK_PERCENTAGE) {
-        if (pump_state) {
-            set_pump_state(false);
-        }
-        if (auto_watering_active) {
-            auto_watering_active = false;
-            ESP_LOGW(TAG, "Auto-riego cancelado: tanque en %.1f%%", last_tank_level);
-        }
-        return;
-    }
+static void node_unlock(void) {
+    xSemaphoreGiveRecursive(node_mutex);
+}
 
-    TickType_t now = xTaskGetTickCount();
+static void set_pump_state(int channel, bool state) {
+    zone_set_pump_state(&node, channel, state);
+}
 
-    // Si hay auto-riego activo, verificar si debe terminar
-    if (auto_watering_active) {
-        bool recovered = last_soil_moisture >= (configured_moisture_threshold + MOISTURE_HYSTERESIS);
-        bool expired = now >= auto_watering_deadline;
+static void clear_zone_id_from_nvs(int channel);
+static void update_mdns_txt(void);
 
-        if (recovered || expired) {
-            auto_watering_active = false;
-            set_pump_state(false);
-            ESP_LOGI(TAG, "Auto-riego completado (%s)",
-                     recovered ? "umbral alcanzado" : "tiempo agotado");
-        }
-        return;
-    }
+// La zona ya no existe en el servidor: el canal queda libre en NVS y en mDNS
+static void zone_released_hook(void *ctx, int channel) {
+    (void)ctx;
+    clear_zone_id_from_nvs(channel);
+    update_mdns_txt();
+}
 
-    // Si la bomba está encendida pero NO hay auto-riego activo,
-    // es un estado manual - no interferir
-    if (pump_state) {
-        ESP_LOGI(TAG, "Bomba ya encendida (modo manual), no interferir");
-        return;
-    }
+static void soil_model_hook(void *ctx, int channel) {
+    (void)ctx;
+    node_storage_save_soil_model(&node, channel);
+}
 
-    // Verificar si debe iniciar auto-riego (humedad bajo el umbral)
-    if (last_soil_moisture > 0.0f && last_soil_moisture < configured_moisture_threshold) {
-        auto_watering_active = true;
-        uint32_t duration_ms = configured_watering_duration * 1000U;
-        auto_watering_deadline = now + pdMS_TO_TICKS(duration_ms);
-        set_pump_state(true);
-        ESP_LOGI(TAG, "🚿 AUTO-RIEGO INICIADO: humedad %.1f%% < umbral %.1f%%",
-                 last_soil_moisture, configured_moisture_threshold);
-    } else {
-        ESP_LOGI(TAG, "✓ Humedad OK (%.1f%% >= %.1f%%), no regar",
-                 last_soil_moisture, configured_moisture_threshold);
-    }
+static void rule_hook(void *ctx, int channel) {
+    (void)ctx;
+    node_storage_save_rule(&node, channel);
 }
 
 // ==================== COMUNICACIÓN API ====================
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
-    static char response_buffer[512];
-    static int response_len = 0;
+// Una respuesta multiplexada trae un bloque de comandos por zona
+static char response_buffer[UPLOAD_RESPONSE_SIZE(ZONE_CHANNEL_COUNT + UPLOAD_LEAF_ZONES)];
+static int response_len = 0;
 
+static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     switch (evt->event_id) {
+        // En modo is_async los eventos llegan dentro de upload_poll()
+        case HTTP_EVENT_ON_CONNECTED:
+            node_lock();
+            upload_session_advance(&upload, UPLOAD_PHASE_SEND, esp_timer_get_time());
+            node_unlock();
+            break;
+        case HTTP_EVENT_HEADERS_SENT:
+            node_lock();
+            upload_session_advance(&upload, UPLOAD_PHASE_RECEIVE, esp_timer_get_time());
+            node_unlock();
+            break;
         case HTTP_EVENT_ON_DATA:
             // Procesar datos tanto para respuestas normales como chunked
             if ((response_len + evt->data_len) < (int)sizeof(response_buffer)) {
@@ -451,68 +705,20 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
         case HTTP_EVENT_ON_FINISH:
             if (response_len > 0) {
                 ESP_LOGI(TAG, "Respuesta: %s", response_buffer);
-                cJSON *root = cJSON_Parse(response_buffer);
-                if (root != NULL) {
-
-                    cJSON *commands = cJSON_GetObjectItem(root, "commands");
-                    if (commands && cJSON_IsObject(commands)) {
-                        // Primero actualizar configuración
-                        update_configuration_from_commands(commands);
-                        
-                        // Verificar si el tanque está bloqueado
-                        cJSON *tank_locked = cJSON_GetObjectItem(commands, "tankLocked");
-                        bool is_tank_locked = tank_locked && cJSON_IsTrue(tank_locked);
-                        
-                        ESP_LOGI(TAG, "📥 Comandos recibidos - tankLocked:%s", is_tank_locked ? "true" : "false");
-                        
-                        if (is_tank_locked) {
-                            // Tanque bloqueado - apagar bomba si está encendida
-                            if (pump_state) {
-                                set_pump_state(false);
-                                auto_watering_active = false;
-                                ESP_LOGW(TAG, "Tanque bloqueado por servidor, bomba apagada");
-                            }
-                        } else {
-                            // Solo procesar comando de bomba si viene explícito (comando manual)
-                            cJSON *pump_state_obj = cJSON_GetObjectItem(commands, "pumpState");
-                            
-                            if (pump_state_obj == NULL) {
-                                ESP_LOGI(TAG, "📥 pumpState: NULL (auto-mode decide)");
-                            } else if (cJSON_IsNull(pump_state_obj)) {
-                                ESP_LOGI(TAG, "📥 pumpState: null (auto-mode decide)");
-                            } else if (cJSON_IsBool(pump_state_obj)) {
-                                bool requested_state = cJSON_IsTrue(pump_state_obj);
-                                ESP_LOGI(TAG, "📥 pumpState: %s (comando manual)", requested_state ? "true" : "false");
-                                if (requested_state != pump_state) {
-                                    set_pump_state(requested_state);
-                                    // Si es comando manual, cancelar auto-watering
-                                    auto_watering_active = false;
-                                    ESP_LOGI(TAG, "✅ Comando manual ejecutado: bomba %s", requested_state ? "ON" : "OFF");
-                                } else {
-                                    ESP_LOGI(TAG, "ℹ️ Bomba ya está %s, no cambiar", pump_state ? "ON" : "OFF");
-                                }
-                            } else {
-                                ESP_LOGW(TAG, "📥 pumpState: tipo desconocido");
-                            }
-                        }
-                    }
-
-                    // Fallback para compatibilidad con respuestas antiguas
-                    if (!cJSON_HasObjectItem(root, "commands")) {
-                        cJSON *pump_cmd = cJSON_GetObjectItem(root, "pumpCommand");
-                        if (pump_cmd && cJSON_IsBool(pump_cmd)) {
-                            bool requested_state = cJSON_IsTrue(pump_cmd);
-                            if (requested_state != pump_state) {
-                                set_pump_state(requested_state);
-                                auto_watering_active = false;
-                            }
-                        }
-                    }
-
-                    // Aplicar lógica de auto-mode DESPUÉS de procesar comandos
-                    apply_auto_mode_logic();
-
-                    cJSON_Delete(root);
+                cJSON *response = cJSON_ParseWithLength(response_buffer, (size_t)response_len);
+                if (response != NULL) {
+                    node_lock();
+                    upload_apply_response(&node, response);
+                    node_unlock();
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+                    // Los commands de las zonas de hojas bajan por ESP-NOW
+                    xSemaphoreTake(link_mutex, portMAX_DELAY);
+                    link_gateway_route_response(&gateway, response);
+                    xSemaphoreGive(link_mutex);
+#endif
+                    cJSON_Delete(response);
+                } else {
+                    ESP_LOGW(TAG, "Respuesta no es JSON válido");
                 }
                 response_len = 0;
             }
@@ -524,99 +730,294 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-static void send_sensor_data(void) {
-    if (!wifi_connected) {
-        ESP_LOGW(TAG, "WiFi no conectado");
-        return;
+static esp_http_client_handle_t create_upload_client(void) {
+    esp_http_client_config_t config = {};
+    config.url = SERVER_URL;
+    config.event_handler = http_event_handler;
+    config.method = HTTP_METHOD_POST;
+    config.transport_type = HTTP_TRANSPORT_OVER_SSL;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+    // perform() devuelve ESP_ERR_HTTP_EAGAIN en vez de esperar a la red;
+    // timeout_ms acota cada espera de socket dentro de un paso
+    config.is_async = true;
+    config.timeout_ms = UPLOAD_IO_TIMEOUT_MS;
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    return client;
+}
+
+static void sample_sensors(void) {
+    // Sensores compartidos: se leen una sola vez por ciclo para todas las
+    // zonas, sin lock; el ADC de un canal sin zona cuesta microsegundos
+    dht_sample_t dht = measure_dht();
+    echo_sample_t echo = measure_echo();
+    adc_sample_t light = measure_adc(ADC_SENSOR_LIGHT);
+    adc_sample_t soil[ZONE_CHANNEL_COUNT];
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        soil[ch] = measure_adc(ch);
     }
-    
-    if (current_zone_id <= 0) {
-        // Sin zona, el servidor local ya está corriendo esperando configuración
-        return;
+
+    node_lock();
+    apply_dht_measurement(&dht);
+    node.tank_level = apply_water_level(&echo, &node.tank_quality);
+    // LDR_DARK_ADC (oscuro) -> 0%, LDR_BRIGHT_ADC (brillante) -> 100%
+    node.light_level = apply_adc_sample(ADC_SENSOR_LIGHT, &light, &node.light_quality);
+
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        if (node.zones[ch].zone_id > 0) {
+            sensor_quality_t quality = SENSOR_QUALITY_INVALID;
+            float moisture = apply_adc_sample(ch, &soil[ch], &quality);
+            zone_observe_moisture(&node, ch, moisture, quality);
+        }
     }
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "zoneId", current_zone_id);
+    zone_apply_auto_mode_all(&node);
+    last_sample_us = esp_timer_get_time();
+    node_unlock();
+    invalidate_info_cache();
+}
 
-    refresh_dht_measurement();
-    float temperature_c = last_temperature_c;
-    float ambient_humidity = last_ambient_humidity;
-    float soil_moisture = read_soil_moisture();
-    float water_level = read_water_level();
-    float light_level = read_light_level();
+static bool sample_is_fresh(void) {
+    return last_sample_us != 0 && (esp_timer_get_time() - last_sample_us) < (int64_t)SENSOR_CYCLE_MS * 1000;
+}
 
-    last_soil_moisture = soil_moisture;
-    last_tank_level = water_level;
+// Zonas que viajan en el POST: las propias más las de hojas recientes
+static int upload_zone_count(void) {
+    node_lock();
+    int count = node_configured_zone_count(&node);
+    node_unlock();
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+    xSemaphoreTake(link_mutex, portMAX_DELAY);
+    count += link_gateway_zone_count(&gateway);
+    xSemaphoreGive(link_mutex);
+#endif
+    return count;
+}
 
-    apply_auto_mode_logic();
+static bool upload_ready(void) {
+    if (!wifi_connected) {
+        ESP_LOGW(TAG, "WiFi no conectado");
+        return false;
+    }
+    // Sin zonas, el servidor local ya está corriendo esperando configuración
+    return upload_zone_count() > 0;
+}
 
-    cJSON *sensors = cJSON_CreateObject();
-    cJSON_AddNumberToObject(sensors, "temperature", temperature_c);
-    cJSON_AddNumberToObject(sensors, "ambientHumidity", ambient_humidity);
-    cJSON_AddNumberToObject(sensors, "soilMoisture", soil_moisture);
-    cJSON_AddNumberToObject(sensors, "waterLevel", water_level);
-    cJSON_AddNumberToObject(sensors, "lightLevel", light_level);
-    cJSON_AddBoolToObject(sensors, "pumpStatus", pump_state);
-    cJSON_AddItemToObject(root, "sensors", sensors);
+// Lectura (si la última ya es vieja) y payload serializado del ciclo. El
+// documento cJSON se libera enseguida: el cliente solo necesita el texto.
+static char *build_upload_payload(void) {
+    if (!sample_is_fresh()) {
+        sample_sensors();
+    }
+
+    // Los objetos cJSON del ciclo anterior ya fueron liberados
+    json_arena_reset();
+    heap_probe_t json_probe = heap_budget_begin();
+
+    // Un único POST multiplexado para todas las zonas del nodo
+    node_lock();
+    cJSON *root = upload_build_payload(&node);
+    node_unlock();
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+    xSemaphoreTake(link_mutex, portMAX_DELAY);
+    int leaf_zones = link_gateway_add_zones(&gateway, root, GATEWAY_UPLOAD_ZONES);
+    int leaves = link_gateway_active_leaves(&gateway);
+    xSemaphoreGive(link_mutex);
+    if (leaf_zones > 0) {
+        ESP_LOGI(TAG, "📡 %d zonas de %d hojas ESP-NOW en este envío", leaf_zones, leaves);
+    }
+#endif
 
+#if AGROMIND_STATIC_MEMORY
+    static char payload_buffer[UPLOAD_PAYLOAD_SIZE];
+    char *payload = cJSON_PrintPreallocated(root, payload_buffer, sizeof(payload_buffer), false)
+                        ? payload_buffer : NULL;
+#else
     char *payload = cJSON_PrintUnformatted(root);
+#endif
+    heap_budget_sample(HEAP_SUBSYS_JSON, &json_probe);
+    cJSON_Delete(root);
+    if (payload == NULL) {
+        ESP_LOGE(TAG, "No se pudo serializar el payload");
+        return NULL;
+    }
     ESP_LOGI(TAG, "Enviando payload: %s", payload);
+    return payload;
+}
 
-    esp_http_client_config_t config = {};
-    config.url = SERVER_URL;
-    config.event_handler = http_event_handler;
-    config.method = HTTP_METHOD_POST;
-    config.transport_type = HTTP_TRANSPORT_OVER_SSL;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
+static void set_upload_payload(char *payload) {
+    esp_http_client_set_post_field(upload_client, payload, strlen(payload));
+#if !AGROMIND_STATIC_MEMORY
+    if (upload_payload != NULL && upload_payload != payload) {
+        free(upload_payload);
+    }
+#endif
+    upload_payload = payload;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, payload, strlen(payload));
+static void upload_start(void) {
+    char *payload = build_upload_payload();
+    if (payload == NULL) {
+        return;
+    }
 
-    esp_err_t err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "HTTP Status = %d, content_length = %lld",
+    upload_heap_probe = heap_budget_begin();
+#if AGROMIND_STATIC_MEMORY
+    // El cliente (y su sesión TLS) se reutiliza entre ciclos en lugar de
+    // crearlo y destruirlo en cada envío
+    if (upload_client == NULL) {
+        upload_client = create_upload_client();
+    }
+#else
+    upload_client = create_upload_client();
+#endif
+    set_upload_payload(payload);
+    response_len = 0;
+
+    boot_profile_begin(BOOT_PHASE_FIRST_UPLOAD);
+    node_lock();
+    upload_session_start(&upload, esp_timer_get_time());
+    node_unlock();
+}
+
+// Cierra la subida en curso. true si un ciclo quedó esperando a esta
+static bool upload_end(upload_end_t end) {
+    heap_budget_sample(HEAP_SUBSYS_HTTP_CLIENT, &upload_heap_probe);
+    upload_phase_t phase = upload.phase;
+    node_lock();
+    bool pending = upload_session_finish(&upload, end, esp_timer_get_time());
+    node_unlock();
+
+    if (end == UPLOAD_END_OK) {
+        int status_code = esp_http_client_get_status_code(upload_client);
+        ESP_LOGI(TAG, "HTTP Status = %d, content_length = %lld (%.0f ms)",
                  status_code,
-                 esp_http_client_get_content_length(client));
-        
-        // Si la zona no existe (404), resetear configuración
-        if (status_code == 404) {
-            ESP_LOGW(TAG, "⚠️ Zona %ld no existe en el servidor", current_zone_id);
-            ESP_LOGI(TAG, "🔄 Reseteando configuración, esperando nueva zona desde la app...");
-            // Borrar zone_id de NVS
-            nvs_handle_t nvs_h;
-            if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_h) == ESP_OK) {
-                nvs_erase_key(nvs_h, NVS_KEY_ZONE_ID);
-                nvs_commit(nvs_h);
-                nvs_close(nvs_h);
+                 esp_http_client_get_content_length(upload_client),
+                 (double)upload.stats.upload_last_us / 1000.0);
+        // Los 404 por zona llegan dentro de la respuesta multiplexada
+        // y se procesan en http_event_handler()
+        if (status_code >= 200 && status_code < 300) {
+            ota_update_confirm("primera subida al servidor");
+            if (!boot_profile_done(BOOT_PHASE_FIRST_UPLOAD)) {
+                boot_profile_end(BOOT_PHASE_FIRST_UPLOAD);
+                boot_profile_report();
+                invalidate_info_cache();
             }
-            current_zone_id = 0;
         }
-    } else {
+    } else if (end != UPLOAD_END_ERROR) {
+        ESP_LOGW(TAG, "⏱️ Subida abortada en %s: %s (%.0f ms)", upload_phase_name(phase), upload_end_name(end),
+                 (double)upload.stats.upload_last_us / 1000.0);
+    }
+
+#if AGROMIND_STATIC_MEMORY
+    if (end != UPLOAD_END_OK) {
+        // Conexión en mal estado (o a medias): se recrea en la próxima subida
+        esp_http_client_cleanup(upload_client);
+        upload_client = NULL;
+    }
+#else
+    esp_http_client_cleanup(upload_client);
+    upload_client = NULL;
+    free(upload_payload);
+    upload_payload = NULL;
+#endif
+    return pending;
+}
+
+// Un paso de la subida en curso: bloquea como mucho UPLOAD_IO_TIMEOUT_MS
+// por espera de socket (la resolución DNS sigue siendo bloqueante)
+static void upload_poll(void) {
+    if (!upload_session_active(&upload)) {
+        return;
+    }
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_http_client_perform(upload_client);
+    int64_t now_us = esp_timer_get_time();
+    node_lock();
+    upload_session_note_call(&upload, now_us - start_us);
+    node_unlock();
+
+    upload_end_t end = UPLOAD_END_OK;
+    if (err == ESP_ERR_HTTP_EAGAIN) {
+        if (!upload_session_expired(&upload, now_us, &end)) {
+            return;
+        }
+    } else if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP POST falló: %s", esp_err_to_name(err));
+        end = UPLOAD_END_ERROR;
     }
 
-    esp_http_client_cleanup(client);
-    cJSON_Delete(root);
-    free(payload);
+    // Un ciclo esperó a esta subida: sale ya con la lectura más nueva
+    if (upload_end(end) && upload_ready()) {
+        upload_start();
+    }
+}
+
+// Ciclo de lectura: no espera a que termine la subida anterior
+static void send_sensor_data(int64_t late_us) {
+    if (!upload_ready()) {
+        return;
+    }
+
+    node_lock();
+    upload_cycle_t action = upload_session_cycle(&upload, late_us);
+    node_unlock();
+    switch (action) {
+        case UPLOAD_CYCLE_START:
+            upload_start();
+            break;
+        case UPLOAD_CYCLE_REPLACE: {
+            // La anterior sigue conectando y no envió nada: sale con esta lectura
+            char *payload = build_upload_payload();
+            if (payload == NULL) {
+                // El buffer del post field pudo quedar a medias
+                upload_end(UPLOAD_END_ERROR);
+                break;
+            }
+            set_upload_payload(payload);
+            ESP_LOGI(TAG, "🔁 Subida todavía conectando: sale con la lectura nueva");
+            break;
+        }
+        case UPLOAD_CYCLE_DEFER:
+            // Se lee igual para que el modo automático no espere a la red
+            sample_sensors();
+            ESP_LOGW(TAG, "⏳ Subida anterior en %s: esta lectura sale cuando termine",
+                     upload_phase_name(upload.phase));
+            break;
+    }
+    upload_poll();
 }
 
 // ==================== FUNCIONES NVS ====================
 
+static void zone_nvs_key(int channel, char *key, size_t key_len) {
+    if (channel == 0) {
+        snprintf(key, key_len, "%s", NVS_KEY_ZONE_ID);
+    } else {
+        snprintf(key, key_len, NVS_KEY_ZONE_ID_FMT, channel);
+    }
+}
+
 static void load_config_from_nvs(void) {
     nvs_handle_t nvs;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
     
     if (err == ESP_OK) {
-        // Cargar zone_id
-        int32_t zone_id = 0;
-        if (nvs_get_i32(nvs, NVS_KEY_ZONE_ID, &zone_id) == ESP_OK) {
-            current_zone_id = zone_id;
-            ESP_LOGI(TAG, "📦 NVS: zone_id = %ld", current_zone_id);
-        } else {
-            ESP_LOGI(TAG, "📦 NVS: Sin zone_id guardado");
-            current_zone_id = 0;
+        // Cargar zone_id de cada canal
+        for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+            char key[16];
+            zone_nvs_key(ch, key, sizeof(key));
+            int32_t zone_id = 0;
+            if (nvs_get_i32(nvs, key, &zone_id) == ESP_OK) {
+                node.zones[ch].zone_id = zone_id;
+                ESP_LOGI(TAG, "📦 NVS: canal %d -> zone_id = %ld", ch, node.zones[ch].zone_id);
+            } else {
+                ESP_LOGI(TAG, "📦 NVS: canal %d sin zone_id guardado", ch);
+                node.zones[ch].zone_id = 0;
+            }
+
+            node_storage_load_channel(nvs, &node, ch);
         }
         
         nvs_close(nvs);
@@ -625,37 +1026,133 @@ static void load_config_from_nvs(void) {
     }
 }
 
-static void save_zone_id_to_nvs(int32_t zone_id) {
+// Sobrescribe la curva de fábrica de un canal si hay una guardada en NVS
+template <typename Curve>
+static void load_sensor_calibration(nvs_handle_t nvs, sensor_channel_t<Curve> *sensor) {
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_CALIBRATION_FMT, sensor->name);
+
+    Curve curve;
+    size_t length = sizeof(curve);
+    if (nvs_get_blob(nvs, key, &curve, &length) == ESP_OK && length == sizeof(curve)) {
+        sensor->active = curve;
+        ESP_LOGI(TAG, "📦 NVS: calibración personalizada para %s", sensor->name);
+    }
+}
+
+static void load_calibration_from_nvs(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    for (size_t i = 0; i < adc_sensors.size(); ++i) {
+        load_sensor_calibration(nvs, &adc_sensors.channel[i]);
+    }
+    load_sensor_calibration(nvs, &tank_sensor);
+    nvs_close(nvs);
+}
+
+// curve == NULL borra la calibración personalizada (vuelve a la de fábrica)
+template <typename Curve>
+static esp_err_t save_sensor_calibration(const sensor_channel_t<Curve> *sensor, const Curve *curve) {
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_CALIBRATION_FMT, sensor->name);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (curve != NULL) {
+        err = nvs_set_blob(nvs, key, curve, sizeof(*curve));
+    } else {
+        err = nvs_erase_key(nvs, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+static void save_zone_id_to_nvs(int channel, int32_t zone_id) {
     nvs_handle_t nvs;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
     
     if (err == ESP_OK) {
-        nvs_set_i32(nvs, NVS_KEY_ZONE_ID, zone_id);
+        char key[16];
+        zone_nvs_key(channel, key, sizeof(key));
+        nvs_set_i32(nvs, key, zone_id);
+        if (node.zones[channel].zone_id != zone_id) {
+            node_storage_forget_channel(nvs, &node, channel);
+        }
         nvs_commit(nvs);
         nvs_close(nvs);
-        ESP_LOGI(TAG, "💾 Zone ID %ld guardado en NVS", zone_id);
+        ESP_LOGI(TAG, "💾 Zone ID %ld guardado en NVS (canal %d)", zone_id, channel);
     } else {
         ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
     }
 }
 
-static void clear_zone_id_from_nvs(void) {
+static void clear_zone_id_from_nvs(int channel) {
     nvs_handle_t nvs;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
     
     if (err == ESP_OK) {
-        nvs_erase_key(nvs, NVS_KEY_ZONE_ID);
+        char key[16];
+        zone_nvs_key(channel, key, sizeof(key));
+        nvs_erase_key(nvs, key);
+        node_lock();
+        node_storage_forget_channel(nvs, &node, channel);
         nvs_commit(nvs);
         nvs_close(nvs);
-        current_zone_id = 0;
-        ESP_LOGI(TAG, "🗑️ Zone ID borrado de NVS");
+        node.zones[channel].zone_id = 0;
+        node.zones[channel].auto_watering_active = false;
+        node_unlock();
+        invalidate_info_cache();
+        ESP_LOGI(TAG, "🗑️ Zone ID borrado de NVS (canal %d)", channel);
+    }
+}
+
+// Token de la API local. Se llama al arrancar el servidor, con la radio
+// ya encendida: esp_fill_random usa su ruido como fuente de entropía.
+static void load_api_token(void) {
+    if (local_api_token[0] != '\0') {
+        return;
     }
+#ifdef LOCAL_API_TOKEN
+    static_assert(sizeof(LOCAL_API_TOKEN) <= sizeof(local_api_token), "LOCAL_API_TOKEN demasiado largo");
+    snprintf(local_api_token, sizeof(local_api_token), "%s", LOCAL_API_TOKEN);
+#else
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    size_t length = sizeof(local_api_token);
+    if (nvs_get_str(nvs, NVS_KEY_API_TOKEN, local_api_token, &length) != ESP_OK) {
+        uint8_t random_bytes[16];
+        esp_fill_random(random_bytes, sizeof(random_bytes));
+        for (size_t i = 0; i < sizeof(random_bytes); ++i) {
+            snprintf(local_api_token + 2 * i, 3, "%02x", random_bytes[i]);
+        }
+        nvs_set_str(nvs, NVS_KEY_API_TOKEN, local_api_token);
+        nvs_commit(nvs);
+        ESP_LOGI(TAG, "🔑 Token de API local generado");
+    }
+    nvs_close(nvs);
+#endif
 }
 
 // ==================== SERVIDOR HTTP LOCAL (para la app) ====================
 
-// GET /info - La app descubre el ESP32 y obtiene su estado
-static esp_err_t info_handler(httpd_req_t *req) {
+// Construye la respuesta de /info directamente en el buffer de la caché
+static bool build_info_response(char *buffer, size_t buffer_len) {
     uint8_t mac[6];
     esp_wifi_get_mac(WIFI_IF_STA, mac);
     
@@ -663,34 +1160,130 @@ static esp_err_t info_handler(httpd_req_t *req) {
     snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     
+    // Foto consistente del nodo: control_task y sensor_task siguen corriendo
+    node_lock();
+    bool any_pump_on = node_any_pump_on(&node);
+
     cJSON *json = cJSON_CreateObject();
     cJSON_AddStringToObject(json, "device", "AgroMind-ESP32");
     cJSON_AddStringToObject(json, "mac", mac_str);
-    cJSON_AddNumberToObject(json, "zoneId", current_zone_id);
-    cJSON_AddBoolToObject(json, "configured", current_zone_id > 0);
-    cJSON_AddBoolToObject(json, "pumpState", pump_state);
+    cJSON_AddStringToObject(json, "role", AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY ? "gateway"
+                                          : AGROMIND_NODE_ROLE == NODE_ROLE_LEAF ? "leaf" : "standalone");
+    // zoneId/configured/pumpState se mantienen para apps de una sola zona
+    cJSON_AddNumberToObject(json, "zoneId", node.zones[0].zone_id);
+    cJSON_AddBoolToObject(json, "configured", node_configured_zone_count(&node) > 0);
+    cJSON_AddBoolToObject(json, "pumpState", any_pump_on);
     
     // Agregar últimas lecturas de sensores
     cJSON *sensors = cJSON_CreateObject();
-    cJSON_AddNumberToObject(sensors, "temperature", last_temperature_c);
-    cJSON_AddNumberToObject(sensors, "humidity", last_ambient_humidity);
-    cJSON_AddNumberToObject(sensors, "soilMoisture", last_soil_moisture);
-    cJSON_AddNumberToObject(sensors, "tankLevel", last_tank_level);
+    cJSON_AddNumberToObject(sensors, "temperature", node.temperature_c);
+    cJSON_AddNumberToObject(sensors, "humidity", node.ambient_humidity);
+    cJSON_AddNumberToObject(sensors, "soilMoisture", node.zones[0].last_soil_moisture);
+    cJSON_AddNumberToObject(sensors, "tankLevel", node.tank_level);
+    cJSON *quality = cJSON_AddObjectToObject(sensors, "quality");
+    cJSON_AddStringToObject(quality, "temperature", sensor_quality_name(node.temperature_quality));
+    cJSON_AddStringToObject(quality, "humidity", sensor_quality_name(node.humidity_quality));
+    cJSON_AddStringToObject(quality, "tankLevel", sensor_quality_name(node.tank_quality));
+    cJSON_AddStringToObject(quality, "lightLevel", sensor_quality_name(node.light_quality));
     cJSON_AddItemToObject(json, "sensors", sensors);
+
+    // Tabla de canales: la app vincula cada canal a una zona con /pair
+    cJSON *channels = cJSON_CreateArray();
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        const zone_state_t *zone = &node.zones[ch];
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "channel", ch);
+        cJSON_AddNumberToObject(entry, "zoneId", zone->zone_id);
+        cJSON_AddBoolToObject(entry, "configured", zone->zone_id > 0);
+        cJSON_AddBoolToObject(entry, "pumpState", zone->pump_state);
+        cJSON_AddBoolToObject(entry, "autoMode", zone->auto_mode_enabled);
+        cJSON_AddNumberToObject(entry, "soilMoisture", zone->last_soil_moisture);
+        cJSON_AddStringToObject(entry, "soilQuality", sensor_quality_name(zone->soil_quality));
+        cJSON_AddNumberToObject(entry, "pumpSessions", zone->meter.sessions);
+        cJSON_AddNumberToObject(entry, "waterUsedLiters", round(zone_pump_liters(&node, ch) * 10.0) / 10.0);
+
+        // Modelo del suelo: ganancia por segundo de bomba, secado por hora
+        // y cuánto falta para el próximo riego automático
+        const soil_model_params_t *params = &zone->soil.params;
+        cJSON *model = cJSON_AddObjectToObject(entry, "soilModel");
+        cJSON_AddBoolToObject(model, "ready", soil_model_ready(&zone->soil));
+        cJSON_AddNumberToObject(model, "gainPerSecond", roundf(params->gain_per_s * 1000.0f) / 1000.0);
+        cJSON_AddNumberToObject(model, "dryingPerHour", roundf(params->dry_per_hour * 100.0f) / 100.0);
+        cJSON_AddNumberToObject(model, "waterings", params->gain_samples);
+        cJSON_AddNumberToObject(model, "dryingWindows", params->dry_samples);
+        cJSON_AddNumberToObject(model, "lastDuration", zone->planned_duration_s);
+        float hours = soil_model_hours_until(&zone->soil, zone->last_soil_moisture, zone->moisture_threshold);
+        cJSON_AddNumberToObject(model, "hoursToThreshold", hours < 0.0f ? -1.0 : roundf(hours * 10.0f) / 10.0);
+        cJSON *rule = cJSON_AddObjectToObject(entry, "rule");
+        cJSON_AddNumberToObject(rule, "bytes", zone->rule.length);
+        cJSON_AddBoolToObject(rule, "blocked", zone->rule_blocked);
+        cJSON_AddItemToArray(channels, entry);
+    }
+    cJSON_AddItemToObject(json, "channels", channels);
+    upload_session_t upload_snapshot = upload;
+    node_unlock();
+    boot_profile_add_json(json);
+    upload_session_add_json(&upload_snapshot, json);
     
-    char *response = cJSON_PrintUnformatted(json);
+    bool ok = cJSON_PrintPreallocated(json, buffer, (int)buffer_len, false);
+    cJSON_Delete(json);
+    return ok;
+}
+
+// GET /info - La app descubre el ESP32 y obtiene su estado
+static esp_err_t info_handler(httpd_req_t *req) {
+    int64_t now_us = esp_timer_get_time();
+    uint32_t version = node.state_version;
+
+    // Solo la tarea de httpd toca la caché, no hace falta mutex
+    if (info_cache.length == 0 ||
+        info_cache.state_version != version ||
+        (now_us - info_cache.built_at_us) > (int64_t)INFO_CACHE_TTL_MS * 1000) {
+        heap_probe_t probe = heap_budget_begin();
+        bool ok = build_info_response(info_cache.body, sizeof(info_cache.body));
+        heap_budget_sample(HEAP_SUBSYS_LOCAL_SERVER, &probe);
+        if (!ok) {
+            info_cache.length = 0;
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        info_cache.length = strlen(info_cache.body);
+        info_cache.state_version = version;
+        info_cache.built_at_us = now_us;
+    }
     
     // Agregar headers CORS para que la app pueda acceder
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, response);
-    
-    free(response);
-    cJSON_Delete(json);
+    httpd_resp_send(req, info_cache.body, (ssize_t)info_cache.length);
     return ESP_OK;
 }
 
-// POST /pair - La app envía el Zone ID para vincular
+static bool local_api_authorized(httpd_req_t *req);
+
+// Canal pedido en el body. Sin "channel" queda default_channel; false si no
+// es un canal válido. El double se valida antes de convertirlo: un int fuera
+// de rango (o NaN) es comportamiento indefinido.
+static bool parse_channel(const cJSON *json, int default_channel, int *channel) {
+    const cJSON *item = json != NULL ? cJSON_GetObjectItem(json, "channel") : NULL;
+    if (item == NULL) {
+        *channel = default_channel;
+        return true;
+    }
+    double value = cJSON_GetNumberValue(item);
+    if (!cJSON_IsNumber(item) || !(value >= 0.0 && value < ZONE_CHANNEL_COUNT) || value != (int)value) {
+        return false;
+    }
+    *channel = (int)value;
+    return true;
+}
+
+// POST /pair - La app envía el Zone ID (y opcionalmente el canal) para vincular.
+// Sin CORS: el token de la respuesta no debe poder leerlo cualquier página web.
+// Cambiar un canal ya vinculado (o mover una zona ya vinculada) pide el token;
+// la respuesta solo lo trae en el primer emparejamiento del nodo o si la
+// petición ya venía autenticada.
 static esp_err_t pair_handler(httpd_req_t *req) {
     char buf[128];
     int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
@@ -705,40 +1298,70 @@ static esp_err_t pair_handler(httpd_req_t *req) {
     
     cJSON *json = cJSON_Parse(buf);
     if (json == NULL) {
-        httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON inválido");
         return ESP_FAIL;
     }
     
+    bool authorized = local_api_authorized(req);
     cJSON *zone_id_item = cJSON_GetObjectItem(json, "zoneId");
+    int channel = 0;  // sin "channel" se vincula el canal 0 (app de una zona)
     
-    if (zone_id_item && cJSON_IsNumber(zone_id_item)) {
-        int32_t new_zone_id = (int32_t)cJSON_GetNumberValue(zone_id_item);
+    if (!parse_channel(json, 0, &channel)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Canal inválido");
+    } else if (zone_id_item && cJSON_IsNumber(zone_id_item)) {
+        double zone_id_value = cJSON_GetNumberValue(zone_id_item);
+        int32_t new_zone_id = zone_id_value >= 1.0 && zone_id_value <= INT32_MAX ? (int32_t)zone_id_value : 0;
         
-        if (new_zone_id > 0) {
-            current_zone_id = new_zone_id;
-            save_zone_id_to_nvs(new_zone_id);
+        node_lock();
+        // Una zona solo puede estar vinculada a un canal
+        int previous_channel = new_zone_id > 0 ? node_find_channel(&node, new_zone_id) : -1;
+        bool takes_over = node.zones[channel].zone_id > 0 ||
+                          (previous_channel >= 0 && previous_channel != channel);
+        bool first_pairing = node_configured_zone_count(&node) == 0;
+
+        if (new_zone_id <= 0) {
+            node_unlock();
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Zone ID inválido");
+        } else if (takes_over && !authorized) {
+            node_unlock();
+            ESP_LOGW(TAG, "🔒 Canal %d ya vinculado: emparejamiento sin token rechazado", channel);
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Canal ya vinculado, falta el token");
+        } else {
+            if (previous_channel >= 0 && previous_channel != channel) {
+                if (node.zones[previous_channel].pump_state) {
+                    set_pump_state(previous_channel, false);
+                }
+                clear_zone_id_from_nvs(previous_channel);
+            }
+
+            // Antes de cambiar zone_id: si la zona es otra se olvida el modelo del suelo
+            save_zone_id_to_nvs(channel, new_zone_id);
+            node.zones[channel].zone_id = new_zone_id;
+            node_unlock();
+            invalidate_info_cache();
+            update_mdns_txt();
             
-            ESP_LOGI(TAG, "✅ Emparejado con zona %ld", current_zone_id);
+            ESP_LOGI(TAG, "✅ Canal %d emparejado con zona %ld", channel, new_zone_id);
             
             cJSON *response = cJSON_CreateObject();
             cJSON_AddBoolToObject(response, "success", true);
-            cJSON_AddNumberToObject(response, "zoneId", current_zone_id);
+            cJSON_AddNumberToObject(response, "zoneId", new_zone_id);
+            cJSON_AddNumberToObject(response, "channel", channel);
             cJSON_AddStringToObject(response, "message", "ESP32 vinculado correctamente");
+            // La app lo guarda para usar /control sin pasar por el servidor
+            if (first_pairing || authorized) {
+                cJSON_AddStringToObject(response, "apiToken", local_api_token);
+            }
             
             char *resp_str = cJSON_PrintUnformatted(response);
-            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
             httpd_resp_set_type(req, "application/json");
             httpd_resp_sendstr(req, resp_str);
             
             free(resp_str);
             cJSON_Delete(response);
-        } else {
-            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Zone ID inválido");
         }
     } else {
-        httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Falta zoneId");
     }
     
@@ -746,11 +1369,63 @@ static esp_err_t pair_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
-// POST /unpair - Desvincular el ESP32 de la zona
+// POST /unpair - Desvincular un canal ({ "channel": N }) o todo el nodo (sin body).
+// Pide el token si hay algo vinculado: si no, bastaría con desvincular y volver
+// a emparejar para que /pair lo entregue.
 static esp_err_t unpair_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "🔓 Solicitud de desvinculación");
     
-    clear_zone_id_from_nvs();
+    // Solo un POST sin body desvincula todo: un body que no se pudo leer o
+    // que no trae un canal válido nunca cae en "todos los canales"
+    int channel = -1;  // -1 = todos los canales
+    if (req->content_len > 0) {
+        char buf[64];
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        if (ret <= 0) {
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        buf[ret] = '\0';
+        cJSON *json = cJSON_Parse(buf);
+        if (json == NULL) {
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON inválido");
+            return ESP_OK;
+        }
+        bool valid = parse_channel(json, -1, &channel) && channel >= 0;
+        cJSON_Delete(json);
+        if (!valid) {
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Canal inválido");
+            return ESP_OK;
+        }
+    }
+
+    bool authorized = local_api_authorized(req);
+    node_lock();
+    bool paired = false;
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        paired = paired || ((channel < 0 || ch == channel) && node.zones[ch].zone_id > 0);
+    }
+    if (paired && !authorized) {
+        node_unlock();
+        httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Token inválido");
+        return ESP_OK;
+    }
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        if (channel >= 0 && ch != channel) {
+            continue;
+        }
+        if (node.zones[ch].pump_state) {
+            set_pump_state(ch, false);
+        }
+        clear_zone_id_from_nvs(ch);
+    }
+    node_unlock();
+    update_mdns_txt();
     
     cJSON *response = cJSON_CreateObject();
     cJSON_AddBoolToObject(response, "success", true);
@@ -766,6 +1441,316 @@ static esp_err_t unpair_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// Puntos dentro del rango del ADC y del canal, y una recta que no desborde
+// Q16.16 en todo el rango crudo: si las salidas en 0 y en ADC_RAW_MAX caben,
+// también caben la escala, el offset y cualquier eval_q16() intermedio.
+static bool calibration_points_valid(const sensor_channel_t<linear_curve_t> *sensor,
+                                     double raw_a, double value_a, double raw_b, double value_b) {
+    double min_value = sensor_from_q16(sensor->min_q16);
+    double max_value = sensor_from_q16(sensor->max_q16);
+    if (!(raw_a >= 0.0 && raw_a <= ADC_RAW_MAX) || !(raw_b >= 0.0 && raw_b <= ADC_RAW_MAX) ||
+        !(value_a >= min_value && value_a <= max_value) || !(value_b >= min_value && value_b <= max_value) ||
+        raw_a == raw_b) {
+        return false;
+    }
+    // Margen de una unidad para el redondeo de escala y offset a Q16
+    const double q16_limit = (double)INT32_MAX / SENSOR_Q16_ONE - 1.0;
+    double scale = (value_b - value_a) / (raw_b - raw_a);
+    double at_zero = value_a - raw_a * scale;
+    double at_max = at_zero + ADC_RAW_MAX * scale;
+    return fabs(at_zero) < q16_limit && fabs(at_max) < q16_limit;
+}
+
+// POST /calibrate - Recalibración de un canal ADC por dos puntos
+// { "sensor": "soil0", "rawA": 3200, "valueA": 0, "rawB": 700, "valueB": 100 }
+// { "sensor": "soil0", "reset": true } vuelve a la calibración de config.h
+// Pide el token de /control: una curva falsa haría regar una zona. Sin CORS.
+static esp_err_t calibrate_handler(httpd_req_t *req) {
+    if (!local_api_authorized(req)) {
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Token inválido");
+        return ESP_OK;
+    }
+
+    char buf[160];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *json = cJSON_Parse(buf);
+    if (json == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON inválido");
+        return ESP_FAIL;
+    }
+
+    sensor_channel_t<linear_curve_t> *sensor = NULL;
+    const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(json, "sensor"));
+    for (size_t i = 0; name != NULL && i < adc_sensors.size(); ++i) {
+        if (strcmp(adc_sensors.channel[i].name, name) == 0) {
+            sensor = &adc_sensors.channel[i];
+        }
+    }
+    if (sensor == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Sensor desconocido");
+        cJSON_Delete(json);
+        return ESP_OK;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "reset"))) {
+        err = save_sensor_calibration<linear_curve_t>(sensor, NULL);
+        if (err == ESP_OK) {
+            node_lock();
+            sensor->active = sensor->factory;
+            adc_filter_reset[sensor - adc_sensors.channel] = true;
+            node_unlock();
+        }
+    } else {
+        cJSON *raw_a = cJSON_GetObjectItem(json, "rawA");
+        cJSON *value_a = cJSON_GetObjectItem(json, "valueA");
+        cJSON *raw_b = cJSON_GetObjectItem(json, "rawB");
+        cJSON *value_b = cJSON_GetObjectItem(json, "valueB");
+        if (!cJSON_IsNumber(raw_a) || !cJSON_IsNumber(value_a) ||
+            !cJSON_IsNumber(raw_b) || !cJSON_IsNumber(value_b) ||
+            !calibration_points_valid(sensor, cJSON_GetNumberValue(raw_a), cJSON_GetNumberValue(value_a),
+                                      cJSON_GetNumberValue(raw_b), cJSON_GetNumberValue(value_b))) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Puntos de calibración inválidos");
+            cJSON_Delete(json);
+            return ESP_OK;
+        }
+        linear_curve_t curve = linear_curve_t::from_points((float)cJSON_GetNumberValue(raw_a),
+                                                           (float)cJSON_GetNumberValue(value_a),
+                                                           (float)cJSON_GetNumberValue(raw_b),
+                                                           (float)cJSON_GetNumberValue(value_b));
+        err = save_sensor_calibration(sensor, &curve);
+        if (err == ESP_OK) {
+            node_lock();
+            sensor->active = curve;
+            adc_filter_reset[sensor - adc_sensors.channel] = true;
+            node_unlock();
+        }
+    }
+    cJSON_Delete(json);
+
+    if (err != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "🎯 Calibración de %s actualizada (scale=%ld offset=%ld Q16)",
+             sensor->name, sensor->active.scale_q16, sensor->active.offset_q16);
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+    cJSON_AddStringToObject(response, "sensor", sensor->name);
+    cJSON_AddBoolToObject(response, "factory",
+                          sensor->active.scale_q16 == sensor->factory.scale_q16 &&
+                          sensor->active.offset_q16 == sensor->factory.offset_q16);
+
+    char *resp_str = cJSON_PrintUnformatted(response);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp_str);
+
+    free(resp_str);
+    cJSON_Delete(response);
+    return ESP_OK;
+}
+
+// ==================== API LOCAL DE CONTROL ====================
+// GET /control devuelve el estado de cada canal y POST /control aplica un
+// comando con el formato de "commands" del servidor. Se atienden en la
+// tarea de httpd (no escriben NVS): la bomba cambia antes de responder.
+
+// Compara el header "Authorization: Bearer <token>" en tiempo constante
+static bool local_api_authorized(httpd_req_t *req) {
+    char header[LOCAL_API_TOKEN_MAX + 16];
+    if (local_api_token[0] == '\0' ||
+        httpd_req_get_hdr_value_str(req, "Authorization", header, sizeof(header)) != ESP_OK ||
+        strncmp(header, "Bearer ", 7) != 0) {
+        return false;
+    }
+    const char *token = header + 7;
+    size_t length = strlen(local_api_token);
+    if (strlen(token) != length) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < length; ++i) {
+        diff |= (uint8_t)(token[i] ^ local_api_token[i]);
+    }
+    return diff == 0;
+}
+
+static void add_control_channel(cJSON *array, int channel) {
+    const zone_state_t *zone = &node.zones[channel];
+    cJSON *entry = cJSON_CreateObject();
+    cJSON_AddNumberToObject(entry, "channel", channel);
+    cJSON_AddNumberToObject(entry, "zoneId", zone->zone_id);
+    cJSON_AddBoolToObject(entry, "pumpState", zone->pump_state);
+    cJSON_AddBoolToObject(entry, "autoWatering", zone->auto_watering_active);
+    cJSON_AddBoolToObject(entry, "autoMode", zone->auto_mode_enabled);
+    cJSON_AddNumberToObject(entry, "moistureThreshold", zone->moisture_threshold);
+    cJSON_AddNumberToObject(entry, "wateringDuration", zone->watering_duration);
+    cJSON_AddBoolToObject(entry, "configPending", zone->config_pending);
+    upload_add_reading(entry, "soilMoisture", zone->last_soil_moisture, zone->soil_quality);
+    cJSON_AddItemToArray(array, entry);
+}
+
+// channel < 0: todos los canales
+static esp_err_t send_control_state(httpd_req_t *req, int channel, const char *error) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", error == NULL);
+    if (error != NULL) {
+        cJSON_AddStringToObject(response, "error", error);
+    }
+    node_lock();
+    upload_add_reading(response, "tankLevel", node.tank_level, node.tank_quality);
+    cJSON_AddBoolToObject(response, "tankLocked", node_tank_locked(&node));
+    cJSON *channels = cJSON_AddArrayToObject(response, "channels");
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        if (channel < 0 || ch == channel) {
+            add_control_channel(channels, ch);
+        }
+    }
+    node_unlock();
+
+    char *resp_str = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    if (resp_str == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    if (error != NULL) {
+        httpd_resp_set_status(req, "409 Conflict");
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_sendstr(req, resp_str);
+    free(resp_str);
+    return ESP_OK;
+}
+
+// GET /control - Estado de bombas y config de cada canal
+static esp_err_t control_get_handler(httpd_req_t *req) {
+    if (!local_api_authorized(req)) {
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Token inválido");
+        return ESP_OK;
+    }
+    return send_control_state(req, -1, NULL);
+}
+
+// POST /control - Bomba manual y config de un canal, con las reglas de los
+// "commands" del servidor y el bloqueo por tanque vacío
+// { "channel": 0, "pumpState": true, "autoMode": false, "moistureThreshold": 35, "wateringDuration": 20 }
+static esp_err_t control_post_handler(httpd_req_t *req) {
+    if (!local_api_authorized(req)) {
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Token inválido");
+        return ESP_OK;
+    }
+
+    char buf[192];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *json = cJSON_Parse(buf);
+    if (json == NULL || !cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON inválido");
+        return ESP_FAIL;
+    }
+
+    int channel = 0;  // sin "channel" se usa el canal 0 (app de una zona)
+    if (!parse_channel(json, 0, &channel)) {
+        cJSON_Delete(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Canal inválido");
+        return ESP_OK;
+    }
+
+    node_lock();
+    zone_local_result_t result = zone_apply_local_commands(&node, channel, json);
+    node_unlock();
+    cJSON_Delete(json);
+    invalidate_info_cache();
+
+    switch (result) {
+        case ZONE_LOCAL_UNPAIRED:
+            return send_control_state(req, channel, "unpaired");
+        case ZONE_LOCAL_TANK_LOCKED:
+            return send_control_state(req, channel, "tankLocked");
+        default:
+            return send_control_state(req, channel, NULL);
+    }
+}
+
+// ==================== HANDLERS ASÍNCRONOS ====================
+// El handler registrado con async_dispatch_handler() se ejecuta en un
+// worker; la tarea de httpd queda libre para seguir atendiendo /info.
+
+static void async_worker_task(void *pvParameters) {
+    async_request_t item;
+    while (true) {
+        if (xQueueReceive(async_request_queue, &item, portMAX_DELAY) == pdTRUE) {
+            item.handler(item.req);
+            httpd_req_async_handler_complete(item.req);
+        }
+    }
+}
+
+static esp_err_t async_dispatch_handler(httpd_req_t *req) {
+    esp_err_t (*handler)(httpd_req_t *) = (esp_err_t (*)(httpd_req_t *))req->user_ctx;
+
+    httpd_req_t *async_req = NULL;
+    if (async_request_queue == NULL || httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        return handler(req);  // sin workers: atender en línea
+    }
+
+    async_request_t item = { async_req, handler };
+    if (xQueueSend(async_request_queue, &item, 0) != pdTRUE) {
+        // La respuesta va por la copia asíncrona, que es la dueña del
+        // socket desde handler_begin; recién después se libera
+        ESP_LOGW(TAG, "Workers ocupados, rechazando %s", async_req->uri);
+        httpd_resp_set_status(async_req, "503 Service Unavailable");
+        httpd_resp_set_hdr(async_req, "Access-Control-Allow-Origin", "*");
+        httpd_resp_set_hdr(async_req, "Retry-After", "1");
+        httpd_resp_sendstr(async_req, "Ocupado, reintentar");
+        httpd_req_async_handler_complete(async_req);
+        return ESP_OK;
+    }
+    return ESP_OK;
+}
+
+static void start_async_workers(void) {
+    if (async_request_queue != NULL) {
+        return;
+    }
+#if AGROMIND_STATIC_MEMORY
+    static uint8_t queue_storage[ASYNC_QUEUE_LENGTH * sizeof(async_request_t)];
+    static StaticQueue_t queue_buffer;
+    async_request_queue = xQueueCreateStatic(ASYNC_QUEUE_LENGTH, sizeof(async_request_t),
+                                             queue_storage, &queue_buffer);
+    static StackType_t worker_stacks[ASYNC_WORKER_COUNT][ASYNC_WORKER_STACK_SIZE];
+    static StaticTask_t worker_tcbs[ASYNC_WORKER_COUNT];
+    for (int i = 0; i < ASYNC_WORKER_COUNT; ++i) {
+        xTaskCreateStatic(async_worker_task, "httpd_async", ASYNC_WORKER_STACK_SIZE,
+                          NULL, 5, worker_stacks[i], &worker_tcbs[i]);
+    }
+#else
+    async_request_queue = xQueueCreate(ASYNC_QUEUE_LENGTH, sizeof(async_request_t));
+    for (int i = 0; i < ASYNC_WORKER_COUNT; ++i) {
+        xTaskCreate(async_worker_task, "httpd_async", ASYNC_WORKER_STACK_SIZE, NULL, 5, NULL);
+    }
+#endif
+}
+
 // Handler para CORS preflight
 static esp_err_t cors_handler(httpd_req_t *req) {
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -783,6 +1768,16 @@ static void start_local_server(void) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.stack_size = 8192;
     config.server_port = LOCAL_SERVER_PORT;
+    config.max_open_sockets = LOCAL_SERVER_MAX_SOCKETS;
+    config.max_uri_handlers = LOCAL_SERVER_MAX_HANDLERS;
+    config.recv_wait_timeout = LOCAL_SERVER_TIMEOUT_S;
+    config.send_wait_timeout = LOCAL_SERVER_TIMEOUT_S;
+    // Si se agotan los sockets se cierra el menos usado recientemente
+    // (apps que dejaron conexiones abiertas) en vez de rechazar /pair
+    config.lru_purge_enable = true;
+
+    start_async_workers();
+    load_api_token();
     
     if (httpd_start(&local_server, &config) == ESP_OK) {
         // GET /info
@@ -798,8 +1793,8 @@ static void start_local_server(void) {
         httpd_uri_t uri_pair = {
             .uri = "/pair",
             .method = HTTP_POST,
-            .handler = pair_handler,
-            .user_ctx = NULL
+            .handler = async_dispatch_handler,
+            .user_ctx = (void *)pair_handler
         };
         httpd_register_uri_handler(local_server, &uri_pair);
         
@@ -807,20 +1802,13 @@ static void start_local_server(void) {
         httpd_uri_t uri_unpair = {
             .uri = "/unpair",
             .method = HTTP_POST,
-            .handler = unpair_handler,
-            .user_ctx = NULL
+            .handler = async_dispatch_handler,
+            .user_ctx = (void *)unpair_handler
         };
         httpd_register_uri_handler(local_server, &uri_unpair);
         
-        // OPTIONS para CORS
-        httpd_uri_t uri_cors_pair = {
-            .uri = "/pair",
-            .method = HTTP_OPTIONS,
-            .handler = cors_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(local_server, &uri_cors_pair);
-        
+        // OPTIONS para CORS. /pair, /calibrate y /control no lo tienen: el
+        // token solo lo usa la app, nunca una página web
         httpd_uri_t uri_cors_unpair = {
             .uri = "/unpair",
             .method = HTTP_OPTIONS,
@@ -829,12 +1817,122 @@ static void start_local_server(void) {
         };
         httpd_register_uri_handler(local_server, &uri_cors_unpair);
         
+        // POST /calibrate
+        httpd_uri_t uri_calibrate = {
+            .uri = "/calibrate",
+            .method = HTTP_POST,
+            .handler = async_dispatch_handler,
+            .user_ctx = (void *)calibrate_handler
+        };
+        httpd_register_uri_handler(local_server, &uri_calibrate);
+        
+        // GET/POST /control (API local con token)
+        httpd_uri_t uri_control_get = {
+            .uri = "/control",
+            .method = HTTP_GET,
+            .handler = control_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(local_server, &uri_control_get);
+        
+        httpd_uri_t uri_control_post = {
+            .uri = "/control",
+            .method = HTTP_POST,
+            .handler = control_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(local_server, &uri_control_post);
+        
         ESP_LOGI(TAG, "🌐 Servidor local iniciado en puerto %d", LOCAL_SERVER_PORT);
     } else {
         ESP_LOGE(TAG, "❌ Error iniciando servidor local");
     }
 }
 
+// ==================== DESCUBRIMIENTO mDNS ====================
+// Registros TXT del servicio:
+//   mac=AA:BB:CC:DD:EE:FF  zoneId=<zona del canal 0>  configured=0|1
+//   zones=<zona canal 0>,<zona canal 1>,...  path=/info
+
+// Devuelve si hay algún canal configurado (TXT "configured")
+static bool build_mdns_txt_values(char *zone_id, size_t zone_id_len,
+                                  char *zone_list, size_t zone_list_len) {
+    node_lock();
+    snprintf(zone_id, zone_id_len, "%ld", (long)node.zones[0].zone_id);
+
+    size_t offset = 0;
+    zone_list[0] = '\0';
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT && offset < zone_list_len; ++ch) {
+        offset += snprintf(zone_list + offset, zone_list_len - offset, "%s%ld",
+                           ch > 0 ? "," : "", (long)node.zones[ch].zone_id);
+    }
+    bool configured = node_configured_zone_count(&node) > 0;
+    node_unlock();
+    return configured;
+}
+
+// Mantiene los TXT al día cuando cambia la vinculación de algún canal
+static void update_mdns_txt(void) {
+    if (!mdns_started) {
+        return;
+    }
+    char zone_id[12];
+    char zone_list[12 * MAX_ZONE_CHANNELS];
+    bool configured = build_mdns_txt_values(zone_id, sizeof(zone_id), zone_list, sizeof(zone_list));
+
+    mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, "zoneId", zone_id);
+    mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, "zones", zone_list);
+    mdns_service_txt_item_set(MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, "configured", configured ? "1" : "0");
+}
+
+static void start_mdns_service(void) {
+    if (mdns_started) {
+        return;
+    }
+
+    esp_err_t err = mdns_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error iniciando mDNS: %s", esp_err_to_name(err));
+        return;
+    }
+
+    uint8_t mac[6];
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+
+    char mac_str[18];
+    snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    // Hostname único por placa: agromind-xxxxxx.local
+    char hostname[20];
+    snprintf(hostname, sizeof(hostname), "agromind-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    mdns_hostname_set(hostname);
+    mdns_instance_name_set(MDNS_INSTANCE_NAME);
+
+    char zone_id[12];
+    char zone_list[12 * MAX_ZONE_CHANNELS];
+    bool configured = build_mdns_txt_values(zone_id, sizeof(zone_id), zone_list, sizeof(zone_list));
+
+    mdns_txt_item_t txt[] = {
+        { "mac", mac_str },
+        { "zoneId", zone_id },
+        { "configured", configured ? "1" : "0" },
+        { "zones", zone_list },
+        { "path", "/info" },
+    };
+
+    err = mdns_service_add(NULL, MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, LOCAL_SERVER_PORT,
+                           txt, sizeof(txt) / sizeof(txt[0]));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error registrando servicio mDNS: %s", esp_err_to_name(err));
+        return;
+    }
+
+    mdns_started = true;
+    ESP_LOGI(TAG, "📣 mDNS: %s.local anunciando %s.%s en puerto %d",
+             hostname, MDNS_SERVICE_TYPE, MDNS_SERVICE_PROTO, LOCAL_SERVER_PORT);
+}
+
 // ==================== CONFIGURACIÓN WIFI ====================
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
@@ -861,9 +1959,11 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
         ESP_LOGI(TAG, "========================================");
         retry_num = 0;
         wifi_connected = true;
-        
-        // Iniciar servidor local cuando tengamos IP
-        start_local_server();
+        boot_profile_end(BOOT_PHASE_WIFI_CONNECT);
+        // sensor_task arranca el servidor local y mDNS (ver start_local_services)
+        if (sensor_task_handle != NULL) {
+            xTaskNotifyGive(sensor_task_handle);
+        }
     }
 }
 
@@ -898,25 +1998,296 @@ static void wifi_init(void) {
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
+    boot_profile_begin(BOOT_PHASE_WIFI_CONNECT);
 
     ESP_LOGI(TAG, "Conectando a WiFi: %s", WIFI_SSID);
 }
 
+// ==================== ESP-NOW (GATEWAY / HOJA) ====================
+
+#if AGROMIND_NODE_ROLE != NODE_ROLE_STANDALONE
+typedef struct {
+    uint8_t mac[LINK_MAC_LEN];
+    uint8_t data[LINK_MAX_FRAME];
+    size_t length;
+} espnow_frame_t;
+
+// Corre en la tarea de WiFi: solo copia la trama a la cola
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int length) {
+    if (length <= 0 || length > LINK_MAX_FRAME || link_frame_type(data, (size_t)length) == 0) {
+        return;
+    }
+    espnow_frame_t frame;
+    memcpy(frame.mac, info->src_addr, LINK_MAC_LEN);
+    memcpy(frame.data, data, (size_t)length);
+    frame.length = (size_t)length;
+    if (xQueueSend(espnow_queue, &frame, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Cola ESP-NOW llena, trama descartada");
+    }
+}
+
+static int espnow_radio_send(void *ctx, const uint8_t mac[LINK_MAC_LEN], const uint8_t *data, size_t length) {
+    (void)ctx;
+    if (!esp_now_is_peer_exist(mac)) {
+        // Canal 0 = el del AP: gateway y hojas comparten la red WiFi
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, mac, LINK_MAC_LEN);
+        peer.channel = 0;
+        peer.ifidx = WIFI_IF_STA;
+        peer.encrypt = false;
+        esp_err_t err = esp_now_add_peer(&peer);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "esp_now_add_peer falló: %s", esp_err_to_name(err));
+            return -1;
+        }
+    }
+    return esp_now_send(mac, data, length) == ESP_OK ? 0 : -1;
+}
+
+static void espnow_task(void *pvParameters) {
+    (void)pvParameters;
+    espnow_frame_t frame;
+    while (true) {
+        if (xQueueReceive(espnow_queue, &frame, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        xSemaphoreTake(link_mutex, portMAX_DELAY);
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+        link_gateway_handle_frame(&gateway, frame.mac, frame.data, frame.length);
+#else
+        // Los comandos del gateway cambian las zonas: mismo lock que el resto
+        node_lock();
+        link_leaf_handle_frame(&leaf, frame.mac, frame.data, frame.length);
+        node_unlock();
+        invalidate_info_cache();
+#endif
+        xSemaphoreGive(link_mutex);
+    }
+}
+
+static void espnow_init(void) {
+#if AGROMIND_STATIC_MEMORY
+    static StaticSemaphore_t link_mutex_buffer;
+    link_mutex = xSemaphoreCreateMutexStatic(&link_mutex_buffer);
+    static uint8_t queue_storage[ESPNOW_QUEUE_LENGTH * sizeof(espnow_frame_t)];
+    static StaticQueue_t queue_buffer;
+    espnow_queue = xQueueCreateStatic(ESPNOW_QUEUE_LENGTH, sizeof(espnow_frame_t),
+                                      queue_storage, &queue_buffer);
+#else
+    link_mutex = xSemaphoreCreateMutex();
+    espnow_queue = xQueueCreate(ESPNOW_QUEUE_LENGTH, sizeof(espnow_frame_t));
+#endif
+    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
+
+    link_radio_t radio = {};
+    radio.send = espnow_radio_send;
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+    link_gateway_init(&gateway, &radio);
+    ESP_LOGI(TAG, "📡 Modo gateway ESP-NOW (hasta %d hojas)", LINK_MAX_LEAVES);
+#else
+    link_leaf_init(&leaf, &node, &radio);
+#ifdef ESPNOW_GATEWAY_MAC
+    // Solo este gateway puede mandar comandos, aunque deje de responder
+    static const uint8_t pinned_gateway[LINK_MAC_LEN] = ESPNOW_GATEWAY_MAC;
+    link_leaf_pin_gateway(&leaf, pinned_gateway);
+#endif
+    ESP_LOGI(TAG, "📡 Modo hoja ESP-NOW: las lecturas van al gateway");
+#endif
+#if AGROMIND_STATIC_MEMORY
+    static StackType_t task_stack[ESPNOW_TASK_STACK_SIZE];
+    static StaticTask_t task_tcb;
+    xTaskCreateStatic(espnow_task, "espnow_task", ESPNOW_TASK_STACK_SIZE, NULL, 5, task_stack, &task_tcb);
+#else
+    xTaskCreate(espnow_task, "espnow_task", ESPNOW_TASK_STACK_SIZE, NULL, 5, NULL);
+#endif
+}
+#endif
+
+#if AGROMIND_NODE_ROLE == NODE_ROLE_LEAF
+// La hoja no abre sesión TLS: muestrea y manda la trama al gateway
+static void send_leaf_reading(void) {
+    // Se muestrea sin link_mutex: espnow_task sigue atendiendo al gateway
+    if (!sample_is_fresh()) {
+        sample_sensors();
+    }
+    boot_profile_begin(BOOT_PHASE_FIRST_UPLOAD);
+    xSemaphoreTake(link_mutex, portMAX_DELAY);
+    node_lock();
+    bool sent = link_leaf_send_reading(&leaf);
+    node_unlock();
+    if (!sent) {
+        ESP_LOGW(TAG, "No se pudo enviar la lectura por ESP-NOW");
+    } else if (!boot_profile_done(BOOT_PHASE_FIRST_UPLOAD)) {
+        boot_profile_end(BOOT_PHASE_FIRST_UPLOAD);
+        boot_profile_report();
+    }
+    bool gateway_alive = link_leaf_gateway_alive(&leaf);
+    xSemaphoreGive(link_mutex);
+    if (gateway_alive) {
+        ota_update_confirm("gateway ESP-NOW responde");
+    }
+}
+#endif
+
 // ==================== TAREA PRINCIPAL ====================
 
+// Servidor local y mDNS, en cuanto hay IP. Los arranca solo sensor_task:
+// se crea con el ADC y los GPIO ya configurados, y GOT_IP puede llegar
+// antes (WiFi se asocia mientras app_main configura los periféricos).
+static void start_local_services(void) {
+    if (!wifi_connected) {
+        return;
+    }
+    start_local_server();
+    start_mdns_service();
+}
+
+// El OTA no reinicia mientras alguna bomba está regando. Antes de
+// reiniciar se guardan los contadores de riego pendientes
+static bool can_reboot_for_update(void) {
+    node_lock();
+    bool idle = !node_any_pump_on(&node);
+    if (idle) {
+        node_storage_flush_pump_meters(&node, true);
+    }
+    node_unlock();
+    return idle;
+}
+
+// ==================== CONTROL RÁPIDO ====================
+// Entre dos ciclos de sensor_task (5 s, más lo que tarde la subida) una
+// bomba seguiría regando con la última lectura. Mientras alguna está
+// encendida control_task lee el tanque y el suelo de los canales que riegan
+// a FAST_CONTROL_HZ y aplica zone_fast_control(); con todas apagadas
+// duerme hasta que relay_hook lo despierta.
+
+static void fast_control_step(void) {
+    // El eco (hasta 60 ms sin respuesta) se mide sin lock: /control y
+    // /info no esperan al paso rápido
+    echo_sample_t echo = measure_echo();
+    node_lock();
+    fast_sampling = true;
+    node.tank_level = apply_water_level(&echo, &node.tank_quality);
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        if (!node.zones[ch].pump_state) {
+            continue;
+        }
+        sensor_quality_t quality = SENSOR_QUALITY_INVALID;
+        adc_sample_t soil = measure_adc(ch);
+        float moisture = apply_adc_sample(ch, &soil, &quality);
+        zone_observe_moisture(&node, ch, moisture, quality);
+        zone_fast_control(&node, ch);
+    }
+    fast_sampling = false;
+    node_unlock();
+}
+
+static void control_task(void *pvParameters) {
+    const TickType_t period = pdMS_TO_TICKS(1000 / FAST_CONTROL_HZ);
+    while (true) {
+        if (!node_any_pump_on(&node)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        ESP_LOGI(TAG, "⚡ Control rápido a %d Hz", FAST_CONTROL_HZ);
+        TickType_t last_wake = xTaskGetTickCount();
+        uint32_t samples = 0;
+        while (node_any_pump_on(&node)) {
+            vTaskDelayUntil(&last_wake, period);
+            fast_control_step();
+            samples++;
+        }
+        invalidate_info_cache();
+        ESP_LOGI(TAG, "⚡ Bombas apagadas, fin del control rápido (%lu muestras)", (unsigned long)samples);
+    }
+}
+
+// Un ciclo de lectura y envío; late_us es cuánto se atrasó respecto de lo previsto
+static void sensor_cycle(uint32_t cycle, int64_t late_us) {
+    node_lock();
+    int configured = node_configured_zone_count(&node);
+    node_unlock();
+    // Solo enviar datos si hay al menos una zona configurada
+    if (configured > 0) {
+#if AGROMIND_NODE_ROLE == NODE_ROLE_LEAF
+        send_leaf_reading();
+#else
+        send_sensor_data(late_us);
+#endif
+#if AGROMIND_NODE_ROLE == NODE_ROLE_GATEWAY
+    } else if (upload_zone_count() > 0) {
+        // Gateway sin zonas propias: sube solo las de sus hojas
+        send_sensor_data(late_us);
+#endif
+    } else {
+        ESP_LOGI(TAG, "⏳ Esperando configuración desde la app...");
+        ESP_LOGI(TAG, "   La app puede conectarse a http://<mi-ip>/info");
+        // Sin zonas no hay subidas: basta con volver a tener red
+        if (wifi_connected) {
+            ota_update_confirm("WiFi conectado, sin zonas");
+        }
+    }
+
+    node_lock();
+    node_storage_flush_pump_meters(&node, false);
+    node_unlock();
+
+    if (cycle % HEAP_REPORT_INTERVAL_CYCLES == 0) {
+        heap_budget_report("periódico");
+        upload_session_report(&upload);
+    }
+}
+
 static void sensor_task(void *pvParameters) {
-    const TickType_t delay_ticks = pdMS_TO_TICKS(5000);  // 5 segundos entre envíos
-    
+    const TickType_t cycle_ticks = pdMS_TO_TICKS(SENSOR_CYCLE_MS);
+    const TickType_t poll_ticks = pdMS_TO_TICKS(UPLOAD_POLL_MS);
+    uint32_t cycle = 0;
+
+    const upload_limits_t limits = {
+        .connect_ms = UPLOAD_CONNECT_TIMEOUT_MS,
+        .send_ms = UPLOAD_SEND_TIMEOUT_MS,
+        .receive_ms = UPLOAD_RECEIVE_TIMEOUT_MS,
+        .budget_ms = UPLOAD_BUDGET_MS,
+    };
+    node_lock();
+    upload_session_init(&upload, &limits);
+    node_unlock();
+
+    // Primera lectura sin esperar a la red: WiFi sigue asociándose
+    boot_profile_begin(BOOT_PHASE_FIRST_SAMPLE);
+    sample_sensors();
+    boot_profile_end(BOOT_PHASE_FIRST_SAMPLE);
+    ESP_LOGI(TAG, "📷 Primera lectura lista (WiFi %s)", wifi_connected ? "conectado" : "asociándose");
+
+    // Los ciclos van cada SENSOR_CYCLE_MS aunque haya una subida en curso:
+    // entre ciclos se la avanza de a un paso cada UPLOAD_POLL_MS
+    TickType_t next_cycle = xTaskGetTickCount();
     while (true) {
-        // Solo enviar datos si hay zona configurada
-        if (current_zone_id > 0) {
-            send_sensor_data();
+        start_local_services();
+        TickType_t now = xTaskGetTickCount();
+        TickType_t late = now - next_cycle;
+        if (late < portMAX_DELAY / 2) {
+            next_cycle += cycle_ticks;
+            if ((TickType_t)(now - next_cycle) < portMAX_DELAY / 2) {
+                // Se perdió un ciclo entero: seguir desde ahora, sin ráfagas
+                next_cycle = now + cycle_ticks;
+            }
+            sensor_cycle(++cycle, (int64_t)late * portTICK_PERIOD_MS * 1000);
         } else {
-            ESP_LOGI(TAG, "⏳ Esperando configuración desde la app...");
-            ESP_LOGI(TAG, "   La app puede conectarse a http://<mi-ip>/info");
+            upload_poll();
+        }
+
+        TickType_t wait = next_cycle - xTaskGetTickCount();
+        if (wait >= portMAX_DELAY / 2) {
+            wait = 0;
+        } else if (upload_session_active(&upload) && wait > poll_ticks) {
+            wait = poll_ticks;
+        }
+        // GOT_IP lo despierta antes para subir en cuanto hay red
+        if (ulTaskNotifyTake(pdTRUE, wait) > 0) {
+            next_cycle = xTaskGetTickCount();
         }
-        
-        vTaskDelay(delay_ticks);
     }
 }
 
@@ -928,36 +2299,83 @@ extern "C" void app_main(void) {
     ESP_LOGI(TAG, "         ESP32 Sensor Node");
     ESP_LOGI(TAG, "========================================");
 
+    boot_profile_begin(BOOT_PHASE_NVS);
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_profile_end(BOOT_PHASE_NVS);
+
+    boot_profile_begin(BOOT_PHASE_CONFIG);
+    memory_budget_init();
+    ota_update_init();
     
     // Cargar configuración guardada
+    node_hooks_t hooks = {};
+    hooks.set_relay = relay_hook;
+    hooks.zone_released = zone_released_hook;
+    hooks.soil_model_updated = soil_model_hook;
+    hooks.rule_updated = rule_hook;
+    node_state_init(&node, ZONE_CHANNEL_COUNT, &hooks);
+    node.pump_flow_lph = PUMP_FLOW_LPH;
+    init_sensor_filters();
+#if AGROMIND_STATIC_MEMORY
+    static StaticSemaphore_t node_mutex_buffer;
+    node_mutex = xSemaphoreCreateRecursiveMutexStatic(&node_mutex_buffer);
+    static StaticSemaphore_t echo_mutex_buffer;
+    echo_mutex = xSemaphoreCreateMutexStatic(&echo_mutex_buffer);
+#else
+    node_mutex = xSemaphoreCreateRecursiveMutex();
+    echo_mutex = xSemaphoreCreateMutex();
+#endif
     load_config_from_nvs();
+    load_calibration_from_nvs();
     
     ESP_LOGI(TAG, "📋 Configuración:");
-    ESP_LOGI(TAG, "   Zone ID: %ld %s", current_zone_id, 
-             current_zone_id > 0 ? "(configurado)" : "(pendiente)");
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        ESP_LOGI(TAG, "   Canal %d -> Zone ID: %ld %s", ch, node.zones[ch].zone_id,
+                 node.zones[ch].zone_id > 0 ? "(configurado)" : "(pendiente)");
+    }
     ESP_LOGI(TAG, "   WiFi: %s", WIFI_SSID);
+    boot_profile_end(BOOT_PHASE_CONFIG);
 
-    // IMPORTANTE: Poner el GPIO del relé en HIGH ANTES de configurarlo
+    boot_profile_begin(BOOT_PHASE_RELAYS);
+    // IMPORTANTE: Poner el GPIO de cada relé en HIGH ANTES de configurarlo
     // para evitar que el relé se active durante el boot (relé active-low)
-    gpio_reset_pin(RELAY_PIN);
-    gpio_set_level(RELAY_PIN, 1);
+    uint64_t relay_mask = 0;
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        gpio_num_t relay_pin = ZONE_CHANNEL_PINS[ch].relay_pin;
+        gpio_reset_pin(relay_pin);
+        gpio_set_level(relay_pin, 1);
+        relay_mask |= (1ULL << relay_pin);
+    }
 
-    // Configurar RELAY_PIN por separado con pull-up para mantenerlo HIGH durante boot
+    // Configurar los relés por separado con pull-up para mantenerlos HIGH durante boot
     gpio_config_t relay_conf = {};
     relay_conf.intr_type = GPIO_INTR_DISABLE;
     relay_conf.mode = GPIO_MODE_OUTPUT;
-    relay_conf.pin_bit_mask = (1ULL << RELAY_PIN);
+    relay_conf.pin_bit_mask = relay_mask;
     relay_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
     relay_conf.pull_up_en = GPIO_PULLUP_ENABLE;  // Pull-up para mantener HIGH
     ESP_ERROR_CHECK(gpio_config(&relay_conf));
-    gpio_set_level(RELAY_PIN, 1);  // Asegurar que está en HIGH
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        gpio_set_level(ZONE_CHANNEL_PINS[ch].relay_pin, 1);  // Asegurar que está en HIGH
+    }
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        set_pump_state(ch, false);
+    }
+    boot_profile_end(BOOT_PHASE_RELAYS);
+
+    // La asociación WiFi y el DHCP tardan segundos y corren en la tarea de
+    // WiFi: se arrancan ya y el resto del hardware se configura mientras
+    // tanto. sensor_task toma la primera lectura sin esperar la IP.
+    boot_profile_begin(BOOT_PHASE_WIFI_INIT);
+    wifi_init();
+    boot_profile_end(BOOT_PHASE_WIFI_INIT);
 
+    boot_profile_begin(BOOT_PHASE_PERIPHERALS);
     // Configurar TRIG_PIN
     gpio_config_t io_conf = {};
     io_conf.intr_type = GPIO_INTR_DISABLE;
@@ -982,8 +2400,6 @@ extern "C" void app_main(void) {
     ESP_ERROR_CHECK(gpio_config(&dht_conf));
     gpio_set_level(DHT_PIN, 1);
 
-    set_pump_state(false);
-
     adc_oneshot_unit_init_cfg_t init_config1 = {
         .unit_id = ADC_UNIT_1,
         .ulp_mode = ADC_ULP_MODE_DISABLE,
@@ -994,7 +2410,9 @@ extern "C" void app_main(void) {
         .atten = ADC_ATTEN_DB_12,
         .bitwidth = ADC_BITWIDTH_12,
     };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, SOIL_MOISTURE_ADC_CHANNEL, &chan_config));
+    for (int ch = 0; ch < ZONE_CHANNEL_COUNT; ++ch) {
+        ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ZONE_CHANNEL_PINS[ch].soil_channel, &chan_config));
+    }
     ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, LDR_ADC_CHANNEL, &chan_config));
 
     adc_cali_line_fitting_config_t cali_config = {
@@ -1008,9 +2426,32 @@ extern "C" void app_main(void) {
     } else {
         ESP_LOGW(TAG, "No se pudo calibrar ADC, se usará valor bruto");
     }
+    boot_profile_end(BOOT_PHASE_PERIPHERALS);
 
-    wifi_init();
+    boot_profile_begin(BOOT_PHASE_TASKS);
+#if AGROMIND_NODE_ROLE != NODE_ROLE_STANDALONE
+    espnow_init();
+#endif
+    ota_update_start_task(can_reboot_for_update);
+
+    heap_budget_report("arranque");
 
     ESP_LOGI(TAG, "Sistema listo, iniciando tarea de sensores");
-    xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 5, NULL);
+#if AGROMIND_STATIC_MEMORY
+    // Prioridad sobre sensor_task: una subida lenta no retrasa el apagado
+    static StackType_t control_task_stack[CONTROL_TASK_STACK_SIZE];
+    static StaticTask_t control_task_tcb;
+    control_task_handle = xTaskCreateStatic(control_task, "control_task", CONTROL_TASK_STACK_SIZE,
+                                            NULL, 6, control_task_stack, &control_task_tcb);
+    static StackType_t sensor_task_stack[SENSOR_TASK_STACK_SIZE];
+    static StaticTask_t sensor_task_tcb;
+    sensor_task_handle = xTaskCreateStatic(sensor_task, "sensor_task", SENSOR_TASK_STACK_SIZE,
+                                           NULL, 5, sensor_task_stack, &sensor_task_tcb);
+    json_arena_set_owner(sensor_task_handle);
+#else
+    // Prioridad sobre sensor_task: una subida lenta no retrasa el apagado
+    xTaskCreate(control_task, "control_task", CONTROL_TASK_STACK_SIZE, NULL, 6, &control_task_handle);
+    xTaskCreate(sensor_task, "sensor_task", SENSOR_TASK_STACK_SIZE, NULL, 5, &sensor_task_handle);
+#endif
+    boot_profile_end(BOOT_PHASE_TASKS);
 }
@@ -0,0 +1,135 @@
+/*
+ * AgroMind - Presupuesto de memoria (ver memory_budget.h)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "cJSON.h"
+
+#include "config.h"
+#include "memory_budget.h"
+
+static const char *TAG = "MEMORIA";
+
+static const char *const SUBSYSTEM_NAMES[HEAP_SUBSYS_COUNT] = {
+    "json",
+    "http_client",
+    "local_server",
+};
+
+static size_t subsystem_peak_bytes[HEAP_SUBSYS_COUNT];
+static size_t free_at_boot = 0;
+
+// ==================== ARENA JSON ====================
+
+#if AGROMIND_STATIC_MEMORY
+
+static uint8_t json_arena[JSON_ARENA_SIZE] __attribute__((aligned(8)));
+static size_t json_arena_used = 0;
+static size_t json_arena_peak = 0;
+static uint32_t json_arena_overflows = 0;
+static TaskHandle_t json_arena_owner = NULL;
+
+static bool is_arena_pointer(const void *ptr) {
+    const uint8_t *p = (const uint8_t *)ptr;
+    return p >= json_arena && p < json_arena + sizeof(json_arena);
+}
+
+static void *json_arena_malloc(size_t size) {
+    if (xTaskGetCurrentTaskHandle() == json_arena_owner) {
+        size_t aligned = (size + 7U) & ~(size_t)7U;
+        if (json_arena_used + aligned <= sizeof(json_arena)) {
+            void *ptr = json_arena + json_arena_used;
+            json_arena_used += aligned;
+            if (json_arena_used > json_arena_peak) {
+                json_arena_peak = json_arena_used;
+            }
+            return ptr;
+        }
+        // Sin espacio: se usa el heap para no perder el ciclo, y se reporta
+        json_arena_overflows++;
+    }
+    return malloc(size);
+}
+
+static void json_arena_free(void *ptr) {
+    if (ptr == NULL || is_arena_pointer(ptr)) {
+        return;  // la arena se libera en bloque con json_arena_reset()
+    }
+    free(ptr);
+}
+
+void json_arena_reset(void) {
+    if (xTaskGetCurrentTaskHandle() == json_arena_owner) {
+        json_arena_used = 0;
+    }
+}
+
+void json_arena_set_owner(void *task_handle) {
+    json_arena_owner = (TaskHandle_t)task_handle;
+    json_arena_used = 0;
+}
+
+#else
+
+void json_arena_reset(void) {
+}
+
+void json_arena_set_owner(void *task_handle) {
+    (void)task_handle;
+}
+
+#endif
+
+void memory_budget_init(void) {
+    free_at_boot = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    memset(subsystem_peak_bytes, 0, sizeof(subsystem_peak_bytes));
+
+#if AGROMIND_STATIC_MEMORY
+    json_arena_owner = xTaskGetCurrentTaskHandle();
+    cJSON_Hooks hooks = {};
+    hooks.malloc_fn = json_arena_malloc;
+    hooks.free_fn = json_arena_free;
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "Modo memoria estática: arena JSON de %u bytes", (unsigned)sizeof(json_arena));
+#endif
+}
+
+// ==================== PRESUPUESTO DE HEAP ====================
+
+heap_probe_t heap_budget_begin(void) {
+    heap_probe_t probe;
+    probe.free_at_start = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    return probe;
+}
+
+void heap_budget_sample(heap_subsystem_t subsystem, const heap_probe_t *probe) {
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (free_now >= probe->free_at_start) {
+        return;
+    }
+    size_t used = probe->free_at_start - free_now;
+    if (used > subsystem_peak_bytes[subsystem]) {
+        subsystem_peak_bytes[subsystem] = used;
+    }
+}
+
+void heap_budget_report(const char *when) {
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    ESP_LOGI(TAG, "📊 Heap (%s): libre %u | mínimo histórico %u | bloque mayor %u | arranque %u",
+             when, (unsigned)free_now, (unsigned)min_free, (unsigned)largest, (unsigned)free_at_boot);
+    for (int i = 0; i < HEAP_SUBSYS_COUNT; ++i) {
+        ESP_LOGI(TAG, "   %-13s peor caso %u bytes", SUBSYSTEM_NAMES[i], (unsigned)subsystem_peak_bytes[i]);
+    }
+#if AGROMIND_STATIC_MEMORY
+    ESP_LOGI(TAG, "   arena json    pico %u / %u bytes | desbordes %lu",
+             (unsigned)json_arena_peak, (unsigned)sizeof(json_arena), (unsigned long)json_arena_overflows);
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+ * AgroMind - Presupuesto de memoria
+ *
+ * - Arena fija para cJSON (AGROMIND_STATIC_MEMORY): los objetos JSON de la
+ *   tarea dueña se reservan en un buffer estático que se reinicia en cada
+ *   ciclo, así el heap no se fragmenta con semanas de uso. Las demás tareas
+ *   (servidor local) siguen usando malloc/free.
+ * - Reporte de heap: consumo máximo observado por subsistema, mínimo libre
+ *   histórico y bloque libre más grande (indicador de fragmentación).
+ */
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef AGROMIND_STATIC_MEMORY
+#define AGROMIND_STATIC_MEMORY 0
+#endif
+
+#ifndef JSON_ARENA_SIZE
+#define JSON_ARENA_SIZE (12 * 1024)
+#endif
+
+typedef enum {
+    HEAP_SUBSYS_JSON = 0,       // construcción/parseo de JSON del ciclo de envío
+    HEAP_SUBSYS_HTTP_CLIENT,    // esp_http_client + TLS
+    HEAP_SUBSYS_LOCAL_SERVER,   // handlers del servidor local
+    HEAP_SUBSYS_COUNT
+} heap_subsystem_t;
+
+typedef struct {
+    size_t free_at_start;
+} heap_probe_t;
+
+// Instala los hooks de cJSON (solo en modo estático). La tarea que llama
+// queda como dueña de la arena.
+void memory_budget_init(void);
+
+// Descarta todo lo reservado en la arena. Solo desde la tarea dueña, al
+// inicio de cada ciclo, cuando ya no quedan objetos cJSON vivos.
+void json_arena_reset(void);
+
+// Cambia la tarea dueña de la arena (p.ej. al crear sensor_task)
+void json_arena_set_owner(void *task_handle);
+
+heap_probe_t heap_budget_begin(void);
+void heap_budget_sample(heap_subsystem_t subsystem, const heap_probe_t *probe);
+
+// Imprime el reporte completo en el log
+void heap_budget_report(const char *when);
+
+#endif // MEMORY_BUDGET_H
@@ -0,0 +1,152 @@
+/*
+ * AgroMind - Persistencia por canal en NVS (ver node_storage.h)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "node_storage.h"
+
+static const char *TAG = "NVS";
+
+void node_storage_load_channel(nvs_handle_t nvs, node_state_t *node, int channel) {
+    char key[16];
+
+    // Lo aprendido del suelo sobrevive a los reinicios
+    snprintf(key, sizeof(key), NVS_KEY_SOIL_MODEL_FMT, channel);
+    soil_model_params_t params = {};
+    size_t length = sizeof(params);
+    if (nvs_get_blob(nvs, key, &params, &length) == ESP_OK && length == sizeof(params) &&
+        soil_model_import(&node->zones[channel].soil, &params)) {
+        ESP_LOGI(TAG, "📦 NVS: canal %d modelo suelo +%.3f%%/s -%.2f%%/h (%u riegos)", channel,
+                 params.gain_per_s, params.dry_per_hour, (unsigned)params.gain_samples);
+    }
+
+    // Contadores de riego
+    snprintf(key, sizeof(key), NVS_KEY_PUMP_METER_FMT, channel);
+    pump_meter_blob_t blob = {};
+    length = sizeof(blob);
+    if (nvs_get_blob(nvs, key, &blob, &length) == ESP_OK && length == sizeof(blob) &&
+        blob.version == PUMP_METER_BLOB_VERSION) {
+        pump_meter_t *meter = &node->zones[channel].meter;
+        meter->total_runtime_us = blob.total_runtime_us;
+        meter->sessions = blob.sessions;
+        meter->last_session_us = blob.last_session_us;
+        ESP_LOGI(TAG, "📦 NVS: canal %d %lu riegos, %.1f L", channel,
+                 (unsigned long)blob.sessions, zone_pump_liters(node, channel));
+    }
+
+    // La regla se vuelve a verificar: pudo guardarla otra versión del firmware
+    snprintf(key, sizeof(key), NVS_KEY_RULE_FMT, channel);
+    uint8_t code[RULE_MAX_CODE];
+    length = sizeof(code);
+    if (nvs_get_blob(nvs, key, code, &length) == ESP_OK) {
+        rule_verify_t result = rule_program_load(&node->zones[channel].rule, code, length);
+        if (result == RULE_VERIFY_OK) {
+            ESP_LOGI(TAG, "📦 NVS: canal %d regla de %u bytes", channel, (unsigned)length);
+        } else {
+            ESP_LOGW(TAG, "📦 NVS: canal %d regla descartada (%s)", channel, rule_verify_name(result));
+        }
+    }
+}
+
+void node_storage_save_soil_model(const node_state_t *node, int channel) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_SOIL_MODEL_FMT, channel);
+    const soil_model_params_t *params = &node->zones[channel].soil.params;
+    if (nvs_set_blob(nvs, key, params, sizeof(*params)) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+void node_storage_save_rule(const node_state_t *node, int channel) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_RULE_FMT, channel);
+    const rule_program_t *rule = &node->zones[channel].rule;
+    err = rule->length > 0 ? nvs_set_blob(nvs, key, rule->code, rule->length) : nvs_erase_key(nvs, key);
+    if (err == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+// Cada riego no gasta un ciclo de borrado de la flash. Si se corta la luz
+// se pierden los riegos del último intervalo, nunca los anteriores.
+void node_storage_flush_pump_meters(node_state_t *node, bool force) {
+    int64_t now_us = esp_timer_get_time();
+    if (!force && now_us - node->meters_flushed_us < (int64_t)PUMP_METER_FLUSH_INTERVAL_S * 1000000) {
+        return;
+    }
+
+    bool any_dirty = false;
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        any_dirty = any_dirty || node->zones[ch].meter.dirty;
+    }
+    if (!any_dirty) {
+        return;
+    }
+    node->meters_flushed_us = now_us;
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error abriendo NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        pump_meter_t *meter = &node->zones[ch].meter;
+        if (!meter->dirty) {
+            continue;
+        }
+        pump_meter_blob_t blob = {};
+        blob.version = PUMP_METER_BLOB_VERSION;
+        blob.total_runtime_us = meter->total_runtime_us;
+        blob.sessions = meter->sessions;
+        blob.last_session_us = meter->last_session_us;
+
+        char key[16];
+        snprintf(key, sizeof(key), NVS_KEY_PUMP_METER_FMT, ch);
+        if (nvs_set_blob(nvs, key, &blob, sizeof(blob)) == ESP_OK) {
+            meter->dirty = false;
+        }
+    }
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+void node_storage_forget_channel(nvs_handle_t nvs, node_state_t *node, int channel) {
+    char key[16];
+    snprintf(key, sizeof(key), NVS_KEY_SOIL_MODEL_FMT, channel);
+    nvs_erase_key(nvs, key);
+    soil_model_reset(&node->zones[channel].soil);
+    // Un cambio de la API local y la regla eran de la zona anterior
+    node->zones[channel].config_pending = false;
+    snprintf(key, sizeof(key), NVS_KEY_RULE_FMT, channel);
+    nvs_erase_key(nvs, key);
+    node->zones[channel].rule.length = 0;
+    node->zones[channel].rule_blocked = false;
+
+    // Un riego en curso sigue contando para la zona nueva
+    snprintf(key, sizeof(key), NVS_KEY_PUMP_METER_FMT, channel);
+    nvs_erase_key(nvs, key);
+    pump_meter_t *meter = &node->zones[channel].meter;
+    int64_t on_since_us = meter->on_since_us;
+    memset(meter, 0, sizeof(*meter));
+    meter->on_since_us = on_since_us;
+}
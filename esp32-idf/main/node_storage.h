@@ -0,0 +1,53 @@
+/*
+ * AgroMind - Persistencia por canal en NVS
+ *
+ * Lo que cada canal acumula con el uso: el modelo del suelo (soil_model.h)
+ * y los contadores de riego (pump_meter_t); y la regla de riego de su zona
+ * (rule_vm.h), que solo se escribe cuando el servidor manda otra. Vive fuera de main.cpp para que
+ * el arnés de soak del host (host/tools/soak_sim) ejecute la misma política
+ * de escrituras contra un NVS simulado que cuenta cada escritura.
+ *
+ * Los contadores se escriben agrupados: como mucho una vez cada
+ * PUMP_METER_FLUSH_INTERVAL_S (y forzado antes de un reinicio), no en cada
+ * riego. El modelo del suelo se guarda cuando aprende algo (como mucho una
+ * vez por riego o por ventana de secado de una hora).
+ */
+
+#ifndef NODE_STORAGE_H
+#define NODE_STORAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nvs.h"
+#include "zone_control.h"
+
+#define NVS_NAMESPACE "agromind"
+#define NVS_KEY_SOIL_MODEL_FMT "soil_%d"    // blob soil_model_params_t de un canal
+#define NVS_KEY_PUMP_METER_FMT "pump_%d"    // blob pump_meter_blob_t de un canal
+#define NVS_KEY_RULE_FMT "rule_%d"          // bytecode de la regla de un canal
+
+#define PUMP_METER_FLUSH_INTERVAL_S 600
+#define PUMP_METER_BLOB_VERSION 1
+
+// Lo que se persiste de pump_meter_t (el riego en curso no)
+typedef struct {
+    uint8_t version;
+    uint64_t total_runtime_us;
+    uint32_t sessions;
+    uint32_t last_session_us;
+} pump_meter_blob_t;
+
+// Carga el modelo del suelo, los contadores y la regla guardados de un canal
+void node_storage_load_channel(nvs_handle_t nvs, node_state_t *node, int channel);
+
+void node_storage_save_soil_model(const node_state_t *node, int channel);
+// Sin regla borra la clave
+void node_storage_save_rule(const node_state_t *node, int channel);
+
+// Guarda los contadores que cambiaron. Sin force respeta el intervalo
+void node_storage_flush_pump_meters(node_state_t *node, bool force);
+
+// Otra zona (u otra maceta) en el canal: lo aprendido y lo regado ya no aplican
+void node_storage_forget_channel(nvs_handle_t nvs, node_state_t *node, int channel);
+
+#endif // NODE_STORAGE_H
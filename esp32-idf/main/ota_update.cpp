@@ -0,0 +1,636 @@
+/*
+ * AgroMind - Actualización OTA (ver ota_update.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_app_desc.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "nvs.h"
+#include "mbedtls/sha256.h"
+#include "cJSON.h"
+
+#include "config.h"
+#include "delta_patch.h"
+#include "memory_budget.h"
+#include "ota_update.h"
+
+#ifdef OTA_MANIFEST_URL
+#define OTA_ENABLED 1
+#else
+#define OTA_ENABLED 0
+#define OTA_MANIFEST_URL ""
+#endif
+
+#ifndef OTA_CHECK_INTERVAL_S
+#define OTA_CHECK_INTERVAL_S (6 * 3600)
+#endif
+
+#ifndef OTA_VERIFY_TIMEOUT_S
+#define OTA_VERIFY_TIMEOUT_S 300      // tiempo para la primera subida tras actualizar
+#endif
+
+#define OTA_SECTOR_SIZE 4096
+#define OTA_CHECKPOINT_BYTES (64 * 1024)
+#define OTA_MAX_ATTEMPTS 6
+#define OTA_RETRY_BASE_MS 2000
+#define OTA_HTTP_TIMEOUT_MS 15000
+#define OTA_MANIFEST_MAX 2048
+#define OTA_URL_MAX 192
+#define OTA_VERSION_MAX 32
+#define OTA_TASK_STACK_SIZE 8192
+
+#define OTA_NVS_NAMESPACE "agromind"
+#define OTA_NVS_KEY_CHECKPOINT "ota_ckpt"
+#define OTA_CHECKPOINT_MAGIC 0x4F544131u  // "OTA1"
+
+static const char *TAG = "OTA";
+
+typedef struct {
+    char version[OTA_VERSION_MAX];
+    uint8_t sha256[DELTA_HASH_SIZE];     // imagen destino
+    uint32_t size;
+    char image_url[OTA_URL_MAX];
+    char patch_url[OTA_URL_MAX];         // vacío = no hay parche para esta versión
+    uint32_t patch_size;
+} ota_manifest_t;
+
+// Progreso persistido en NVS para reanudar la descarga
+typedef struct {
+    uint32_t magic;
+    uint8_t target_sha256[DELTA_HASH_SIZE];
+    uint32_t partition_address;
+    uint8_t is_delta;
+    uint8_t source_verified;
+    uint32_t download_offset;            // bytes del archivo ya procesados (Range)
+    uint32_t image_written;              // bytes escritos en la partición (múltiplo de sector)
+    delta_state_t delta;
+} ota_checkpoint_t;
+
+typedef struct {
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+    mbedtls_sha256_context sha;
+    uint8_t sector[OTA_SECTOR_SIZE];
+    size_t sector_fill;
+    ota_checkpoint_t checkpoint;
+    uint32_t last_checkpoint;
+} ota_session_t;
+
+static bool pending_verify = false;
+static int64_t verify_deadline_us = 0;
+static bool (*reboot_allowed)(void) = NULL;
+
+// ==================== UTILIDADES ====================
+
+static bool parse_sha256_hex(const char *hex, uint8_t out[DELTA_HASH_SIZE]) {
+    if (hex == NULL || strlen(hex) != DELTA_HASH_SIZE * 2) {
+        return false;
+    }
+    for (int i = 0; i < DELTA_HASH_SIZE; ++i) {
+        char byte[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+        char *end = NULL;
+        out[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (end != byte + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void copy_json_string(const cJSON *object, const char *name, char *out, size_t out_len) {
+    const char *value = cJSON_GetStringValue(cJSON_GetObjectItem(object, name));
+    snprintf(out, out_len, "%s", value != NULL ? value : "");
+}
+
+// SHA-256 de los primeros "length" bytes de una partición
+static esp_err_t hash_partition(const esp_partition_t *partition, uint32_t length,
+                                mbedtls_sha256_context *sha) {
+    static uint8_t buffer[1024];
+    for (uint32_t offset = 0; offset < length; offset += sizeof(buffer)) {
+        uint32_t chunk = length - offset < sizeof(buffer) ? length - offset : sizeof(buffer);
+        esp_err_t err = esp_partition_read(partition, offset, buffer, chunk);
+        if (err != ESP_OK) {
+            return err;
+        }
+        mbedtls_sha256_update(sha, buffer, chunk);
+    }
+    return ESP_OK;
+}
+
+static int read_running_image(void *ctx, uint32_t offset, uint8_t *buffer, size_t len) {
+    const esp_partition_t *running = (const esp_partition_t *)ctx;
+    return esp_partition_read(running, offset, buffer, len) == ESP_OK ? 0 : -1;
+}
+
+// ==================== CHECKPOINT EN NVS ====================
+
+static bool load_checkpoint(ota_checkpoint_t *checkpoint) {
+    nvs_handle_t nvs;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    size_t length = sizeof(*checkpoint);
+    esp_err_t err = nvs_get_blob(nvs, OTA_NVS_KEY_CHECKPOINT, checkpoint, &length);
+    nvs_close(nvs);
+    return err == ESP_OK && length == sizeof(*checkpoint) && checkpoint->magic == OTA_CHECKPOINT_MAGIC;
+}
+
+static void save_checkpoint(const ota_checkpoint_t *checkpoint) {
+    nvs_handle_t nvs;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (checkpoint != NULL) {
+        nvs_set_blob(nvs, OTA_NVS_KEY_CHECKPOINT, checkpoint, sizeof(*checkpoint));
+    } else {
+        nvs_erase_key(nvs, OTA_NVS_KEY_CHECKPOINT);
+    }
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+// ==================== MANIFIESTO ====================
+
+static bool fetch_manifest(ota_manifest_t *manifest, const char *running_version) {
+    esp_http_client_config_t config = {};
+    config.url = OTA_MANIFEST_URL;
+    config.timeout_ms = OTA_HTTP_TIMEOUT_MS;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+
+    char *body = (char *)calloc(1, OTA_MANIFEST_MAX);
+    bool ok = false;
+    if (body != NULL && esp_http_client_open(client, 0) == ESP_OK) {
+        esp_http_client_fetch_headers(client);
+        int status = esp_http_client_get_status_code(client);
+        int length = 0;
+        int n;
+        while (length < OTA_MANIFEST_MAX - 1 &&
+               (n = esp_http_client_read(client, body + length, OTA_MANIFEST_MAX - 1 - length)) > 0) {
+            length += n;
+        }
+        ok = status == 200 && length > 0;
+        if (!ok) {
+            ESP_LOGW(TAG, "Manifiesto no disponible (HTTP %d)", status);
+        }
+    } else {
+        ESP_LOGW(TAG, "No se pudo conectar a %s", OTA_MANIFEST_URL);
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+
+    if (!ok) {
+        free(body);
+        return false;
+    }
+
+    // { version, url, size, sha256, patches: [{ fromVersion, url, size }] }
+    memset(manifest, 0, sizeof(*manifest));
+    cJSON *root = cJSON_Parse(body);
+    free(body);
+    if (root == NULL) {
+        ESP_LOGW(TAG, "Manifiesto inválido");
+        return false;
+    }
+    copy_json_string(root, "version", manifest->version, sizeof(manifest->version));
+    copy_json_string(root, "url", manifest->image_url, sizeof(manifest->image_url));
+    cJSON *size = cJSON_GetObjectItem(root, "size");
+    manifest->size = cJSON_IsNumber(size) ? (uint32_t)cJSON_GetNumberValue(size) : 0;
+    ok = manifest->version[0] != '\0' && manifest->image_url[0] != '\0' &&
+         parse_sha256_hex(cJSON_GetStringValue(cJSON_GetObjectItem(root, "sha256")), manifest->sha256);
+
+    cJSON *patch = NULL;
+    cJSON_ArrayForEach(patch, cJSON_GetObjectItem(root, "patches")) {
+        const char *from = cJSON_GetStringValue(cJSON_GetObjectItem(patch, "fromVersion"));
+        if (from != NULL && strcmp(from, running_version) == 0) {
+            copy_json_string(patch, "url", manifest->patch_url, sizeof(manifest->patch_url));
+            cJSON *patch_size = cJSON_GetObjectItem(patch, "size");
+            manifest->patch_size = cJSON_IsNumber(patch_size) ? (uint32_t)cJSON_GetNumberValue(patch_size) : 0;
+            break;
+        }
+    }
+    cJSON_Delete(root);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Manifiesto incompleto (version/url/sha256)");
+    }
+    return ok;
+}
+
+// ==================== ESCRITURA DE LA IMAGEN ====================
+
+static esp_err_t flush_sector(ota_session_t *session) {
+    if (session->sector_fill == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_ota_write(session->handle, session->sector, session->sector_fill);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mbedtls_sha256_update(&session->sha, session->sector, session->sector_fill);
+    session->checkpoint.image_written += (uint32_t)session->sector_fill;
+    session->sector_fill = 0;
+
+    // Solo en límites de sector: esp_ota_resume retoma desde ahí
+    ota_checkpoint_t *checkpoint = &session->checkpoint;
+    if (checkpoint->image_written % OTA_SECTOR_SIZE == 0 &&
+        checkpoint->image_written - session->last_checkpoint >= OTA_CHECKPOINT_BYTES) {
+        if (!checkpoint->is_delta) {
+            checkpoint->download_offset = checkpoint->image_written;
+        } else {
+            checkpoint->download_offset = checkpoint->delta.patch_consumed;
+        }
+        save_checkpoint(checkpoint);
+        session->last_checkpoint = checkpoint->image_written;
+    }
+    return ESP_OK;
+}
+
+// Procesa un bloque descargado. Devuelve ESP_ERR_INVALID_CRC si la imagen
+// origen no coincide con la del parche (hay que usar la imagen completa).
+// En modo delta sigue llamando al aplicador con la entrada ya agotada: un
+// COPY produce su salida aunque no llegue nada más (length = 0 solo drena).
+static esp_err_t process_chunk(ota_session_t *session, const uint8_t *data, size_t length, bool *done) {
+    ota_checkpoint_t *checkpoint = &session->checkpoint;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+
+    while (!*done && (length > 0 || checkpoint->is_delta)) {
+        size_t room = OTA_SECTOR_SIZE - session->sector_fill;
+        size_t consumed = 0;
+        size_t produced = 0;
+
+        if (checkpoint->is_delta) {
+            delta_result_t result = delta_apply_step(&checkpoint->delta, data, length, &consumed,
+                                                     session->sector + session->sector_fill, room, &produced,
+                                                     read_running_image, (void *)running);
+            if (result != DELTA_OK && result != DELTA_DONE) {
+                ESP_LOGE(TAG, "Parche inválido: %s", delta_result_name(result));
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+
+            // Apenas llega la cabecera: el parche debe partir de la imagen que corre
+            if (!checkpoint->source_verified && checkpoint->delta.phase != DELTA_PHASE_HEADER) {
+                const delta_header_t *header = &checkpoint->delta.header;
+                uint8_t digest[DELTA_HASH_SIZE];
+                mbedtls_sha256_context source_sha;
+                mbedtls_sha256_init(&source_sha);
+                mbedtls_sha256_starts(&source_sha, 0);
+                esp_err_t err = header->source_size <= running->size
+                                    ? hash_partition(running, header->source_size, &source_sha)
+                                    : ESP_ERR_INVALID_SIZE;
+                mbedtls_sha256_finish(&source_sha, digest);
+                mbedtls_sha256_free(&source_sha);
+                if (err != ESP_OK || memcmp(digest, header->source_sha256, DELTA_HASH_SIZE) != 0 ||
+                    memcmp(header->target_sha256, checkpoint->target_sha256, DELTA_HASH_SIZE) != 0) {
+                    ESP_LOGW(TAG, "El parche no corresponde a la imagen actual");
+                    return ESP_ERR_INVALID_CRC;
+                }
+                checkpoint->source_verified = 1;
+            }
+            *done = result == DELTA_DONE;
+        } else {
+            consumed = length < room ? length : room;
+            memcpy(session->sector + session->sector_fill, data, consumed);
+            produced = consumed;
+        }
+
+        session->sector_fill += produced;
+        data += consumed;
+        length -= consumed;
+
+        if (session->sector_fill == OTA_SECTOR_SIZE || *done) {
+            esp_err_t err = flush_sector(session);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "esp_ota_write falló: %s", esp_err_to_name(err));
+                return err;
+            }
+        }
+        if (consumed == 0 && produced == 0 && !*done) {
+            break;  // el aplicador espera más datos
+        }
+    }
+    return ESP_OK;
+}
+
+static uint8_t download_buffer[2048];
+
+// Parche descargado entero: lo que falte del último COPY sale de la imagen
+// que corre. Si aun así no llega a DONE, el parche está truncado.
+static esp_err_t finish_delta(ota_session_t *session, bool *done) {
+    esp_err_t err = process_chunk(session, download_buffer, 0, done);
+    if (err == ESP_OK && !*done) {
+        ESP_LOGE(TAG, "Parche incompleto: %lu de %lu bytes escritos",
+                 (unsigned long)(session->checkpoint.image_written + session->sector_fill),
+                 (unsigned long)session->checkpoint.delta.header.target_size);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    return err;
+}
+
+// Una pasada de descarga desde download_offset. ESP_OK = archivo completo.
+static esp_err_t download_pass(ota_session_t *session, const char *url, uint32_t file_size, bool *done) {
+    ota_checkpoint_t *checkpoint = &session->checkpoint;
+    // Lo pendiente en el buffer de sector ya se descargó
+    uint32_t offset = checkpoint->is_delta ? checkpoint->delta.patch_consumed
+                                           : checkpoint->image_written + (uint32_t)session->sector_fill;
+    if (checkpoint->is_delta && file_size > 0 && offset >= file_size) {
+        // El checkpoint ya consumió todo el parche: un Range desde el final
+        // daría 416
+        return finish_delta(session, done);
+    }
+
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.timeout_ms = OTA_HTTP_TIMEOUT_MS;
+    config.buffer_size = 2048;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+
+    char range[32];
+    if (offset > 0) {
+        snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)offset);
+        esp_http_client_set_header(client, "Range", range);
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK) {
+        esp_http_client_fetch_headers(client);
+        int status = esp_http_client_get_status_code(client);
+        if (offset > 0 && status == 200) {
+            // El servidor ignoró Range: no se puede reanudar
+            ESP_LOGW(TAG, "El servidor no soporta Range, reiniciando descarga");
+            err = ESP_ERR_NOT_SUPPORTED;
+        } else if (status != 200 && status != 206) {
+            ESP_LOGW(TAG, "Descarga HTTP %d", status);
+            err = ESP_FAIL;
+        }
+    }
+
+    uint8_t *buffer = download_buffer;
+    int64_t last_log_us = 0;
+    while (err == ESP_OK && !*done) {
+        int n = esp_http_client_read(client, (char *)buffer, sizeof(download_buffer));
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (n == 0) {
+            // Fin del cuerpo: en imagen completa termina al llegar al tamaño
+            if (!checkpoint->is_delta && checkpoint->image_written + session->sector_fill >= file_size) {
+                *done = true;
+                err = flush_sector(session);
+            } else if (!esp_http_client_is_complete_data_received(client)) {
+                err = ESP_ERR_TIMEOUT;   // conexión cortada: se reanuda con Range
+            } else if (checkpoint->is_delta) {
+                err = finish_delta(session, done);
+            } else {
+                err = ESP_ERR_INVALID_SIZE;
+            }
+            break;
+        }
+        err = process_chunk(session, buffer, (size_t)n, done);
+
+        int64_t now = esp_timer_get_time();
+        if (now - last_log_us > 5000000) {
+            last_log_us = now;
+            ESP_LOGI(TAG, "⬇️ %lu bytes escritos", (unsigned long)checkpoint->image_written);
+        }
+    }
+
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+// ==================== SESIÓN DE ACTUALIZACIÓN ====================
+
+static esp_err_t begin_session(ota_session_t *session, const ota_manifest_t *manifest, bool use_delta) {
+    memset(session, 0, sizeof(*session));
+    session->partition = esp_ota_get_next_update_partition(NULL);
+    if (session->partition == NULL) {
+        ESP_LOGE(TAG, "Sin partición OTA libre (¿tabla de particiones de una sola app?)");
+        return ESP_ERR_NOT_FOUND;
+    }
+    mbedtls_sha256_init(&session->sha);
+    mbedtls_sha256_starts(&session->sha, 0);
+
+    ota_checkpoint_t saved;
+    bool resume = load_checkpoint(&saved) &&
+                  memcmp(saved.target_sha256, manifest->sha256, DELTA_HASH_SIZE) == 0 &&
+                  saved.partition_address == session->partition->address &&
+                  saved.is_delta == (use_delta ? 1 : 0) &&
+                  saved.image_written > 0;
+
+    if (resume) {
+        // Lo ya escrito vuelve a pasar por el hash de destino
+        esp_err_t err = hash_partition(session->partition, saved.image_written, &session->sha);
+        if (err == ESP_OK) {
+            err = esp_ota_resume(session->partition, OTA_WITH_SEQUENTIAL_WRITES,
+                                 saved.image_written, &session->handle);
+        }
+        if (err == ESP_OK) {
+            session->checkpoint = saved;
+            session->last_checkpoint = saved.image_written;
+            ESP_LOGI(TAG, "▶️ Reanudando %s en %lu bytes",
+                     use_delta ? "parche" : "imagen", (unsigned long)saved.image_written);
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "No se pudo reanudar (%s), empezando de cero", esp_err_to_name(err));
+        mbedtls_sha256_free(&session->sha);
+        mbedtls_sha256_init(&session->sha);
+        mbedtls_sha256_starts(&session->sha, 0);
+    }
+
+    esp_err_t err = esp_ota_begin(session->partition, OTA_WITH_SEQUENTIAL_WRITES, &session->handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin falló: %s", esp_err_to_name(err));
+        return err;
+    }
+    ota_checkpoint_t *checkpoint = &session->checkpoint;
+    checkpoint->magic = OTA_CHECKPOINT_MAGIC;
+    memcpy(checkpoint->target_sha256, manifest->sha256, DELTA_HASH_SIZE);
+    checkpoint->partition_address = session->partition->address;
+    checkpoint->is_delta = use_delta ? 1 : 0;
+    delta_state_init(&checkpoint->delta);
+    save_checkpoint(checkpoint);
+    return ESP_OK;
+}
+
+static void end_session(ota_session_t *session, bool keep_checkpoint) {
+    if (session->handle != 0) {
+        esp_ota_abort(session->handle);
+        session->handle = 0;
+    }
+    mbedtls_sha256_free(&session->sha);
+    if (!keep_checkpoint) {
+        save_checkpoint(NULL);
+    }
+}
+
+// Descarga (con reintentos y reanudación) y deja lista la partición nueva
+static esp_err_t run_update(const ota_manifest_t *manifest, bool use_delta) {
+    static ota_session_t session;
+    esp_err_t err = begin_session(&session, manifest, use_delta);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    const char *url = use_delta ? manifest->patch_url : manifest->image_url;
+    uint32_t file_size = use_delta ? manifest->patch_size : manifest->size;
+    ESP_LOGI(TAG, "⬇️ Descargando %s %s (%lu bytes)", use_delta ? "parche" : "imagen",
+             manifest->version, (unsigned long)file_size);
+
+    bool done = false;
+    for (int attempt = 0; attempt < OTA_MAX_ATTEMPTS && !done; ++attempt) {
+        if (attempt > 0) {
+            vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_BASE_MS << attempt));
+        }
+        err = download_pass(&session, url, file_size, &done);
+        if (err == ESP_ERR_INVALID_CRC || err == ESP_ERR_INVALID_RESPONSE || err == ESP_ERR_NOT_SUPPORTED ||
+            (use_delta && err == ESP_ERR_INVALID_SIZE)) {
+            end_session(&session, false);
+            return err;
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Descarga interrumpida (%s), intento %d/%d",
+                     esp_err_to_name(err), attempt + 1, OTA_MAX_ATTEMPTS);
+        }
+    }
+    if (!done) {
+        // El último checkpoint en NVS queda: el próximo chequeo continúa desde ahí
+        end_session(&session, true);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t digest[DELTA_HASH_SIZE];
+    mbedtls_sha256_finish(&session.sha, digest);
+    if (memcmp(digest, manifest->sha256, DELTA_HASH_SIZE) != 0) {
+        ESP_LOGE(TAG, "❌ SHA-256 de la imagen nueva no coincide");
+        end_session(&session, false);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    err = esp_ota_end(session.handle);
+    session.handle = 0;
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(session.partition);
+    }
+    end_session(&session, false);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Imagen rechazada: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "✅ Versión %s lista en %s", manifest->version, session.partition->label);
+    return ESP_OK;
+}
+
+static void check_for_update(void) {
+    const esp_app_desc_t *app = esp_app_get_description();
+    ota_manifest_t manifest;
+    if (!fetch_manifest(&manifest, app->version)) {
+        return;
+    }
+
+    if (strcmp(manifest.version, app->version) == 0) {
+        ESP_LOGI(TAG, "Firmware al día (%s)", app->version);
+        save_checkpoint(NULL);
+        return;
+    }
+
+    ESP_LOGI(TAG, "🆕 Nueva versión %s (actual %s)", manifest.version, app->version);
+    esp_err_t err = ESP_FAIL;
+    if (manifest.patch_url[0] != '\0') {
+        err = run_update(&manifest, true);
+        if (err != ESP_OK) {
+            // Cualquier parche que no llegó a DONE: la imagen completa no
+            // depende de él (su checkpoint reemplaza al del parche)
+            ESP_LOGW(TAG, "Parche sin completar (%s), se descarga la imagen completa", esp_err_to_name(err));
+        }
+    }
+    if (err != ESP_OK) {
+        err = run_update(&manifest, false);
+    }
+    if (err != ESP_OK) {
+        return;
+    }
+
+    // No cortar un riego en curso
+    while (reboot_allowed != NULL && !reboot_allowed()) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    ESP_LOGI(TAG, "🔄 Reiniciando en la versión %s", manifest.version);
+    vTaskDelay(pdMS_TO_TICKS(500));
+    esp_restart();
+}
+
+// ==================== API ====================
+
+void ota_update_init(void) {
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+        pending_verify = true;
+        verify_deadline_us = esp_timer_get_time() + (int64_t)OTA_VERIFY_TIMEOUT_S * 1000000;
+        ESP_LOGW(TAG, "🧪 Imagen nueva en %s pendiente de verificación (%ds para subir datos)",
+                 running->label, OTA_VERIFY_TIMEOUT_S);
+    }
+    ESP_LOGI(TAG, "Firmware %s en %s", esp_app_get_description()->version, running->label);
+}
+
+void ota_update_confirm(const char *reason) {
+    if (!pending_verify) {
+        return;
+    }
+    if (esp_ota_mark_app_valid_cancel_rollback() == ESP_OK) {
+        pending_verify = false;
+        ESP_LOGI(TAG, "✅ Imagen confirmada (%s)", reason);
+    }
+}
+
+bool ota_update_pending_verify(void) {
+    return pending_verify;
+}
+
+static void ota_task(void *pvParameters) {
+    (void)pvParameters;
+    // Primer chequeo poco después de arrancar (la red ya suele estar lista)
+    TickType_t next_check = xTaskGetTickCount() + pdMS_TO_TICKS(30000);
+
+    while (1) {
+        if (pending_verify && esp_timer_get_time() > verify_deadline_us) {
+            ESP_LOGE(TAG, "❌ La imagen nueva no logró subir datos, volviendo a la anterior");
+            esp_ota_mark_app_invalid_rollback_and_reboot();
+        }
+        if ((int32_t)(xTaskGetTickCount() - next_check) >= 0) {
+            check_for_update();
+            next_check = xTaskGetTickCount() + pdMS_TO_TICKS(OTA_CHECK_INTERVAL_S * 1000ULL);
+        }
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+}
+
+void ota_update_start_task(bool (*can_reboot)(void)) {
+    reboot_allowed = can_reboot;
+#if OTA_ENABLED
+#if AGROMIND_STATIC_MEMORY
+    static StackType_t ota_task_stack[OTA_TASK_STACK_SIZE];
+    static StaticTask_t ota_task_tcb;
+    xTaskCreateStatic(ota_task, "ota_task", OTA_TASK_STACK_SIZE, NULL, 3, ota_task_stack, &ota_task_tcb);
+#else
+    xTaskCreate(ota_task, "ota_task", OTA_TASK_STACK_SIZE, NULL, 3, NULL);
+#endif
+#else
+    (void)ota_task;
+    ESP_LOGI(TAG, "OTA deshabilitado (define OTA_MANIFEST_URL en config.h)");
+#endif
+}
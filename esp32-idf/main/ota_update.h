@@ -0,0 +1,34 @@
+/*
+ * AgroMind - Actualización OTA con parches delta y descarga reanudable
+ *
+ * - Manifiesto JSON en OTA_MANIFEST_URL (config.h) con la versión publicada,
+ *   la imagen completa y parches AGD1 desde versiones anteriores. Se usa el
+ *   parche de la versión que corre; si no hay, la imagen completa.
+ * - La descarga usa HTTP Range y guarda un checkpoint en NVS cada
+ *   OTA_CHECKPOINT_BYTES: un corte de WiFi o un reinicio continúa donde
+ *   quedó (esp_ota_resume) en lugar de empezar de cero.
+ * - Se verifica el SHA-256 de la imagen origen (antes de escribir) y de la
+ *   destino (antes de cambiar la partición de arranque).
+ * - A/B: se escribe en la partición OTA libre y se arranca desde ella. Con
+ *   CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE la imagen nueva queda pendiente
+ *   de verificación: si no logra subir datos antes de OTA_VERIFY_TIMEOUT_S
+ *   (o se reinicia antes), el bootloader vuelve a la anterior.
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdbool.h>
+
+// Llamar al arranque, antes de la primera subida
+void ota_update_init(void);
+
+// La imagen funciona (primera subida correcta): cancela el rollback
+void ota_update_confirm(const char *reason);
+
+bool ota_update_pending_verify(void);
+
+// can_reboot: el nodo puede reiniciarse ahora (p. ej. ninguna bomba regando)
+void ota_update_start_task(bool (*can_reboot)(void));
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,267 @@
+/*
+ * AgroMind - Reglas de riego en bytecode (ver rule_vm.h)
+ */
+
+#include <string.h>
+
+#include "rule_vm.h"
+
+// Bytes de operando de cada opcode, -1 si no existe
+static int operand_size(uint8_t op) {
+    switch (op) {
+        case RULE_OP_PUSH:
+            return 2;
+        case RULE_OP_LOAD:
+        case RULE_OP_JMP:
+        case RULE_OP_JFK:
+        case RULE_OP_JTK:
+            return 1;
+        case RULE_OP_ADD:
+        case RULE_OP_SUB:
+        case RULE_OP_MUL:
+        case RULE_OP_LT:
+        case RULE_OP_LE:
+        case RULE_OP_GT:
+        case RULE_OP_GE:
+        case RULE_OP_NOT:
+        case RULE_OP_AND:
+        case RULE_OP_OR:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// Profundidad de pila con la que se llega a pc; dos caminos deben coincidir
+static rule_verify_t merge_depth(int8_t *depth, size_t pc, int value) {
+    if (depth[pc] < 0) {
+        depth[pc] = (int8_t)value;
+        return RULE_VERIFY_OK;
+    }
+    return depth[pc] == value ? RULE_VERIFY_OK : RULE_VERIFY_STACK_MISMATCH;
+}
+
+rule_verify_t rule_verify(const uint8_t *code, size_t length) {
+    if (length == 0) {
+        return RULE_VERIFY_EMPTY;
+    }
+    if (length > RULE_MAX_CODE) {
+        return RULE_VERIFY_TOO_LONG;
+    }
+    if (code[0] != RULE_VM_VERSION) {
+        return RULE_VERIFY_BAD_VERSION;
+    }
+
+    // Primera pasada: límites de instrucción, opcodes y operandos
+    bool starts[RULE_MAX_CODE + 1] = {};
+    size_t pc = 1;
+    while (pc < length) {
+        int size = operand_size(code[pc]);
+        if (size < 0) {
+            return RULE_VERIFY_BAD_OPCODE;
+        }
+        if (pc + 1 + (size_t)size > length) {
+            return RULE_VERIFY_TRUNCATED;
+        }
+        if (code[pc] == RULE_OP_LOAD && code[pc + 1] >= RULE_VAR_COUNT) {
+            return RULE_VERIFY_BAD_VARIABLE;
+        }
+        starts[pc] = true;
+        pc += 1 + (size_t)size;
+    }
+    starts[length] = true;
+
+    // Segunda pasada: como los saltos solo van hacia adelante, al llegar a
+    // una instrucción ya se conocen todos los caminos que entran en ella
+    int8_t depth[RULE_MAX_CODE + 1];
+    memset(depth, -1, sizeof(depth));
+    depth[1] = 0;
+    for (pc = 1; pc < length;) {
+        int d = depth[pc];
+        if (d < 0) {
+            return RULE_VERIFY_UNREACHABLE;
+        }
+        uint8_t op = code[pc];
+        size_t next = pc + 1 + (size_t)operand_size(op);
+        rule_verify_t result = RULE_VERIFY_OK;
+
+        switch (op) {
+            case RULE_OP_PUSH:
+            case RULE_OP_LOAD:
+                if (d + 1 > RULE_MAX_STACK) {
+                    return RULE_VERIFY_STACK_OVERFLOW;
+                }
+                result = merge_depth(depth, next, d + 1);
+                break;
+            case RULE_OP_NOT:
+                if (d < 1) {
+                    return RULE_VERIFY_STACK_UNDERFLOW;
+                }
+                result = merge_depth(depth, next, d);
+                break;
+            case RULE_OP_JMP:
+            case RULE_OP_JFK:
+            case RULE_OP_JTK: {
+                int8_t offset = (int8_t)code[pc + 1];
+                if (offset < 0) {
+                    return RULE_VERIFY_BACKWARD_JUMP;
+                }
+                size_t target = next + (size_t)offset;
+                if (target > length || !starts[target]) {
+                    return RULE_VERIFY_BAD_JUMP;
+                }
+                if (op == RULE_OP_JMP) {
+                    result = merge_depth(depth, target, d);
+                    break;
+                }
+                if (d < 1) {
+                    return RULE_VERIFY_STACK_UNDERFLOW;
+                }
+                result = merge_depth(depth, target, d);
+                if (result == RULE_VERIFY_OK) {
+                    result = merge_depth(depth, next, d - 1);
+                }
+                break;
+            }
+            default:
+                // Binarias: dos operandos, un resultado
+                if (d < 2) {
+                    return RULE_VERIFY_STACK_UNDERFLOW;
+                }
+                result = merge_depth(depth, next, d - 1);
+                break;
+        }
+        if (result != RULE_VERIFY_OK) {
+            return result;
+        }
+        pc = next;
+    }
+
+    return depth[length] == 1 ? RULE_VERIFY_OK : RULE_VERIFY_BAD_RESULT;
+}
+
+const char *rule_verify_name(rule_verify_t result) {
+    switch (result) {
+        case RULE_VERIFY_OK: return "ok";
+        case RULE_VERIFY_EMPTY: return "vacío";
+        case RULE_VERIFY_TOO_LONG: return "demasiado largo";
+        case RULE_VERIFY_BAD_VERSION: return "versión desconocida";
+        case RULE_VERIFY_BAD_OPCODE: return "opcode desconocido";
+        case RULE_VERIFY_TRUNCATED: return "instrucción incompleta";
+        case RULE_VERIFY_BAD_VARIABLE: return "variable desconocida";
+        case RULE_VERIFY_BACKWARD_JUMP: return "salto hacia atrás";
+        case RULE_VERIFY_BAD_JUMP: return "salto inválido";
+        case RULE_VERIFY_UNREACHABLE: return "código inalcanzable";
+        case RULE_VERIFY_STACK_UNDERFLOW: return "pila vacía";
+        case RULE_VERIFY_STACK_OVERFLOW: return "pila llena";
+        case RULE_VERIFY_STACK_MISMATCH: return "pila distinta entre caminos";
+        case RULE_VERIFY_BAD_RESULT: return "resultado inválido";
+    }
+    return "?";
+}
+
+rule_verify_t rule_program_load(rule_program_t *program, const uint8_t *code, size_t length) {
+    rule_verify_t result = rule_verify(code, length);
+    if (result == RULE_VERIFY_OK) {
+        memcpy(program->code, code, length);
+        program->length = (uint8_t)length;
+    }
+    return result;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool rule_hex_decode(const char *hex, uint8_t *code, size_t *length) {
+    size_t chars = strlen(hex);
+    if (chars % 2 != 0 || chars / 2 > RULE_MAX_CODE) {
+        return false;
+    }
+    for (size_t i = 0; i < chars / 2; ++i) {
+        int high = hex_value(hex[2 * i]);
+        int low = hex_value(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        code[i] = (uint8_t)((high << 4) | low);
+    }
+    *length = chars / 2;
+    return true;
+}
+
+// ==================== INTÉRPRETE ====================
+// Sin comprobaciones de pila ni de límites: rule_verify() ya las hizo
+
+rule_result_t rule_eval(const rule_program_t *program, const rule_inputs_t *inputs) {
+    const uint8_t *code = program->code;
+    size_t length = program->length;
+    if (length == 0) {
+        return RULE_ALLOW;
+    }
+
+    float stack[RULE_MAX_STACK];
+    int sp = 0;
+    size_t pc = 1;
+    while (pc < length) {
+        switch (code[pc]) {
+            case RULE_OP_PUSH:
+                stack[sp++] = (float)(int16_t)(code[pc + 1] | (code[pc + 2] << 8)) / 10.0f;
+                pc += 3;
+                break;
+            case RULE_OP_LOAD: {
+                uint8_t var = code[pc + 1];
+                if ((inputs->valid & (1U << var)) == 0) {
+                    return RULE_NO_DATA;
+                }
+                stack[sp++] = inputs->values[var];
+                pc += 2;
+                break;
+            }
+            case RULE_OP_ADD: stack[sp - 2] = stack[sp - 2] + stack[sp - 1]; sp--; pc++; break;
+            case RULE_OP_SUB: stack[sp - 2] = stack[sp - 2] - stack[sp - 1]; sp--; pc++; break;
+            case RULE_OP_MUL: stack[sp - 2] = stack[sp - 2] * stack[sp - 1]; sp--; pc++; break;
+            case RULE_OP_LT: stack[sp - 2] = stack[sp - 2] < stack[sp - 1] ? 1.0f : 0.0f; sp--; pc++; break;
+            case RULE_OP_LE: stack[sp - 2] = stack[sp - 2] <= stack[sp - 1] ? 1.0f : 0.0f; sp--; pc++; break;
+            case RULE_OP_GT: stack[sp - 2] = stack[sp - 2] > stack[sp - 1] ? 1.0f : 0.0f; sp--; pc++; break;
+            case RULE_OP_GE: stack[sp - 2] = stack[sp - 2] >= stack[sp - 1] ? 1.0f : 0.0f; sp--; pc++; break;
+            case RULE_OP_NOT: stack[sp - 1] = stack[sp - 1] == 0.0f ? 1.0f : 0.0f; pc++; break;
+            case RULE_OP_AND:
+                stack[sp - 2] = (stack[sp - 2] != 0.0f && stack[sp - 1] != 0.0f) ? 1.0f : 0.0f;
+                sp--;
+                pc++;
+                break;
+            case RULE_OP_OR:
+                stack[sp - 2] = (stack[sp - 2] != 0.0f || stack[sp - 1] != 0.0f) ? 1.0f : 0.0f;
+                sp--;
+                pc++;
+                break;
+            case RULE_OP_JMP:
+                pc += 2 + (size_t)(int8_t)code[pc + 1];
+                break;
+            case RULE_OP_JFK:
+            case RULE_OP_JTK: {
+                bool truth = stack[sp - 1] != 0.0f;
+                if (truth == (code[pc] == RULE_OP_JTK)) {
+                    pc += 2 + (size_t)(int8_t)code[pc + 1];
+                } else {
+                    sp--;
+                    pc += 2;
+                }
+                break;
+            }
+            default:
+                return RULE_NO_DATA;
+        }
+    }
+    return stack[0] != 0.0f ? RULE_ALLOW : RULE_BLOCK;
+}
@@ -0,0 +1,116 @@
+/*
+ * AgroMind - Reglas de riego en bytecode
+ *
+ * La app escribe una regla por zona ("light < 70 and temperature >= 10"),
+ * el backend la compila (backend/src/services/ruleCompiler.ts) y la manda
+ * en hex dentro de "commands.rule". El nodo la verifica, la guarda en NVS
+ * y la evalúa con cada lectura: si da falso el modo automático no inicia
+ * un riego aunque la humedad esté bajo el umbral. La regla solo puede
+ * impedir un riego, nunca forzarlo; umbral, histéresis y tanque mínimo
+ * siguen aplicando igual.
+ *
+ * Programa: versión u8 | instrucciones. Máquina de pila de floats:
+ *   PUSH i16   constante en décimas (355 = 35.5)
+ *   LOAD u8    variable (rule_var_t)
+ *   ADD SUB MUL | LT LE GT GE | NOT AND OR   (verdadero = 1, falso = 0)
+ *   JMP i8     salto relativo al final de la instrucción
+ *   JFK i8     si la cima es falsa salta y la conserva; si no, la descarta
+ *   JTK i8     lo mismo con verdadera (así compila and/or con cortocircuito)
+ * El resultado es el único valor que queda en la pila (distinto de 0 = riega).
+ *
+ * Costo acotado: rule_verify() rechaza saltos hacia atrás (el único modo
+ * de hacer un bucle), saltos a mitad de una instrucción o fuera del
+ * programa, opcodes o variables desconocidos, y pilas que se vacían,
+ * pasan de RULE_MAX_STACK o llegan distintas a un mismo punto. Un programa
+ * aceptado ejecuta como mucho una vez cada instrucción: menos de
+ * RULE_MAX_CODE pasos, sin memoria dinámica.
+ *
+ * Portable (sin ESP-IDF): host/tools/rule_bench lo mide y lo somete a
+ * programas aleatorios.
+ */
+
+#ifndef RULE_VM_H
+#define RULE_VM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RULE_VM_VERSION 1
+#define RULE_MAX_CODE 64            // bytes, con la versión
+#define RULE_MAX_STACK 8
+
+#define RULE_OP_PUSH 0x01
+#define RULE_OP_LOAD 0x02
+#define RULE_OP_ADD 0x10
+#define RULE_OP_SUB 0x11
+#define RULE_OP_MUL 0x12
+#define RULE_OP_LT 0x20
+#define RULE_OP_LE 0x21
+#define RULE_OP_GT 0x22
+#define RULE_OP_GE 0x23
+#define RULE_OP_NOT 0x28
+#define RULE_OP_AND 0x29
+#define RULE_OP_OR 0x2A
+#define RULE_OP_JMP 0x30
+#define RULE_OP_JFK 0x31
+#define RULE_OP_JTK 0x32
+
+// Mismo orden que VARIABLES en ruleCompiler.ts
+typedef enum {
+    RULE_VAR_SOIL = 0,              // soilMoisture de la zona (%)
+    RULE_VAR_TANK,                  // tankLevel (%)
+    RULE_VAR_TEMPERATURE,           // temperature (°C)
+    RULE_VAR_HUMIDITY,              // humidity ambiente (%)
+    RULE_VAR_LIGHT,                 // lightLevel (%)
+    RULE_VAR_THRESHOLD,             // moistureThreshold de la zona (%)
+    RULE_VAR_COUNT
+} rule_var_t;
+
+typedef enum {
+    RULE_VERIFY_OK = 0,
+    RULE_VERIFY_EMPTY,
+    RULE_VERIFY_TOO_LONG,
+    RULE_VERIFY_BAD_VERSION,
+    RULE_VERIFY_BAD_OPCODE,
+    RULE_VERIFY_TRUNCATED,          // falta el operando de la última instrucción
+    RULE_VERIFY_BAD_VARIABLE,
+    RULE_VERIFY_BACKWARD_JUMP,
+    RULE_VERIFY_BAD_JUMP,           // fuera del programa o a mitad de instrucción
+    RULE_VERIFY_UNREACHABLE,
+    RULE_VERIFY_STACK_UNDERFLOW,
+    RULE_VERIFY_STACK_OVERFLOW,
+    RULE_VERIFY_STACK_MISMATCH,     // dos caminos llegan con pilas distintas
+    RULE_VERIFY_BAD_RESULT,         // no termina con exactamente un valor
+} rule_verify_t;
+
+typedef enum {
+    RULE_ALLOW = 0,
+    RULE_BLOCK,
+    RULE_NO_DATA,                   // leyó una variable sin lectura fiable
+} rule_result_t;
+
+// Programa verificado. length 0 = sin regla
+typedef struct {
+    uint8_t length;
+    uint8_t code[RULE_MAX_CODE];
+} rule_program_t;
+
+typedef struct {
+    float values[RULE_VAR_COUNT];
+    uint32_t valid;                 // bit (1 << rule_var_t): valor usable
+} rule_inputs_t;
+
+rule_verify_t rule_verify(const uint8_t *code, size_t length);
+const char *rule_verify_name(rule_verify_t result);
+
+// Verifica y copia; si no pasa, program queda como estaba
+rule_verify_t rule_program_load(rule_program_t *program, const uint8_t *code, size_t length);
+
+// Decodifica hex ("" = sin regla). false si no es hex o pasa de RULE_MAX_CODE
+bool rule_hex_decode(const char *hex, uint8_t *code, size_t *length);
+
+// Solo para programas cargados con rule_program_load. Sin regla: RULE_ALLOW
+rule_result_t rule_eval(const rule_program_t *program, const rule_inputs_t *inputs);
+
+#endif // RULE_VM_H
@@ -0,0 +1,135 @@
+/*
+ * AgroMind - Canales de sensores con calibración resuelta en compilación
+ *
+ * Cada canal convierte una lectura cruda (ADC, microsegundos de eco, ...)
+ * a su magnitud física. Los valores de calibración de config.h se pliegan
+ * en tiempo de compilación a coeficientes en punto fijo Q16.16, de modo que
+ * cada lectura cuesta una multiplicación, una suma y un desplazamiento (sin
+ * divisiones en float). Las curvas no lineales usan una tabla de tramos.
+ *
+ * La calibración activa puede reemplazarse en tiempo de ejecución (por
+ * ejemplo desde NVS) sin tocar la de fábrica.
+ *
+ * Este header no depende de ESP-IDF.
+ */
+
+#ifndef SENSOR_CHANNEL_H
+#define SENSOR_CHANNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SENSOR_Q16_ONE 65536
+
+constexpr int32_t sensor_to_q16(float value) {
+    return (int32_t)(value * (float)SENSOR_Q16_ONE + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+static inline float sensor_from_q16(int32_t value_q16) {
+    return (float)value_q16 * (1.0f / (float)SENSOR_Q16_ONE);
+}
+
+// ==================== CURVA LINEAL ====================
+// salida_q16 = raw * scale_q16 + offset_q16
+
+struct linear_curve_t {
+    int32_t scale_q16;
+    int32_t offset_q16;
+
+    // Recta que pasa por (raw_a, out_a) y (raw_b, out_b)
+    static constexpr linear_curve_t from_points(float raw_a, float out_a, float raw_b, float out_b) {
+        float scale = (out_b - out_a) / (raw_b - raw_a);
+        float offset = out_a - raw_a * scale;
+        return linear_curve_t{ sensor_to_q16(scale), sensor_to_q16(offset) };
+    }
+
+    constexpr int32_t eval_q16(int32_t raw) const {
+        return (int32_t)((int64_t)raw * scale_q16 + offset_q16);
+    }
+};
+
+// ==================== CURVA POR TRAMOS ====================
+// Para respuestas no lineales (p.ej. tanques de sección variable).
+// Los puntos se dan con raw ascendente; fuera del rango se extrapola
+// con el primer/último tramo y el canal se encarga de acotar.
+
+template <size_t N>
+struct table_curve_t {
+    static_assert(N >= 2, "Una curva por tramos necesita al menos 2 puntos");
+
+    int32_t raw[N];
+    linear_curve_t segment[N - 1];
+
+    constexpr int32_t eval_q16(int32_t value) const {
+        size_t i = 0;
+        while (i < N - 2 && value >= raw[i + 1]) {
+            ++i;
+        }
+        return segment[i].eval_q16(value);
+    }
+};
+
+// points[i] = { raw, salida }, raw estrictamente ascendente
+template <size_t N>
+constexpr table_curve_t<N> make_table_curve(const float (&points)[N][2]) {
+    table_curve_t<N> curve{};
+    for (size_t i = 0; i < N; ++i) {
+        curve.raw[i] = (int32_t)points[i][0];
+    }
+    for (size_t i = 0; i + 1 < N; ++i) {
+        curve.segment[i] = linear_curve_t::from_points(points[i][0], points[i][1],
+                                                       points[i + 1][0], points[i + 1][1]);
+    }
+    return curve;
+}
+
+// ==================== CANAL ====================
+
+template <typename Curve>
+struct sensor_channel_t {
+    const char *name;       // nombre corto para logs y para la clave NVS de recalibración
+    int source;             // origen físico (canal ADC, pin, ...) interpretado por quien lee
+    Curve factory;          // calibración de config.h (compilada)
+    Curve active;           // calibración en uso
+    int32_t min_q16;
+    int32_t max_q16;
+
+    constexpr int32_t convert_q16(int32_t raw) const {
+        int32_t value = active.eval_q16(raw);
+        if (value < min_q16) {
+            return min_q16;
+        }
+        if (value > max_q16) {
+            return max_q16;
+        }
+        return value;
+    }
+
+    float convert(int32_t raw) const {
+        return sensor_from_q16(convert_q16(raw));
+    }
+};
+
+template <typename Curve>
+constexpr sensor_channel_t<Curve> make_sensor_channel(const char *name, int source,
+                                                     const Curve &curve,
+                                                     float min_value, float max_value) {
+    return sensor_channel_t<Curve>{ name, source, curve, curve,
+                                    sensor_to_q16(min_value), sensor_to_q16(max_value) };
+}
+
+// Conjunto de N canales con el mismo tipo de curva, declarados en una sola lista
+template <typename Curve, size_t N>
+struct sensor_bank_t {
+    sensor_channel_t<Curve> channel[N];
+
+    static constexpr size_t size() { return N; }
+
+    void reset_to_factory(void) {
+        for (size_t i = 0; i < N; ++i) {
+            channel[i].active = channel[i].factory;
+        }
+    }
+};
+
+#endif // SENSOR_CHANNEL_H
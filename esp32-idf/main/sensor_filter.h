@@ -0,0 +1,181 @@
+/*
+ * AgroMind - Filtro de lecturas por canal de sensor
+ *
+ * Etapa entre la adquisición (sensor_channel.h) y quien consume el valor
+ * (modo automático, modelo del suelo, subida, ESP-NOW). Por cada muestra:
+ *
+ *   1. Hampel sobre las últimas `window` muestras crudas: si la muestra se
+ *      aleja de la mediana más de k * 1.4826 * MAD se reemplaza por la
+ *      mediana. Un cambio real se acepta cuando ocupa media ventana.
+ *   2. Límite de cambio por muestra respecto de la salida anterior.
+ *   3. EWMA (alpha = 1 la desactiva).
+ *
+ * Una lectura fallida (timeout, checksum, error de ADC) no es un valor:
+ * se reporta con miss(), que mantiene la última salida como HELD hasta
+ * max_held fallos seguidos y después la marca INVALID.
+ *
+ * Todo en Q16.16 y sin memoria dinámica: el estado es un anillo fijo de
+ * SENSOR_FILTER_MAX_WINDOW muestras. Header sin dependencias de ESP-IDF.
+ */
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "sensor_channel.h"
+
+#define SENSOR_FILTER_MAX_WINDOW 9
+
+// Calidad de la última salida. 0 = OK para que un node_state_t recién
+// inicializado (o el de un simulador que no filtra) se considere válido.
+enum sensor_quality_t : uint8_t {
+    SENSOR_QUALITY_OK = 0,          // muestra aceptada tal cual (suavizada)
+    SENSOR_QUALITY_FILTERED = 1,    // atípica o recortada por el límite de cambio
+    SENSOR_QUALITY_HELD = 2,        // falló la lectura: se repite la última salida
+    SENSOR_QUALITY_INVALID = 3,     // sin dato fiable: no usar
+};
+
+static inline bool sensor_quality_usable(sensor_quality_t quality) {
+    return quality != SENSOR_QUALITY_INVALID;
+}
+
+// Muestra nueva de verdad (no repetida): la usan los modelos que aprenden
+static inline bool sensor_quality_fresh(sensor_quality_t quality) {
+    return quality == SENSOR_QUALITY_OK || quality == SENSOR_QUALITY_FILTERED;
+}
+
+static inline const char *sensor_quality_name(sensor_quality_t quality) {
+    switch (quality) {
+        case SENSOR_QUALITY_OK: return "ok";
+        case SENSOR_QUALITY_FILTERED: return "filtered";
+        case SENSOR_QUALITY_HELD: return "held";
+        default: return "invalid";
+    }
+}
+
+struct sensor_filter_config_t {
+    uint8_t window;             // 1 = sin Hampel
+    int32_t k_q16;              // umbral en desvíos (MAD escalado)
+    int32_t min_sigma_q16;      // piso del desvío: señales planas no rechazan todo
+    int32_t alpha_q16;          // peso de la muestra nueva en la EWMA
+    int32_t max_step_q16;       // cambio máximo por muestra (0 = sin límite)
+    uint8_t max_held;           // fallos seguidos antes de INVALID
+};
+
+constexpr sensor_filter_config_t make_sensor_filter_config(int window, float k, float min_sigma,
+                                                           float alpha, float max_step, int max_held) {
+    return sensor_filter_config_t{
+        (uint8_t)(window < 1 ? 1 : (window > SENSOR_FILTER_MAX_WINDOW ? SENSOR_FILTER_MAX_WINDOW : window)),
+        sensor_to_q16(k), sensor_to_q16(min_sigma), sensor_to_q16(alpha),
+        sensor_to_q16(max_step), (uint8_t)max_held
+    };
+}
+
+// Inserción: N <= 9, más barato que cualquier selección general
+static inline int32_t sensor_filter_median(int32_t *values, uint8_t n) {
+    for (uint8_t i = 1; i < n; ++i) {
+        int32_t key = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > key) {
+            values[j + 1] = values[j];
+            --j;
+        }
+        values[j + 1] = key;
+    }
+    return (n & 1) ? values[n / 2] : (int32_t)(((int64_t)values[n / 2 - 1] + values[n / 2]) / 2);
+}
+
+struct sensor_filter_t {
+    sensor_filter_config_t config;
+    int32_t ring_q16[SENSOR_FILTER_MAX_WINDOW];
+    uint8_t count;
+    uint8_t head;
+    uint8_t misses;
+    bool has_output;
+    int32_t output_q16;
+    sensor_quality_t quality;
+
+    uint32_t filtered;          // muestras reemplazadas o recortadas
+    uint32_t failures;          // lecturas fallidas
+
+    void init(const sensor_filter_config_t &filter_config) {
+        memset(this, 0, sizeof(*this));
+        config = filter_config;
+        quality = SENSOR_QUALITY_INVALID;
+    }
+
+    float value(void) const {
+        return sensor_from_q16(output_q16);
+    }
+
+    sensor_quality_t update(float raw) {
+        return update_q16(sensor_to_q16(raw));
+    }
+
+    sensor_quality_t update_q16(int32_t raw_q16) {
+        bool replaced = false;
+        int32_t sample = raw_q16;
+
+        // 1. Hampel: la muestra cruda entra siempre al anillo
+        ring_q16[head] = raw_q16;
+        head = (uint8_t)((head + 1) % config.window);
+        if (count < config.window) {
+            count++;
+        }
+        if (config.window >= 3 && count >= 3) {
+            int32_t scratch[SENSOR_FILTER_MAX_WINDOW];
+            memcpy(scratch, ring_q16, sizeof(int32_t) * count);
+            int32_t median = sensor_filter_median(scratch, count);
+            for (uint8_t i = 0; i < count; ++i) {
+                int32_t deviation = ring_q16[i] - median;
+                scratch[i] = deviation < 0 ? -deviation : deviation;
+            }
+            // 1.4826 * MAD estima el desvío estándar con ruido gaussiano
+            int64_t sigma = ((int64_t)sensor_filter_median(scratch, count) * 97163) >> 16;
+            if (sigma < config.min_sigma_q16) {
+                sigma = config.min_sigma_q16;
+            }
+            int64_t deviation = (int64_t)raw_q16 - median;
+            if (deviation < 0) {
+                deviation = -deviation;
+            }
+            if (deviation > ((sigma * config.k_q16) >> 16)) {
+                sample = median;
+                replaced = true;
+            }
+        }
+
+        if (!has_output) {
+            output_q16 = sample;
+            has_output = true;
+        } else {
+            // 2. Límite de cambio por muestra
+            int64_t step = (int64_t)sample - output_q16;
+            if (config.max_step_q16 > 0 && (step > config.max_step_q16 || step < -config.max_step_q16)) {
+                step = step > 0 ? config.max_step_q16 : -config.max_step_q16;
+                replaced = true;
+            }
+            // 3. EWMA
+            output_q16 = (int32_t)(output_q16 + ((step * config.alpha_q16) >> 16));
+        }
+
+        misses = 0;
+        if (replaced) {
+            filtered++;
+        }
+        quality = replaced ? SENSOR_QUALITY_FILTERED : SENSOR_QUALITY_OK;
+        return quality;
+    }
+
+    sensor_quality_t miss(void) {
+        failures++;
+        if (misses < UINT8_MAX) {
+            misses++;
+        }
+        quality = has_output && misses <= config.max_held ? SENSOR_QUALITY_HELD : SENSOR_QUALITY_INVALID;
+        return quality;
+    }
+};
+
+#endif // SENSOR_FILTER_H
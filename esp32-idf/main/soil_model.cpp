@@ -0,0 +1,227 @@
+/*
+ * AgroMind - Modelo incremental de respuesta del suelo (ver soil_model.h)
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "soil_model.h"
+
+static uint32_t ticks_to_ms(TickType_t ticks) {
+    return (uint32_t)(((uint64_t)ticks * 1000U) / configTICK_RATE_HZ);
+}
+
+// Comparación segura ante el desborde de TickType_t
+static bool tick_reached(TickType_t now, TickType_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static float ewma(float current, float sample, float alpha, uint16_t samples) {
+    return samples == 0 ? sample : current + alpha * (sample - current);
+}
+
+static uint16_t saturating_increment(uint16_t value) {
+    return value == UINT16_MAX ? value : (uint16_t)(value + 1);
+}
+
+void soil_model_reset(soil_model_t *model) {
+    memset(model, 0, sizeof(*model));
+    model->params.version = SOIL_MODEL_PARAMS_VERSION;
+}
+
+bool soil_model_import(soil_model_t *model, const soil_model_params_t *params) {
+    if (params->version != SOIL_MODEL_PARAMS_VERSION ||
+        !(params->gain_per_s >= 0.0f && params->gain_per_s <= SOIL_MODEL_GAIN_MAX) ||
+        !(params->dry_per_hour >= 0.0f && params->dry_per_hour <= SOIL_MODEL_DRY_MAX) ||
+        !(params->ceiling >= 0.0f && params->ceiling <= 100.0f)) {
+        return false;
+    }
+    soil_model_reset(model);
+    model->params = *params;
+    return true;
+}
+
+// EWMA con el tiempo real entre lecturas: control_task muestrea más rápido
+// con la bomba encendida que sensor_task con ella apagada
+static void update_level(soil_model_t *model, float moisture, TickType_t now) {
+    if (!model->has_level) {
+        model->has_level = true;
+        model->level = moisture;
+    } else {
+        float dt_s = (float)ticks_to_ms(now - model->level_tick) / 1000.0f;
+        model->level += (moisture - model->level) * dt_s / (dt_s + (float)SOIL_MODEL_LEVEL_TAU_S);
+    }
+    model->level_tick = now;
+}
+
+// Sobre la humedad suavizada: el ruido de una meseta no cuenta como subida
+static void track_rise(soil_model_t *model, TickType_t now) {
+    if (model->level >= model->rise_mark + SOIL_MODEL_RISE_STEP) {
+        model->rise_mark = model->level;
+        model->rise_tick = now;
+    }
+}
+
+void soil_model_pump_changed(soil_model_t *model, bool on, float moisture, TickType_t now) {
+    if (on && !model->watering) {
+        // Un pulso durante la infiltración del anterior cuenta como el mismo riego
+        if (!model->settling) {
+            model->cycle_start_tick = now;
+            model->start_moisture = model->has_level ? model->level : moisture;
+            model->pumped_ms = 0;
+            model->rise_mark = model->start_moisture;
+            model->rise_tick = now;
+        }
+        model->settling = false;
+        model->watering = true;
+        model->pump_on_tick = now;
+        model->has_anchor = false;
+    } else if (!on && model->watering) {
+        model->pumped_ms += ticks_to_ms(now - model->pump_on_tick);
+        model->watering = false;
+        model->settling = true;
+        model->pump_off_tick = now;
+        model->settle_deadline = now + pdMS_TO_TICKS(SOIL_MODEL_SETTLE_S * 1000U);
+        model->peak_moisture = model->has_level ? model->level : moisture;
+        model->peak_tick = now;
+    }
+}
+
+// La humedad dejó de subir antes de apagar la bomba: suelo saturado (o el
+// agua corre fuera del alcance del sensor), la ganancia saldría baja
+static bool watering_stalled(const soil_model_t *model) {
+    int32_t since_rise_ms = (int32_t)ticks_to_ms(model->pump_off_tick - model->rise_tick);
+    if ((int32_t)(model->pump_off_tick - model->rise_tick) <= 0) {
+        return false;
+    }
+    uint32_t limit_ms = model->pumped_ms / SOIL_MODEL_STALL_FRACTION;
+    if (limit_ms < SOIL_MODEL_STALL_MIN_MS) {
+        limit_ms = SOIL_MODEL_STALL_MIN_MS;
+    }
+    return since_rise_ms > (int32_t)limit_ms;
+}
+
+// Fin de la infiltración: una muestra de ganancia
+static bool learn_gain(soil_model_t *model) {
+    soil_model_params_t *params = &model->params;
+    if (model->start_moisture <= 0.0f || model->pumped_ms < SOIL_MODEL_MIN_PUMP_MS) {
+        return false;   // sin lectura inicial o riego muy corto
+    }
+
+    // Techo: el pico más alto que dejó un riego. Volver a él es suelo
+    // saturado aunque el agua siguiera llegando después de apagar la bomba
+    bool saturated = params->ceiling > 0.0f && model->peak_moisture >= params->ceiling - SOIL_MODEL_CEILING_MARGIN;
+    bool changed = false;
+    if (model->peak_moisture > params->ceiling) {
+        params->ceiling = model->peak_moisture;
+        changed = true;
+    }
+    if (saturated || model->peak_moisture >= 99.0f || watering_stalled(model)) {
+        return changed;
+    }
+
+    // Lo secado hasta el pico: lo que pasó después no está en la medida
+    float elapsed_h = (float)ticks_to_ms(model->peak_tick - model->cycle_start_tick) / 3600000.0f;
+    float dried = params->dry_samples > 0 ? params->dry_per_hour * elapsed_h : 0.0f;
+    float gained = model->peak_moisture - model->start_moisture + dried;
+    float sample = gained / ((float)model->pumped_ms / 1000.0f);
+    if (!(sample >= SOIL_MODEL_GAIN_MIN && sample <= SOIL_MODEL_GAIN_MAX)) {
+        return changed;
+    }
+
+    params->gain_per_s = ewma(params->gain_per_s, sample, SOIL_MODEL_GAIN_ALPHA, params->gain_samples);
+    params->gain_samples = saturating_increment(params->gain_samples);
+    return true;
+}
+
+// Ventana de secado completa: una muestra de %/h
+static bool learn_drying(soil_model_t *model, float moisture, TickType_t now) {
+    soil_model_params_t *params = &model->params;
+    float elapsed_h = (float)ticks_to_ms(now - model->anchor_tick) / 3600000.0f;
+    float sample = (model->anchor_moisture - moisture) / elapsed_h;
+
+    model->anchor_tick = now;
+    model->anchor_moisture = moisture;
+    // Una ventana algo negativa es ruido de un secado lento y cuenta: tirar
+    // todas las negativas deja el promedio alto. Más que eso es agua
+    if (sample < -SOIL_MODEL_DRY_RISE) {
+        return false;   // subió sin bomba: lluvia o riego externo
+    }
+    if (sample > SOIL_MODEL_DRY_MAX) {
+        sample = SOIL_MODEL_DRY_MAX;
+    }
+
+    params->dry_per_hour = ewma(params->dry_per_hour, sample, SOIL_MODEL_DRY_ALPHA, params->dry_samples);
+    if (params->dry_per_hour < 0.0f) {
+        params->dry_per_hour = 0.0f;
+    }
+    params->dry_samples = saturating_increment(params->dry_samples);
+    return true;
+}
+
+bool soil_model_observe(soil_model_t *model, float moisture, TickType_t now) {
+    if (moisture <= 0.0f) {
+        return false;
+    }
+    update_level(model, moisture, now);
+    if (model->watering) {
+        track_rise(model, now);
+        return false;
+    }
+
+    if (model->settling) {
+        track_rise(model, now);
+        if (model->level > model->peak_moisture) {
+            model->peak_moisture = model->level;
+            model->peak_tick = now;
+        }
+        if (!tick_reached(now, model->settle_deadline)) {
+            return false;
+        }
+        model->settling = false;
+        model->has_anchor = true;
+        model->anchor_tick = now;
+        model->anchor_moisture = model->level;
+        return learn_gain(model);
+    }
+
+    if (!model->has_anchor) {
+        model->has_anchor = true;
+        model->anchor_tick = now;
+        model->anchor_moisture = model->level;
+        return false;
+    }
+    if (ticks_to_ms(now - model->anchor_tick) < SOIL_MODEL_DRY_WINDOW_S * 1000U) {
+        return false;
+    }
+    return learn_drying(model, model->level, now);
+}
+
+bool soil_model_ready(const soil_model_t *model) {
+    return model->params.gain_samples >= SOIL_MODEL_MIN_SAMPLES && model->params.gain_per_s > 0.0f;
+}
+
+uint32_t soil_model_duration_s(const soil_model_t *model, float moisture, float target, uint32_t fallback_s) {
+    if (!soil_model_ready(model) || moisture <= 0.0f) {
+        return fallback_s;
+    }
+
+    // Lo que se va a secar mientras el agua llega al sensor también hay que reponerlo
+    float needed = target - moisture + model->params.dry_per_hour * (SOIL_MODEL_SETTLE_S / 3600.0f);
+    float seconds = ceilf(needed / model->params.gain_per_s);
+    uint32_t max_s = (fallback_s > 0 ? fallback_s : 1U) * SOIL_MODEL_MAX_FACTOR;
+    if (!(seconds >= (float)SOIL_MODEL_MIN_DURATION_S)) {
+        return SOIL_MODEL_MIN_DURATION_S;
+    }
+    return seconds >= (float)max_s ? max_s : (uint32_t)seconds;
+}
+
+float soil_model_hours_until(const soil_model_t *model, float moisture, float threshold) {
+    if (model->params.dry_samples == 0 || model->params.dry_per_hour < 0.01f || moisture <= 0.0f) {
+        return -1.0f;
+    }
+    if (moisture <= threshold) {
+        return 0.0f;
+    }
+    return (moisture - threshold) / model->params.dry_per_hour;
+}
@@ -0,0 +1,110 @@
+/*
+ * AgroMind - Modelo incremental de respuesta del suelo por zona
+ *
+ * Aprende dos parámetros por canal con actualizaciones O(1) y memoria fija:
+ *
+ *   ganancia  % de humedad que sube por segundo de bomba. Se mide al final
+ *             de cada riego (automático o manual): pico de humedad dentro de
+ *             SOIL_MODEL_SETTLE_S tras apagar la bomba, menos la humedad al
+ *             encenderla, más lo que se secó hasta el pico, dividido por los
+ *             segundos de bomba. Un riego que dejó de subir con la bomba
+ *             encendida, o cuyo pico llega al techo (el pico más alto de un
+ *             riego anterior), es suelo saturado y no se mide: el agua de
+ *             más no llegó al sensor.
+ *   secado    % que pierde por hora con la bomba apagada, medido en ventanas
+ *             de SOIL_MODEL_DRY_WINDOW_S (una ventana corta es puro ruido
+ *             del ADC). Subidas sin bomba (lluvia, riego a mano) se ignoran.
+ *
+ * Inicio, pico y ventanas usan la humedad suavizada con una EWMA de
+ * SOIL_MODEL_LEVEL_TAU_S: el máximo de lecturas con ruido siempre queda
+ * alto, y el modo automático enciende justo en una lectura baja.
+ *
+ * Ambos son medias exponenciales (EWMA), así el modelo sigue los cambios de
+ * estación sin guardar historia. Con SOIL_MODEL_MIN_SAMPLES riegos medidos
+ * soil_model_duration_s() dimensiona el riego para llegar al objetivo; antes
+ * se usa la duración configurada. Solo los parámetros aprendidos se guardan
+ * en NVS (soil_model_params_t); el seguimiento del riego en curso es RAM.
+ */
+
+#ifndef SOIL_MODEL_H
+#define SOIL_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#define SOIL_MODEL_SETTLE_S 180             // infiltración hasta el sensor
+#define SOIL_MODEL_DRY_WINDOW_S 3600
+#define SOIL_MODEL_MIN_SAMPLES 2
+#define SOIL_MODEL_MIN_PUMP_MS 2000         // riegos más cortos no enseñan nada
+#define SOIL_MODEL_LEVEL_TAU_S 20           // suavizado de la humedad
+#define SOIL_MODEL_RISE_STEP 0.5f           // % que cuenta como "sigue subiendo"
+#define SOIL_MODEL_STALL_MIN_MS 5000        // estancado: sin subir en el último
+#define SOIL_MODEL_STALL_FRACTION 4         // 1/4 del riego (y al menos 5 s)
+#define SOIL_MODEL_DRY_RISE 1.0f            // %/h de subida sin bomba: lluvia
+#define SOIL_MODEL_CEILING_MARGIN 1.0f      // % bajo el techo que ya es saturado
+#define SOIL_MODEL_GAIN_ALPHA 0.3f
+#define SOIL_MODEL_DRY_ALPHA 0.2f
+#define SOIL_MODEL_GAIN_MIN 0.005f          // %/s, fuera de esto es un sensor roto
+#define SOIL_MODEL_GAIN_MAX 5.0f
+#define SOIL_MODEL_DRY_MAX 20.0f            // %/h
+#define SOIL_MODEL_MIN_DURATION_S 2
+#define SOIL_MODEL_MAX_FACTOR 2             // tope: 2x wateringDuration configurada
+
+#define SOIL_MODEL_PARAMS_VERSION 2
+
+// Lo que se persiste (blob en NVS por canal)
+typedef struct {
+    uint8_t version;
+    float gain_per_s;
+    float dry_per_hour;
+    uint16_t gain_samples;
+    uint16_t dry_samples;
+    float ceiling;                  // pico más alto de un riego (techo del suelo)
+} soil_model_params_t;
+
+typedef struct {
+    soil_model_params_t params;
+
+    // Humedad suavizada (EWMA por tiempo, ver SOIL_MODEL_LEVEL_TAU_S)
+    bool has_level;
+    float level;
+    TickType_t level_tick;
+
+    // Riego en curso o recién terminado
+    bool watering;
+    bool settling;
+    TickType_t pump_on_tick;
+    TickType_t pump_off_tick;
+    TickType_t cycle_start_tick;
+    TickType_t settle_deadline;
+    float start_moisture;
+    float peak_moisture;
+    TickType_t peak_tick;
+    uint32_t pumped_ms;
+    float rise_mark;                // último nivel que subió SOIL_MODEL_RISE_STEP
+    TickType_t rise_tick;
+
+    // Ventana de secado
+    bool has_anchor;
+    TickType_t anchor_tick;
+    float anchor_moisture;
+} soil_model_t;
+
+void soil_model_reset(soil_model_t *model);
+// Carga parámetros guardados; false si el blob no es válido
+bool soil_model_import(soil_model_t *model, const soil_model_params_t *params);
+
+// La bomba del canal cambió; moisture = última lectura del suelo
+void soil_model_pump_changed(soil_model_t *model, bool on, float moisture, TickType_t now);
+// Nueva lectura del suelo. Devuelve true si cambió algún parámetro aprendido
+bool soil_model_observe(soil_model_t *model, float moisture, TickType_t now);
+
+bool soil_model_ready(const soil_model_t *model);
+// Segundos de bomba para llevar la humedad hasta target; fallback_s mientras
+// el modelo no esté listo
+uint32_t soil_model_duration_s(const soil_model_t *model, float moisture, float target, uint32_t fallback_s);
+// Horas hasta que la humedad caiga a threshold (-1 si no se sabe)
+float soil_model_hours_until(const soil_model_t *model, float moisture, float threshold);
+
+#endif // SOIL_MODEL_H
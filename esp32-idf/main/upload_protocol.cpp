@@ -0,0 +1,141 @@
+/*
+ * AgroMind - Protocolo de subida (ver upload_protocol.h)
+ */
+
+#include <math.h>
+#include "esp_log.h"
+
+#include "upload_protocol.h"
+
+static const char *TAG = "AGROMIND";
+
+void upload_add_reading(cJSON *sensors, const char *field, float value, sensor_quality_t quality) {
+    if (sensor_quality_usable(quality)) {
+        cJSON_AddNumberToObject(sensors, field, value);
+    } else {
+        cJSON_AddNullToObject(sensors, field);
+    }
+    if (quality == SENSOR_QUALITY_OK) {
+        return;
+    }
+    cJSON *quality_obj = cJSON_GetObjectItem(sensors, "quality");
+    if (quality_obj == NULL) {
+        quality_obj = cJSON_AddObjectToObject(sensors, "quality");
+    }
+    cJSON_AddStringToObject(quality_obj, field, sensor_quality_name(quality));
+}
+
+void upload_add_pump_meter(cJSON *sensors, uint32_t sessions, double runtime_ms, double liters) {
+    cJSON_AddNumberToObject(sensors, "pumpSessions", sessions);
+    cJSON_AddNumberToObject(sensors, "pumpRuntimeMs", floor(runtime_ms));
+    cJSON_AddNumberToObject(sensors, "waterUsedLiters", round(liters * 100.0) / 100.0);
+}
+
+cJSON *upload_build_payload(const node_state_t *node) {
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON *sensors = cJSON_CreateObject();
+    upload_add_reading(sensors, "temperature", node->temperature_c, node->temperature_quality);
+    upload_add_reading(sensors, "ambientHumidity", node->ambient_humidity, node->humidity_quality);
+    upload_add_reading(sensors, "waterLevel", node->tank_level, node->tank_quality);
+    upload_add_reading(sensors, "lightLevel", node->light_level, node->light_quality);
+    cJSON_AddItemToObject(root, "sensors", sensors);
+
+    cJSON *zone_array = cJSON_CreateArray();
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        const zone_state_t *zone = &node->zones[ch];
+        if (zone->zone_id <= 0) {
+            continue;
+        }
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "zoneId", zone->zone_id);
+        cJSON_AddNumberToObject(entry, "channel", ch);
+        cJSON *zone_sensors = cJSON_CreateObject();
+        upload_add_reading(zone_sensors, "soilMoisture", zone->last_soil_moisture, zone->soil_quality);
+        cJSON_AddBoolToObject(zone_sensors, "pumpStatus", zone->pump_state);
+        upload_add_pump_meter(zone_sensors, zone->meter.sessions,
+                              (double)zone->meter.total_runtime_us / 1000.0, zone_pump_liters(node, ch));
+        cJSON_AddItemToObject(entry, "sensors", zone_sensors);
+        if (zone->config_pending) {
+            cJSON *local_config = cJSON_AddObjectToObject(entry, "localConfig");
+            cJSON_AddBoolToObject(local_config, "autoMode", zone->auto_mode_enabled);
+            cJSON_AddNumberToObject(local_config, "moistureThreshold", zone->moisture_threshold);
+            cJSON_AddNumberToObject(local_config, "wateringDuration", zone->watering_duration);
+        }
+        if (zone->rule_blocked) {
+            cJSON_AddBoolToObject(entry, "ruleBlocked", true);
+        }
+        cJSON_AddItemToArray(zone_array, entry);
+    }
+    cJSON_AddItemToObject(root, "zones", zone_array);
+
+    return root;
+}
+
+static void handle_zone_results(node_state_t *node, const cJSON *zone_results) {
+    const cJSON *result = NULL;
+    cJSON_ArrayForEach(result, zone_results) {
+        cJSON *zone_id_item = cJSON_GetObjectItem(result, "zoneId");
+        if (!zone_id_item || !cJSON_IsNumber(zone_id_item)) {
+            continue;
+        }
+        int channel = node_find_channel(node, (int32_t)cJSON_GetNumberValue(zone_id_item));
+        if (channel < 0) {
+            continue;
+        }
+
+        // Si la zona no existe (404), liberar solo ese canal
+        cJSON *status_item = cJSON_GetObjectItem(result, "status");
+        if (status_item && cJSON_IsNumber(status_item) &&
+            (int)cJSON_GetNumberValue(status_item) == 404) {
+            ESP_LOGW(TAG, "⚠️ Zona %ld no existe en el servidor", (long)node->zones[channel].zone_id);
+            ESP_LOGI(TAG, "🔄 Liberando canal %d, esperando nueva zona desde la app...", channel);
+            zone_release(node, channel);
+            continue;
+        }
+
+        cJSON *commands = cJSON_GetObjectItem(result, "commands");
+        if (commands && cJSON_IsObject(commands)) {
+            zone_apply_commands(node, channel, commands);
+        }
+    }
+}
+
+void upload_apply_response(node_state_t *node, const cJSON *root) {
+    // Respuesta multiplexada: { zones: [{ zoneId, status, commands }] }
+    cJSON *zone_results = cJSON_GetObjectItem(root, "zones");
+    if (zone_results && cJSON_IsArray(zone_results)) {
+        handle_zone_results(node, zone_results);
+    }
+
+    // Respuesta de una sola zona (backend anterior): aplica al canal 0
+    cJSON *commands = cJSON_GetObjectItem(root, "commands");
+    if (commands && cJSON_IsObject(commands) && node->zones[0].zone_id > 0) {
+        zone_apply_commands(node, 0, commands);
+    }
+
+    // Fallback para compatibilidad con respuestas antiguas
+    if (!cJSON_HasObjectItem(root, "commands") && !cJSON_HasObjectItem(root, "zones")) {
+        cJSON *pump_cmd = cJSON_GetObjectItem(root, "pumpCommand");
+        if (pump_cmd && cJSON_IsBool(pump_cmd)) {
+            bool requested_state = cJSON_IsTrue(pump_cmd);
+            if (requested_state != node->zones[0].pump_state) {
+                zone_set_pump_state(node, 0, requested_state);
+                node->zones[0].auto_watering_active = false;
+            }
+        }
+    }
+
+    // Aplicar lógica de auto-mode DESPUÉS de procesar comandos
+    zone_apply_auto_mode_all(node);
+}
+
+bool upload_handle_response(node_state_t *node, const char *body, size_t length) {
+    cJSON *root = cJSON_ParseWithLength(body, length);
+    if (root == NULL) {
+        return false;
+    }
+    upload_apply_response(node, root);
+    cJSON_Delete(root);
+    return true;
+}
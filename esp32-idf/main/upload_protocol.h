@@ -0,0 +1,53 @@
+/*
+ * AgroMind - Protocolo de subida a /api/iot/sensor-data
+ *
+ * Construye el POST multiplexado de un nodo y aplica la respuesta del
+ * servidor sobre su node_state_t. Lo comparten el firmware
+ * (send_sensor_data / http_event_handler) y el simulador de flota del host.
+ *
+ * Petición: { sensors: {compartidos},
+ *             zones: [{ zoneId, channel, sensors, localConfig?, ruleBlocked? }] }
+ *           (cada "sensors" puede traer quality: { campo: "filtered"|"held"|"invalid" };
+ *            el de cada zona trae sus contadores de riego; localConfig es la
+ *            config cambiada por la API local que el servidor debe adoptar;
+ *            ruleBlocked, que la regla de la zona impide el auto-riego)
+ * Respuesta: { success, zones: [{ zoneId, status, commands }] }
+ *            (commands.rule: bytecode de la regla en hex, ver rule_vm.h)
+ *            (o { commands } / { pumpCommand } de backends anteriores)
+ */
+
+#ifndef UPLOAD_PROTOCOL_H
+#define UPLOAD_PROTOCOL_H
+
+#include <stddef.h>
+#include "cJSON.h"
+#include "zone_control.h"
+
+// Tamaño suficiente para la respuesta multiplexada de todas las zonas,
+// cada una con una regla de RULE_MAX_CODE bytes en hex
+#define UPLOAD_RESPONSE_SIZE(channels) (256 + 384 * (channels))
+
+// Devuelve el documento a serializar (el llamador hace cJSON_Delete)
+cJSON *upload_build_payload(const node_state_t *node);
+
+// Agrega un valor de sensor con su calidad (sensor_filter.h): INVALID va
+// como null y la calidad se agrega en sensors.quality solo si no es "ok",
+// así el caso normal no agranda el payload. El backend asocia la calidad
+// al valor del mismo objeto.
+void upload_add_reading(cJSON *sensors, const char *field, float value, sensor_quality_t quality);
+
+// Contadores de riego acumulados del canal (pumpSessions, pumpRuntimeMs,
+// waterUsedLiters). El backend suma la diferencia con la subida anterior;
+// si bajan (corte de luz antes de guardarlos, zona re-vinculada) toma el
+// valor como nuevo origen sin sumar nada.
+void upload_add_pump_meter(cJSON *sensors, uint32_t sessions, double runtime_ms, double liters);
+
+// Aplica comandos por zona, libera canales con 404 y corre el modo automático.
+// Devuelve false si el cuerpo no es JSON válido.
+bool upload_handle_response(node_state_t *node, const char *body, size_t length);
+
+// Igual, sobre una respuesta ya parseada (el gateway la reparte también a
+// sus hojas). Las zonas que no son de este nodo se ignoran.
+void upload_apply_response(node_state_t *node, const cJSON *root);
+
+#endif // UPLOAD_PROTOCOL_H
@@ -0,0 +1,179 @@
+/*
+ * AgroMind - Subida no bloqueante (ver upload_session.h)
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "upload_session.h"
+
+static const char *TAG = "SUBIDA";
+
+void upload_session_init(upload_session_t *session, const upload_limits_t *limits) {
+    memset(session, 0, sizeof(*session));
+    session->limits = *limits;
+    session->phase = UPLOAD_PHASE_IDLE;
+}
+
+upload_cycle_t upload_session_cycle(upload_session_t *session, int64_t late_us) {
+    upload_stats_t *stats = &session->stats;
+    late_us = late_us > 0 ? late_us : 0;
+    stats->cycles++;
+    stats->late_total_us += late_us;
+    stats->late_max_us = late_us > stats->late_max_us ? late_us : stats->late_max_us;
+
+    if (session->phase == UPLOAD_PHASE_IDLE) {
+        return UPLOAD_CYCLE_START;
+    }
+    if (session->phase == UPLOAD_PHASE_CONNECT) {
+        stats->superseded++;
+        return UPLOAD_CYCLE_REPLACE;
+    }
+    // El payload pendiente se arma recién al terminar: un ciclo nuevo deja
+    // sin subir la lectura del anterior
+    if (session->pending) {
+        stats->superseded++;
+    } else {
+        session->pending = true;
+        stats->deferred++;
+    }
+    return UPLOAD_CYCLE_DEFER;
+}
+
+void upload_session_start(upload_session_t *session, int64_t now_us) {
+    session->phase = UPLOAD_PHASE_CONNECT;
+    session->pending = false;
+    session->started_us = now_us;
+    session->phase_started_us = now_us;
+    session->stats.started++;
+}
+
+static void close_phase(upload_session_t *session, int64_t now_us) {
+    int64_t elapsed_us = now_us - session->phase_started_us;
+    int64_t *max_us = &session->stats.phase_max_us[session->phase];
+    *max_us = elapsed_us > *max_us ? elapsed_us : *max_us;
+}
+
+void upload_session_advance(upload_session_t *session, upload_phase_t phase, int64_t now_us) {
+    if (session->phase == UPLOAD_PHASE_IDLE || phase <= session->phase) {
+        return;
+    }
+    close_phase(session, now_us);
+    session->phase = phase;
+    session->phase_started_us = now_us;
+}
+
+void upload_session_note_call(upload_session_t *session, int64_t duration_us) {
+    upload_stats_t *stats = &session->stats;
+    stats->calls++;
+    stats->call_total_us += duration_us;
+    stats->call_max_us = duration_us > stats->call_max_us ? duration_us : stats->call_max_us;
+}
+
+static uint32_t phase_limit_ms(const upload_session_t *session) {
+    switch (session->phase) {
+        case UPLOAD_PHASE_CONNECT: return session->limits.connect_ms;
+        case UPLOAD_PHASE_SEND: return session->limits.send_ms;
+        case UPLOAD_PHASE_RECEIVE: return session->limits.receive_ms;
+        default: return 0;
+    }
+}
+
+bool upload_session_expired(const upload_session_t *session, int64_t now_us, upload_end_t *reason) {
+    if (session->phase == UPLOAD_PHASE_IDLE) {
+        return false;
+    }
+    if (now_us - session->phase_started_us > (int64_t)phase_limit_ms(session) * 1000) {
+        *reason = UPLOAD_END_TIMEOUT;
+        return true;
+    }
+    if (now_us - session->started_us > (int64_t)session->limits.budget_ms * 1000) {
+        *reason = UPLOAD_END_BUDGET;
+        return true;
+    }
+    return false;
+}
+
+bool upload_session_finish(upload_session_t *session, upload_end_t end, int64_t now_us) {
+    if (session->phase == UPLOAD_PHASE_IDLE) {
+        return false;
+    }
+    upload_stats_t *stats = &session->stats;
+    close_phase(session, now_us);
+    if (end == UPLOAD_END_TIMEOUT) {
+        stats->timeouts[session->phase]++;
+    }
+    stats->ended[end]++;
+    stats->upload_last_us = now_us - session->started_us;
+    stats->upload_max_us = stats->upload_last_us > stats->upload_max_us ? stats->upload_last_us : stats->upload_max_us;
+
+    session->phase = UPLOAD_PHASE_IDLE;
+    bool pending = session->pending;
+    session->pending = false;
+    return pending;
+}
+
+const char *upload_phase_name(upload_phase_t phase) {
+    switch (phase) {
+        case UPLOAD_PHASE_IDLE: return "inactiva";
+        case UPLOAD_PHASE_CONNECT: return "conexión";
+        case UPLOAD_PHASE_SEND: return "envío";
+        case UPLOAD_PHASE_RECEIVE: return "recepción";
+        default: return "?";
+    }
+}
+
+const char *upload_end_name(upload_end_t end) {
+    switch (end) {
+        case UPLOAD_END_OK: return "ok";
+        case UPLOAD_END_ERROR: return "error";
+        case UPLOAD_END_TIMEOUT: return "plazo vencido";
+        case UPLOAD_END_BUDGET: return "sin presupuesto";
+        default: return "?";
+    }
+}
+
+static double to_ms(int64_t us) {
+    return (double)(us / 100) / 10.0;
+}
+
+void upload_session_report(const upload_session_t *session) {
+    const upload_stats_t *stats = &session->stats;
+    ESP_LOGI(TAG, "📊 Subidas: %lu iniciadas, %lu ok, %lu error, %lu plazo vencido, %lu sin presupuesto",
+             (unsigned long)stats->started, (unsigned long)stats->ended[UPLOAD_END_OK],
+             (unsigned long)stats->ended[UPLOAD_END_ERROR], (unsigned long)stats->ended[UPLOAD_END_TIMEOUT],
+             (unsigned long)stats->ended[UPLOAD_END_BUDGET]);
+    ESP_LOGI(TAG, "   plazos vencidos: conexión %lu, envío %lu, recepción %lu",
+             (unsigned long)stats->timeouts[UPLOAD_PHASE_CONNECT], (unsigned long)stats->timeouts[UPLOAD_PHASE_SEND],
+             (unsigned long)stats->timeouts[UPLOAD_PHASE_RECEIVE]);
+    ESP_LOGI(TAG, "   lecturas reemplazadas %lu, ciclos en espera %lu",
+             (unsigned long)stats->superseded, (unsigned long)stats->deferred);
+    ESP_LOGI(TAG, "   bloqueo por paso: máx. %.1f ms, medio %.2f ms (%lu pasos)", to_ms(stats->call_max_us),
+             stats->calls > 0 ? (double)stats->call_total_us / 1000.0 / (double)stats->calls : 0.0,
+             (unsigned long)stats->calls);
+    ESP_LOGI(TAG, "   subida: última %.1f ms, máx. %.1f ms; atraso de ciclo máx. %.1f ms",
+             to_ms(stats->upload_last_us), to_ms(stats->upload_max_us), to_ms(stats->late_max_us));
+}
+
+void upload_session_add_json(const upload_session_t *session, cJSON *parent) {
+    const upload_stats_t *stats = &session->stats;
+    cJSON *upload = cJSON_AddObjectToObject(parent, "upload");
+    cJSON_AddStringToObject(upload, "phase", upload_phase_name(session->phase));
+    cJSON_AddNumberToObject(upload, "started", stats->started);
+    cJSON_AddNumberToObject(upload, "ok", stats->ended[UPLOAD_END_OK]);
+    cJSON_AddNumberToObject(upload, "errors", stats->ended[UPLOAD_END_ERROR]);
+    cJSON_AddNumberToObject(upload, "overBudget", stats->ended[UPLOAD_END_BUDGET]);
+
+    cJSON *timeouts = cJSON_AddObjectToObject(upload, "timeouts");
+    cJSON_AddNumberToObject(timeouts, "connect", stats->timeouts[UPLOAD_PHASE_CONNECT]);
+    cJSON_AddNumberToObject(timeouts, "send", stats->timeouts[UPLOAD_PHASE_SEND]);
+    cJSON_AddNumberToObject(timeouts, "receive", stats->timeouts[UPLOAD_PHASE_RECEIVE]);
+
+    cJSON_AddNumberToObject(upload, "superseded", stats->superseded);
+    cJSON_AddNumberToObject(upload, "deferred", stats->deferred);
+    cJSON_AddNumberToObject(upload, "maxStallMs", to_ms(stats->call_max_us));
+    cJSON_AddNumberToObject(upload, "lastUploadMs", to_ms(stats->upload_last_us));
+    cJSON_AddNumberToObject(upload, "maxUploadMs", to_ms(stats->upload_max_us));
+    cJSON_AddNumberToObject(upload, "maxCycleLateMs", to_ms(stats->late_max_us));
+}
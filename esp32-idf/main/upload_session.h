@@ -0,0 +1,119 @@
+/*
+ * AgroMind - Subida no bloqueante: plazos, presupuesto y estadísticas
+ *
+ * sensor_task no espera a que termine el POST: lo arranca y en cada vuelta
+ * lo avanza un paso (esp_http_client en modo is_async, cada llamada
+ * bloquea como mucho UPLOAD_IO_TIMEOUT_MS) mientras sigue leyendo los
+ * sensores a su ritmo. Este módulo decide, sin tocar la red:
+ *
+ *   - Plazos por fase: conexión (DNS + TCP + TLS), envío de la petición y
+ *     recepción de la respuesta. Si una fase se pasa, la subida se aborta.
+ *   - Presupuesto total por subida, desde que arrancó, aunque cada fase
+ *     vaya dentro de su plazo.
+ *   - Qué hacer con la lectura de un ciclo nuevo si la subida anterior no
+ *     terminó: si su payload todavía no salió (conectando) se reemplaza por
+ *     el nuevo; si ya se envió, el ciclo queda pendiente y sube apenas
+ *     termine. Un pendiente que no llegó a salir lo reemplaza el siguiente.
+ *   - Cuánto bloqueó cada paso a sensor_task y cuánto se atrasó cada ciclo
+ *     de lectura, para medir el efecto contra un servidor lento
+ *     (host/tools/upload_stall_bench).
+ *
+ * Portable: los tiempos los pasa el llamador (µs de esp_timer).
+ */
+
+#ifndef UPLOAD_SESSION_H
+#define UPLOAD_SESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cJSON.h"
+
+typedef enum {
+    UPLOAD_PHASE_IDLE = 0,
+    UPLOAD_PHASE_CONNECT,           // DNS, TCP y TLS
+    UPLOAD_PHASE_SEND,              // conectado, escribiendo la petición
+    UPLOAD_PHASE_RECEIVE,           // petición enviada, esperando la respuesta completa
+    UPLOAD_PHASE_COUNT
+} upload_phase_t;
+
+typedef enum {
+    UPLOAD_END_OK = 0,              // respuesta completa (cualquier status HTTP)
+    UPLOAD_END_ERROR,               // error de red, TLS o HTTP
+    UPLOAD_END_TIMEOUT,             // una fase pasó su plazo
+    UPLOAD_END_BUDGET,              // la subida pasó su presupuesto total
+    UPLOAD_END_COUNT
+} upload_end_t;
+
+// Qué hacer con la lectura de un ciclo nuevo
+typedef enum {
+    UPLOAD_CYCLE_START = 0,         // no hay subida en curso: arrancar una
+    UPLOAD_CYCLE_REPLACE,           // la subida en curso no envió nada: cambiar su payload
+    UPLOAD_CYCLE_DEFER,             // ya envió: subir cuando termine
+} upload_cycle_t;
+
+typedef struct {
+    uint32_t connect_ms;
+    uint32_t send_ms;
+    uint32_t receive_ms;
+    uint32_t budget_ms;             // total por subida
+} upload_limits_t;
+
+typedef struct {
+    uint32_t started;
+    uint32_t ended[UPLOAD_END_COUNT];
+    uint32_t timeouts[UPLOAD_PHASE_COUNT];  // fase en la que venció el plazo
+    uint32_t superseded;            // lecturas reemplazadas antes de salir
+    uint32_t deferred;              // ciclos que esperaron a la subida anterior
+    uint32_t calls;                 // pasos de la subida
+    int64_t call_total_us;
+    int64_t call_max_us;            // lo máximo que un paso bloqueó a sensor_task
+    int64_t upload_last_us;
+    int64_t upload_max_us;
+    int64_t phase_max_us[UPLOAD_PHASE_COUNT];
+    uint32_t cycles;
+    int64_t late_total_us;
+    int64_t late_max_us;            // atraso máximo de un ciclo de lectura
+} upload_stats_t;
+
+typedef struct {
+    upload_limits_t limits;
+    upload_phase_t phase;
+    bool pending;                   // hay un ciclo esperando a esta subida
+    int64_t started_us;
+    int64_t phase_started_us;
+    upload_stats_t stats;
+} upload_session_t;
+
+void upload_session_init(upload_session_t *session, const upload_limits_t *limits);
+
+static inline bool upload_session_active(const upload_session_t *session) {
+    return session->phase != UPLOAD_PHASE_IDLE;
+}
+
+// Ciclo de lectura nuevo, late_us después de lo previsto
+upload_cycle_t upload_session_cycle(upload_session_t *session, int64_t late_us);
+
+void upload_session_start(upload_session_t *session, int64_t now_us);
+
+// El transporte avisa que llegó a una fase; los retrocesos se ignoran
+// (con keep-alive la conexión ya está hecha y se pasa directo a enviar)
+void upload_session_advance(upload_session_t *session, upload_phase_t phase, int64_t now_us);
+
+// Un paso de la subida que bloqueó duration_us
+void upload_session_note_call(upload_session_t *session, int64_t duration_us);
+
+// true si pasó el plazo de la fase o el presupuesto; reason dice cuál
+bool upload_session_expired(const upload_session_t *session, int64_t now_us, upload_end_t *reason);
+
+// Termina la subida. true si hay un ciclo pendiente que debe subir ya
+bool upload_session_finish(upload_session_t *session, upload_end_t end, int64_t now_us);
+
+const char *upload_phase_name(upload_phase_t phase);
+const char *upload_end_name(upload_end_t end);
+
+void upload_session_report(const upload_session_t *session);
+
+// Agrega "upload" con las estadísticas (para /info)
+void upload_session_add_json(const upload_session_t *session, cJSON *parent);
+
+#endif // UPLOAD_SESSION_H
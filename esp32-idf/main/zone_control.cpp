@@ -0,0 +1,537 @@
+/*
+ * AgroMind - Lógica de control de zonas (ver zone_control.h)
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "zone_control.h"
+
+static const char *TAG = "AGROMIND";
+
+void node_state_init(node_state_t *node, int channel_count, const node_hooks_t *hooks) {
+    memset(node, 0, sizeof(*node));
+    node->channel_count = channel_count > MAX_ZONE_CHANNELS ? MAX_ZONE_CHANNELS : channel_count;
+    node->state_version = 1;
+    node->pump_flow_lph = DEFAULT_PUMP_FLOW_LPH;
+    if (hooks != NULL) {
+        node->hooks = *hooks;
+    }
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        zone_state_t *zone = &node->zones[ch];
+        zone->moisture_threshold = 30.0f;
+        zone->watering_duration = 10;
+        soil_model_reset(&zone->soil);
+    }
+}
+
+void node_state_touch(node_state_t *node) {
+    node->state_version = node->state_version + 1;
+}
+
+int node_configured_zone_count(const node_state_t *node) {
+    int count = 0;
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        if (node->zones[ch].zone_id > 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int node_find_channel(const node_state_t *node, int32_t zone_id) {
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        if (zone_id > 0 && node->zones[ch].zone_id == zone_id) {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+// Comparación segura ante el desborde de TickType_t (cada 49.7 días a 1000 Hz)
+static bool tick_reached(TickType_t now, TickType_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+// ==================== CONTROL DE BOMBA ====================
+
+static void pump_meter_record(pump_meter_t *meter, bool was_on, bool on) {
+    int64_t now_us = esp_timer_get_time();
+    if (on && !was_on) {
+        meter->on_since_us = now_us;
+    } else if (!on && was_on && meter->on_since_us > 0) {
+        uint64_t duration_us = (uint64_t)(now_us - meter->on_since_us);
+        meter->total_runtime_us += duration_us;
+        meter->sessions++;
+        meter->last_session_us = duration_us > UINT32_MAX ? UINT32_MAX : (uint32_t)duration_us;
+        meter->on_since_us = 0;
+        meter->dirty = true;
+    }
+}
+
+void zone_set_pump_state(node_state_t *node, int channel, bool state) {
+    zone_state_t *zone = &node->zones[channel];
+    soil_model_pump_changed(&zone->soil, state, zone->last_soil_moisture, xTaskGetTickCount());
+    pump_meter_record(&zone->meter, zone->pump_state, state);
+    zone->pump_state = state;
+    node_state_touch(node);
+    if (node->hooks.set_relay != NULL) {
+        node->hooks.set_relay(node->hooks.ctx, channel, state);
+    }
+}
+
+double zone_pump_liters(const node_state_t *node, int channel) {
+    return (double)node->zones[channel].meter.total_runtime_us / 3600e6 * node->pump_flow_lph;
+}
+
+void zone_release(node_state_t *node, int channel) {
+    zone_state_t *zone = &node->zones[channel];
+    if (zone->pump_state) {
+        zone_set_pump_state(node, channel, false);
+    }
+    zone->zone_id = 0;
+    zone->auto_watering_active = false;
+    zone->config_pending = false;
+    zone->rule.length = 0;
+    zone->rule_blocked = false;
+    soil_model_reset(&zone->soil);
+    memset(&zone->meter, 0, sizeof(zone->meter));
+    node_state_touch(node);
+    if (node->hooks.zone_released != NULL) {
+        node->hooks.zone_released(node->hooks.ctx, channel);
+    }
+}
+
+void zone_observe_moisture(node_state_t *node, int channel, float moisture, sensor_quality_t quality) {
+    zone_state_t *zone = &node->zones[channel];
+    zone->last_soil_moisture = moisture;
+    zone->soil_quality = quality;
+    if (!sensor_quality_fresh(quality) || !soil_model_observe(&zone->soil, moisture, xTaskGetTickCount())) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "📈 Modelo suelo [canal %d]: +%.3f%%/s de bomba (%u riegos), -%.2f%%/h (%u ventanas)",
+             channel, zone->soil.params.gain_per_s, (unsigned)zone->soil.params.gain_samples,
+             zone->soil.params.dry_per_hour, (unsigned)zone->soil.params.dry_samples);
+    node_state_touch(node);
+    if (node->hooks.soil_model_updated != NULL) {
+        node->hooks.soil_model_updated(node->hooks.ctx, channel);
+    }
+}
+
+// Valores de "commands" con las mismas reglas que zone_update_configuration
+static bool read_auto_mode(const cJSON *commands, bool *value) {
+    cJSON *item = cJSON_GetObjectItem(commands, "autoMode");
+    if (item == NULL || !cJSON_IsBool(item)) {
+        return false;
+    }
+    *value = cJSON_IsTrue(item);
+    return true;
+}
+
+static bool read_threshold(const cJSON *commands, float *value) {
+    cJSON *item = cJSON_GetObjectItem(commands, "moistureThreshold");
+    if (item == NULL || !cJSON_IsNumber(item) || (float)cJSON_GetNumberValue(item) <= 0.0f) {
+        return false;
+    }
+    *value = (float)cJSON_GetNumberValue(item);
+    return true;
+}
+
+static bool read_duration(const cJSON *commands, uint32_t *value) {
+    cJSON *item = cJSON_GetObjectItem(commands, "wateringDuration");
+    if (item == NULL || !cJSON_IsNumber(item)) {
+        return false;
+    }
+    double raw_duration = cJSON_GetNumberValue(item);
+    *value = raw_duration < 1.0 ? 1U : (uint32_t)raw_duration;
+    return true;
+}
+
+// true si aplicar "commands" no cambiaría la configuración de la zona
+static bool zone_config_matches(const zone_state_t *zone, const cJSON *commands) {
+    bool auto_mode;
+    float threshold;
+    uint32_t duration;
+    if (read_auto_mode(commands, &auto_mode) && auto_mode != zone->auto_mode_enabled) {
+        return false;
+    }
+    if (read_threshold(commands, &threshold) && threshold != zone->moisture_threshold) {
+        return false;
+    }
+    if (read_duration(commands, &duration) && duration != zone->watering_duration) {
+        return false;
+    }
+    return true;
+}
+
+bool zone_update_configuration(node_state_t *node, int channel, const cJSON *commands) {
+    if (commands == NULL) {
+        return false;
+    }
+
+    zone_state_t *zone = &node->zones[channel];
+    bool previous_auto_mode = zone->auto_mode_enabled;
+    bool config_changed = false;
+
+    bool new_auto_mode;
+    if (read_auto_mode(commands, &new_auto_mode) && new_auto_mode != zone->auto_mode_enabled) {
+        zone->auto_mode_enabled = new_auto_mode;
+        config_changed = true;
+    }
+
+    if (previous_auto_mode && !zone->auto_mode_enabled && zone->auto_watering_active) {
+        zone->auto_watering_active = false;
+        if (zone->pump_state) {
+            zone_set_pump_state(node, channel, false);
+            ESP_LOGI(TAG, "Modo auto desactivado, bomba apagada");
+        }
+    }
+
+    float new_threshold;
+    if (read_threshold(commands, &new_threshold) && new_threshold != zone->moisture_threshold) {
+        zone->moisture_threshold = new_threshold;
+        config_changed = true;
+    }
+
+    uint32_t new_duration;
+    if (read_duration(commands, &new_duration) && new_duration != zone->watering_duration) {
+        zone->watering_duration = new_duration;
+        config_changed = true;
+    }
+
+    if (config_changed) {
+        node_state_touch(node);
+        ESP_LOGI(TAG, "Config zona %ld [canal %d] -> auto:%s umbral:%.1f%% dur:%us",
+                 (long)zone->zone_id,
+                 channel,
+                 zone->auto_mode_enabled ? "ON" : "OFF",
+                 zone->moisture_threshold,
+                 (unsigned)zone->watering_duration);
+    }
+    return config_changed;
+}
+
+// "rule": bytecode en hex, "" = sin regla. Llega en cada respuesta: solo se
+// verifica y se persiste si cambió, y una regla rechazada no se vuelve a
+// verificar (ni a loguear) hasta que el servidor mande otra.
+static uint32_t rule_source_hash(const char *text) {
+    uint32_t hash = 2166136261u;    // FNV-1a
+    for (const char *c = text; *c != '\0'; ++c) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    return hash;
+}
+
+static void zone_update_rule(node_state_t *node, int channel, const cJSON *commands) {
+    cJSON *item = cJSON_GetObjectItem(commands, "rule");
+    if (item == NULL || !cJSON_IsString(item)) {
+        return;  // backend sin reglas: se conserva la guardada
+    }
+    zone_state_t *zone = &node->zones[channel];
+    uint32_t hash = rule_source_hash(item->valuestring);
+    if (hash == zone->rule_rejected_hash) {
+        return;
+    }
+
+    uint8_t code[RULE_MAX_CODE];
+    size_t length = 0;
+    if (!rule_hex_decode(item->valuestring, code, &length)) {
+        zone->rule_rejected_hash = hash;
+        ESP_LOGE(TAG, "❌ Regla rechazada [canal %d]: no es bytecode en hex", channel);
+        return;
+    }
+    if (length == zone->rule.length && memcmp(code, zone->rule.code, length) == 0) {
+        return;
+    }
+
+    if (length == 0) {
+        zone->rule.length = 0;
+        ESP_LOGI(TAG, "📜 Regla de riego [canal %d] eliminada", channel);
+    } else {
+        rule_verify_t result = rule_program_load(&zone->rule, code, length);
+        if (result != RULE_VERIFY_OK) {
+            zone->rule_rejected_hash = hash;
+            ESP_LOGE(TAG, "❌ Regla rechazada [canal %d]: %s", channel, rule_verify_name(result));
+            return;
+        }
+        ESP_LOGI(TAG, "📜 Regla de riego [canal %d]: %u bytes", channel, (unsigned)length);
+    }
+    zone->rule_rejected_hash = 0;
+    zone->rule_blocked = false;
+    node_state_touch(node);
+    if (node->hooks.rule_updated != NULL) {
+        node->hooks.rule_updated(node->hooks.ctx, channel);
+    }
+}
+
+static rule_result_t zone_eval_rule(const node_state_t *node, const zone_state_t *zone) {
+    rule_inputs_t inputs;
+    inputs.values[RULE_VAR_SOIL] = zone->last_soil_moisture;
+    inputs.values[RULE_VAR_TANK] = node->tank_level;
+    inputs.values[RULE_VAR_TEMPERATURE] = node->temperature_c;
+    inputs.values[RULE_VAR_HUMIDITY] = node->ambient_humidity;
+    inputs.values[RULE_VAR_LIGHT] = node->light_level;
+    inputs.values[RULE_VAR_THRESHOLD] = zone->moisture_threshold;
+    inputs.valid = (sensor_quality_usable(zone->soil_quality) ? 1U << RULE_VAR_SOIL : 0) |
+                   (sensor_quality_usable(node->tank_quality) ? 1U << RULE_VAR_TANK : 0) |
+                   (sensor_quality_usable(node->temperature_quality) ? 1U << RULE_VAR_TEMPERATURE : 0) |
+                   (sensor_quality_usable(node->humidity_quality) ? 1U << RULE_VAR_HUMIDITY : 0) |
+                   (sensor_quality_usable(node->light_quality) ? 1U << RULE_VAR_LIGHT : 0) |
+                   (1U << RULE_VAR_THRESHOLD);
+    return rule_eval(&zone->rule, &inputs);
+}
+
+// El auto-riego en curso termina al llegar a umbral + histéresis o al vencer su plazo
+static bool auto_watering_done(const zone_state_t *zone, TickType_t now, bool *recovered) {
+    *recovered = sensor_quality_usable(zone->soil_quality) &&
+                 zone->last_soil_moisture >= (zone->moisture_threshold + MOISTURE_HYSTERESIS);
+    return *recovered || tick_reached(now, zone->auto_watering_deadline);
+}
+
+void zone_apply_auto_mode(node_state_t *node, int channel) {
+    zone_state_t *zone = &node->zones[channel];
+
+    // Si el modo automático está desactivado, asegurarse de que la bomba esté apagada
+    // (a menos que haya un comando manual activo)
+    if (!zone->auto_mode_enabled) {
+        if (zone->auto_watering_active) {
+            zone->auto_watering_active = false;
+            if (zone->pump_state) {
+                zone_set_pump_state(node, channel, false);
+                ESP_LOGI(TAG, "Modo auto desactivado - bomba apagada");
+            }
+        }
+        return;
+    }
+
+    ESP_LOGI(TAG, "🌱 Auto-mode check [canal %d]: moisture=%.1f%% threshold=%.1f%% tank=%.1f%% pump=%s",
+             channel, zone->last_soil_moisture, zone->moisture_threshold, node->tank_level,
+             zone->pump_state ? "ON" : "OFF");
+
+    if (node->tank_level <= 0.0f && zone->last_soil_moisture <= 0.0f) {
+        ESP_LOGW(TAG, "⚠️ Sin lecturas de sensores todavía");
+        return;  // aún no hay lecturas recientes
+    }
+
+    // Sin nivel de tanque o humedad fiables no se decide nada nuevo: un
+    // riego en curso solo termina por su plazo
+    bool tank_usable = sensor_quality_usable(node->tank_quality);
+    bool soil_usable = sensor_quality_usable(zone->soil_quality);
+
+    // Si el tanque está muy bajo, apagar la bomba
+    if (tank_usable && node->tank_level <= MIN_TANK_PERCENTAGE) {
+        if (zone->pump_state) {
+            zone_set_pump_state(node, channel, false);
+        }
+        if (zone->auto_watering_active) {
+            zone->auto_watering_active = false;
+            ESP_LOGW(TAG, "Auto-riego cancelado: tanque en %.1f%%", node->tank_level);
+        }
+        return;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+
+    // Si hay auto-riego activo, verificar si debe terminar
+    if (zone->auto_watering_active) {
+        bool recovered;
+        if (auto_watering_done(zone, now, &recovered)) {
+            zone->auto_watering_active = false;
+            zone_set_pump_state(node, channel, false);
+            ESP_LOGI(TAG, "Auto-riego completado (%s)",
+                     recovered ? "umbral alcanzado" : "tiempo agotado");
+        }
+        return;
+    }
+
+    // Si la bomba está encendida pero NO hay auto-riego activo,
+    // es un estado manual - no interferir
+    if (zone->pump_state) {
+        ESP_LOGI(TAG, "Bomba ya encendida (modo manual), no interferir");
+        return;
+    }
+
+    if (!tank_usable || !soil_usable) {
+        ESP_LOGW(TAG, "⚠️ Lecturas no fiables [canal %d] (tanque %s, suelo %s), no se inicia riego",
+                 channel, sensor_quality_name(node->tank_quality), sensor_quality_name(zone->soil_quality));
+        return;
+    }
+
+    // La regla del usuario se evalúa con cada lectura (costo fijo). Sin
+    // datos para evaluarla decide solo el umbral, como sin regla
+    rule_result_t rule = zone_eval_rule(node, zone);
+    if ((rule == RULE_BLOCK) != zone->rule_blocked) {
+        zone->rule_blocked = rule == RULE_BLOCK;
+        node_state_touch(node);
+    }
+
+    // Verificar si debe iniciar auto-riego (humedad bajo el umbral)
+    if (zone->last_soil_moisture > 0.0f && zone->last_soil_moisture < zone->moisture_threshold) {
+        if (rule == RULE_BLOCK) {
+            ESP_LOGI(TAG, "📜 Regla de riego [canal %d]: humedad %.1f%% < umbral, pero no se riega",
+                     channel, zone->last_soil_moisture);
+            return;
+        }
+        if (rule == RULE_NO_DATA) {
+            ESP_LOGW(TAG, "⚠️ Regla sin lecturas fiables [canal %d], decide el umbral", channel);
+        }
+        // Con el modelo aprendido, el riego se dimensiona para llegar a
+        // umbral + histéresis; si no, se usa la duración configurada
+        float target = zone->moisture_threshold + MOISTURE_HYSTERESIS;
+        uint32_t duration_s = soil_model_duration_s(&zone->soil, zone->last_soil_moisture, target,
+                                                    zone->watering_duration);
+        zone->auto_watering_active = true;
+        zone->planned_duration_s = duration_s;
+        zone->auto_watering_deadline = now + pdMS_TO_TICKS(duration_s * 1000U);
+        zone_set_pump_state(node, channel, true);
+        ESP_LOGI(TAG, "🚿 AUTO-RIEGO INICIADO [canal %d]: humedad %.1f%% < umbral %.1f%%, %us (%s)",
+                 channel, zone->last_soil_moisture, zone->moisture_threshold, (unsigned)duration_s,
+                 soil_model_ready(&zone->soil) ? "modelo" : "configurado");
+    } else {
+        ESP_LOGI(TAG, "✓ Humedad OK (%.1f%% >= %.1f%%), no regar",
+                 zone->last_soil_moisture, zone->moisture_threshold);
+    }
+}
+
+bool node_tank_locked(const node_state_t *node) {
+    return sensor_quality_usable(node->tank_quality) && node->tank_level <= MIN_TANK_PERCENTAGE;
+}
+
+void zone_apply_auto_mode_all(node_state_t *node) {
+    bool tank_locked = node_tank_locked(node);
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        zone_state_t *zone = &node->zones[ch];
+        if (zone->zone_id <= 0) {
+            continue;
+        }
+        // Un riego manual (API local) no espera al tankLocked del servidor
+        if (tank_locked && zone->pump_state && !zone->auto_watering_active) {
+            zone_set_pump_state(node, ch, false);
+            ESP_LOGW(TAG, "Tanque en %.1f%%, bomba manual apagada [canal %d]", node->tank_level, ch);
+        }
+        zone_apply_auto_mode(node, ch);
+    }
+}
+
+bool node_any_pump_on(const node_state_t *node) {
+    for (int ch = 0; ch < node->channel_count; ++ch) {
+        if (node->zones[ch].pump_state) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void zone_fast_control(node_state_t *node, int channel) {
+    zone_state_t *zone = &node->zones[channel];
+    if (!zone->pump_state) {
+        return;
+    }
+    if (node_tank_locked(node)) {
+        zone->auto_watering_active = false;
+        zone_set_pump_state(node, channel, false);
+        ESP_LOGW(TAG, "Tanque en %.1f%%, bomba apagada [canal %d]", node->tank_level, channel);
+        return;
+    }
+    bool recovered;
+    if (zone->auto_watering_active && auto_watering_done(zone, xTaskGetTickCount(), &recovered)) {
+        zone->auto_watering_active = false;
+        zone_set_pump_state(node, channel, false);
+        ESP_LOGI(TAG, "Auto-riego completado [canal %d] (%s, %.1f%%)", channel,
+                 recovered ? "umbral alcanzado" : "tiempo agotado", zone->last_soil_moisture);
+    }
+}
+
+// Comando manual de bomba (pumpState explícito); cancela el auto-riego
+static void apply_manual_pump(node_state_t *node, int channel, bool requested_state) {
+    zone_state_t *zone = &node->zones[channel];
+    if (requested_state != zone->pump_state) {
+        zone_set_pump_state(node, channel, requested_state);
+        zone->auto_watering_active = false;
+        ESP_LOGI(TAG, "✅ Comando manual ejecutado: bomba %s", requested_state ? "ON" : "OFF");
+    } else {
+        ESP_LOGI(TAG, "ℹ️ Bomba ya está %s, no cambiar", zone->pump_state ? "ON" : "OFF");
+    }
+}
+
+// Aplica el objeto "commands" que el servidor devuelve para una zona
+void zone_apply_commands(node_state_t *node, int channel, const cJSON *commands) {
+    zone_state_t *zone = &node->zones[channel];
+
+    // Primero actualizar configuración. Con un cambio local pendiente la
+    // config del servidor solo se acepta cuando ya coincide con la local
+    // (el backend adoptó localConfig); si no, se conserva la local.
+    if (!zone->config_pending) {
+        zone_update_configuration(node, channel, commands);
+    } else if (zone_config_matches(zone, commands)) {
+        zone->config_pending = false;
+        node_state_touch(node);
+        ESP_LOGI(TAG, "☁️ Config local de zona %ld confirmada por el servidor", (long)zone->zone_id);
+    } else {
+        ESP_LOGI(TAG, "Config local pendiente [canal %d], se ignora la del servidor", channel);
+    }
+    // La regla solo la cambia el servidor (la API local no la toca)
+    zone_update_rule(node, channel, commands);
+
+    // Verificar si el tanque está bloqueado
+    cJSON *tank_locked = cJSON_GetObjectItem(commands, "tankLocked");
+    bool is_tank_locked = tank_locked && cJSON_IsTrue(tank_locked);
+
+    ESP_LOGI(TAG, "📥 Comandos zona %ld [canal %d] - tankLocked:%s",
+             (long)zone->zone_id, channel, is_tank_locked ? "true" : "false");
+
+    if (is_tank_locked) {
+        // Tanque bloqueado - apagar bomba si está encendida
+        if (zone->pump_state) {
+            zone_set_pump_state(node, channel, false);
+            zone->auto_watering_active = false;
+            ESP_LOGW(TAG, "Tanque bloqueado por servidor, bomba apagada");
+        }
+        return;
+    }
+
+    // Solo procesar comando de bomba si viene explícito (comando manual)
+    cJSON *pump_state_obj = cJSON_GetObjectItem(commands, "pumpState");
+
+    if (pump_state_obj == NULL) {
+        ESP_LOGI(TAG, "📥 pumpState: NULL (auto-mode decide)");
+    } else if (cJSON_IsNull(pump_state_obj)) {
+        ESP_LOGI(TAG, "📥 pumpState: null (auto-mode decide)");
+    } else if (cJSON_IsBool(pump_state_obj)) {
+        bool requested_state = cJSON_IsTrue(pump_state_obj);
+        ESP_LOGI(TAG, "📥 pumpState: %s (comando manual)", requested_state ? "true" : "false");
+        apply_manual_pump(node, channel, requested_state);
+    } else {
+        ESP_LOGW(TAG, "📥 pumpState: tipo desconocido");
+    }
+}
+
+zone_local_result_t zone_apply_local_commands(node_state_t *node, int channel, const cJSON *commands) {
+    zone_state_t *zone = &node->zones[channel];
+    if (zone->zone_id <= 0) {
+        return ZONE_LOCAL_UNPAIRED;
+    }
+
+    if (zone_update_configuration(node, channel, commands)) {
+        zone->config_pending = true;
+    }
+
+    cJSON *pump_state_obj = cJSON_GetObjectItem(commands, "pumpState");
+    if (pump_state_obj != NULL && cJSON_IsBool(pump_state_obj)) {
+        bool requested_state = cJSON_IsTrue(pump_state_obj);
+        ESP_LOGI(TAG, "📱 pumpState local [canal %d]: %s", channel, requested_state ? "true" : "false");
+        if (requested_state && node_tank_locked(node)) {
+            ESP_LOGW(TAG, "Tanque en %.1f%%, bomba bloqueada", node->tank_level);
+            return ZONE_LOCAL_TANK_LOCKED;
+        }
+        apply_manual_pump(node, channel, requested_state);
+    }
+
+    // Un cambio de autoMode o umbral se aplica ya, sin esperar al próximo ciclo
+    zone_apply_auto_mode(node, channel);
+    return ZONE_LOCAL_OK;
+}
@@ -0,0 +1,155 @@
+/*
+ * AgroMind - Estado del nodo y lógica de control de zonas
+ *
+ * Reglas de bomba, modo automático y aplicación de "commands" del servidor,
+ * independientes del hardware: el efecto físico (relé, NVS, mDNS) se delega
+ * en los hooks. El firmware tiene una única instancia; las herramientas de
+ * host (esp32-idf/host) crean miles para simular una flota.
+ *
+ * Cada canal mide el tiempo exacto de bomba (pump_meter_t) y lleva su
+ * modelo de respuesta del suelo (soil_model.h): las
+ * lecturas entran por zone_observe_moisture() y el modo automático lo usa
+ * para dimensionar cada riego.
+ *
+ * Cada zona puede tener una regla del usuario (rule_vm.h) que llega en
+ * "commands.rule": se evalúa con cada lectura y, si da falso, el modo
+ * automático no inicia el riego (ruleBlocked viaja en la subida para que
+ * el backend tampoco lo ordene).
+ *
+ * La configuración llega por dos caminos: los "commands" de cada subida y
+ * la API local del nodo (zone_apply_local_commands). Un cambio local queda
+ * pendiente (config_pending) y viaja en las subidas hasta que la respuesta
+ * del servidor lo confirma; mientras tanto la config del servidor no lo pisa.
+ *
+ * Solo depende de FreeRTOS (ticks), esp_log y cJSON, que en el host
+ * provee esp32-idf/host/shim.
+ */
+
+#ifndef ZONE_CONTROL_H
+#define ZONE_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "cJSON.h"
+#include "sensor_filter.h"
+#include "soil_model.h"
+#include "rule_vm.h"
+
+#define MAX_ZONE_CHANNELS 8
+
+#define MOISTURE_HYSTERESIS 5.0f
+#define MIN_TANK_PERCENTAGE 5.0f
+#define DEFAULT_PUMP_FLOW_LPH 120.0f
+
+// Contador de riego de un canal, con marcas de esp_timer (µs) tomadas en
+// zone_set_pump_state. Los totales se persisten (el firmware los guarda en
+// NVS de forma agrupada, ver dirty) y viajan en cada subida: el backend
+// suma la diferencia con lo último que recibió.
+typedef struct {
+    uint64_t total_runtime_us;
+    uint32_t sessions;                  // riegos completados
+    uint32_t last_session_us;
+    int64_t on_since_us;                // 0 = bomba apagada
+    bool dirty;                         // cambió desde la última persistencia
+} pump_meter_t;
+
+// Estado de cada zona controlada por el nodo (índice = canal)
+typedef struct {
+    int32_t zone_id;                    // 0 = canal sin vincular (guardado en NVS)
+    bool pump_state;
+    bool auto_mode_enabled;
+    float moisture_threshold;
+    uint32_t watering_duration;
+    bool auto_watering_active;
+    TickType_t auto_watering_deadline;
+    float last_soil_moisture;
+    sensor_quality_t soil_quality;
+    pump_meter_t meter;
+    soil_model_t soil;
+    uint32_t planned_duration_s;        // duración del último auto-riego
+    bool config_pending;                // cambio local sin confirmar por el servidor
+    rule_program_t rule;                // regla verificada (guardada en NVS)
+    bool rule_blocked;                  // la última evaluación impidió regar
+    uint32_t rule_rejected_hash;        // "rule" que no pasó la verificación
+} zone_state_t;
+
+// Resultado de un comando de la API local
+typedef enum {
+    ZONE_LOCAL_OK,
+    ZONE_LOCAL_UNPAIRED,                // canal sin zona vinculada
+    ZONE_LOCAL_TANK_LOCKED,             // se pidió encender la bomba con el tanque vacío
+} zone_local_result_t;
+
+// Efectos externos. Cualquiera puede ser NULL.
+typedef struct {
+    void (*set_relay)(void *ctx, int channel, bool on);
+    // El servidor respondió 404: el canal ya quedó libre en el estado,
+    // el hook solo persiste (NVS) y anuncia el cambio
+    void (*zone_released)(void *ctx, int channel);
+    // El modelo del suelo del canal aprendió: persistir sus parámetros
+    void (*soil_model_updated)(void *ctx, int channel);
+    // Llegó otra regla (o se quitó): persistirla
+    void (*rule_updated)(void *ctx, int channel);
+    void *ctx;
+} node_hooks_t;
+
+typedef struct {
+    zone_state_t zones[MAX_ZONE_CHANNELS];
+    int channel_count;
+
+    // Sensores compartidos por todas las zonas (última lectura)
+    float temperature_c;
+    float ambient_humidity;
+    float tank_level;
+    float light_level;
+    sensor_quality_t temperature_quality;
+    sensor_quality_t humidity_quality;
+    sensor_quality_t tank_quality;
+    sensor_quality_t light_quality;
+
+    float pump_flow_lph;                // caudal de las bombas (litros/hora)
+    int64_t meters_flushed_us;          // última escritura de contadores (node_storage.h)
+
+    // Versión del estado visible (caché de /info); cambia con cada mutación
+    volatile uint32_t state_version;
+
+    node_hooks_t hooks;
+} node_state_t;
+
+void node_state_init(node_state_t *node, int channel_count, const node_hooks_t *hooks);
+void node_state_touch(node_state_t *node);
+
+int node_configured_zone_count(const node_state_t *node);
+int node_find_channel(const node_state_t *node, int32_t zone_id);
+
+void zone_set_pump_state(node_state_t *node, int channel, bool state);
+// Litros acumulados del canal según su tiempo de bomba y el caudal
+double zone_pump_liters(const node_state_t *node, int channel);
+// Libera un canal (zona borrada en el servidor): bomba apagada y zone_id = 0
+void zone_release(node_state_t *node, int channel);
+
+// Nueva lectura (filtrada) de humedad del canal. Solo las muestras frescas
+// actualizan el modelo del suelo; con INVALID el modo automático no riega.
+void zone_observe_moisture(node_state_t *node, int channel, float moisture, sensor_quality_t quality);
+
+// Bloqueo por tanque vacío, la misma regla que aplica el servidor (tankLocked)
+bool node_tank_locked(const node_state_t *node);
+
+// Devuelve true si cambió autoMode, moistureThreshold o wateringDuration
+bool zone_update_configuration(node_state_t *node, int channel, const cJSON *commands);
+void zone_apply_commands(node_state_t *node, int channel, const cJSON *commands);
+// Comando de la API local con el mismo formato que "commands" (sin
+// tankLocked: el bloqueo se decide con el nivel de tanque del nodo)
+zone_local_result_t zone_apply_local_commands(node_state_t *node, int channel, const cJSON *commands);
+void zone_apply_auto_mode(node_state_t *node, int channel);
+void zone_apply_auto_mode_all(node_state_t *node);
+
+// Control rápido mientras la bomba del canal está encendida, con lecturas
+// de suelo y tanque recién tomadas: apaga en cuanto el auto-riego llega a
+// umbral + histéresis o vence, y cualquier riego si el tanque se bloquea.
+// No inicia riegos (eso sigue en zone_apply_auto_mode, a ritmo normal).
+void zone_fast_control(node_state_t *node, int channel);
+bool node_any_pump_on(const node_state_t *node);
+
+#endif // ZONE_CONTROL_H
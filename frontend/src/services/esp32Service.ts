@@ -274,37 +274,6 @@ class ESP32Service {
         return null;
     }
 
-    /**
-     * Empareja un ESP32 con una zona específica
-     */
-    async pairESP32(ip: string, zoneId: number): Promise<{ success: boolean; message: string }> {
-        try {
-            console.log(`🔗 Emparejando ESP32 en ${ip} con zona ${zoneId}...`);
-            
-            const response = await fetch(`http://${ip}/pair`, {
-                method: 'POST',
-                headers: {
-                    'Content-Type': 'application/json',
-                },
-                body: JSON.stringify({ zoneId }),
-            });
-
-            if (!response.ok) {
-                throw new Error(`Error HTTP: ${response.status}`);
-            }
-
-            const data = await response.json();
-            console.log(`✅ ESP32 emparejado: ${data.message}`);
-            return { success: data.success, message: data.message };
-        } catch (error) {
-            console.error('❌ Error emparejando ESP32:', error);
-            return { 
-                success: false, 
-                message: error instanceof Error ? error.message : 'Error de conexión' 
-            };
-        }
-    }
-
     /**
      * Prueba conexión directa a un ESP32 por IP
      */
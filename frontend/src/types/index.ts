@@ -30,6 +30,8 @@ export interface ZoneConfig {
     respectRainForecast: boolean;
     schedules?: WateringSchedule[];
     vacationMode?: VacationMode;
+    rule?: string;          // p. ej. "light < 70 and temperature >= 10"; vacía = sin regla
+    ruleBytecode?: string;  // lo compila el backend, no se edita
 }
 
 export interface ZoneSensors {
@@ -229,7 +229,7 @@ export default function AddZoneScreen() {
             
             if (manualIP.trim()) {
                 const device = await ESP32Service.testESP32Connection(manualIP.trim());
-                if (device && !device.configured) {
+                if (device && ESP32Service.getFreeChannel(device) !== null) {
                     devices = [device];
                 }
             }
@@ -237,15 +237,15 @@ export default function AddZoneScreen() {
             // Si no hay IP manual o no se encontró, escanear la red
             if (devices.length === 0) {
                 devices = await ESP32Service.scanForESP32Devices();
-                // Filtrar solo dispositivos sin configurar
-                devices = devices.filter(d => !d.configured);
+                // Filtrar solo dispositivos con algún canal libre
+                devices = devices.filter(d => ESP32Service.getFreeChannel(d) !== null);
             }
             
             setDiscoveredDevices(devices);
             
             if (devices.length === 0) {
                 setConnectionStep('error');
-                setErrorMessage('No se encontró ningún ESP32 disponible en la red. Asegúrate de que:\n\n• El ESP32 esté encendido\n• Esté conectado a la misma red WiFi\n• No esté vinculado a otra zona');
+                setErrorMessage('No se encontró ningún ESP32 disponible en la red. Asegúrate de que:\n\n• El ESP32 esté encendido\n• Esté conectado a la misma red WiFi\n• Tenga algún canal sin vincular');
                 return;
             }
             
@@ -281,8 +281,12 @@ export default function AddZoneScreen() {
                 useNativeDriver: false,
             }).start();
             
-            // Emparejar el ESP32 con la zona
-            const pairResult = await ESP32Service.pairESP32(device.ip, zoneId);
+            // Emparejar la zona con el primer canal libre del ESP32
+            const channel = ESP32Service.getFreeChannel(device);
+            if (channel === null) {
+                throw new Error('El ESP32 ya no tiene canales libres');
+            }
+            const pairResult = await ESP32Service.pairESP32(device.ip, zoneId, channel);
             
             if (!pairResult.success) {
                 throw new Error(pairResult.message || 'Error al emparejar el ESP32');
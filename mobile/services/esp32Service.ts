@@ -1,8 +1,28 @@
+import AsyncStorage from '@react-native-async-storage/async-storage';
 import { API_CONFIG } from '../constants/api';
 import { ZoneConfig, ZoneSensors, ZoneStatus } from '../types';
 
 const getZoneDetailUrl = (zoneId: number) => `${API_CONFIG.BASE_URL}/zones/detail/${zoneId}`;
 
+// IP, canal y token de la API local del ESP32 que controla cada zona
+const LOCAL_LINK_PREFIX = 'esp32Local:';
+const getLocalLinkKey = (zoneId: number) => `${LOCAL_LINK_PREFIX}${zoneId}`;
+const LOCAL_CONTROL_TIMEOUT_MS = 1500;
+
+interface ESP32LocalLink {
+    ip: string;
+    channel: number;
+    token: string;
+}
+
+// Mismo formato que los "commands" del servidor
+export interface ESP32LocalCommand {
+    pumpState?: boolean;
+    autoMode?: boolean;
+    moistureThreshold?: number;
+    wateringDuration?: number;
+}
+
 export interface ESP32SensorData {
     temperature?: number | null;
     soilMoisture?: number | null;
@@ -11,6 +31,13 @@ export interface ESP32SensorData {
     pumpStatus?: boolean;
 }
 
+// Entrada de "channels" en /info: un ESP32 puede regar varias zonas
+export interface ESP32ChannelInfo {
+    channel: number;
+    zoneId: number;
+    configured: boolean;
+}
+
 export interface ESP32DeviceInfo {
     ip: string;
     device: string;
@@ -18,6 +45,7 @@ export interface ESP32DeviceInfo {
     zoneId: number;
     configured: boolean;
     pumpState: boolean;
+    channels: ESP32ChannelInfo[];
     sensors: {
         temperature: number;
         humidity: number;
@@ -131,9 +159,53 @@ class ESP32Service {
     }
 
     /**
-     * Controla el estado de la bomba
+     * Envía un comando directo al ESP32 por la red local (POST /control).
+     * Devuelve false si no hay enlace guardado, no responde o lo rechaza
+     * (por ejemplo con el tanque vacío).
+     */
+    async sendLocalCommand(zoneId: number, command: ESP32LocalCommand): Promise<boolean> {
+        const stored = await AsyncStorage.getItem(getLocalLinkKey(zoneId));
+        if (!stored) {
+            return false;
+        }
+        const link: ESP32LocalLink = JSON.parse(stored);
+        try {
+            const controller = new AbortController();
+            const timeoutId = setTimeout(() => controller.abort(), LOCAL_CONTROL_TIMEOUT_MS);
+            const response = await fetch(`http://${link.ip}/control`, {
+                method: 'POST',
+                headers: {
+                    'Content-Type': 'application/json',
+                    'Authorization': `Bearer ${link.token}`,
+                },
+                body: JSON.stringify({ channel: link.channel, ...command }),
+                signal: controller.signal,
+            });
+            clearTimeout(timeoutId);
+            return response.ok;
+        } catch (error) {
+            return false;
+        }
+    }
+
+    /**
+     * Cambia umbral, duración o modo automático directamente en el ESP32;
+     * el ESP32 la sincroniza con el servidor en sus próximas subidas
+     */
+    async updateZoneConfigLocal(zoneId: number, config: Omit<ESP32LocalCommand, 'pumpState'>): Promise<boolean> {
+        return this.sendLocalCommand(zoneId, config);
+    }
+
+    /**
+     * Controla el estado de la bomba: primero por la red local y, si el
+     * ESP32 no está al alcance, a través del servidor
      */
     async togglePump(zoneId: number, state: boolean): Promise<boolean> {
+        if (await this.sendLocalCommand(zoneId, { pumpState: state })) {
+            console.log(`💧 Bomba ${state ? 'encendida' : 'apagada'} para zona ${zoneId} (red local)`);
+            return true;
+        }
+
         try {
             const response = await fetch(`${API_CONFIG.BASE_URL}/zones/${zoneId}/pump`, {
                 method: 'POST',
@@ -282,6 +354,13 @@ class ESP32Service {
                         zoneId: data.zoneId || 0,
                         configured: data.configured || false,
                         pumpState: data.pumpState || false,
+                        channels: Array.isArray(data.channels)
+                            ? data.channels.map((entry: any) => ({
+                                channel: entry.channel,
+                                zoneId: entry.zoneId || 0,
+                                configured: entry.configured || false,
+                            }))
+                            : [],
                         sensors: data.sensors || { temperature: 0, humidity: 0, soilMoisture: 0, tankLevel: 0 }
                     };
                 }
@@ -292,26 +371,65 @@ class ESP32Service {
         return null;
     }
 
+    /**
+     * Primer canal sin zona del ESP32, o null si están todos vinculados.
+     * Un firmware sin "channels" en /info tiene un único canal, el 0
+     */
+    getFreeChannel(device: ESP32DeviceInfo): number | null {
+        if (device.channels.length === 0) {
+            return device.configured ? null : 0;
+        }
+        const free = device.channels.find(entry => !entry.configured);
+        return free ? free.channel : null;
+    }
+
+    /**
+     * Token guardado de otra zona del mismo ESP32: el ESP32 solo lo entrega
+     * en el primer emparejamiento y lo pide para cambiar canales vinculados
+     */
+    private async findLocalToken(ip: string): Promise<string | null> {
+        const keys = (await AsyncStorage.getAllKeys()).filter(key => key.startsWith(LOCAL_LINK_PREFIX));
+        for (const [, stored] of await AsyncStorage.multiGet(keys)) {
+            if (stored) {
+                const link: ESP32LocalLink = JSON.parse(stored);
+                if (link.ip === ip) {
+                    return link.token;
+                }
+            }
+        }
+        return null;
+    }
+
     /**
      * Empareja un ESP32 con una zona específica
      */
-    async pairESP32(ip: string, zoneId: number): Promise<{ success: boolean; message: string }> {
+    async pairESP32(ip: string, zoneId: number, channel: number = 0): Promise<{ success: boolean; message: string }> {
         try {
             console.log(`🔗 Emparejando ESP32 en ${ip} con zona ${zoneId}...`);
             
+            const token = await this.findLocalToken(ip);
             const response = await fetch(`http://${ip}/pair`, {
                 method: 'POST',
                 headers: {
                     'Content-Type': 'application/json',
+                    ...(token ? { 'Authorization': `Bearer ${token}` } : {}),
                 },
-                body: JSON.stringify({ zoneId }),
+                body: JSON.stringify({ zoneId, channel }),
             });
 
+            if (response.status === 401) {
+                throw new Error('El canal ya está vinculado desde otro dispositivo');
+            }
             if (!response.ok) {
                 throw new Error(`Error HTTP: ${response.status}`);
             }
 
             const data = await response.json();
+            const apiToken = data.apiToken ?? token;
+            if (apiToken) {
+                const link: ESP32LocalLink = { ip, channel: data.channel ?? channel, token: apiToken };
+                await AsyncStorage.setItem(getLocalLinkKey(zoneId), JSON.stringify(link));
+            }
             console.log(`✅ ESP32 emparejado: ${data.message}`);
             return { success: data.success, message: data.message };
         } catch (error) {
@@ -324,14 +442,25 @@ class ESP32Service {
     }
 
     /**
-     * Desempareja un ESP32 (borra su configuración)
+     * Desempareja el canal del ESP32 vinculado a una zona; los demás
+     * canales del mismo ESP32 siguen regando sus zonas
      */
-    async unpairESP32(ip: string): Promise<{ success: boolean; message: string }> {
+    async unpairESP32(zoneId: number): Promise<{ success: boolean; message: string }> {
         try {
-            console.log(`🔓 Desemparejando ESP32 en ${ip}...`);
+            const stored = await AsyncStorage.getItem(getLocalLinkKey(zoneId));
+            if (!stored) {
+                throw new Error('La zona no tiene un ESP32 vinculado desde este dispositivo');
+            }
+            const link: ESP32LocalLink = JSON.parse(stored);
+            console.log(`🔓 Desemparejando canal ${link.channel} del ESP32 en ${link.ip}...`);
             
-            const response = await fetch(`http://${ip}/unpair`, {
+            const response = await fetch(`http://${link.ip}/unpair`, {
                 method: 'POST',
+                headers: {
+                    'Content-Type': 'application/json',
+                    'Authorization': `Bearer ${link.token}`,
+                },
+                body: JSON.stringify({ channel: link.channel }),
             });
 
             if (!response.ok) {
@@ -339,6 +468,7 @@ class ESP32Service {
             }
 
             const data = await response.json();
+            await AsyncStorage.removeItem(getLocalLinkKey(zoneId));
             console.log(`✅ ESP32 desemparejado: ${data.message}`);
             return { success: data.success, message: data.message };
         } catch (error) {
@@ -33,6 +33,8 @@ export interface ZoneConfig {
     weatherAdjust?: boolean;
     schedules?: WateringSchedule[];
     vacationMode?: VacationMode;
+    rule?: string;          // p. ej. "light < 70 and temperature >= 10"; vacía = sin regla
+    ruleBytecode?: string;  // lo compila el backend, no se edita
 }
 
 export interface ZoneSensors {